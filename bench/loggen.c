@@ -0,0 +1,469 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Deterministic synthetic strace and ltrace logs for the parser benchmarks.
+// Lines look like those of "strace -f -ttt -T -o" and "ltrace -f -ttt -o": a pid, a timestamp, the
+// call, its result and, for strace, its duration. The same options and seed always give the same log.
+
+#define LINE_MAX_BYTES 8192
+#define MAX_PIDS 4096
+#define MAX_LIVE 64 // Allocations or mappings per pid that free, realloc and munmap can pick from
+#define MAX_FDS 64
+#define RESERVED_FDS 0x37ull // stdin, stdout, stderr, the epoll fd 4 and the socket fd 5
+#define FUTEX_WORDS 8
+#define MAP_SIZE 262144
+
+typedef enum {
+    RESULT_FIXED,   // ok as written
+    RESULT_LENGTH,  // The length of the string argument
+    RESULT_ADDRESS, // A new address
+    RESULT_FD,      // The lowest free file descriptor of the pid
+} result_kind_t;
+
+typedef enum {
+    STRING_NONE,
+    STRING_PATH,
+    STRING_DATA,
+} string_kind_t;
+
+typedef struct {
+    const char *name;
+    const char *head;     // Arguments before the string; see put_head for the placeholders
+    string_kind_t string;
+    const char *tail;     // Arguments after it; "%zu" is the string's length
+    result_kind_t result;
+    const char *ok;
+    const char *error;    // The result of a failed call, NULL if it cannot fail
+    int weight;
+} call_template_t;
+
+static const call_template_t strace_calls[] = {
+    { "openat", "AT_FDCWD, ", STRING_PATH, ", O_RDONLY|O_CLOEXEC", RESULT_FD, NULL,
+      "-1 ENOENT (No such file or directory)", 10 },
+    { "newfstatat", "AT_FDCWD, ", STRING_PATH, ", {st_mode=S_IFREG|0644, st_size=4096, ...}, 0", RESULT_FIXED, "0",
+      "-1 ENOENT (No such file or directory)", 8 },
+    { "access", "", STRING_PATH, ", R_OK", RESULT_FIXED, "0", "-1 ENOENT (No such file or directory)", 4 },
+    { "read", "%f, ", STRING_DATA, ", 4096", RESULT_LENGTH, NULL, "-1 EAGAIN (Resource temporarily unavailable)", 20 },
+    { "write", "1, ", STRING_DATA, ", %zu", RESULT_LENGTH, NULL, "-1 EPIPE (Broken pipe)", 16 },
+    { "close", "%F", STRING_NONE, "", RESULT_FIXED, "0", "-1 EBADF (Bad file descriptor)", 10 },
+    { "mmap", "NULL, 262144, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0", STRING_NONE, "",
+      RESULT_ADDRESS, NULL, "-1 ENOMEM (Cannot allocate memory)", 6 },
+    { "munmap", "%m, 262144", STRING_NONE, "", RESULT_FIXED, "0", "-1 EINVAL (Invalid argument)", 6 },
+    { "futex", "%w, FUTEX_WAIT_PRIVATE, 2, NULL", STRING_NONE, "", RESULT_FIXED, "0",
+      "-1 EAGAIN (Resource temporarily unavailable)", 8 },
+    { "futex", "%W, FUTEX_WAKE_PRIVATE, 1", STRING_NONE, "", RESULT_FIXED, "1", NULL, 8 },
+    { "recvfrom", "5, ", STRING_DATA, ", 65536, 0, NULL, NULL", RESULT_LENGTH, NULL,
+      "-1 EAGAIN (Resource temporarily unavailable)", 6 },
+    { "epoll_wait", "4, [{events=EPOLLIN, data={u32=5, u64=5}}], 64, 100", STRING_NONE, "", RESULT_FIXED, "1",
+      "-1 EINTR (Interrupted system call)", 6 },
+    { "getpid", "", STRING_NONE, "", RESULT_FIXED, "1234", NULL, 4 },
+};
+
+static const call_template_t ltrace_calls[] = {
+    { "malloc", "%zu", STRING_NONE, "", RESULT_ADDRESS, NULL, "0", 20 },
+    { "free", "%p", STRING_NONE, "", RESULT_FIXED, "<void>", NULL, 18 },
+    { "calloc", "1, %zu", STRING_NONE, "", RESULT_ADDRESS, NULL, "0", 3 },
+    { "realloc", "%p, %zu", STRING_NONE, "", RESULT_ADDRESS, NULL, "0", 3 },
+    { "strlen", "", STRING_DATA, "", RESULT_LENGTH, NULL, NULL, 14 },
+    { "strcmp", "", STRING_DATA, ", \"GET /index.html\"", RESULT_FIXED, "1", NULL, 10 },
+    { "memcpy", "0x55d0c0a1f2a0, 0x55d0c0a1e100, 256", STRING_NONE, "", RESULT_FIXED, "0x55d0c0a1f2a0", NULL, 8 },
+    { "fopen", "", STRING_PATH, ", \"r\"", RESULT_ADDRESS, NULL, "0", 3 },
+    { "fgets", "0x7ffd4e1c2a40, 1024, 0x55d0c0a012a0", STRING_NONE, "", RESULT_FIXED, "0x7ffd4e1c2a40", "0", 6 },
+    { "puts", "", STRING_DATA, "", RESULT_LENGTH, NULL, "-1", 6 },
+};
+
+typedef struct {
+    int ltrace;
+    uint64_t size;
+    int pids;
+    int min_length;
+    int max_length;
+    double unfinished; // Share of calls split into unfinished and resumed halves
+    double errors;     // Share of calls that fail
+    uint64_t seed;
+    const char *output;
+} loggen_options_t;
+
+typedef struct {
+    long pid;
+    int pending;                   // A call is waiting for its resumed half
+    char resumed[LINE_MAX_BYTES];  // That half, after the pid and timestamp
+    uint64_t live[MAX_LIVE];       // Addresses returned and not yet freed or unmapped
+    size_t num_live;
+    uint64_t fds;                  // Open file descriptors, one bit each
+} pid_state_t;
+
+typedef struct {
+    const loggen_options_t *options;
+    const call_template_t *calls;
+    size_t num_calls;
+    int total_weight;
+    int error_weight;
+    uint64_t random;
+    uint64_t clock_us;              // Timestamp of the last line
+    uint64_t next_address;
+    uint64_t next_mapping;
+    int waiters[FUTEX_WORDS];       // Threads blocked in FUTEX_WAIT on each word
+    FILE *out;
+    uint64_t written;
+} generator_t;
+
+static uint64_t next_random(generator_t *gen) {
+    gen->random ^= gen->random << 13;
+    gen->random ^= gen->random >> 7;
+    gen->random ^= gen->random << 17;
+    return gen->random;
+}
+
+static double next_fraction(generator_t *gen) {
+    return (double)(next_random(gen) >> 11) / 9007199254740992.0;
+}
+
+// Line lengths are log-uniform between the bounds: mostly short lines with a long tail
+static size_t next_length(generator_t *gen) {
+    double low = (double)gen->options->min_length;
+    double high = (double)gen->options->max_length;
+    double length = low * pow(high / low, next_fraction(gen));
+    return (size_t)length;
+}
+
+// Appends a quoted string of exactly length characters, quotes included
+static size_t put_string(generator_t *gen, string_kind_t kind, size_t length, char *buf) {
+    static const char path_chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_-./";
+    static const char data_chars[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789=:;,.";
+    size_t used = 0;
+    if (length < 2) {
+        length = 2;
+    }
+    buf[used++] = '"';
+    while (used + 1 < length) {
+        uint64_t r = next_random(gen);
+        if (kind == STRING_DATA && r % 29 == 0 && used + 3 < length) {
+            buf[used++] = '\\'; // An escape such as strace prints for a line break
+            buf[used++] = 'n';
+        } else if (kind == STRING_PATH) {
+            char c = used == 1 ? '/' : path_chars[(r >> 8) % (sizeof(path_chars) - 1)];
+            buf[used++] = c;
+        } else {
+            buf[used++] = data_chars[(r >> 8) % (sizeof(data_chars) - 1)];
+        }
+    }
+    buf[used++] = '"';
+    return used;
+}
+
+static const call_template_t *pick_call(generator_t *gen, int failing) {
+    int pick = (int)(next_random(gen) % (uint64_t)(failing ? gen->error_weight : gen->total_weight));
+    for (size_t i = 0; i < gen->num_calls; i++) {
+        const call_template_t *call = &gen->calls[i];
+        if (failing && call->error == NULL) {
+            continue;
+        }
+        if (pick < call->weight) {
+            return call;
+        }
+        pick -= call->weight;
+    }
+    return &gen->calls[0];
+}
+
+// Calls that take a file, a mapping or a waiter need one to exist, except for a failing close or munmap
+static int can_generate(const generator_t *gen, const pid_state_t *pid, const call_template_t *call, int failing) {
+    if (strstr(call->head, "%f") != NULL) {
+        return (pid->fds & ~RESERVED_FDS) != 0;
+    }
+    if (strstr(call->head, "%F") != NULL) {
+        return failing || (pid->fds & ~RESERVED_FDS) != 0;
+    }
+    if (strstr(call->head, "%m") != NULL) {
+        return failing || pid->num_live > 0;
+    }
+    if (strstr(call->head, "%W") != NULL) {
+        for (int i = 0; i < FUTEX_WORDS; i++) {
+            if (gen->waiters[i] > 0) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+    return 1;
+}
+
+// One of the files the pid has open, picked at random
+static int pick_file(generator_t *gen, const pid_state_t *pid) {
+    uint64_t files = pid->fds & ~RESERVED_FDS;
+    int skip = (int)(next_random(gen) % (uint64_t)__builtin_popcountll(files));
+    while (skip-- > 0) {
+        files &= files - 1;
+    }
+    return __builtin_ctzll(files);
+}
+
+static uint64_t futex_word(int index) {
+    return 0x7f3a2c0008d0ull + (uint64_t)index * 0x40;
+}
+
+// Writes the arguments before the string; returns their length. The placeholders are
+// "%p", an allocation that is freed (ltrace), "%m" a mapping that is unmapped, "%f" an open
+// file, "%F" an open file that is closed, "%w" a futex word waited on, "%W" one with waiters
+// that is woken, and "%zu" a size.
+static size_t put_head(generator_t *gen, pid_state_t *pid, const call_template_t *call, int failing, char *buf,
+                       size_t size) {
+    const char *p = call->head;
+    size_t used = 0;
+    size_t bytes = 16 << (next_random(gen) % 10);
+    while (*p != '\0' && used + 32 < size) {
+        if (p[0] == '%' && (p[1] == 'p' || p[1] == 'm')) {
+            uint64_t address = 0;
+            if (p[1] == 'm' && failing) {
+                address = gen->next_mapping + 1; // Not page aligned, hence EINVAL
+            } else if (pid->num_live > 0) {
+                size_t index = (size_t)(next_random(gen) % pid->num_live);
+                address = pid->live[index];
+                pid->live[index] = pid->live[--pid->num_live];
+            }
+            used += (size_t)snprintf(buf + used, size - used, address ? "0x%llx" : "nil", (unsigned long long)address);
+            p += 2;
+        } else if (p[0] == '%' && (p[1] == 'f' || p[1] == 'F')) {
+            int fd;
+            if (p[1] == 'F' && failing) {
+                fd = pid->fds == ~0ull ? MAX_FDS : __builtin_ctzll(~pid->fds);
+            } else {
+                fd = pick_file(gen, pid);
+                if (p[1] == 'F') {
+                    pid->fds &= ~(1ull << fd);
+                }
+            }
+            used += (size_t)snprintf(buf + used, size - used, "%d", fd);
+            p += 2;
+        } else if (p[0] == '%' && (p[1] == 'w' || p[1] == 'W')) {
+            int index = (int)(next_random(gen) % FUTEX_WORDS);
+            if (p[1] == 'W') {
+                while (gen->waiters[index] == 0) {
+                    index = (index + 1) % FUTEX_WORDS;
+                }
+                gen->waiters[index]--;
+            } else if (!failing) {
+                gen->waiters[index]++;
+            }
+            used += (size_t)snprintf(buf + used, size - used, "0x%llx", (unsigned long long)futex_word(index));
+            p += 2;
+        } else if (p[0] == '%' && p[1] == 'z') {
+            used += (size_t)snprintf(buf + used, size - used, "%zu", bytes);
+            p += 3;
+        } else {
+            buf[used++] = *p++;
+        }
+    }
+    return used;
+}
+
+// Durations are skewed as in real traces: most calls take a few microseconds, a few block for
+// milliseconds and the slowest for up to 100ms. The median is 2us, the 90th percentile 2ms.
+static uint64_t next_duration_us(generator_t *gen) {
+    double fraction = next_fraction(gen);
+    return (uint64_t)pow(100000.0, fraction * fraction * fraction * fraction);
+}
+
+// Writes " = RESULT" and, for strace, the duration
+static size_t put_result(generator_t *gen, pid_state_t *pid, const call_template_t *call, int failing,
+                         size_t string_length, char *buf, size_t size) {
+    size_t used = (size_t)snprintf(buf, size, " = ");
+    if (failing) {
+        used += (size_t)snprintf(buf + used, size - used, "%s", call->error);
+    } else if (call->result == RESULT_LENGTH) {
+        used += (size_t)snprintf(buf + used, size - used, "%zu", string_length > 2 ? string_length - 2 : 0);
+    } else if (call->result == RESULT_ADDRESS) {
+        uint64_t address;
+        if (gen->options->ltrace) {
+            address = gen->next_address += 48;
+        } else {
+            address = gen->next_mapping;
+            gen->next_mapping += MAP_SIZE + 4096; // A gap keeps the mappings apart
+        }
+        if (pid->num_live < MAX_LIVE) {
+            pid->live[pid->num_live++] = address;
+        }
+        used += (size_t)snprintf(buf + used, size - used, "0x%llx", (unsigned long long)address);
+    } else if (call->result == RESULT_FD) {
+        if (pid->fds == ~0ull) {
+            used += (size_t)snprintf(buf + used, size - used, "-1 EMFILE (Too many open files)");
+        } else {
+            int fd = __builtin_ctzll(~pid->fds);
+            pid->fds |= 1ull << fd;
+            used += (size_t)snprintf(buf + used, size - used, "%d", fd);
+        }
+    } else {
+        used += (size_t)snprintf(buf + used, size - used, "%s", call->ok);
+    }
+    if (!gen->options->ltrace) {
+        uint64_t duration = next_duration_us(gen);
+        used += (size_t)snprintf(buf + used, size - used, " <%llu.%06llu>", (unsigned long long)(duration / 1000000),
+                                 (unsigned long long)(duration % 1000000));
+    }
+    return used;
+}
+
+static void emit(generator_t *gen, const pid_state_t *pid, const char *body, size_t length) {
+    gen->clock_us += next_random(gen) % 50 + 1;
+    int prefix = fprintf(gen->out, "%ld %llu.%06llu ", pid->pid, (unsigned long long)(gen->clock_us / 1000000),
+                         (unsigned long long)(gen->clock_us % 1000000));
+    fwrite(body, 1, length, gen->out);
+    fputc('\n', gen->out);
+    gen->written += (uint64_t)prefix + length + 1;
+}
+
+// Emits one call, or the first half of one and keeps the other for later
+static void generate_call(generator_t *gen, pid_state_t *pid) {
+    char line[LINE_MAX_BYTES];
+    int failing = next_fraction(gen) < gen->options->errors;
+    const call_template_t *call = pick_call(gen, failing);
+    while (!can_generate(gen, pid, call, failing)) {
+        call = pick_call(gen, failing);
+    }
+    size_t target = next_length(gen);
+
+    size_t head = (size_t)snprintf(line, sizeof(line), "%s(", call->name);
+    head += put_head(gen, pid, call, failing, line + head, sizeof(line) - head);
+    char result[256];
+    size_t result_length = 0;
+    char tail[256];
+    size_t tail_length = 0;
+    size_t string_length = 0;
+    char *string_at = line + head;
+    if (call->string != STRING_NONE) {
+        // The string takes up whatever the rest of the line leaves of its length
+        size_t fixed = head + strlen(call->tail) + 24 + 24;
+        string_length = target > fixed ? target - fixed : 8;
+        if (string_length > sizeof(line) - head - sizeof(tail) - sizeof(result)) {
+            string_length = sizeof(line) - head - sizeof(tail) - sizeof(result);
+        }
+        string_length = put_string(gen, call->string, string_length, string_at);
+    }
+    tail_length = (size_t)snprintf(tail, sizeof(tail), call->tail, string_length > 2 ? string_length - 2 : 0);
+    result_length = put_result(gen, pid, call, failing, string_length, result, sizeof(result));
+
+    if (next_fraction(gen) < gen->options->unfinished) {
+        // Split after the head, as strace does when another process logs a line in between
+        int n = snprintf(pid->resumed, sizeof(pid->resumed), "<... %s resumed>%s%.*s%s)%.*s", call->name,
+                         gen->options->ltrace ? " " : "", (int)string_length, string_at, tail, (int)result_length, result);
+        if (n > 0 && (size_t)n < sizeof(pid->resumed)) {
+            memcpy(line + head, " <unfinished ...>", 17);
+            emit(gen, pid, line, head + 17);
+            pid->pending = 1;
+            return;
+        }
+    }
+    size_t used = head + string_length;
+    memcpy(line + used, tail, tail_length);
+    used += tail_length;
+    line[used++] = ')';
+    memcpy(line + used, result, result_length);
+    used += result_length;
+    emit(gen, pid, line, used);
+}
+
+static int parse_size(const char *text, uint64_t *size) {
+    char *end;
+    double value = strtod(text, &end);
+    double scale = 1.0;
+    switch (*end) {
+    case 'K': case 'k': scale = 1024.0; end++; break;
+    case 'M': case 'm': scale = 1024.0 * 1024.0; end++; break;
+    case 'G': case 'g': scale = 1024.0 * 1024.0 * 1024.0; end++; break;
+    default: break;
+    }
+    if (end == text || *end != '\0' || value <= 0.0) {
+        return -1;
+    }
+    *size = (uint64_t)(value * scale);
+    return 0;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--format=strace|ltrace] [--size=BYTES[K|M|G]] [--pids=N] [--line-length=MIN:MAX] "
+                    "[--unfinished=PERCENT] [--errors=PERCENT] [--seed=N] [-o FILE]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    loggen_options_t options = { 0, 16 * 1024 * 1024, 4, 60, 300, 0.05, 0.10, 1, NULL };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format=strace") == 0) {
+            options.ltrace = 0;
+        } else if (strcmp(argv[i], "--format=ltrace") == 0) {
+            options.ltrace = 1;
+        } else if (strncmp(argv[i], "--size=", 7) == 0 && parse_size(argv[i] + 7, &options.size) == 0) {
+            continue;
+        } else if (strncmp(argv[i], "--pids=", 7) == 0) {
+            options.pids = atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--line-length=", 14) == 0 &&
+                   sscanf(argv[i] + 14, "%d:%d", &options.min_length, &options.max_length) == 2) {
+            continue;
+        } else if (strncmp(argv[i], "--unfinished=", 13) == 0) {
+            options.unfinished = atof(argv[i] + 13) / 100.0;
+        } else if (strncmp(argv[i], "--errors=", 9) == 0) {
+            options.errors = atof(argv[i] + 9) / 100.0;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            options.seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            options.output = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.pids < 1 || options.pids > MAX_PIDS || options.min_length < 16 ||
+        options.max_length < options.min_length || options.max_length > LINE_MAX_BYTES / 2) {
+        fprintf(stderr, "loggen: --pids takes 1 to %d, --line-length 16 <= MIN <= MAX <= %d\n", MAX_PIDS,
+                LINE_MAX_BYTES / 2);
+        return 1;
+    }
+
+    generator_t gen = { &options, options.ltrace ? ltrace_calls : strace_calls, 0, 0, 0, options.seed * 2654435761u + 1,
+                        1700000000ull * 1000000, 0x55d0c0a00000ull, 0x7f3a2c100000ull, { 0 }, stdout, 0 };
+    gen.num_calls = options.ltrace ? sizeof(ltrace_calls) / sizeof(ltrace_calls[0])
+                                   : sizeof(strace_calls) / sizeof(strace_calls[0]);
+    for (size_t i = 0; i < gen.num_calls; i++) {
+        gen.total_weight += gen.calls[i].weight;
+        gen.error_weight += gen.calls[i].error != NULL ? gen.calls[i].weight : 0;
+    }
+    if (options.output != NULL && (gen.out = fopen(options.output, "w")) == NULL) {
+        perror("loggen: fopen failed");
+        return 1;
+    }
+    pid_state_t *pids = calloc((size_t)options.pids, sizeof(*pids));
+    if (pids == NULL) {
+        perror("loggen: calloc failed");
+        return 1;
+    }
+    for (int p = 0; p < options.pids; p++) {
+        pids[p].pid = 4000 + p * 7;
+        pids[p].fds = RESERVED_FDS;
+    }
+
+    while (gen.written < options.size) {
+        pid_state_t *pid = &pids[next_random(&gen) % (uint64_t)options.pids];
+        if (pid->pending) {
+            emit(&gen, pid, pid->resumed, strlen(pid->resumed));
+            pid->pending = 0;
+        } else {
+            generate_call(&gen, pid);
+        }
+    }
+    // Every split call is completed, so the log holds whole calls only
+    for (int p = 0; p < options.pids; p++) {
+        if (pids[p].pending) {
+            emit(&gen, &pids[p], pids[p].resumed, strlen(pids[p].resumed));
+        }
+    }
+    free(pids);
+    if (gen.out != stdout && fclose(gen.out) != 0) {
+        perror("loggen: fclose failed");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,486 @@
+#define _GNU_SOURCE // For wait4
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "rune_analyzer.h"
+#include "rune_baseline.h"
+#include "rune_latency.h"
+#include "rune_ltrace_parser.h"
+#include "rune_scan.h"
+#include "rune_store.h"
+#include "rune_strace_parser.h"
+
+// Throughput of the parsers and the analyzer on existing logs, such as those of bench/loggen.
+// Every stage runs in a process of its own, so that its peak RSS is its own. The link wraps the
+// allocator (-Wl,--wrap=malloc,...), so that every allocation made by runescope's code is counted;
+// allocations inside libc itself are not. Results can be saved in runescope's baseline format and
+// compared with an earlier save, exiting with status 3 when a stage regressed.
+
+#define DEFAULT_RUNS 5
+#define DEFAULT_THRESHOLD_PERCENT 10.0
+#define REGRESSION_EXIT_STATUS 3
+#define MAX_RUNS 1000
+#define MB (1024.0 * 1024.0)
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static _Atomic uint64_t allocations;
+
+void *__wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+
+// A log to run the stages of one trace kind on
+typedef struct {
+    const char *path;
+    const char *data; // Mapped for the stages that parse from memory
+    size_t len;
+    uint64_t lines;
+} bench_log_t;
+
+typedef struct {
+    const char *name; // Also the metric name prefix in saved results
+    int is_strace;
+    int (*prepare)(const bench_log_t *log, void **context); // Untimed, may be NULL
+    int (*run)(const bench_log_t *log, void *context);      // Timed, once per run
+    void (*cleanup)(void *context);
+} bench_stage_t;
+
+// What a stage process sends back
+typedef struct {
+    int failed;
+    int64_t median_ns;
+    int64_t min_ns;
+    uint64_t allocations; // In one run
+} stage_report_t;
+
+typedef struct {
+    stage_report_t report;
+    long max_rss_kb;
+} stage_result_t;
+
+static int64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Parsers deliver into these, so that nothing they produce goes unused
+static void count_strace_entry(const strace_entry_t *entry, void *user_data) {
+    *(uint64_t *)user_data += (uint64_t)entry->return_value + entry->syscall_name.len;
+}
+
+static void count_ltrace_entry(const ltrace_entry_t *entry, void *user_data) {
+    *(uint64_t *)user_data += (uint64_t)entry->return_value + entry->function_name.len;
+}
+
+// The line parsers alone: no stitching of unfinished calls, nothing stored
+static int run_strace_lines(const bench_log_t *log, void *context) {
+    (void)context;
+    uint64_t parsed = 0;
+    for (const char *p = log->data, *end = log->data + log->len; p < end;) {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        size_t len = newline != NULL ? (size_t)(newline - p) : (size_t)(end - p);
+        strace_entry_t entry;
+        parsed += rune_strace_parser_parse_line(p, len, &entry) != RUNE_LINE_INVALID;
+        p += len + 1;
+    }
+    return parsed > 0 ? 0 : -1;
+}
+
+static int run_ltrace_lines(const bench_log_t *log, void *context) {
+    (void)context;
+    uint64_t parsed = 0;
+    for (const char *p = log->data, *end = log->data + log->len; p < end;) {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        size_t len = newline != NULL ? (size_t)(newline - p) : (size_t)(end - p);
+        ltrace_entry_t entry;
+        parsed += rune_ltrace_parser_parse_line(p, len, &entry) != RUNE_LINE_INVALID;
+        p += len + 1;
+    }
+    return parsed > 0 ? 0 : -1;
+}
+
+// The parsers with stitching, delivering complete entries
+static int run_strace_parse(const bench_log_t *log, void *context) {
+    (void)context;
+    uint64_t sum = 0;
+    return rune_strace_parser_parse_buffer(log->data, log->len, count_strace_entry, &sum);
+}
+
+static int run_ltrace_parse(const bench_log_t *log, void *context) {
+    (void)context;
+    uint64_t sum = 0;
+    return rune_ltrace_parser_parse_buffer(log->data, log->len, count_ltrace_entry, &sum);
+}
+
+// Parsing into the event store
+static int build_store(const bench_log_t *log, int is_strace, rune_store_t *store) {
+    if (rune_store_init(store) == -1) {
+        return -1;
+    }
+    int result = is_strace ? rune_strace_parser_parse_buffer(log->data, log->len, rune_store_add_strace_entry, store)
+                           : rune_ltrace_parser_parse_buffer(log->data, log->len, rune_store_add_ltrace_entry, store);
+    if (result == -1 || store->failed) {
+        rune_store_free(store);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_strace_store(const bench_log_t *log, void *context) {
+    (void)context;
+    rune_store_t store;
+    if (build_store(log, 1, &store) == -1) {
+        return -1;
+    }
+    rune_store_free(&store);
+    return 0;
+}
+
+static int run_ltrace_store(const bench_log_t *log, void *context) {
+    (void)context;
+    rune_store_t store;
+    if (build_store(log, 0, &store) == -1) {
+        return -1;
+    }
+    rune_store_free(&store);
+    return 0;
+}
+
+// The summary scans over a store built beforehand
+static int prepare_store(const bench_log_t *log, int is_strace, void **context) {
+    rune_store_t *store = malloc(sizeof(*store));
+    if (store == NULL || build_store(log, is_strace, store) == -1) {
+        free(store);
+        return -1;
+    }
+    *context = store;
+    return 0;
+}
+
+static int prepare_strace_store(const bench_log_t *log, void **context) {
+    return prepare_store(log, 1, context);
+}
+
+static int prepare_ltrace_store(const bench_log_t *log, void **context) {
+    return prepare_store(log, 0, context);
+}
+
+static int run_scan(const bench_log_t *log, void *context) {
+    (void)log;
+    const rune_store_t *store = context;
+    unsigned long *calls = calloc(store->names.count + 1, sizeof(*calls));
+    unsigned long *errors = calloc(store->names.count + 1, sizeof(*errors));
+    size_t num_pids;
+    rune_store_pid_stat_t *pids = NULL;
+    int result = -1;
+    if (calls != NULL && errors != NULL) {
+        rune_store_count_by_name(store, calls, errors);
+        pids = rune_store_count_by_pid(store, &num_pids);
+        result = pids != NULL ? 0 : -1;
+    }
+    free(calls);
+    free(errors);
+    free(pids);
+    return result;
+}
+
+static void free_store(void *context) {
+    rune_store_free(context);
+    free(context);
+}
+
+// The whole analysis as runescope runs it, report included (stdout goes to /dev/null)
+static int run_strace_analyze(const bench_log_t *log, void *context) {
+    (void)context;
+    return rune_analyzer_analyze_strace(log->path, NULL);
+}
+
+static int run_strace_analyze_all(const bench_log_t *log, void *context) {
+    (void)context;
+    rune_analyzer_options_t options = {0};
+    options.latency = 1;
+    options.futex = 1;
+    options.io = 1;
+    return rune_analyzer_analyze_strace(log->path, &options);
+}
+
+static int run_ltrace_analyze(const bench_log_t *log, void *context) {
+    (void)context;
+    return rune_analyzer_analyze_ltrace(log->path, NULL);
+}
+
+static int run_ltrace_analyze_alloc(const bench_log_t *log, void *context) {
+    (void)context;
+    rune_analyzer_options_t options = {0};
+    options.alloc = 1;
+    return rune_analyzer_analyze_ltrace(log->path, &options);
+}
+
+static const bench_stage_t stages[] = {
+    { "strace.parse_line", 1, NULL, run_strace_lines, NULL },
+    { "strace.parse", 1, NULL, run_strace_parse, NULL },
+    { "strace.store", 1, NULL, run_strace_store, NULL },
+    { "strace.scan", 1, prepare_strace_store, run_scan, free_store },
+    { "strace.analyze", 1, NULL, run_strace_analyze, NULL },
+    { "strace.analyze_all", 1, NULL, run_strace_analyze_all, NULL },
+    { "ltrace.parse_line", 0, NULL, run_ltrace_lines, NULL },
+    { "ltrace.parse", 0, NULL, run_ltrace_parse, NULL },
+    { "ltrace.store", 0, NULL, run_ltrace_store, NULL },
+    { "ltrace.scan", 0, prepare_ltrace_store, run_scan, free_store },
+    { "ltrace.analyze", 0, NULL, run_ltrace_analyze, NULL },
+    { "ltrace.analyze_alloc", 0, NULL, run_ltrace_analyze_alloc, NULL },
+};
+
+#define NUM_STAGES (sizeof(stages) / sizeof(stages[0]))
+
+static int compare_ns(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Runs in the stage process: one warmup run, then the measured ones
+static stage_report_t measure_stage(const bench_stage_t *stage, const bench_log_t *log, int runs) {
+    stage_report_t report = { 1, 0, 0, 0 };
+    int64_t times[MAX_RUNS];
+    void *context = NULL;
+    if (stage->prepare != NULL && stage->prepare(log, &context) == -1) {
+        return report;
+    }
+    if (stage->run(log, context) == -1) {
+        if (stage->cleanup != NULL) {
+            stage->cleanup(context);
+        }
+        return report;
+    }
+    for (int r = 0; r < runs; r++) {
+        atomic_store(&allocations, 0);
+        int64_t started = clock_ns();
+        if (stage->run(log, context) == -1) {
+            break;
+        }
+        times[r] = clock_ns() - started;
+        if (r == 0) {
+            report.allocations = atomic_load(&allocations);
+        }
+        if (r == runs - 1) {
+            report.failed = 0;
+        }
+    }
+    if (stage->cleanup != NULL) {
+        stage->cleanup(context);
+    }
+    if (!report.failed) {
+        qsort(times, (size_t)runs, sizeof(times[0]), compare_ns);
+        report.median_ns = runs % 2 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2;
+        report.min_ns = times[0];
+    }
+    return report;
+}
+
+static int run_stage(const bench_stage_t *stage, const bench_log_t *log, int runs, stage_result_t *result) {
+    int report_pipe[2];
+    if (pipe(report_pipe) == -1) {
+        perror("parse_bench: pipe failed");
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("parse_bench: fork failed");
+        close(report_pipe[0]);
+        close(report_pipe[1]);
+        return -1;
+    } else if (pid == 0) {
+        close(report_pipe[0]);
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd != -1) {
+            dup2(null_fd, STDOUT_FILENO); // The analyzer prints its report
+            close(null_fd);
+        }
+        stage_report_t report = measure_stage(stage, log, runs);
+        _exit(write(report_pipe[1], &report, sizeof(report)) == (ssize_t)sizeof(report) ? 0 : 1);
+    }
+
+    close(report_pipe[1]);
+    ssize_t n;
+    while ((n = read(report_pipe[0], &result->report, sizeof(result->report))) == -1 && errno == EINTR) {
+    }
+    close(report_pipe[0]);
+    int status;
+    struct rusage ru;
+    while (wait4(pid, &status, 0, &ru) == -1) {
+        if (errno != EINTR) {
+            perror("parse_bench: wait4 failed");
+            return -1;
+        }
+    }
+    result->max_rss_kb = ru.ru_maxrss;
+    if (n != (ssize_t)sizeof(result->report) || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        result->report.failed) {
+        fprintf(stderr, "parse_bench: stage %s failed\n", stage->name);
+        return -1;
+    }
+    return 0;
+}
+
+static int open_log(const char *path, bench_log_t *log) {
+    log->path = path;
+    if (rune_scan_map_file(path, "benchmark log", &log->data, &log->len) == -1) {
+        return -1;
+    }
+    if (log->data == NULL) {
+        fprintf(stderr, "parse_bench: %s is empty\n", path);
+        return -1;
+    }
+    log->lines = 0;
+    for (const char *p = log->data, *end = log->data + log->len;
+         (p = memchr(p, '\n', (size_t)(end - p))) != NULL; p++) {
+        log->lines++;
+    }
+    return 0;
+}
+
+static void print_log(const char *kind, const bench_log_t *log) {
+    printf("%s log: %s, %.1fMB, %llu lines\n", kind, log->path, (double)log->len / MB, (unsigned long long)log->lines);
+}
+
+static int add_metrics(rune_baseline_t *results, const bench_stage_t *stage, const bench_log_t *log,
+                       const stage_result_t *result) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s.time_per_mb_ns", stage->name);
+    if (rune_baseline_add(results, name, (double)result->report.median_ns * MB / (double)log->len) == -1) {
+        return -1;
+    }
+    snprintf(name, sizeof(name), "%s.allocs_per_kline", stage->name);
+    if (rune_baseline_add(results, name, 1000.0 * (double)result->report.allocations / (double)log->lines) == -1) {
+        return -1;
+    }
+    snprintf(name, sizeof(name), "%s.max_rss_kb", stage->name);
+    return rune_baseline_add(results, name, (double)result->max_rss_kb);
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--runs=N] [--save=FILE] [--compare=FILE [--threshold=PERCENT]] "
+                    "[--strace=LOG] [--ltrace=LOG]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    const char *strace_path = NULL;
+    const char *ltrace_path = NULL;
+    const char *save_path = NULL;
+    const char *compare_path = NULL;
+    double threshold = DEFAULT_THRESHOLD_PERCENT;
+    int runs = DEFAULT_RUNS;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--strace=", 9) == 0) {
+            strace_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "--ltrace=", 9) == 0) {
+            ltrace_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "--runs=", 7) == 0) {
+            runs = atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--save=", 7) == 0) {
+            save_path = argv[i] + 7;
+        } else if (strncmp(argv[i], "--compare=", 10) == 0) {
+            compare_path = argv[i] + 10;
+        } else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+            threshold = atof(argv[i] + 12);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((strace_path == NULL && ltrace_path == NULL) || runs < 1 || runs > MAX_RUNS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bench_log_t logs[2] = {{0}}; // ltrace, strace: indexed by is_strace
+    if ((ltrace_path != NULL && open_log(ltrace_path, &logs[0]) == -1) ||
+        (strace_path != NULL && open_log(strace_path, &logs[1]) == -1)) {
+        return 1;
+    }
+    rune_baseline_t results;
+    if (rune_baseline_init(&results) == -1) {
+        return 1;
+    }
+
+    printf("--- Parser benchmarks (median of %d runs after 1 warmup) ---\n", runs);
+    if (strace_path != NULL) {
+        print_log("strace", &logs[1]);
+    }
+    if (ltrace_path != NULL) {
+        print_log("ltrace", &logs[0]);
+    }
+    printf("%-22s %10s %10s %10s %10s %12s\n", "stage", "median", "lines/s", "MB/s", "peak RSS", "allocs/line");
+    int status = 0;
+    for (size_t s = 0; s < NUM_STAGES && status == 0; s++) {
+        const bench_log_t *log = &logs[stages[s].is_strace];
+        if (log->path == NULL) {
+            continue;
+        }
+        stage_result_t result;
+        if (run_stage(&stages[s], log, runs, &result) == -1) {
+            status = 1;
+            break;
+        }
+        char median[32];
+        double seconds = (double)result.report.median_ns / 1e9;
+        printf("%-22s %10s %9.2fM %10.1f %8.1fMB %12.3f\n", stages[s].name,
+               rune_latency_format(result.report.median_ns, median, sizeof(median)),
+               seconds > 0.0 ? (double)log->lines / seconds / 1e6 : 0.0,
+               seconds > 0.0 ? (double)log->len / MB / seconds : 0.0, (double)result.max_rss_kb / 1024.0,
+               (double)result.report.allocations / (double)log->lines);
+        fflush(stdout);
+        if (add_metrics(&results, &stages[s], log, &result) == -1) {
+            status = 1;
+        }
+    }
+
+    if (status == 0 && save_path != NULL) {
+        if (rune_baseline_save(&results, save_path) == 0) {
+            printf("Results written to: %s\n", save_path);
+        } else {
+            status = 1;
+        }
+    }
+    rune_baseline_t saved;
+    if (status == 0 && compare_path != NULL && rune_baseline_init(&saved) == 0) {
+        rune_baseline_thresholds_t thresholds = { threshold, NULL, 0 };
+        int regressions = rune_baseline_load(&saved, compare_path) == 0
+                              ? rune_baseline_compare(&saved, &results, &thresholds, stdout)
+                              : -1;
+        status = regressions < 0 ? 1 : (regressions > 0 ? REGRESSION_EXIT_STATUS : 0);
+        rune_baseline_free(&saved);
+    }
+    rune_baseline_free(&results);
+    for (int k = 0; k < 2; k++) {
+        if (logs[k].data != NULL) {
+            rune_scan_unmap_file(logs[k].data, logs[k].len);
+        }
+    }
+    return status;
+}
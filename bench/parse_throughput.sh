@@ -0,0 +1,24 @@
+#!/bin/sh
+# Generates an strace and an ltrace log of the given size with loggen and
+# measures every parser and analyzer stage on them with parse_bench. Further
+# arguments go to parse_bench, e.g. --save=FILE or --compare=FILE.
+#
+# Usage: bench/parse_throughput.sh [size] [parse_bench options]
+
+SIZE=${1:-64M}
+[ $# -gt 0 ] && shift
+DIR=$(dirname "$0")
+LOGGEN="$DIR/loggen"
+PARSE_BENCH="$DIR/parse_bench"
+
+if [ ! -x "$LOGGEN" ] || [ ! -x "$PARSE_BENCH" ]; then
+    echo "parse_throughput: build with 'make bench' first" >&2
+    exit 1
+fi
+
+LOGS=$(mktemp -d) || exit 1
+trap 'rm -rf "$LOGS"' EXIT INT TERM
+
+"$LOGGEN" --format=strace --size="$SIZE" -o "$LOGS/strace.log" || exit 1
+"$LOGGEN" --format=ltrace --size="$SIZE" -o "$LOGS/ltrace.log" || exit 1
+"$PARSE_BENCH" --strace="$LOGS/strace.log" --ltrace="$LOGS/ltrace.log" "$@"
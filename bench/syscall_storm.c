@@ -0,0 +1,25 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Syscall-heavy workload for measuring tracing overhead.
+// Each iteration makes four syscalls, only one of which (openat) is in the %file class.
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 100000;
+
+    for (long i = 0; i < iterations; i++) {
+        getppid();
+        int fd = open("/dev/null", O_WRONLY);
+        if (fd == -1) {
+            perror("syscall_storm: open failed");
+            return 1;
+        }
+        if (write(fd, "x", 1) != 1) {
+            perror("syscall_storm: write failed");
+        }
+        close(fd);
+    }
+    return 0;
+}
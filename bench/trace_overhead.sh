@@ -0,0 +1,49 @@
+#!/bin/sh
+# Compares the overhead of the strace child in rune_exec.c against the native
+# ptrace/seccomp tracer, on a syscall-heavy workload.
+#
+# Usage: bench/trace_overhead.sh [iterations]
+
+ITERATIONS=${1:-100000}
+DIR=$(dirname "$0")
+RUNESCOPE="$DIR/../runescope"
+STORM="$DIR/syscall_storm"
+
+if [ ! -x "$RUNESCOPE" ] || [ ! -x "$STORM" ]; then
+    echo "trace_overhead: build with 'make bench-trace' first" >&2
+    exit 1
+fi
+
+now() {
+    date +%s.%N
+}
+
+# Runs a command with all output discarded and prints its wall time in seconds
+measure() {
+    start=$(now)
+    "$@" > /dev/null 2>&1
+    end=$(now)
+    echo "$start $end" | awk '{ printf "%.3f", $2 - $1 }'
+}
+
+report() {
+    label=$1
+    seconds=$2
+    ratio=$(echo "$seconds $BASELINE" | awk '{ printf "%.1f", $1 / $2 }')
+    printf "%-40s %8s s  %6sx\n" "$label" "$seconds" "$ratio"
+}
+
+echo "Workload: $STORM $ITERATIONS ($((ITERATIONS * 4)) syscalls)"
+BASELINE=$(measure "$STORM" "$ITERATIONS")
+report "untraced" "$BASELINE"
+
+if command -v strace > /dev/null 2>&1; then
+    report "runescope -s (strace, all syscalls)" "$(measure "$RUNESCOPE" -s "$STORM" "$ITERATIONS")"
+    report "strace -f -e trace=file" "$(measure strace -f -o /dev/null -e trace=file "$STORM" "$ITERATIONS")"
+else
+    echo "strace not found, skipping the strace runs"
+fi
+
+report "runescope -n (native, all syscalls)" "$(measure "$RUNESCOPE" -n "$STORM" "$ITERATIONS")"
+report "runescope --trace=file (native)" "$(measure "$RUNESCOPE" --trace=file "$STORM" "$ITERATIONS")"
+report "runescope --trace=network (native)" "$(measure "$RUNESCOPE" --trace=network "$STORM" "$ITERATIONS")"
@@ -0,0 +1,662 @@
+#define _POSIX_C_SOURCE 200809L // For flockfile
+#include "rune_alloc.h"
+#include "rune_histogram.h"
+#include "rune_latency.h"
+#include "rune_scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ARGS 4
+#define INITIAL_MAP_BITS 12
+#define SIZE_CLASSES 65          // Class c holds sizes in (2^(c-1), 2^c]; class 0 holds 0 and 1
+#define SHORT_LIVED_NS 1000000   // Freed within 1ms counts as short-lived...
+#define SHORT_LIVED_CALLS 100    // ...or within 100 library calls when the trace has no timestamps
+#define TIMELINE_SLOTS 20
+#define TIMELINE_BAR 40
+#define POOL_CANDIDATES 3
+
+typedef enum {
+    ALLOC_NONE,
+    ALLOC_NEW,     // Returns a new block
+    ALLOC_RESIZE,  // realloc: frees ptr_arg (if not NULL) and returns a new block
+    ALLOC_FREE
+} alloc_kind_t;
+
+static const struct {
+    const char *name;
+    alloc_kind_t kind;
+    int ptr_arg;    // Block passed in, -1 for none
+    int count_arg;  // Element count, -1 for none
+    int size_arg;   // Size in bytes (per element with count_arg), -1 for none
+} alloc_functions[] = {
+    { "malloc", ALLOC_NEW, -1, -1, 0 },
+    { "calloc", ALLOC_NEW, -1, 0, 1 },
+    { "valloc", ALLOC_NEW, -1, -1, 0 },
+    { "pvalloc", ALLOC_NEW, -1, -1, 0 },
+    { "memalign", ALLOC_NEW, -1, -1, 1 },
+    { "aligned_alloc", ALLOC_NEW, -1, -1, 1 },
+    { "_Znwm", ALLOC_NEW, -1, -1, 0 },       // operator new
+    { "_Znam", ALLOC_NEW, -1, -1, 0 },       // operator new[]
+    { "realloc", ALLOC_RESIZE, 0, -1, 1 },
+    { "reallocarray", ALLOC_RESIZE, 0, 1, 2 },
+    { "free", ALLOC_FREE, 0, -1, -1 },
+    { "cfree", ALLOC_FREE, 0, -1, -1 },
+    { "_ZdlPv", ALLOC_FREE, 0, -1, -1 },     // operator delete
+    { "_ZdaPv", ALLOC_FREE, 0, -1, -1 },     // operator delete[]
+    { "_ZdlPvm", ALLOC_FREE, 0, -1, -1 },    // Sized operator delete
+    { "_ZdaPvm", ALLOC_FREE, 0, -1, -1 },
+};
+
+// Calls that decide which processes share a heap
+typedef enum {
+    PROC_NONE,
+    PROC_FORK,     // The child gets a copy of the parent's heap
+    PROC_THREAD    // The new thread shares its creator's heap
+} proc_kind_t;
+
+static const struct {
+    const char *name;
+    proc_kind_t kind;
+} proc_functions[] = {
+    { "fork", PROC_FORK },
+    { "vfork", PROC_FORK },
+    { "pthread_create", PROC_THREAD },
+};
+
+// A live block; addr 0 marks an empty slot
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    int64_t born;       // Allocation time in ns, or event index without timestamps
+    uint32_t space;     // The heap it belongs to: one per process, shared by its threads
+    uint32_t inherited; // Copied from the parent at fork rather than allocated by this process
+} alloc_block_t;
+
+// Open-addressing map of live blocks, keyed by heap and address, with linear probing. Removal shifts the
+// following entries back instead of leaving tombstones, so lookups stay short
+// however many millions of blocks come and go.
+typedef struct {
+    alloc_block_t *slots;
+    size_t mask;    // Capacity - 1; capacity is a power of two
+    int shift;      // 64 - log2(capacity), for Fibonacci hashing
+    size_t count;
+} alloc_map_t;
+
+// Totals for one size class
+typedef struct {
+    unsigned long allocs;
+    uint64_t bytes;
+    unsigned long short_lived;
+    unsigned long unfreed;
+    uint64_t unfreed_bytes;
+} size_class_t;
+
+static size_t map_home(const alloc_map_t *map, uint32_t space, uint64_t addr) {
+    return (size_t)((((addr >> 4) ^ ((uint64_t)space << 44)) * 0x9E3779B97F4A7C15ull) >> map->shift);
+}
+
+static int map_holds(const alloc_block_t *slot, uint32_t space, uint64_t addr) {
+    return slot->addr == addr && slot->space == space;
+}
+
+static int map_init(alloc_map_t *map, int bits) {
+    map->slots = calloc((size_t)1 << bits, sizeof(alloc_block_t));
+    if (map->slots == NULL) {
+        perror("runescope: calloc failed for allocation map");
+        return -1;
+    }
+    map->mask = ((size_t)1 << bits) - 1;
+    map->shift = 64 - bits;
+    map->count = 0;
+    return 0;
+}
+
+static int map_put(alloc_map_t *map, const alloc_block_t *block);
+
+static int map_grow(alloc_map_t *map) {
+    alloc_map_t grown;
+    if (map_init(&grown, 64 - map->shift + 1) == -1) {
+        return -1;
+    }
+    for (size_t i = 0; i <= map->mask; i++) {
+        if (map->slots[i].addr != 0) {
+            map_put(&grown, &map->slots[i]);
+        }
+    }
+    free(map->slots);
+    *map = grown;
+    return 0;
+}
+
+// Inserts a block, replacing a live block at the same address in the same heap
+static int map_put(alloc_map_t *map, const alloc_block_t *block) {
+    if ((map->count + 1) * 4 > (map->mask + 1) * 3 && map_grow(map) == -1) {
+        return -1;
+    }
+    size_t i = map_home(map, block->space, block->addr);
+    while (map->slots[i].addr != 0 && !map_holds(&map->slots[i], block->space, block->addr)) {
+        i = (i + 1) & map->mask;
+    }
+    map->count += map->slots[i].addr == 0;
+    map->slots[i] = *block;
+    return 0;
+}
+
+// Removes the block at addr of a heap into *removed; returns 0 if there is none
+static int map_take(alloc_map_t *map, uint32_t space, uint64_t addr, alloc_block_t *removed) {
+    size_t i = map_home(map, space, addr);
+    while (!map_holds(&map->slots[i], space, addr)) {
+        if (map->slots[i].addr == 0) {
+            return 0;
+        }
+        i = (i + 1) & map->mask;
+    }
+    *removed = map->slots[i];
+    map->count--;
+
+    // Shift back every following entry that would no longer be reachable
+    size_t hole = i;
+    for (size_t j = (i + 1) & map->mask; map->slots[j].addr != 0; j = (j + 1) & map->mask) {
+        size_t home = map_home(map, map->slots[j].space, map->slots[j].addr);
+        if (((j - home) & map->mask) >= ((j - hole) & map->mask)) {
+            map->slots[hole] = map->slots[j];
+            hole = j;
+        }
+    }
+    map->slots[hole].addr = 0;
+    return 1;
+}
+
+static int size_class(uint64_t size) {
+    return size <= 1 ? 0 : 64 - __builtin_clzll(size - 1);
+}
+
+static uint64_t arg_value(const rune_strview_t *args, size_t nargs, int index) {
+    long value = 0;
+    if (index >= 0 && (size_t)index < nargs) {
+        rune_scan_number(args[index].ptr, args[index].ptr + args[index].len, &value);
+    }
+    return (uint64_t)value;
+}
+
+// Per-run state
+typedef struct {
+    alloc_map_t map;
+    size_class_t classes[SIZE_CLASSES];
+    rune_histogram_t lifetimes;  // In ns, or in calls without timestamps
+    unsigned long news, resizes, frees, free_null, unknown_frees, failed;
+    uint64_t allocated;
+    uint64_t live, peak;
+    size_t peak_blocks;
+    int64_t peak_at;
+    uint32_t *space_of;          // Per pid index: heap + 1, 0 = none yet
+    uint32_t *parent_of;         // Per pid index: pid index + 1 of the process that forked it, 0 = none
+    uint32_t num_spaces;
+    long thread_creator;         // Pid index whose heap new threads join, -1 = none
+    size_t inherited;            // Live blocks copied into forked children
+    uint64_t timeline[TIMELINE_SLOTS]; // Highest live bytes in each slot of the trace
+    uint64_t timeline_end[TIMELINE_SLOTS]; // Live bytes after the last call in each slot
+    int timeline_seen[TIMELINE_SLOTS];
+    int64_t first, span;
+    int timed;
+} alloc_state_t;
+
+static void note_live(alloc_state_t *state, int64_t now) {
+    if (state->live > state->peak) {
+        state->peak = state->live;
+        state->peak_blocks = state->map.count - state->inherited;
+        state->peak_at = now;
+    }
+    size_t slot = state->span > 0 ? (size_t)((double)(now - state->first) / (double)state->span * TIMELINE_SLOTS) : 0;
+    if (slot >= TIMELINE_SLOTS) {
+        slot = TIMELINE_SLOTS - 1;
+    }
+    if (state->live > state->timeline[slot]) {
+        state->timeline[slot] = state->live;
+    }
+    state->timeline_end[slot] = state->live;
+    state->timeline_seen[slot] = 1;
+}
+
+// A slot starts with the bytes the previous slots left live, even when it has no calls of its own
+static void carry_timeline(alloc_state_t *state) {
+    uint64_t carried = 0;
+    for (int s = 0; s < TIMELINE_SLOTS; s++) {
+        if (carried > state->timeline[s]) {
+            state->timeline[s] = carried;
+        }
+        if (state->timeline_seen[s]) {
+            carried = state->timeline_end[s];
+        }
+    }
+}
+
+// Gives a forked child its own copy of every block live in its parent's heap
+static int copy_space(alloc_state_t *state, uint32_t from, uint32_t to) {
+    size_t n = 0;
+    for (size_t i = 0; i <= state->map.mask; i++) {
+        n += state->map.slots[i].addr != 0 && state->map.slots[i].space == from;
+    }
+    alloc_block_t *blocks = malloc((n + 1) * sizeof(alloc_block_t));
+    if (blocks == NULL) {
+        perror("runescope: malloc failed for forked heap");
+        return -1;
+    }
+    n = 0;
+    for (size_t i = 0; i <= state->map.mask; i++) {
+        if (state->map.slots[i].addr != 0 && state->map.slots[i].space == from) {
+            blocks[n] = state->map.slots[i];
+            blocks[n].space = to;
+            blocks[n].inherited = 1;
+            n++;
+        }
+    }
+    int result = 0;
+    for (size_t k = 0; k < n && result == 0; k++) {
+        result = map_put(&state->map, &blocks[k]);
+        state->inherited += result == 0;
+    }
+    free(blocks);
+    return result;
+}
+
+// The heap of a process: a copy of its parent's when it was forked, its creator's when it is a thread
+static long space_for(alloc_state_t *state, uint32_t pid_index) {
+    if (state->space_of[pid_index] != 0) {
+        return (long)state->space_of[pid_index] - 1;
+    }
+    uint32_t parent = state->parent_of[pid_index];
+    if (parent == 0 && state->thread_creator >= 0 && (uint32_t)state->thread_creator != pid_index) {
+        long space = space_for(state, (uint32_t)state->thread_creator);
+        state->space_of[pid_index] = (uint32_t)space + 1;
+        return space;
+    }
+    // Assigned before the parent's heap is looked up, so a cycle of reused pids ends here
+    uint32_t space = state->num_spaces++;
+    state->space_of[pid_index] = space + 1;
+    if (parent != 0) {
+        long from = space_for(state, parent - 1);
+        if (from < 0 || copy_space(state, (uint32_t)from, space) == -1) {
+            return -1;
+        }
+    }
+    return space;
+}
+
+static void release(alloc_state_t *state, uint32_t space, uint64_t addr, int64_t now, int counts_lifetime) {
+    alloc_block_t block;
+    if (!map_take(&state->map, space, addr, &block)) {
+        state->unknown_frees++; // Allocated before the trace or by an untraced function
+        return;
+    }
+    if (block.inherited) {
+        state->inherited--; // The parent allocated it and keeps its own copy
+        return;
+    }
+    state->live -= block.size;
+    if (counts_lifetime) {
+        int64_t lifetime = now - block.born;
+        rune_histogram_record(&state->lifetimes, lifetime);
+        if (lifetime < (state->timed ? SHORT_LIVED_NS : SHORT_LIVED_CALLS)) {
+            state->classes[size_class(block.size)].short_lived++;
+        }
+    }
+}
+
+static int allocate(alloc_state_t *state, uint32_t space, uint64_t addr, uint64_t size, int64_t now) {
+    alloc_block_t block = { addr, size, now, space, 0 };
+    alloc_block_t old;
+    if (map_take(&state->map, space, addr, &old)) {
+        // Its free was not traced
+        if (old.inherited) {
+            state->inherited--;
+        } else {
+            state->live -= old.size;
+        }
+    }
+    if (map_put(&state->map, &block) == -1) {
+        return -1;
+    }
+    size_class_t *c = &state->classes[size_class(size)];
+    c->allocs++;
+    c->bytes += size;
+    state->allocated += size;
+    state->live += size;
+    return 0;
+}
+
+static void print_report(alloc_state_t *state, FILE *out) {
+    char a[16], b[16], c[16];
+    unsigned long allocs = 0, short_lived = 0;
+    for (int k = 0; k < SIZE_CLASSES; k++) {
+        allocs += state->classes[k].allocs;
+        short_lived += state->classes[k].short_lived;
+    }
+    for (size_t i = 0; i <= state->map.mask; i++) {
+        const alloc_block_t *block = &state->map.slots[i];
+        if (block->addr != 0 && !block->inherited) {
+            state->classes[size_class(block->size)].unfreed++;
+            state->classes[size_class(block->size)].unfreed_bytes += block->size;
+        }
+    }
+
+    fprintf(out, "\n--- Allocations: %lu allocations, %lu reallocs, %lu frees (%lu of NULL, %lu of unknown blocks), %lu failed ---\n",
+            state->news, state->resizes, state->frees, state->free_null, state->unknown_frees, state->failed);
+    if (allocs == 0) {
+        fprintf(out, "No allocations in this trace (trace with -l)\n");
+        return;
+    }
+    const char *unit = state->timed ? "s" : " calls";
+    double span = state->timed ? (double)state->span / 1e9 : (double)state->span;
+    fprintf(out, "Allocated %s in %lu blocks over %.3f%s", rune_latency_format_bytes(state->allocated, a, sizeof(a)), allocs, span,
+            unit);
+    if (state->timed && span > 0) {
+        fprintf(out, ": %.0f allocations/s, %s/s\n", (double)allocs / span,
+                rune_latency_format_bytes((uint64_t)((double)state->allocated / span), b, sizeof(b)));
+    } else if (span > 0) {
+        fprintf(out, ": %.1f allocations per 1000 library calls\n", 1000.0 * (double)allocs / span);
+    } else {
+        fprintf(out, "\n");
+    }
+    double peak_at = state->timed ? (double)(state->peak_at - state->first) / 1e9 : (double)(state->peak_at - state->first);
+    fprintf(out, "Peak live: %s in %zu blocks at +%.3f%s\n", rune_latency_format_bytes(state->peak, a, sizeof(a)), state->peak_blocks,
+            peak_at, unit);
+    if (state->timed) {
+        fprintf(out, "Short-lived (freed within %s): %lu of %llu freed blocks (%.1f%%); lifetime p50 %s, p99 %s\n",
+                rune_latency_format(SHORT_LIVED_NS, a, sizeof(a)), short_lived,
+                (unsigned long long)state->lifetimes.count,
+                state->lifetimes.count ? 100.0 * (double)short_lived / (double)state->lifetimes.count : 0.0,
+                rune_latency_format(rune_histogram_percentile(&state->lifetimes, 50), b, sizeof(b)),
+                rune_latency_format(rune_histogram_percentile(&state->lifetimes, 99), c, sizeof(c)));
+    } else {
+        fprintf(out, "Short-lived (freed within %d calls): %lu of %llu freed blocks (%.1f%%); lifetime p50 %lld calls, p99 %lld calls\n",
+                SHORT_LIVED_CALLS, short_lived, (unsigned long long)state->lifetimes.count,
+                state->lifetimes.count ? 100.0 * (double)short_lived / (double)state->lifetimes.count : 0.0,
+                (long long)rune_histogram_percentile(&state->lifetimes, 50),
+                (long long)rune_histogram_percentile(&state->lifetimes, 99));
+    }
+    fprintf(out, "Unfreed at exit: %zu blocks, %s\n", state->map.count - state->inherited, rune_latency_format_bytes(state->live, a, sizeof(a)));
+
+    fprintf(out, "\n%15s %10s %6s %10s %12s %10s %12s\n", "size", "allocs", "%", "bytes", "short-lived", "unfreed",
+            "unfreed bytes");
+    for (int k = 0; k < SIZE_CLASSES; k++) {
+        const size_class_t *cls = &state->classes[k];
+        if (cls->allocs == 0 && cls->unfreed == 0) {
+            continue;
+        }
+        char range[32];
+        if (k == 0) {
+            snprintf(range, sizeof(range), "0-1");
+        } else {
+            snprintf(range, sizeof(range), "%s-%s", rune_latency_format_bytes(((uint64_t)1 << (k - 1)) + 1, a, sizeof(a)),
+                     rune_latency_format_bytes((uint64_t)1 << (k < 64 ? k : 63), b, sizeof(b)));
+        }
+        fprintf(out, "%15s %10lu %6.2f %10s %12lu %10lu %12s\n", range, cls->allocs,
+                100.0 * (double)cls->allocs / (double)allocs, rune_latency_format_bytes(cls->bytes, a, sizeof(a)), cls->short_lived,
+                cls->unfreed, rune_latency_format_bytes(cls->unfreed_bytes, b, sizeof(b)));
+    }
+
+    // Size classes where most blocks die young are where a pool or arena pays off
+    fprintf(out, "\nPool/arena candidates (most short-lived blocks):");
+    int used[SIZE_CLASSES] = {0};
+    int listed = 0;
+    for (int n = 0; n < POOL_CANDIDATES; n++) {
+        int best = -1;
+        for (int k = 0; k < SIZE_CLASSES; k++) {
+            if (!used[k] && state->classes[k].short_lived > 0 &&
+                (best < 0 || state->classes[k].short_lived > state->classes[best].short_lived)) {
+                best = k;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        used[best] = 1;
+        fprintf(out, "%s blocks up to %s (%lu short-lived)", listed++ ? "," : "",
+                rune_latency_format_bytes((uint64_t)1 << (best < 64 ? best : 63), a, sizeof(a)), state->classes[best].short_lived);
+    }
+    fprintf(out, "%s\n", listed ? "" : " none");
+
+    fprintf(out, "\nLive bytes over the trace (peak in each 1/%d):\n", TIMELINE_SLOTS);
+    for (int s = 0; s < TIMELINE_SLOTS; s++) {
+        double at = (double)s * span / TIMELINE_SLOTS;
+        int bar = state->peak ? (int)((double)state->timeline[s] / (double)state->peak * TIMELINE_BAR + 0.5) : 0;
+        fprintf(out, "  %10.3f%-6s %9s  %.*s\n", at, unit, rune_latency_format_bytes(state->timeline[s], a, sizeof(a)), bar,
+                "########################################");
+    }
+}
+
+typedef struct {
+    long pid;
+    uint32_t index;
+} pid_slot_t;
+
+static int compare_pid_slots(const void *a, const void *b) {
+    const pid_slot_t *sa = a;
+    const pid_slot_t *sb = b;
+    return (sa->pid > sb->pid) - (sa->pid < sb->pid);
+}
+
+// Pid index + 1 of a pid, 0 if it never made a call
+static uint32_t find_pid_index(const pid_slot_t *slots, size_t num_pids, long pid) {
+    size_t lo = 0, hi = num_pids;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (slots[mid].pid < pid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < num_pids && slots[lo].pid == pid ? slots[lo].index + 1 : 0;
+}
+
+static void free_state(alloc_state_t *state) {
+    free(state->map.slots);
+    free(state->space_of);
+    free(state->parent_of);
+    free(state);
+}
+
+// Finds the parent of every forked process that made a call, and the first thread creator
+static void find_parents(alloc_state_t *state, const rune_store_t *store, const int8_t *procs,
+                         const uint32_t *pid_index, const pid_slot_t *slots, size_t num_pids) {
+    state->thread_creator = -1;
+    for (size_t i = 0; i < store->count; i++) {
+        int proc = procs[store->name_id[i]];
+        if (proc == PROC_THREAD && state->thread_creator < 0) {
+            state->thread_creator = (long)pid_index[i]; // Until the replay reaches a later creator
+        } else if (proc == PROC_FORK && store->ret[i] > 0 && !(store->flags[i] & RUNE_EVENT_UNFINISHED)) {
+            uint32_t child = find_pid_index(slots, num_pids, store->ret[i]);
+            if (child != 0 && child - 1 != pid_index[i] && state->parent_of[child - 1] == 0) {
+                state->parent_of[child - 1] = pid_index[i] + 1;
+            }
+        }
+    }
+}
+
+// Replays the allocation calls of a store; NULL on allocation failure
+static alloc_state_t *replay(const rune_store_t *store) {
+    alloc_state_t *state = calloc(1, sizeof(alloc_state_t));
+    int8_t *roles = malloc((store->names.count + 1) * sizeof(int8_t));
+    int8_t *procs = calloc(store->names.count + 1, sizeof(int8_t));
+    long *pids = NULL;
+    size_t num_pids = 0;
+    uint32_t *pid_index = rune_store_pid_index(store, &pids, &num_pids);
+    pid_slot_t *slots = malloc((num_pids + 1) * sizeof(pid_slot_t));
+    if (state != NULL) {
+        state->space_of = calloc(num_pids + 1, sizeof(uint32_t));
+        state->parent_of = calloc(num_pids + 1, sizeof(uint32_t));
+    }
+    if (state == NULL || roles == NULL || procs == NULL || pid_index == NULL || slots == NULL ||
+        state->space_of == NULL || state->parent_of == NULL || map_init(&state->map, INITIAL_MAP_BITS) == -1) {
+        perror("runescope: allocation failed for allocation profile");
+        if (state != NULL) {
+            free_state(state);
+        }
+        free(roles);
+        free(procs);
+        free(pid_index);
+        free(pids);
+        free(slots);
+        return NULL;
+    }
+    for (size_t p = 0; p < num_pids; p++) {
+        slots[p].pid = pids[p];
+        slots[p].index = (uint32_t)p;
+    }
+    qsort(slots, num_pids, sizeof(pid_slot_t), compare_pid_slots);
+    rune_histogram_init(&state->lifetimes);
+    for (uint32_t id = 0; id < store->names.count; id++) {
+        const char *name = rune_store_name(store, id);
+        roles[id] = -1;
+        for (size_t k = 0; k < sizeof(alloc_functions) / sizeof(alloc_functions[0]); k++) {
+            if (strcmp(name, alloc_functions[k].name) == 0) {
+                roles[id] = (int8_t)k;
+                break;
+            }
+        }
+        for (size_t k = 0; k < sizeof(proc_functions) / sizeof(proc_functions[0]); k++) {
+            if (strcmp(name, proc_functions[k].name) == 0) {
+                procs[id] = (int8_t)proc_functions[k].kind;
+                break;
+            }
+        }
+    }
+
+    // The time axis: timestamps if every allocation call has one, call indexes otherwise
+    int64_t first = 0, last = 0;
+    int seen = 0;
+    state->timed = 1;
+    for (size_t i = 0; i < store->count; i++) {
+        if (roles[store->name_id[i]] >= 0) {
+            int64_t ts = store->timestamp_ns[i];
+            state->timed &= ts != 0;
+            first = seen && first < ts ? first : ts;
+            last = seen && last > ts ? last : ts;
+            seen = 1;
+        }
+    }
+    if (!state->timed) {
+        first = 0;
+        last = store->count > 0 ? (int64_t)store->count - 1 : 0;
+    }
+    state->first = first;
+    state->span = last - first;
+
+    // Each process has a heap of its own; blocks are paired with frees within one heap only
+    find_parents(state, store, procs, pid_index, slots, num_pids);
+    int result = 0;
+    for (size_t i = 0; i < store->count && result == 0; i++) {
+        int proc = procs[store->name_id[i]];
+        if (proc == PROC_THREAD) {
+            state->thread_creator = (long)pid_index[i];
+            continue;
+        }
+        if (proc == PROC_FORK) {
+            // The child's copy is taken here unless its own calls came first
+            uint32_t child = store->ret[i] > 0 ? find_pid_index(slots, num_pids, store->ret[i]) : 0;
+            if (child != 0 && state->parent_of[child - 1] == pid_index[i] + 1 && space_for(state, child - 1) < 0) {
+                result = -1;
+            }
+            continue;
+        }
+        int role = roles[store->name_id[i]];
+        if (role < 0 || (store->flags[i] & RUNE_EVENT_UNFINISHED)) {
+            continue;
+        }
+        long heap = space_for(state, pid_index[i]);
+        if (heap < 0) {
+            result = -1;
+            break;
+        }
+        uint32_t space = (uint32_t)heap;
+        int64_t now = state->timed ? store->timestamp_ns[i] : (int64_t)i;
+        rune_strview_t text = rune_store_args(store, i);
+        rune_strview_t args[MAX_ARGS];
+        size_t nargs = rune_scan_split_args(text.ptr, text.ptr + text.len, args, MAX_ARGS);
+        uint64_t ptr = arg_value(args, nargs, alloc_functions[role].ptr_arg);
+        uint64_t size = arg_value(args, nargs, alloc_functions[role].size_arg);
+        if (alloc_functions[role].count_arg >= 0) {
+            size *= arg_value(args, nargs, alloc_functions[role].count_arg);
+        }
+        uint64_t ret = (uint64_t)store->ret[i];
+
+        switch (alloc_functions[role].kind) {
+        case ALLOC_NEW:
+            state->news++;
+            if (ret == 0) {
+                state->failed++;
+            } else {
+                result = allocate(state, space, ret, size, now);
+            }
+            break;
+        case ALLOC_RESIZE:
+            state->resizes++;
+            if (ret == 0 && size > 0) {
+                state->failed++; // The old block stays valid
+                break;
+            }
+            if (ptr != 0) {
+                release(state, space, ptr, now, 0);
+            }
+            if (ret != 0) {
+                result = allocate(state, space, ret, size, now);
+            }
+            break;
+        case ALLOC_FREE:
+            state->frees++;
+            if (ptr == 0) {
+                state->free_null++;
+            } else {
+                release(state, space, ptr, now, 1);
+            }
+            break;
+        case ALLOC_NONE:
+            break;
+        }
+        note_live(state, now);
+    }
+    carry_timeline(state);
+
+    free(roles);
+    free(procs);
+    free(pid_index);
+    free(pids);
+    free(slots);
+    if (result == -1) {
+        free_state(state);
+        return NULL;
+    }
+    return state;
+}
+
+int rune_alloc_report(const rune_store_t *store, FILE *out) {
+    alloc_state_t *state = replay(store);
+    if (state == NULL) {
+        return -1;
+    }
+    flockfile(out);
+    print_report(state, out);
+    funlockfile(out);
+    free_state(state);
+    return 0;
+}
+
+int rune_alloc_summarize(const rune_store_t *store, rune_alloc_summary_t *summary) {
+    alloc_state_t *state = replay(store);
+    if (state == NULL) {
+        return -1;
+    }
+    memset(summary, 0, sizeof(*summary));
+    for (int k = 0; k < SIZE_CLASSES; k++) {
+        summary->allocations += state->classes[k].allocs;
+    }
+    summary->frees = state->frees;
+    summary->allocated_bytes = state->allocated;
+    summary->peak_bytes = state->peak;
+    summary->unfreed_blocks = state->map.count - state->inherited;
+    summary->unfreed_bytes = state->live;
+    free_state(state);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef RUNE_ALLOC_H
+#define RUNE_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "rune_store.h"
+
+/**
+ * @brief Heap allocation profile from ltrace'd malloc/calloc/realloc/free.
+ *
+ * Every allocation is paired with the free of its address through an
+ * open-addressing hash map, so the analysis runs in constant time per call
+ * and memory proportional to the blocks live at any one time. Each process
+ * of an ltrace -f log has a heap of its own: a forked child starts with a
+ * copy of its parent's live blocks (not counted as its allocations or
+ * leaks), and pids that were not forked are taken for threads of the
+ * process that last called pthread_create, when there is one.
+ */
+
+// Totals of an allocation profile, for comparing runs
+typedef struct {
+    unsigned long allocations; // Blocks handed out, including by realloc
+    unsigned long frees;
+    uint64_t allocated_bytes;
+    uint64_t peak_bytes;       // Most bytes live at once
+    size_t unfreed_blocks;     // Still live at the end of the trace
+    uint64_t unfreed_bytes;
+} rune_alloc_summary_t;
+
+/**
+ * @brief Prints the allocation profile of the library calls in a store.
+ *
+ * Reports allocation and free counts, an allocation-size histogram by
+ * power-of-two class, the allocation rate, peak live bytes and how live
+ * bytes evolve over the trace, short-lived allocations per size class
+ * (candidates for arenas or pools), and blocks never freed. Times come from
+ * ltrace -ttt when the trace has them; otherwise the trace is measured in
+ * library calls.
+ *
+ * @param store The library call events (malloc, calloc, realloc, free,
+ *              memalign, aligned_alloc, operator new/delete, ...).
+ * @param out The stream to print to.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_alloc_report(const rune_store_t *store, FILE *out);
+
+/**
+ * @brief Computes the totals of the allocation profile without printing it.
+ *
+ * @param store The library call events.
+ * @param summary Receives the totals.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_alloc_summarize(const rune_store_t *store, rune_alloc_summary_t *summary);
+
+#endif // RUNE_ALLOC_H
@@ -1,14 +1,338 @@
 #include "rune_analyzer.h"
+#include "rune_alloc.h"
+#include "rune_futex.h"
+#include "rune_io.h"
+#include "rune_latency.h"
+#include "rune_pool.h"
+#include "rune_rtrace.h"
+#include "rune_store.h"
+#include "rune_syscalls.h"
+#include "rune_summary.h"
+#include "rune_vm.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-int rune_analyzer_analyze_strace(const char *strace_log_path) {
+// Chunks per thread, so one slow chunk doesn't leave the other threads idle
+#define CHUNKS_PER_THREAD 4
+#define TOP_PIDS 10
+#define TOP_LATENCY_PIDS 10
+#define TOP_FUTEX_WORDS 20
+#define TOP_IO_TARGETS 20
+#define TOP_VM_SPACES 20
+
+static const rune_analyzer_options_t default_options = {0};
+
+static void print_and_store_strace_entry(const strace_entry_t *entry, void *user_data) {
+    rune_strace_parser_print_entry(entry, NULL);
+    rune_store_add_strace_entry(entry, user_data);
+}
+
+static void print_and_store_ltrace_entry(const ltrace_entry_t *entry, void *user_data) {
+    rune_ltrace_parser_print_entry(entry, NULL);
+    rune_store_add_ltrace_entry(entry, user_data);
+}
+
+// A chunk's events; those the parallel parse delivered late are at the end
+typedef struct {
+    rune_store_t store;
+    size_t *late;            // Where each late event belongs among the others
+    size_t late_count;
+    size_t late_capacity;
+} chunk_t;
+
+static void note_late(chunk_t *chunk, size_t position) {
+    if (chunk->late_count == chunk->late_capacity) {
+        size_t capacity = chunk->late_capacity ? chunk->late_capacity * 2 : 16;
+        size_t *late = realloc(chunk->late, capacity * sizeof(size_t));
+        if (late == NULL) {
+            perror("runescope: realloc failed for late events");
+            chunk->store.failed = 1;
+            return;
+        }
+        chunk->late = late;
+        chunk->late_capacity = capacity;
+    }
+    chunk->late[chunk->late_count++] = position;
+}
+
+static void add_chunk_strace_entry(const strace_entry_t *entry, void *user_data) {
+    chunk_t *chunk = user_data;
+    rune_store_add_strace_entry(entry, &chunk->store);
+}
+
+static void add_late_strace_entry(const strace_entry_t *entry, size_t position, void *user_data) {
+    chunk_t *chunk = user_data;
+    note_late(chunk, position);
+    rune_store_add_strace_entry(entry, &chunk->store);
+}
+
+static void add_chunk_ltrace_entry(const ltrace_entry_t *entry, void *user_data) {
+    chunk_t *chunk = user_data;
+    rune_store_add_ltrace_entry(entry, &chunk->store);
+}
+
+static void add_late_ltrace_entry(const ltrace_entry_t *entry, size_t position, void *user_data) {
+    chunk_t *chunk = user_data;
+    note_late(chunk, position);
+    rune_store_add_ltrace_entry(entry, &chunk->store);
+}
+
+// One store per chunk; returns the chunk count, or 0 on failure
+static size_t chunks_init(const rune_analyzer_options_t *options, chunk_t **chunks, void ***user_data) {
+    int threads = options->num_threads > 0 ? options->num_threads : rune_pool_cpu_count();
+    size_t num_chunks = (size_t)threads * CHUNKS_PER_THREAD;
+    *chunks = calloc(num_chunks, sizeof(chunk_t));
+    *user_data = calloc(num_chunks, sizeof(void *));
+    if (*chunks == NULL || *user_data == NULL) {
+        perror("runescope: calloc failed for chunk stores");
+        free(*chunks);
+        free(*user_data);
+        return 0;
+    }
+    for (size_t i = 0; i < num_chunks; i++) {
+        if (rune_store_init(&(*chunks)[i].store) == -1) {
+            for (size_t j = 0; j < i; j++) {
+                rune_store_free(&(*chunks)[j].store);
+            }
+            free(*chunks);
+            free(*user_data);
+            return 0;
+        }
+        (*user_data)[i] = &(*chunks)[i];
+    }
+    return num_chunks;
+}
+
+// Appends a chunk's events to store with its late events moved to where they belong
+static int chunk_append(rune_store_t *store, const chunk_t *chunk) {
+    if (chunk->late_count == 0) {
+        return rune_store_append(store, &chunk->store, NULL);
+    }
+
+    size_t *order = malloc(chunk->store.count * sizeof(size_t));
+    if (order == NULL) {
+        perror("runescope: malloc failed for chunk order");
+        return -1;
+    }
+    size_t others = chunk->store.count - chunk->late_count;
+    size_t next = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < chunk->late_count; i++) {
+        while (next < chunk->late[i] && next < others) {
+            order[n++] = next++;
+        }
+        order[n++] = others + i;
+    }
+    while (next < others) {
+        order[n++] = next++;
+    }
+    int result = rune_store_append(store, &chunk->store, order);
+    free(order);
+    return result;
+}
+
+// Appends the chunks in log order to store and frees them
+static int chunks_merge(rune_store_t *store, chunk_t *chunks, void **user_data, size_t num_chunks,
+                        int parse_result) {
+    int result = parse_result;
+    for (size_t i = 0; i < num_chunks; i++) {
+        if (result == 0 && (chunks[i].store.failed || chunk_append(store, &chunks[i]) == -1)) {
+            result = -1;
+        }
+        rune_store_free(&chunks[i].store);
+        free(chunks[i].late);
+    }
+    free(chunks);
+    free(user_data);
+    return result;
+}
+
+// Fills store from a log, in parallel unless every entry has to be printed in order
+static int build_store(rune_store_t *store, const char *log_path, const rune_analyzer_options_t *options,
+                       int is_strace) {
+    int result;
+    if (options->verbose) {
+        if (is_strace) {
+            result = rune_strace_parser_parse_file(log_path, print_and_store_strace_entry, store);
+        } else {
+            result = rune_ltrace_parser_parse_file(log_path, print_and_store_ltrace_entry, store);
+        }
+        return store->failed ? -1 : result;
+    }
+
+    chunk_t *chunks;
+    void **user_data;
+    size_t num_chunks = chunks_init(options, &chunks, &user_data);
+    if (num_chunks == 0) {
+        return -1;
+    }
+    if (is_strace) {
+        result = rune_strace_parser_parse_file_parallel(log_path, options->num_threads, num_chunks,
+                                                        add_chunk_strace_entry, add_late_strace_entry, user_data);
+    } else {
+        result = rune_ltrace_parser_parse_file_parallel(log_path, options->num_threads, num_chunks,
+                                                        add_chunk_ltrace_entry, add_late_ltrace_entry, user_data);
+    }
+    return chunks_merge(store, chunks, user_data, num_chunks, result);
+}
+
+// Prints per-name and per-pid tables computed from the store's columns
+static int report(const rune_store_t *store, int is_strace, const rune_analyzer_options_t *options) {
+    const char *title = is_strace ? "Strace summary" : "Ltrace summary";
+    const char *name_header = is_strace ? "syscall" : "function";
+    size_t args_bytes;
+    size_t bytes = rune_store_memory(store, &args_bytes);
+    printf("Event store: %zu events, %zu distinct names, %zu bytes (%.1f bytes/event + %zu bytes of arguments)\n",
+           store->count, store->names.count, bytes,
+           store->count ? (double)(bytes - args_bytes) / (double)store->count : 0.0, args_bytes);
+
+    unsigned long *calls = malloc((store->names.count + 1) * sizeof(unsigned long));
+    unsigned long *errors = malloc((store->names.count + 1) * sizeof(unsigned long));
+    rune_summary_t summary;
+    if (calls == NULL || errors == NULL || rune_summary_init(&summary) == -1) {
+        perror("runescope: allocation failed for report");
+        free(calls);
+        free(errors);
+        return -1;
+    }
+    rune_store_count_by_name(store, calls, errors);
+    for (uint32_t id = 0; id < store->names.count; id++) {
+        const char *name = rune_store_name(store, id);
+        if (rune_summary_add_counts(&summary, name, strlen(name), calls[id], errors[id]) == -1) {
+            break;
+        }
+    }
+    rune_summary_print(&summary, stdout, title, name_header, 0);
+    rune_summary_free(&summary);
+    free(calls);
+    free(errors);
+
+    size_t num_pids;
+    rune_store_pid_stat_t *pids = rune_store_count_by_pid(store, &num_pids);
+    if (pids == NULL) {
+        return -1;
+    }
+    size_t shown = num_pids < TOP_PIDS ? num_pids : TOP_PIDS;
+    printf("\n--- Top pids by errors: %zu distinct ---\n", num_pids);
+    printf("%12s %10s  %s\n", "calls", "errors", "pid");
+    for (size_t i = 0; i < shown; i++) {
+        printf("%12lu %10lu  %ld\n", pids[i].calls, pids[i].errors, pids[i].pid);
+    }
+    if (shown < num_pids) {
+        printf("%12s %10s  (%zu more)\n", "...", "", num_pids - shown);
+    }
+    free(pids);
+
+    if (options->latency && rune_latency_report(store, stdout, name_header, TOP_LATENCY_PIDS) == -1) {
+        return -1;
+    }
+    if (options->futex && rune_futex_report(store, stdout, TOP_FUTEX_WORDS) == -1) {
+        return -1;
+    }
+    if (options->io && is_strace && rune_io_report(store, stdout, TOP_IO_TARGETS) == -1) {
+        return -1;
+    }
+    if (options->mmap && is_strace && rune_vm_report(store, stdout, TOP_VM_SPACES) == -1) {
+        return -1;
+    }
+    if (options->alloc && !is_strace && rune_alloc_report(store, stdout) == -1) {
+        return -1;
+    }
+    if (options->baseline != NULL && rune_baseline_add_store(options->baseline, store, is_strace) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+int rune_analyzer_report(const rune_store_t *store, int is_strace, const rune_analyzer_options_t *options) {
+    if (options == NULL) {
+        options = &default_options;
+    }
+    return report(store, is_strace, options);
+}
+
+static int analyze(const char *log_path, const rune_analyzer_options_t *options, int is_strace) {
+    if (options == NULL) {
+        options = &default_options;
+    }
+    rune_store_t store;
+    if (rune_store_init(&store) == -1) {
+        return -1;
+    }
+    int result = build_store(&store, log_path, options, is_strace);
+    if (result == 0 && options->binary_path != NULL) {
+        result = rune_rtrace_write(&store, is_strace ? RUNE_RTRACE_STRACE : RUNE_RTRACE_LTRACE, options->binary_path);
+        if (result == 0) {
+            printf("Saved %zu events to %s\n", store.count, options->binary_path);
+        }
+    }
+    if (result == 0 && !(options->convert_only && options->binary_path != NULL)) {
+        result = rune_analyzer_report(&store, is_strace, options);
+    }
+    rune_store_free(&store);
+    return result;
+}
+
+int rune_analyzer_analyze_strace(const char *strace_log_path, const rune_analyzer_options_t *options) {
     printf("\n--- Analyzing Strace Data ---\n");
-    // For now, just re-parse and print. Actual analysis logic will go here.
-    return rune_strace_parser_parse_file(strace_log_path);
+    return analyze(strace_log_path, options, 1);
 }
 
-int rune_analyzer_analyze_ltrace(const char *ltrace_log_path) {
+int rune_analyzer_analyze_ltrace(const char *ltrace_log_path, const rune_analyzer_options_t *options) {
     printf("\n--- Analyzing Ltrace Data ---\n");
-    // For now, just re-parse and print. Actual analysis logic will go here.
-    return rune_ltrace_parser_parse_file(ltrace_log_path);
+    return analyze(ltrace_log_path, options, 0);
+}
+
+// Prints stored events in the same format as entries parsed from text
+static void print_store_events(const rune_store_t *store, rune_rtrace_kind_t kind) {
+    for (size_t i = 0; i < store->count; i++) {
+        const char *name = rune_store_name(store, store->name_id[i]);
+        if (kind == RUNE_RTRACE_STRACE) {
+            strace_entry_t entry = {0};
+            entry.pid = store->pid[i];
+            entry.syscall_name = rune_strview_make(name, strlen(name));
+            entry.args = rune_store_args(store, i);
+            entry.return_value = store->ret[i];
+            entry.timestamp_ns = store->timestamp_ns[i];
+            entry.duration_ns = store->duration_ns[i];
+            entry.has_error = (store->flags[i] & RUNE_EVENT_ERROR) != 0;
+            entry.unfinished = (store->flags[i] & RUNE_EVENT_UNFINISHED) != 0;
+            const char *error_name = rune_syscalls_errno_name(store->err[i]);
+            entry.error_str = rune_strview_make(error_name ? error_name : "E?", error_name ? strlen(error_name) : 2);
+            rune_strace_parser_print_entry(&entry, NULL);
+        } else {
+            ltrace_entry_t entry = {0};
+            entry.pid = store->pid[i];
+            entry.function_name = rune_strview_make(name, strlen(name));
+            entry.args = rune_store_args(store, i);
+            entry.return_value = store->ret[i];
+            entry.timestamp_ns = store->timestamp_ns[i];
+            entry.unfinished = (store->flags[i] & RUNE_EVENT_UNFINISHED) != 0;
+            rune_ltrace_parser_print_entry(&entry, NULL);
+        }
+    }
+}
+
+int rune_analyzer_analyze_rtrace(const char *rtrace_path, const rune_analyzer_options_t *options) {
+    printf("\n--- Analyzing Binary Trace ---\n");
+    if (options == NULL) {
+        options = &default_options;
+    }
+    rune_store_t store;
+    if (rune_store_init(&store) == -1) {
+        return -1;
+    }
+    rune_rtrace_kind_t kind;
+    size_t blocks_read, blocks_total;
+    int result = rune_rtrace_load(rtrace_path, &options->window, &store, &kind, &blocks_read, &blocks_total);
+    if (result == 0) {
+        printf("Loaded %zu events from %zu of %zu blocks\n", store.count, blocks_read, blocks_total);
+        if (options->verbose) {
+            print_store_events(&store, kind);
+        }
+        result = rune_analyzer_report(&store, kind == RUNE_RTRACE_STRACE, options);
+    }
+    rune_store_free(&store);
+    return result;
 }
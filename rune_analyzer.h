@@ -3,6 +3,8 @@
 
 #include "rune_strace_parser.h"
 #include "rune_ltrace_parser.h"
+#include "rune_rtrace.h"
+#include "rune_baseline.h"
 
 /**
  * @brief Analyzes parsed strace and ltrace data for various insights.
@@ -12,17 +14,34 @@
  * performance, security, and defensive programming.
  */
 
+// How a log should be analyzed
+typedef struct {
+    int verbose;     // Print every parsed entry (forces a serial, in-order parse)
+    int num_threads; // Parser threads for the summary, 0 = one per CPU
+    const char *binary_path; // If set, also save the parsed events to this .rtrace file
+    int convert_only;        // With binary_path: save the events without printing a report
+    rune_rtrace_filter_t window; // Events to load from .rtrace files
+    int latency;             // Also report per-call latency histograms
+    int futex;               // Also report futex lock contention
+    int io;                  // Also report per-descriptor I/O and I/O anti-patterns (strace)
+    int mmap;                // Also report address-space churn from brk/mmap/munmap/mremap/mprotect (strace)
+    int alloc;               // Also report the heap allocation profile (ltrace)
+    rune_baseline_t *baseline; // If set, also add the summary metrics to this run profile
+} rune_analyzer_options_t;
+
 /**
  * @brief Performs a basic analysis of strace data.
  *
  * This function will read the strace log file, parse it, and provide a summary
  * of system call activities, such as file operations, process management, etc.
- * It will also highlight potential areas of interest for security or performance.
+ * Unless options->verbose is set, the log is parsed in parallel chunks whose
+ * per-chunk summaries are merged at the end.
  *
  * @param strace_log_path The path to the strace log file.
+ * @param options How to parse the log; NULL for the defaults.
  * @return 0 on success, -1 on failure.
  */
-int rune_analyzer_analyze_strace(const char *strace_log_path);
+int rune_analyzer_analyze_strace(const char *strace_log_path, const rune_analyzer_options_t *options);
 
 /**
  * @brief Performs a basic analysis of ltrace data.
@@ -30,10 +49,35 @@ int rune_analyzer_analyze_strace(const char *strace_log_path);
  * This function will read the ltrace log file, parse it, and provide a summary
  * of library call activities, focusing on memory allocation/deallocation,
  * string manipulations, and other high-level library interactions.
+ * Parsing follows the same rules as rune_analyzer_analyze_strace.
  *
  * @param ltrace_log_path The path to the ltrace log file.
+ * @param options How to parse the log; NULL for the defaults.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_analyzer_analyze_ltrace(const char *ltrace_log_path, const rune_analyzer_options_t *options);
+
+/**
+ * @brief Prints the report for events collected elsewhere (e.g. by the native tracer).
+ *
+ * @param store The events.
+ * @param is_strace Non-zero for syscalls, zero for library calls.
+ * @param options What to report; NULL for the defaults.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_analyzer_report(const rune_store_t *store, int is_strace, const rune_analyzer_options_t *options);
+
+/**
+ * @brief Analyzes a trace saved in the .rtrace binary format.
+ *
+ * Only the events in options->window are loaded; the file's block index is
+ * used to skip everything outside it. The report matches the one for the
+ * text log the trace was converted from.
+ *
+ * @param rtrace_path The path to the .rtrace file.
+ * @param options How to analyze the trace; NULL for the defaults.
  * @return 0 on success, -1 on failure.
  */
-int rune_analyzer_analyze_ltrace(const char *ltrace_log_path);
+int rune_analyzer_analyze_rtrace(const char *rtrace_path, const rune_analyzer_options_t *options);
 
 #endif // RUNE_ANALYZER_H
@@ -0,0 +1,407 @@
+#include "rune_baseline.h"
+#include "rune_alloc.h" // For rune_alloc_summarize
+#include "rune_bench.h" // For rune_bench_stats
+#include "rune_exec.h" // For rune_exec_run_measured
+#include "rune_latency.h" // For rune_latency_format
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BASELINE_HEADER "# runescope baseline 1"
+#define MAX_NAME_LEN 512
+#define MIN_TIME_DELTA_NS 100000.0 // Smaller changes are noise whatever their percentage
+#define MIN_SIZE_DELTA_BYTES 4096.0
+#define MIN_COUNT_DELTA 1.0        // One call more or less is not a trend
+#define MAX_LISTED_IMPROVEMENTS 10
+
+// One compared metric
+typedef struct {
+    const char *name;
+    double base;
+    double current;
+    double tolerance; // Percent
+    double excess;    // Change over tolerance, for ranking; INFINITY for new metrics
+    int verdict;      // 1 = regression, -1 = improvement, 0 = within tolerance
+} baseline_row_t;
+
+int rune_baseline_init(rune_baseline_t *baseline) {
+    baseline->values = NULL;
+    baseline->capacity = 0;
+    return rune_intern_init(&baseline->names);
+}
+
+int rune_baseline_add(rune_baseline_t *baseline, const char *name, double value) {
+    long id = rune_intern_id(&baseline->names, name, strlen(name));
+    if (id < 0) {
+        return -1;
+    }
+    if ((size_t)id >= baseline->capacity) {
+        size_t capacity = baseline->capacity ? baseline->capacity * 2 : 64;
+        double *values = realloc(baseline->values, capacity * sizeof(double));
+        if (values == NULL) {
+            perror("runescope: realloc failed for baseline metrics");
+            return -1;
+        }
+        memset(values + baseline->capacity, 0, (capacity - baseline->capacity) * sizeof(double));
+        baseline->values = values;
+        baseline->capacity = capacity;
+    }
+    baseline->values[id] += value;
+    return 0;
+}
+
+static int add_named(rune_baseline_t *baseline, const char *section, const char *name, const char *metric,
+                     double value) {
+    char key[MAX_NAME_LEN];
+    int len = snprintf(key, sizeof(key), "%s.%s.%s", section, name, metric);
+    if (len < 0 || (size_t)len >= sizeof(key) || strchr(name, ' ') != NULL) {
+        return 0; // Not a name the file format can hold; leave it out
+    }
+    return rune_baseline_add(baseline, key, value);
+}
+
+static int add_alloc(rune_baseline_t *baseline, const rune_store_t *store) {
+    rune_alloc_summary_t summary;
+    if (rune_alloc_summarize(store, &summary) == -1) {
+        return -1;
+    }
+    if (summary.allocations == 0 && summary.frees == 0) {
+        return 0;
+    }
+    if (rune_baseline_add(baseline, "alloc.allocations", (double)summary.allocations) == -1 ||
+        rune_baseline_add(baseline, "alloc.allocated_bytes", (double)summary.allocated_bytes) == -1 ||
+        rune_baseline_add(baseline, "alloc.peak_bytes", (double)summary.peak_bytes) == -1 ||
+        rune_baseline_add(baseline, "alloc.unfreed_blocks", (double)summary.unfreed_blocks) == -1 ||
+        rune_baseline_add(baseline, "alloc.unfreed_bytes", (double)summary.unfreed_bytes) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+int rune_baseline_add_store(rune_baseline_t *baseline, const rune_store_t *store, int is_strace) {
+    size_t num_names = store->names.count;
+    unsigned long *calls = malloc((num_names + 1) * sizeof(unsigned long));
+    unsigned long *errors = malloc((num_names + 1) * sizeof(unsigned long));
+    int64_t *time_ns = calloc(num_names + 1, sizeof(int64_t));
+    if (calls == NULL || errors == NULL || time_ns == NULL) {
+        perror("runescope: malloc failed for baseline metrics");
+        free(calls);
+        free(errors);
+        free(time_ns);
+        return -1;
+    }
+    rune_store_count_by_name(store, calls, errors);
+    int timed = 0;
+    for (size_t i = 0; i < store->count; i++) {
+        if (store->duration_ns[i] >= 0) {
+            time_ns[store->name_id[i]] += store->duration_ns[i];
+            timed = 1;
+        }
+    }
+
+    int result = 0;
+    const char *section = is_strace ? "syscall" : "libcall";
+    for (uint32_t id = 0; id < num_names && result == 0; id++) {
+        const char *name = rune_store_name(store, id);
+        result = add_named(baseline, section, name, "calls", (double)calls[id]);
+        if (result == 0 && is_strace) {
+            result = add_named(baseline, section, name, "errors", (double)errors[id]);
+        }
+        if (result == 0 && is_strace && timed) {
+            result = add_named(baseline, section, name, "time_ns", (double)time_ns[id]);
+        }
+    }
+    if (result == 0 && !is_strace) {
+        result = add_alloc(baseline, store);
+    }
+    free(calls);
+    free(errors);
+    free(time_ns);
+    return result;
+}
+
+int rune_baseline_measure(rune_baseline_t *baseline, const char *executable_path, char *const argv_target[], int runs) {
+    static const char *const names[] = {
+        "run.wall_ns", "run.user_ns", "run.sys_ns", "run.max_rss_kb", "run.minor_faults", "run.major_faults",
+        "run.voluntary_switches", "run.involuntary_switches",
+    };
+    enum { NUM_USAGE = sizeof(names) / sizeof(names[0]) };
+    double *values = malloc((size_t)runs * NUM_USAGE * sizeof(double));
+    if (values == NULL) {
+        perror("runescope: malloc failed for baseline runs");
+        return -1;
+    }
+    for (int r = 0; r < runs; r++) {
+        rune_exec_usage_t usage;
+        if (rune_exec_run_measured(executable_path, argv_target, -1, 1, &usage) == -1) {
+            free(values);
+            return -1;
+        }
+        double *row = values + (size_t)r * NUM_USAGE;
+        row[0] = (double)usage.wall_ns;
+        row[1] = (double)usage.user_ns;
+        row[2] = (double)usage.sys_ns;
+        row[3] = (double)usage.max_rss_kb;
+        row[4] = (double)usage.minor_faults;
+        row[5] = (double)usage.major_faults;
+        row[6] = (double)usage.voluntary_switches;
+        row[7] = (double)usage.involuntary_switches;
+    }
+
+    int result = 0;
+    double *column = malloc((size_t)runs * sizeof(double));
+    if (column == NULL) {
+        perror("runescope: malloc failed for baseline runs");
+        result = -1;
+    }
+    for (size_t m = 0; m < NUM_USAGE && result == 0; m++) {
+        for (int r = 0; r < runs; r++) {
+            column[r] = values[(size_t)r * NUM_USAGE + m];
+        }
+        rune_bench_stats_t stats;
+        rune_bench_stats(column, (size_t)runs, &stats);
+        result = rune_baseline_add(baseline, names[m], stats.median);
+    }
+    free(column);
+    free(values);
+    return result;
+}
+
+static const rune_intern_t *sort_names; // For compare_ids
+
+static int compare_ids(const void *a, const void *b) {
+    return strcmp(rune_intern_string(sort_names, *(const uint32_t *)a),
+                  rune_intern_string(sort_names, *(const uint32_t *)b));
+}
+
+int rune_baseline_save(const rune_baseline_t *baseline, const char *path) {
+    size_t count = baseline->names.count;
+    uint32_t *ids = malloc((count + 1) * sizeof(uint32_t));
+    if (ids == NULL) {
+        perror("runescope: malloc failed for baseline");
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        ids[i] = (uint32_t)i;
+    }
+    sort_names = &baseline->names;
+    qsort(ids, count, sizeof(uint32_t), compare_ids);
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror("runescope: Failed to create baseline file");
+        free(ids);
+        return -1;
+    }
+    fprintf(file, "%s\n", BASELINE_HEADER);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(file, "%s %.17g\n", rune_intern_string(&baseline->names, ids[i]), baseline->values[ids[i]]);
+    }
+    free(ids);
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed) {
+        perror("runescope: Failed to write baseline file");
+        return -1;
+    }
+    return 0;
+}
+
+int rune_baseline_load(rune_baseline_t *baseline, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("runescope: Failed to open baseline file");
+        return -1;
+    }
+    char line[MAX_NAME_LEN + 64];
+    int result = 0;
+    if (fgets(line, sizeof(line), file) == NULL || strncmp(line, BASELINE_HEADER, strlen(BASELINE_HEADER)) != 0) {
+        fprintf(stderr, "runescope: Error: %s is not a runescope baseline file.\n", path);
+        result = -1;
+    }
+    unsigned long line_number = 1;
+    while (result == 0 && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0') {
+            continue;
+        }
+        char *space = strrchr(line, ' ');
+        char *end = NULL;
+        double value = space != NULL ? strtod(space + 1, &end) : 0.0;
+        if (space == NULL || space == line || end == space + 1 || *end != '\0') {
+            fprintf(stderr, "runescope: Error: %s:%lu: expected a metric name and a value.\n", path, line_number);
+            result = -1;
+            break;
+        }
+        *space = '\0';
+        result = rune_baseline_add(baseline, line, value);
+    }
+    fclose(file);
+    return result;
+}
+
+static int has_section(const rune_baseline_t *profile, const char *name) {
+    size_t len = strcspn(name, ".") + 1; // The section and its dot
+    for (size_t i = 0; i < profile->names.count; i++) {
+        if (strncmp(rune_intern_string(&profile->names, (uint32_t)i), name, len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static double value_of(const rune_baseline_t *profile, const char *name, int *found) {
+    for (size_t i = 0; i < profile->names.count; i++) {
+        if (strcmp(rune_intern_string(&profile->names, (uint32_t)i), name) == 0) {
+            *found = 1;
+            return profile->values[i];
+        }
+    }
+    *found = 0;
+    return 0.0;
+}
+
+static int ends_with(const char *name, const char *suffix) {
+    size_t len = strlen(name), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+static double min_delta(const char *name) {
+    if (ends_with(name, "_ns")) {
+        return MIN_TIME_DELTA_NS;
+    } else if (ends_with(name, "_kb")) {
+        return MIN_SIZE_DELTA_BYTES / 1024.0;
+    } else if (ends_with(name, "_bytes")) {
+        return MIN_SIZE_DELTA_BYTES;
+    }
+    return MIN_COUNT_DELTA;
+}
+
+static double tolerance_for(const rune_baseline_thresholds_t *thresholds, const char *name) {
+    double percent = thresholds->percent;
+    size_t best = 0;
+    for (size_t i = 0; i < thresholds->num_overrides; i++) {
+        size_t len = strlen(thresholds->overrides[i].prefix);
+        if (len >= best && strncmp(name, thresholds->overrides[i].prefix, len) == 0) {
+            percent = thresholds->overrides[i].percent;
+            best = len;
+        }
+    }
+    return percent;
+}
+
+static void judge(baseline_row_t *row, const rune_baseline_thresholds_t *thresholds) {
+    double delta = row->current - row->base;
+    row->tolerance = tolerance_for(thresholds, row->name);
+    row->verdict = 0;
+    row->excess = 0.0;
+    if (fabs(delta) <= min_delta(row->name)) {
+        return;
+    }
+    if (row->base <= 0.0) {
+        row->verdict = 1;
+        row->excess = INFINITY;
+        return;
+    }
+    double percent = 100.0 * delta / row->base;
+    if (fabs(percent) > row->tolerance) {
+        row->verdict = percent > 0 ? 1 : -1;
+        row->excess = fabs(percent) - row->tolerance;
+    }
+}
+
+static int compare_rows(const void *a, const void *b) {
+    const baseline_row_t *x = a, *y = b;
+    if (x->verdict != y->verdict) {
+        return y->verdict - x->verdict; // Regressions, then unchanged, then improvements
+    }
+    if (x->excess != y->excess) {
+        return x->excess < y->excess ? 1 : -1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+static const char *format_value(const char *name, double value, char *buf, size_t size) {
+    if (ends_with(name, "_ns")) {
+        return rune_latency_format((int64_t)value, buf, size);
+    }
+    snprintf(buf, size, "%.0f%s", value, ends_with(name, "_kb") ? "K" : "");
+    return buf;
+}
+
+static void print_row(const baseline_row_t *row, FILE *out) {
+    char base[32], current[32], change[32];
+    if (row->base <= 0.0) {
+        snprintf(change, sizeof(change), "new");
+    } else if (row->current <= 0.0) {
+        snprintf(change, sizeof(change), "gone");
+    } else {
+        snprintf(change, sizeof(change), "%+.1f%%", 100.0 * (row->current - row->base) / row->base);
+    }
+    fprintf(out, "%14s %14s %9s %6.0f%%  %s\n",
+            row->base <= 0.0 ? "-" : format_value(row->name, row->base, base, sizeof(base)),
+            row->current <= 0.0 ? "-" : format_value(row->name, row->current, current, sizeof(current)), change,
+            row->tolerance, row->name);
+}
+
+int rune_baseline_compare(const rune_baseline_t *baseline, const rune_baseline_t *current,
+                          const rune_baseline_thresholds_t *thresholds, FILE *out) {
+    size_t capacity = baseline->names.count + current->names.count + 1;
+    baseline_row_t *rows = malloc(capacity * sizeof(baseline_row_t));
+    if (rows == NULL) {
+        perror("runescope: malloc failed for baseline comparison");
+        return -1;
+    }
+    size_t count = 0;
+    int found;
+    for (size_t i = 0; i < baseline->names.count; i++) {
+        const char *name = rune_intern_string(&baseline->names, (uint32_t)i);
+        double value = value_of(current, name, &found);
+        if (found || has_section(current, name)) {
+            rows[count++] = (baseline_row_t){ name, baseline->values[i], value, 0, 0, 0 };
+        }
+    }
+    for (size_t i = 0; i < current->names.count; i++) {
+        const char *name = rune_intern_string(&current->names, (uint32_t)i);
+        value_of(baseline, name, &found);
+        if (!found && has_section(baseline, name)) {
+            rows[count++] = (baseline_row_t){ name, 0.0, current->values[i], 0, 0, 0 };
+        }
+    }
+
+    size_t regressions = 0, improvements = 0;
+    for (size_t i = 0; i < count; i++) {
+        judge(&rows[i], thresholds);
+        regressions += rows[i].verdict > 0;
+        improvements += rows[i].verdict < 0;
+    }
+    qsort(rows, count, sizeof(baseline_row_t), compare_rows);
+
+    fprintf(out, "\n--- Baseline comparison: %zu regressions, %zu improvements, %zu metrics within tolerance ---\n",
+            regressions, improvements, count - regressions - improvements);
+    if (regressions + improvements > 0) {
+        fprintf(out, "%14s %14s %9s %7s  %s\n", "baseline", "current", "change", "limit", "metric");
+    }
+    for (size_t i = 0; i < regressions; i++) {
+        print_row(&rows[i], out);
+    }
+    size_t listed = improvements < MAX_LISTED_IMPROVEMENTS ? improvements : MAX_LISTED_IMPROVEMENTS;
+    if (listed > 0) {
+        fprintf(out, "Improvements:\n");
+    }
+    for (size_t i = count - improvements; i < count - improvements + listed; i++) {
+        print_row(&rows[i], out);
+    }
+    if (listed < improvements) {
+        fprintf(out, "(%zu more improvements)\n", improvements - listed);
+    }
+    free(rows);
+    return (int)regressions;
+}
+
+void rune_baseline_free(rune_baseline_t *baseline) {
+    rune_intern_free(&baseline->names);
+    free(baseline->values);
+    baseline->values = NULL;
+    baseline->capacity = 0;
+}
@@ -0,0 +1,126 @@
+#ifndef RUNE_BASELINE_H
+#define RUNE_BASELINE_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "rune_intern.h"
+#include "rune_store.h"
+
+/**
+ * @brief Aggregated run profiles saved as baselines and compared between builds.
+ *
+ * A profile is a flat set of named metrics: per-call counts, errors and time
+ * from the syscall and library call traces, allocation totals, and the
+ * median wall time and resource usage of untraced runs. Names are
+ * dot-separated, such as "syscall.openat.calls" or "run.max_rss_kb", and
+ * every metric is worse when it grows. The suffix of a name gives its unit:
+ * "_ns" for times, "_kb" and "_bytes" for sizes, anything else is a count.
+ *
+ * A baseline file is plain text, one "name value" line per metric after a
+ * "# runescope baseline 1" header, so it can be diffed and kept in version
+ * control next to the code it measures.
+ */
+
+typedef struct {
+    rune_intern_t names; // Metric name -> ID
+    double *values;      // By ID
+    size_t capacity;
+} rune_baseline_t;
+
+// A tolerance for the metrics whose names start with prefix
+typedef struct {
+    const char *prefix;
+    double percent;
+} rune_baseline_threshold_t;
+
+// When a metric that grew counts as a regression
+typedef struct {
+    double percent;                               // Default tolerance, in percent of the baseline value
+    const rune_baseline_threshold_t *overrides;   // The longest matching prefix wins over the default
+    size_t num_overrides;
+} rune_baseline_thresholds_t;
+
+/**
+ * @brief Initializes an empty profile.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_baseline_init(rune_baseline_t *baseline);
+
+/**
+ * @brief Adds to a metric, creating it at zero first if needed.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_baseline_add(rune_baseline_t *baseline, const char *name, double value);
+
+/**
+ * @brief Adds the calls, errors and time per name of a trace.
+ *
+ * Syscalls become "syscall.NAME.calls", ".errors" and, when the trace has
+ * durations, ".time_ns"; library calls become "libcall.NAME.calls". A
+ * library call trace that contains allocations also adds the "alloc.*"
+ * totals of rune_alloc_summarize.
+ *
+ * @param baseline The profile.
+ * @param store The parsed trace.
+ * @param is_strace 1 for syscalls, 0 for library calls.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_baseline_add_store(rune_baseline_t *baseline, const rune_store_t *store, int is_strace);
+
+/**
+ * @brief Runs the untraced target and adds the median of its resource usage.
+ *
+ * Adds "run.wall_ns", "run.user_ns", "run.sys_ns", "run.max_rss_kb",
+ * "run.minor_faults", "run.major_faults", "run.voluntary_switches" and
+ * "run.involuntary_switches". The target's stdout is discarded.
+ *
+ * @param baseline The profile.
+ * @param executable_path The absolute path to the target executable.
+ * @param argv_target The target's arguments, starting with argv[0].
+ * @param runs The number of runs to take the median of.
+ * @return 0 on success, -1 if the target could not be run.
+ */
+int rune_baseline_measure(rune_baseline_t *baseline, const char *executable_path, char *const argv_target[], int runs);
+
+/**
+ * @brief Writes a profile to a baseline file, metrics sorted by name.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int rune_baseline_save(const rune_baseline_t *baseline, const char *path);
+
+/**
+ * @brief Reads a baseline file into an initialized, empty profile.
+ *
+ * @return 0 on success, -1 if the file cannot be read or is not a baseline.
+ */
+int rune_baseline_load(rune_baseline_t *baseline, const char *path);
+
+/**
+ * @brief Compares a profile with a baseline and prints the changes, worst first.
+ *
+ * Changes are ranked by how far they go past their tolerance. A metric
+ * regresses when it grew by more than its tolerance and by more than a
+ * small absolute amount for its unit, so that a call count going from 1 to
+ * 2 is not reported as a 100% regression. Metrics that are new in the
+ * profile regress when they reach that amount. A section that is missing
+ * from the profile altogether (no library calls were traced, no untraced
+ * runs were made) is not compared.
+ *
+ * @param baseline The saved baseline.
+ * @param current The profile of this run.
+ * @param thresholds The tolerances.
+ * @param out The stream to print to.
+ * @return The number of regressions, or -1 on allocation failure.
+ */
+int rune_baseline_compare(const rune_baseline_t *baseline, const rune_baseline_t *current,
+                          const rune_baseline_thresholds_t *thresholds, FILE *out);
+
+/**
+ * @brief Releases the memory held by a profile.
+ */
+void rune_baseline_free(rune_baseline_t *baseline);
+
+#endif // RUNE_BASELINE_H
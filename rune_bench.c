@@ -0,0 +1,338 @@
+#include "rune_bench.h"
+#include "rune_exec.h"
+#include "rune_latency.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define SIGNIFICANCE 0.05
+#define LABEL_MAX 72
+
+typedef enum {
+    UNIT_TIME,
+    UNIT_KB,
+    UNIT_COUNT,
+} metric_unit_t;
+
+static const struct {
+    const char *name;
+    metric_unit_t unit;
+} metrics[] = {
+    { "wall", UNIT_TIME },
+    { "user", UNIT_TIME },
+    { "sys", UNIT_TIME },
+    { "max RSS", UNIT_KB },
+    { "minor faults", UNIT_COUNT },
+    { "major faults", UNIT_COUNT },
+    { "voluntary cs", UNIT_COUNT },
+    { "involuntary cs", UNIT_COUNT },
+};
+
+#define NUM_METRICS (sizeof(metrics) / sizeof(metrics[0]))
+
+static double metric_value(const rune_exec_usage_t *usage, size_t metric) {
+    switch (metric) {
+    case 0: return (double)usage->wall_ns;
+    case 1: return (double)usage->user_ns;
+    case 2: return (double)usage->sys_ns;
+    case 3: return (double)usage->max_rss_kb;
+    case 4: return (double)usage->minor_faults;
+    case 5: return (double)usage->major_faults;
+    case 6: return (double)usage->voluntary_switches;
+    default: return (double)usage->involuntary_switches;
+    }
+}
+
+static const char *format_value(metric_unit_t unit, double value, char *buf, size_t size) {
+    if (unit == UNIT_TIME) {
+        return rune_latency_format((int64_t)llround(value), buf, size);
+    }
+    if (unit == UNIT_KB) {
+        if (value >= 10240.0) {
+            snprintf(buf, size, "%.1fMB", value / 1024.0);
+        } else {
+            snprintf(buf, size, "%.0fKB", value);
+        }
+        return buf;
+    }
+    // Means of small counts keep a decimal, everything else is whole
+    snprintf(buf, size, value < 1000.0 && fabs(value - round(value)) >= 0.05 ? "%.1f" : "%.0f", value);
+    return buf;
+}
+
+// Continued fraction of the incomplete beta function (modified Lentz)
+static double beta_fraction(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1.0);
+    d = 1.0 / (fabs(d) < tiny ? tiny : d);
+    double h = d;
+    for (int m = 1; m <= 300; m++) {
+        double m2 = 2.0 * m;
+        double aa = m * (b - m) * x / ((a - 1.0 + m2) * (a + m2));
+        d = 1.0 + aa * d;
+        c = 1.0 + aa / c;
+        d = 1.0 / (fabs(d) < tiny ? tiny : d);
+        c = fabs(c) < tiny ? tiny : c;
+        h *= d * c;
+        aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + 1.0 + m2));
+        d = 1.0 + aa * d;
+        c = 1.0 + aa / c;
+        d = 1.0 / (fabs(d) < tiny ? tiny : d);
+        c = fabs(c) < tiny ? tiny : c;
+        double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1.0) < 1e-12) {
+            break;
+        }
+    }
+    return h;
+}
+
+// Regularized incomplete beta function I_x(a, b)
+static double beta_regularized(double a, double b, double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    if (x >= 1.0) {
+        return 1.0;
+    }
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+    if (x < (a + 1.0) / (a + b + 2.0)) {
+        return front * beta_fraction(a, b, x) / a;
+    }
+    return 1.0 - front * beta_fraction(b, a, 1.0 - x) / b;
+}
+
+// P(|T| >= t) for Student's t with df degrees of freedom
+static double student_two_sided_p(double t, double df) {
+    return beta_regularized(df / 2.0, 0.5, df / (df + t * t));
+}
+
+// The t with P(|T| >= t) = p, by bisection
+static double student_critical(double p, double df) {
+    double low = 0.0;
+    double high = 1000.0;
+    for (int i = 0; i < 100; i++) {
+        double mid = (low + high) / 2.0;
+        if (student_two_sided_p(mid, df) > p) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return (low + high) / 2.0;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Linear interpolation between the closest ranks of a sorted sample
+static double quantile(const double *sorted, size_t count, double q) {
+    double position = q * (double)(count - 1);
+    size_t below = (size_t)position;
+    if (below + 1 >= count) {
+        return sorted[count - 1];
+    }
+    return sorted[below] + (position - (double)below) * (sorted[below + 1] - sorted[below]);
+}
+
+void rune_bench_stats(double *values, size_t count, rune_bench_stats_t *stats) {
+    rune_bench_stats_t result = {0};
+    result.count = count;
+    if (count == 0) {
+        *stats = result;
+        return;
+    }
+    qsort(values, count, sizeof(values[0]), compare_doubles);
+
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    result.mean = sum / (double)count;
+    double squares = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        squares += (values[i] - result.mean) * (values[i] - result.mean);
+    }
+    result.stddev = count > 1 ? sqrt(squares / (double)(count - 1)) : 0.0;
+    result.median = quantile(values, count, 0.5);
+    result.min = values[0];
+    result.max = values[count - 1];
+
+    double margin = count > 1 ? student_critical(SIGNIFICANCE, (double)(count - 1)) * result.stddev / sqrt((double)count)
+                              : 0.0;
+    result.ci_low = result.mean - margin;
+    result.ci_high = result.mean + margin;
+
+    double q1 = quantile(values, count, 0.25);
+    double q3 = quantile(values, count, 0.75);
+    double fence = 1.5 * (q3 - q1);
+    for (size_t i = 0; i < count; i++) {
+        result.outliers += values[i] < q1 - fence || values[i] > q3 + fence;
+    }
+    *stats = result;
+}
+
+double rune_bench_welch_p(const rune_bench_stats_t *a, const rune_bench_stats_t *b) {
+    if (a->count < 2 || b->count < 2) {
+        return 1.0;
+    }
+    double va = a->stddev * a->stddev / (double)a->count;
+    double vb = b->stddev * b->stddev / (double)b->count;
+    if (va + vb == 0.0) {
+        return a->mean == b->mean ? 1.0 : 0.0; // No noise at all: any difference is real
+    }
+    double t = (a->mean - b->mean) / sqrt(va + vb);
+    double df = (va + vb) * (va + vb) / (va * va / (double)(a->count - 1) + vb * vb / (double)(b->count - 1));
+    return student_two_sided_p(t, df);
+}
+
+static void format_command(const rune_bench_command_t *command, char *buf, size_t size) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (size_t i = 0; command->argv[i] != NULL && used + 1 < size; i++) {
+        int n = snprintf(buf + used, size - used, "%s%s", i > 0 ? " " : "", command->argv[i]);
+        if (n < 0) {
+            break;
+        }
+        used += (size_t)n;
+    }
+    if (used >= size && size > 4) {
+        snprintf(buf + size - 4, 4, "...");
+    }
+}
+
+static void print_command_report(const rune_bench_command_t *command, const char *tag, const rune_exec_usage_t *samples,
+                                 const rune_bench_stats_t *stats, const rune_bench_options_t *options, FILE *out) {
+    char label[LABEL_MAX];
+    format_command(command, label, sizeof(label));
+    fprintf(out, "\n--- Benchmark%s%s: %s (%d runs after %d warmup", tag[0] ? " " : "", tag, label, options->runs,
+            options->warmup);
+    if (options->cpu >= 0) {
+        fprintf(out, ", pinned to CPU %d", options->cpu);
+    }
+    fprintf(out, ") ---\n");
+
+    char cells[5][32];
+    fprintf(out, "%-16s %12s %12s %12s %12s %12s\n", "metric", "mean", "stddev", "median", "min", "max");
+    for (size_t m = 0; m < NUM_METRICS; m++) {
+        const rune_bench_stats_t *s = &stats[m];
+        metric_unit_t unit = metrics[m].unit;
+        fprintf(out, "%-16s %12s %12s %12s %12s %12s\n", metrics[m].name,
+                format_value(unit, s->mean, cells[0], sizeof(cells[0])),
+                format_value(unit, s->stddev, cells[1], sizeof(cells[1])),
+                format_value(unit, s->median, cells[2], sizeof(cells[2])),
+                format_value(unit, s->min, cells[3], sizeof(cells[3])),
+                format_value(unit, s->max, cells[4], sizeof(cells[4])));
+    }
+
+    const rune_bench_stats_t *wall = &stats[0];
+    fprintf(out, "Wall time 95%% CI of the mean: [%s, %s]", format_value(UNIT_TIME, wall->ci_low, cells[0], sizeof(cells[0])),
+            format_value(UNIT_TIME, wall->ci_high, cells[1], sizeof(cells[1])));
+    if (wall->mean > 0.0) {
+        fprintf(out, " (+/- %.1f%%)", 100.0 * (wall->ci_high - wall->mean) / wall->mean);
+    }
+    fprintf(out, "\n");
+    if (wall->outliers > 0) {
+        fprintf(out, "Outliers: %zu of %zu wall times lie outside 1.5 IQR of the quartiles; "
+                "the system may be noisy (try --pin or more --warmup)\n", wall->outliers, wall->count);
+    }
+
+    size_t failed = 0;
+    int last_status = 0;
+    for (size_t r = 0; r < wall->count; r++) {
+        if (samples[r].exit_status != 0) {
+            failed++;
+            last_status = samples[r].exit_status;
+        }
+    }
+    if (failed > 0) {
+        fprintf(out, "Warning: %zu of %zu runs did not exit with status 0 (last: %d%s)\n", failed, wall->count,
+                last_status, last_status == -1 ? ", killed by a signal" : "");
+    }
+}
+
+static void print_comparison(const rune_bench_stats_t *a, const rune_bench_stats_t *b, FILE *out) {
+    char cells[2][32];
+    fprintf(out, "\n--- A/B comparison (Welch's t-test, * = significant at the 95%% level) ---\n");
+    fprintf(out, "%-16s %12s %12s %10s %10s\n", "metric", "A mean", "B mean", "B vs A", "p-value");
+    for (size_t m = 0; m < NUM_METRICS; m++) {
+        double p = rune_bench_welch_p(&a[m], &b[m]);
+        fprintf(out, "%-16s %12s %12s ", metrics[m].name,
+                format_value(metrics[m].unit, a[m].mean, cells[0], sizeof(cells[0])),
+                format_value(metrics[m].unit, b[m].mean, cells[1], sizeof(cells[1])));
+        if (a[m].mean > 0.0) {
+            fprintf(out, "%+9.1f%% ", 100.0 * (b[m].mean - a[m].mean) / a[m].mean);
+        } else {
+            fprintf(out, "%10s ", "-");
+        }
+        fprintf(out, "%10.4f%s\n", p, p < SIGNIFICANCE ? " *" : "");
+    }
+
+    double p = rune_bench_welch_p(&a[0], &b[0]);
+    if (p >= SIGNIFICANCE || a[0].mean <= 0.0 || b[0].mean <= 0.0) {
+        fprintf(out, "Result: no statistically significant difference in wall time (p = %.4f); "
+                "more runs can resolve a smaller difference.\n", p);
+    } else if (b[0].mean < a[0].mean) {
+        fprintf(out, "Result: B is %.3fx faster than A in wall time (p = %.4f).\n", a[0].mean / b[0].mean, p);
+    } else {
+        fprintf(out, "Result: B is %.3fx slower than A in wall time (p = %.4f).\n", b[0].mean / a[0].mean, p);
+    }
+}
+
+int rune_bench_run(const rune_bench_command_t *commands, size_t num_commands, const rune_bench_options_t *options,
+                   FILE *out) {
+    size_t runs = options->runs > 0 ? (size_t)options->runs : 1;
+    int quiet = !options->show_output;
+    rune_exec_usage_t *samples = calloc(num_commands * runs, sizeof(*samples));
+    double *values = malloc(runs * sizeof(*values));
+    rune_bench_stats_t (*stats)[NUM_METRICS] = calloc(num_commands, sizeof(*stats));
+    if (samples == NULL || values == NULL || stats == NULL) {
+        perror("runescope: malloc failed for benchmark samples");
+        free(samples);
+        free(values);
+        free(stats);
+        return -1;
+    }
+
+    // Commands take turns so that slow drift (thermal, page cache, other load) affects all alike
+    int result = 0;
+    rune_exec_usage_t discarded;
+    for (int w = 0; w < options->warmup && result == 0; w++) {
+        for (size_t c = 0; c < num_commands && result == 0; c++) {
+            result = rune_exec_run_measured(commands[c].executable_path, commands[c].argv, options->cpu, quiet,
+                                            &discarded);
+        }
+    }
+    for (size_t r = 0; r < runs && result == 0; r++) {
+        for (size_t c = 0; c < num_commands && result == 0; c++) {
+            result = rune_exec_run_measured(commands[c].executable_path, commands[c].argv, options->cpu, quiet,
+                                            &samples[c * runs + r]);
+        }
+    }
+
+    if (result == 0) {
+        for (size_t c = 0; c < num_commands; c++) {
+            for (size_t m = 0; m < NUM_METRICS; m++) {
+                for (size_t r = 0; r < runs; r++) {
+                    values[r] = metric_value(&samples[c * runs + r], m);
+                }
+                rune_bench_stats(values, runs, &stats[c][m]);
+            }
+            const char *tag = num_commands == 1 ? "" : (c == 0 ? "A" : "B");
+            print_command_report(&commands[c], tag, &samples[c * runs], stats[c], options, out);
+        }
+        if (num_commands == 2) {
+            print_comparison(stats[0], stats[1], out);
+        }
+    }
+
+    free(samples);
+    free(values);
+    free(stats);
+    return result;
+}
@@ -0,0 +1,75 @@
+#ifndef RUNE_BENCH_H
+#define RUNE_BENCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @brief Repeatable benchmarking of untraced runs.
+ *
+ * Each command is run a number of times after some unmeasured warmup runs.
+ * Every run is measured by wall clock and by wait4 rusage, and each metric
+ * is summarized with its mean, median, standard deviation, extremes, a 95%
+ * confidence interval of the mean and Tukey outliers. Two commands are run
+ * interleaved (A, B, A, B, ...) so that drift in the machine's state hits
+ * both alike, and are compared with Welch's t-test.
+ */
+
+// How to benchmark
+typedef struct {
+    int runs;        // Measured runs per command
+    int warmup;      // Unmeasured runs per command before the measured ones
+    int cpu;         // CPU to pin the runs to, -1 to let the scheduler decide
+    int show_output; // Let the target's stdout through instead of discarding it
+} rune_bench_options_t;
+
+// One command to benchmark
+typedef struct {
+    const char *executable_path; // Resolved path of the program
+    char *const *argv;           // Its arguments, starting with argv[0], NULL-terminated
+} rune_bench_command_t;
+
+// Summary of one metric over the measured runs
+typedef struct {
+    size_t count;
+    double mean;
+    double median;
+    double stddev;   // Sample standard deviation
+    double min;
+    double max;
+    double ci_low;   // 95% confidence interval of the mean (Student's t)
+    double ci_high;
+    size_t outliers; // Values outside the 1.5 * IQR fences around the quartiles
+} rune_bench_stats_t;
+
+/**
+ * @brief Summarizes a sample.
+ *
+ * @param values The sample; sorted in place.
+ * @param count The number of values.
+ * @param stats Receives the summary.
+ */
+void rune_bench_stats(double *values, size_t count, rune_bench_stats_t *stats);
+
+/**
+ * @brief Welch's t-test for a difference between the means of two samples.
+ *
+ * @param a The summary of the first sample.
+ * @param b The summary of the second sample.
+ * @return The two-sided p-value of the hypothesis that the means are equal.
+ */
+double rune_bench_welch_p(const rune_bench_stats_t *a, const rune_bench_stats_t *b);
+
+/**
+ * @brief Benchmarks one command, or compares two, and prints the results.
+ *
+ * @param commands The commands: one, or two for an A/B comparison.
+ * @param num_commands 1 or 2.
+ * @param options The number of runs, warmup runs and CPU pinning.
+ * @param out The stream to print to.
+ * @return 0 on success, -1 if a run could not be started or on allocation failure.
+ */
+int rune_bench_run(const rune_bench_command_t *commands, size_t num_commands, const rune_bench_options_t *options,
+                   FILE *out);
+
+#endif // RUNE_BENCH_H
@@ -0,0 +1,269 @@
+#define _GNU_SOURCE // For memmem and CLONE_THREAD
+#include "rune_chrome.h"
+#include <sched.h> // For CLONE_THREAD
+#include <stdlib.h>
+#include <string.h>
+
+#define WRITE_BUFFER_SIZE (1 << 20)
+#define INITIAL_THREAD_CAPACITY 64
+#define MAX_ARGS_LEN 256 // Longer argument text is cut, like strace -s does
+
+static size_t thread_hash(long tid, size_t capacity) {
+    return ((size_t)tid * 2654435761u) & (capacity - 1);
+}
+
+static int thread_table_grow(rune_chrome_writer_t *writer) {
+    size_t capacity = writer->capacity * 2;
+    rune_chrome_thread_t *slots = calloc(capacity, sizeof(rune_chrome_thread_t));
+    if (slots == NULL) {
+        perror("runescope: calloc failed for trace threads");
+        return -1;
+    }
+    for (size_t i = 0; i < writer->capacity; i++) {
+        if (writer->threads[i].tid != 0) {
+            size_t j = thread_hash(writer->threads[i].tid, capacity);
+            while (slots[j].tid != 0) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots[j] = writer->threads[i];
+        }
+    }
+    free(writer->threads);
+    writer->threads = slots;
+    writer->capacity = capacity;
+    return 0;
+}
+
+// Finds a thread, adding it as a process of its own if it is new
+static rune_chrome_thread_t *thread_get(rune_chrome_writer_t *writer, long tid) {
+    if ((writer->count + 1) * 4 > writer->capacity * 3 && thread_table_grow(writer) == -1) {
+        return NULL;
+    }
+    size_t i = thread_hash(tid, writer->capacity);
+    while (writer->threads[i].tid != 0 && writer->threads[i].tid != tid) {
+        i = (i + 1) & (writer->capacity - 1);
+    }
+    rune_chrome_thread_t *thread = &writer->threads[i];
+    if (thread->tid == 0) {
+        thread->tid = tid;
+        thread->tgid = tid;
+        writer->count++;
+    }
+    return thread;
+}
+
+static void begin_record(rune_chrome_writer_t *writer) {
+    fputs(writer->wrote_any ? ",\n" : "\n", writer->file);
+    writer->wrote_any = 1;
+}
+
+// Writes a JSON string literal; bytes outside printable ASCII are escaped
+static void write_string(FILE *file, const char *text, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    size_t limit = len > MAX_ARGS_LEN ? MAX_ARGS_LEN : len;
+    putc('"', file);
+    for (size_t i = 0; i < limit; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            putc('\\', file);
+            putc(c, file);
+        } else if (c < 0x20 || c >= 0x7f) {
+            fputs("\\u00", file);
+            putc(hex[c >> 4], file);
+            putc(hex[c & 0xf], file);
+        } else {
+            putc(c, file);
+        }
+    }
+    if (limit < len) {
+        fputs("...", file);
+    }
+    putc('"', file);
+}
+
+// Trace Event timestamps are microseconds; keep nanosecond precision in the fraction
+static void write_us(FILE *file, int64_t ns) {
+    if (ns < 0) {
+        putc('-', file);
+        ns = -ns;
+    }
+    fprintf(file, "%lld.%03lld", (long long)(ns / 1000), (long long)(ns % 1000));
+}
+
+static void write_common(rune_chrome_writer_t *writer, const char *phase, const rune_chrome_thread_t *thread,
+                         int64_t timestamp_ns) {
+    fprintf(writer->file, "{\"ph\":\"%s\",\"pid\":%ld,\"tid\":%ld,\"ts\":", phase, thread->tgid, thread->tid);
+    write_us(writer->file, timestamp_ns - writer->base_ns);
+}
+
+static void write_flow(rune_chrome_writer_t *writer, const char *phase, const rune_chrome_thread_t *thread,
+                       int64_t timestamp_ns, long id, const char *name) {
+    begin_record(writer);
+    write_common(writer, phase, thread, timestamp_ns);
+    fprintf(writer->file, ",\"id\":%ld,\"cat\":\"process\",\"name\":\"%s\"%s}", id, name,
+            phase[0] == 'f' ? ",\"bp\":\"e\"" : "");
+}
+
+// Prepares the thread of an event: sets the time base and finishes a flow waiting for it
+static rune_chrome_thread_t *start_event(rune_chrome_writer_t *writer, long tid, int64_t timestamp_ns) {
+    if (timestamp_ns == 0) {
+        writer->untimed++;
+        return NULL;
+    }
+    if (writer->base_ns == 0) {
+        writer->base_ns = timestamp_ns;
+    }
+    rune_chrome_thread_t *thread = thread_get(writer, tid);
+    if (thread == NULL) {
+        return NULL;
+    }
+    if (thread->first_ns == 0) {
+        thread->first_ns = timestamp_ns;
+    }
+    if (thread->pending_flow != 0) {
+        write_flow(writer, "f", thread, timestamp_ns, thread->pending_flow, thread->pending_name);
+        thread->pending_flow = 0;
+    }
+    return thread;
+}
+
+// The program name is execve's first argument, a quoted path
+static void name_process(rune_chrome_writer_t *writer, const rune_chrome_thread_t *thread, rune_strview_t args) {
+    const char *start = memchr(args.ptr, '"', args.len);
+    const char *end = start != NULL ? memchr(start + 1, '"', args.len - (size_t)(start + 1 - args.ptr)) : NULL;
+    if (end == NULL) {
+        return;
+    }
+    begin_record(writer);
+    fprintf(writer->file, "{\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"name\":\"process_name\",\"args\":{\"name\":",
+            thread->tgid, thread->tid);
+    write_string(writer->file, start + 1, (size_t)(end - start - 1));
+    fputs("}}", writer->file);
+}
+
+static void link_child(rune_chrome_writer_t *writer, const rune_chrome_thread_t *parent, const strace_entry_t *entry) {
+    long child_tid = entry->return_value;
+    rune_chrome_thread_t parent_copy = *parent; // The table may grow and move parent
+    rune_chrome_thread_t *child = thread_get(writer, child_tid);
+    if (child == NULL) {
+        return;
+    }
+    int is_thread = memmem(entry->args.ptr, entry->args.len, "CLONE_THREAD", 12) != NULL;
+    if (!is_thread && rune_strview_equals(entry->syscall_name, "clone") && entry->args.len > 2 &&
+        memcmp(entry->args.ptr, "0x", 2) == 0) {
+        is_thread = (strtoul(entry->args.ptr, NULL, 16) & CLONE_THREAD) != 0; // The native tracer logs raw flags
+    }
+    const char *name = is_thread ? "thread" : "fork";
+    long id = ++writer->next_flow_id;
+    write_flow(writer, "s", &parent_copy, entry->timestamp_ns, id, name);
+    if (child->first_ns != 0) {
+        // The child ran before the call returned in the parent; its events are already written
+        write_flow(writer, "f", child, child->first_ns, id, name);
+        return;
+    }
+    child->tgid = is_thread ? parent_copy.tgid : child_tid;
+    child->pending_flow = id;
+    child->pending_name = name;
+}
+
+void rune_chrome_add_strace_entry(const strace_entry_t *entry, void *user_data) {
+    rune_chrome_writer_t *writer = user_data;
+    rune_chrome_thread_t *thread = start_event(writer, entry->pid, entry->timestamp_ns);
+    if (thread == NULL) {
+        return;
+    }
+    FILE *file = writer->file;
+    int timed = entry->duration_ns >= 0 && !entry->unfinished;
+    begin_record(writer);
+    write_common(writer, timed ? "X" : "i", thread, entry->timestamp_ns);
+    if (timed) {
+        fputs(",\"dur\":", file);
+        write_us(file, entry->duration_ns);
+    } else {
+        fputs(",\"s\":\"t\"", file);
+    }
+    fputs(",\"cat\":\"syscall\",\"name\":", file);
+    write_string(file, entry->syscall_name.ptr, entry->syscall_name.len);
+    fputs(",\"args\":{\"args\":", file);
+    write_string(file, entry->args.ptr, entry->args.len);
+    if (entry->unfinished) {
+        fputs(",\"unfinished\":true", file);
+    } else if (entry->has_error) {
+        fputs(",\"error\":", file);
+        write_string(file, entry->error_str.ptr, entry->error_str.len);
+    } else {
+        fprintf(file, ",\"ret\":%ld", entry->return_value);
+    }
+    fputs("}}", file);
+    writer->events++;
+
+    if (entry->has_error || entry->unfinished) {
+        return;
+    }
+    if ((rune_strview_equals(entry->syscall_name, "clone") || rune_strview_equals(entry->syscall_name, "clone3") ||
+         rune_strview_equals(entry->syscall_name, "fork") || rune_strview_equals(entry->syscall_name, "vfork")) &&
+        entry->return_value > 0) {
+        link_child(writer, thread, entry);
+    } else if (rune_strview_equals(entry->syscall_name, "execve") || rune_strview_equals(entry->syscall_name, "execveat")) {
+        name_process(writer, thread, entry->args);
+        thread->pending_flow = ++writer->next_flow_id;
+        thread->pending_name = "exec";
+        write_flow(writer, "s", thread, entry->timestamp_ns, thread->pending_flow, "exec");
+    }
+}
+
+void rune_chrome_add_ltrace_entry(const ltrace_entry_t *entry, void *user_data) {
+    rune_chrome_writer_t *writer = user_data;
+    rune_chrome_thread_t *thread = start_event(writer, entry->pid, entry->timestamp_ns);
+    if (thread == NULL) {
+        return;
+    }
+    FILE *file = writer->file;
+    begin_record(writer);
+    write_common(writer, "i", thread, entry->timestamp_ns);
+    fputs(",\"s\":\"t\",\"cat\":\"libcall\",\"name\":", file);
+    write_string(file, entry->function_name.ptr, entry->function_name.len);
+    fputs(",\"args\":{\"args\":", file);
+    write_string(file, entry->args.ptr, entry->args.len);
+    fprintf(file, ",\"ret\":%ld}}", entry->return_value);
+    writer->events++;
+}
+
+int rune_chrome_open(rune_chrome_writer_t *writer, const char *path) {
+    memset(writer, 0, sizeof(*writer));
+    writer->threads = calloc(INITIAL_THREAD_CAPACITY, sizeof(rune_chrome_thread_t));
+    writer->buffer = malloc(WRITE_BUFFER_SIZE);
+    if (writer->threads == NULL || writer->buffer == NULL) {
+        perror("runescope: malloc failed for trace writer");
+        free(writer->threads);
+        free(writer->buffer);
+        return -1;
+    }
+    writer->capacity = INITIAL_THREAD_CAPACITY;
+    writer->file = fopen(path, "w");
+    if (writer->file == NULL) {
+        perror("runescope: Failed to create trace file");
+        free(writer->threads);
+        free(writer->buffer);
+        return -1;
+    }
+    setvbuf(writer->file, writer->buffer, _IOFBF, WRITE_BUFFER_SIZE);
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", writer->file);
+    return 0;
+}
+
+int rune_chrome_close(rune_chrome_writer_t *writer) {
+    fprintf(writer->file, "\n],\"otherData\":{\"producer\":\"runescope\",\"base_time_ns\":%lld}}\n",
+            (long long)writer->base_ns);
+    int failed = ferror(writer->file);
+    if (fclose(writer->file) != 0 || failed) {
+        perror("runescope: Failed to write trace file");
+        failed = 1;
+    }
+    free(writer->buffer);
+    free(writer->threads);
+    writer->file = NULL;
+    writer->buffer = NULL;
+    writer->threads = NULL;
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,85 @@
+#ifndef RUNE_CHROME_H
+#define RUNE_CHROME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "rune_strace_parser.h"
+#include "rune_ltrace_parser.h"
+
+/**
+ * @brief Chrome Trace Event JSON export, for chrome://tracing and Perfetto.
+ *
+ * Every event is written as soon as it is added, so memory use depends on
+ * the number of threads in the trace and not on the number of events.
+ * Timed syscalls become complete ("X") events on their thread's track,
+ * syscalls without a duration and library calls become instant events.
+ * fork, vfork and clone draw a flow arrow from the call to the first event
+ * of the child, and a successful execve one from the call to the first
+ * event after it, which also names the process after the new program.
+ * Threads are grouped under the process that created them with
+ * CLONE_THREAD; a thread that logs before its clone returns in the parent
+ * shows up as a process of its own, though its flow arrow is still drawn. Timestamps are relative to the first
+ * event; its wall clock time is stored in the file's metadata.
+ */
+
+// Per-thread state, kept in an open-addressing table keyed by tid
+typedef struct {
+    long tid;            // 0 = empty slot
+    long tgid;           // The process its events are grouped under
+    long pending_flow;   // Flow to finish at this thread's next event, 0 = none
+    const char *pending_name; // "fork", "thread" or "exec"; both ends of a flow carry its name
+    int64_t first_ns;    // Timestamp of its first event, 0 = none written yet
+} rune_chrome_thread_t;
+
+typedef struct {
+    FILE *file;
+    char *buffer;                  // stdio buffer for file
+    rune_chrome_thread_t *threads;
+    size_t capacity;               // Always a power of two
+    size_t count;
+    int64_t base_ns;               // Wall clock time of the first event, 0 until there is one
+    long next_flow_id;
+    size_t events;                 // Events written, metadata and flows excluded
+    size_t untimed;                // Entries skipped because the trace has no timestamps
+    int wrote_any;                 // A record has been written, the next needs a comma
+} rune_chrome_writer_t;
+
+/**
+ * @brief Creates a trace file and writes its header.
+ *
+ * @param writer The writer to initialize.
+ * @param path The file to create or overwrite.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_chrome_open(rune_chrome_writer_t *writer, const char *path);
+
+/**
+ * @brief Writes a syscall.
+ *
+ * Matches rune_strace_entry_cb, so it can be handed to a parser or the native tracer.
+ *
+ * @param entry The syscall. Entries without a timestamp are counted and skipped.
+ * @param user_data The rune_chrome_writer_t.
+ */
+void rune_chrome_add_strace_entry(const strace_entry_t *entry, void *user_data);
+
+/**
+ * @brief Writes a library call as an instant event.
+ *
+ * Matches rune_ltrace_entry_cb.
+ *
+ * @param entry The library call. Entries without a timestamp are counted and skipped.
+ * @param user_data The rune_chrome_writer_t.
+ */
+void rune_chrome_add_ltrace_entry(const ltrace_entry_t *entry, void *user_data);
+
+/**
+ * @brief Finishes the JSON document, closes the file and frees the writer.
+ *
+ * @param writer The writer.
+ * @return 0 on success, -1 if any write failed.
+ */
+int rune_chrome_close(rune_chrome_writer_t *writer);
+
+#endif // RUNE_CHROME_H
@@ -0,0 +1,212 @@
+#define _GNU_SOURCE // For syscall
+#include "rune_counters.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+// Events in the order they are opened; events sharing a group number > 0 are
+// scheduled on the PMU together, group 0 events stand alone
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    int group;
+} counter_events[] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 1 },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 1 },
+    { "branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, 1 },
+    { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, 1 },
+    { "cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES, 2 },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 2 },
+    { "task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, 0 },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, 0 },
+    { "cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, 0 },
+    { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, 0 },
+    { "major-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ, 0 },
+};
+
+#define NUM_EVENTS (sizeof(counter_events) / sizeof(counter_events[0]))
+
+// Unprivileged users may only count user space at perf_event_paranoid >= 2
+static int must_exclude_kernel(void) {
+    if (geteuid() == 0) {
+        return 0;
+    }
+    FILE *f = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+    int level = 2;
+    if (f != NULL) {
+        if (fscanf(f, "%d", &level) != 1) {
+            level = 2;
+        }
+        fclose(f);
+    }
+    return level >= 2;
+}
+
+static int open_event(rune_counters_t *counters, size_t event, pid_t pid, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter_events[event].type;
+    attr.config = counter_events[event].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1;
+    if (group_fd == -1) {
+        // Group members follow their leader
+        attr.disabled = 1;
+        attr.enable_on_exec = 1;
+    }
+    for (;;) {
+        attr.exclude_kernel = counters->user_only;
+        attr.exclude_hv = counters->user_only;
+        int fd = (int)syscall(SYS_perf_event_open, &attr, pid, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+        if (fd == -1 && (errno == EACCES || errno == EPERM) && !counters->user_only) {
+            counters->user_only = 1; // Retry without kernel activity
+            continue;
+        }
+        return fd;
+    }
+}
+
+int rune_counters_open(rune_counters_t *counters, pid_t pid) {
+    memset(counters, 0, sizeof(*counters));
+    counters->user_only = must_exclude_kernel();
+    int opened = 0;
+    int leader_fd = -1;
+    int leader_group = 0;
+
+    for (size_t i = 0; i < NUM_EVENTS && i < RUNE_COUNTERS_MAX; i++) {
+        rune_counter_t *counter = &counters->counters[counters->count++];
+        counter->name = counter_events[i].name;
+        counter->fd = -1;
+        int group = counter_events[i].group;
+        if (group != 0 && group == leader_group && leader_fd == -1) {
+            continue; // The group's leader could not be opened
+        }
+        int is_member = group != 0 && group == leader_group;
+        counter->fd = open_event(counters, i, pid, is_member ? leader_fd : -1);
+        if (!is_member) {
+            leader_group = group;
+            leader_fd = counter->fd;
+        }
+        if (counter->fd == -1) {
+            if (errno != ENOENT && errno != ENODEV && errno != EOPNOTSUPP && errno != EINVAL) {
+                fprintf(stderr, "runescope: perf_event_open failed for %s: %s\n", counter->name, strerror(errno));
+            }
+            continue;
+        }
+        counter->available = 1;
+        counters->hardware |= counter_events[i].type == PERF_TYPE_HARDWARE;
+        opened++;
+    }
+    if (opened == 0) {
+        fprintf(stderr, "runescope: Error: No performance counters could be opened (check perf_event_paranoid).\n");
+        return -1;
+    }
+    return 0;
+}
+
+void rune_counters_read(rune_counters_t *counters) {
+    for (size_t i = 0; i < counters->count; i++) {
+        rune_counter_t *counter = &counters->counters[i];
+        uint64_t values[3];
+        if (counter->fd == -1) {
+            continue;
+        }
+        if (read(counter->fd, values, sizeof(values)) == (ssize_t)sizeof(values)) {
+            counter->raw = values[0];
+            counter->time_enabled = values[1];
+            counter->time_running = values[2];
+            if (counter->time_running > 0 && counter->time_running < counter->time_enabled) {
+                counter->value = (uint64_t)((double)counter->raw * (double)counter->time_enabled /
+                                            (double)counter->time_running);
+            } else {
+                counter->value = counter->raw;
+            }
+        } else {
+            perror("runescope: read failed for performance counter");
+            counter->available = 0;
+        }
+    }
+    rune_counters_close(counters);
+}
+
+void rune_counters_close(rune_counters_t *counters) {
+    for (size_t i = 0; i < counters->count; i++) {
+        if (counters->counters[i].fd != -1) {
+            close(counters->counters[i].fd);
+            counters->counters[i].fd = -1;
+        }
+    }
+}
+
+// Returns a counter that was counted, or NULL
+static const rune_counter_t *find_counter(const rune_counters_t *counters, const char *name) {
+    for (size_t i = 0; i < counters->count; i++) {
+        const rune_counter_t *counter = &counters->counters[i];
+        if (strcmp(counter->name, name) == 0) {
+            return counter->available && counter->time_running > 0 ? counter : NULL;
+        }
+    }
+    return NULL;
+}
+
+static double ratio(const rune_counter_t *num, const rune_counter_t *den) {
+    return num != NULL && den != NULL && den->value > 0 ? (double)num->value / (double)den->value : -1.0;
+}
+
+void rune_counters_print(const rune_counters_t *counters, FILE *out) {
+    const rune_counter_t *task_clock = find_counter(counters, "task-clock");
+    const rune_counter_t *cycles = find_counter(counters, "cycles");
+    double seconds = task_clock != NULL ? (double)task_clock->value / 1e9 : 0.0;
+
+    fprintf(out, "\n--- Performance counters%s%s ---\n", counters->user_only ? " (user space only)" : "",
+            counters->hardware ? "" : " (no hardware PMU: software events only)");
+    for (size_t i = 0; i < counters->count; i++) {
+        const rune_counter_t *counter = &counters->counters[i];
+        if (!counter->available) {
+            if (counters->hardware || counter_events[i].type != PERF_TYPE_HARDWARE) {
+                fprintf(out, "%20s  %-18s\n", "<not supported>", counter->name);
+            }
+            continue;
+        }
+        if (counter->time_running == 0) {
+            fprintf(out, "%20s  %-18s\n", "<not counted>", counter->name);
+            continue;
+        }
+
+        if (counter == task_clock) {
+            fprintf(out, "%20.2f  %-18s", (double)counter->value / 1e6, "task-clock (msec)");
+        } else {
+            fprintf(out, "%20llu  %-18s", (unsigned long long)counter->value, counter->name);
+        }
+
+        double r = -1.0;
+        if (counter == task_clock && counters->wall_ns > 0) {
+            fprintf(out, " # %8.3f CPUs utilized", (double)counter->value / (double)counters->wall_ns);
+        } else if (counter == cycles && task_clock != NULL && task_clock->value > 0) {
+            fprintf(out, " # %8.3f GHz", (double)counter->value / (double)task_clock->value);
+        } else if (strcmp(counter->name, "instructions") == 0 && (r = ratio(counter, cycles)) >= 0) {
+            fprintf(out, " # %8.2f insn per cycle", r);
+        } else if (strcmp(counter->name, "branch-misses") == 0 &&
+                   (r = ratio(counter, find_counter(counters, "branches"))) >= 0) {
+            fprintf(out, " # %8.2f%% of all branches", 100.0 * r);
+        } else if (strcmp(counter->name, "cache-misses") == 0 &&
+                   (r = ratio(counter, find_counter(counters, "cache-references"))) >= 0) {
+            fprintf(out, " # %8.2f%% of all cache refs", 100.0 * r);
+        } else if (counter_events[i].type == PERF_TYPE_SOFTWARE && counter != task_clock && seconds > 0) {
+            fprintf(out, " # %8.3f K/sec", (double)counter->value / seconds / 1e3);
+        }
+        if (counter->time_running < counter->time_enabled) {
+            fprintf(out, "  (scaled, counted %.2f%% of the time)",
+                    100.0 * (double)counter->time_running / (double)counter->time_enabled);
+        }
+        fprintf(out, "\n");
+    }
+    if (counters->wall_ns > 0) {
+        fprintf(out, "%20.6f  seconds time elapsed\n", (double)counters->wall_ns / 1e9);
+    }
+}
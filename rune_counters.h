@@ -0,0 +1,75 @@
+#ifndef RUNE_COUNTERS_H
+#define RUNE_COUNTERS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * @brief Hardware and software performance counters through perf_event_open.
+ *
+ * Counters are opened on a forked child before it calls execve. They start
+ * counting at the exec and are inherited by every thread and child process
+ * the target creates. Hardware events are opened in groups so that ratios
+ * such as instructions per cycle come from the same scheduling intervals.
+ * Where the CPU's PMU is not available (common in VMs and containers) only
+ * the software events are counted.
+ */
+
+#define RUNE_COUNTERS_MAX 16
+
+// One counter and its final reading
+typedef struct {
+    const char *name;
+    int fd;                 // -1 when not open
+    int available;          // The kernel accepted the event
+    uint64_t raw;           // Count while the event was actually on the PMU
+    uint64_t time_enabled;  // ns the event was enabled
+    uint64_t time_running;  // ns it was scheduled; less than time_enabled when multiplexed
+    uint64_t value;         // raw scaled up to time_enabled
+} rune_counter_t;
+
+typedef struct {
+    rune_counter_t counters[RUNE_COUNTERS_MAX];
+    size_t count;
+    int hardware;           // At least one hardware event could be opened
+    int user_only;          // Kernel activity is excluded (perf_event_paranoid)
+    int64_t wall_ns;        // Wall clock time from exec to exit, set by the caller
+} rune_counters_t;
+
+/**
+ * @brief Opens the counters on a process that has not called execve yet.
+ *
+ * The counters are created disabled with enable_on_exec and inherit set,
+ * so they cover the program the process execs and all of its descendants.
+ *
+ * @param counters The counter set to fill.
+ * @param pid The process to count.
+ * @return 0 if at least one counter could be opened, -1 otherwise.
+ */
+int rune_counters_open(rune_counters_t *counters, pid_t pid);
+
+/**
+ * @brief Reads the final values of all counters and closes them.
+ *
+ * Call once the counted process has exited. Counts of multiplexed events
+ * are scaled up by time_enabled / time_running.
+ *
+ * @param counters The counter set.
+ */
+void rune_counters_read(rune_counters_t *counters);
+
+/**
+ * @brief Closes all counters without reading them.
+ */
+void rune_counters_close(rune_counters_t *counters);
+
+/**
+ * @brief Prints the counts with derived ratios (IPC, miss rates, CPU utilization).
+ *
+ * @param counters The counter set, after rune_counters_read.
+ * @param out The stream to print to.
+ */
+void rune_counters_print(const rune_counters_t *counters, FILE *out);
+
+#endif // RUNE_COUNTERS_H
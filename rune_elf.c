@@ -0,0 +1,816 @@
+#define _GNU_SOURCE // For realpath, strdup and flockfile
+#include "rune_elf.h"
+#include <elf.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef DT_RELR
+#define DT_RELRSZ 35
+#define DT_RELR 36
+#endif
+
+#define LD_SO_CACHE "/etc/ld.so.cache"
+#define CACHE_MAGIC "glibc-ld.so.cache1.1"
+#define MAX_DEPENDENCIES 4096
+
+static const char *const default_dirs[] = { "/lib64", "/usr/lib64", "/lib", "/usr/lib" };
+
+// A mapped ELF file
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    const Elf64_Ehdr *ehdr;
+    const Elf64_Phdr *phdrs;
+    size_t num_phdrs;
+} elf_file_t;
+
+// One object of the loaded set and what it costs to load
+typedef struct {
+    char *name;             // As requested (DT_NEEDED), or the path given
+    char *path;             // Canonical path, NULL if not found
+    long parent;            // Index of the object that needed it, -1 for the executable
+    int depth;
+    int is_interpreter;
+    uint16_t type;          // ET_EXEC or ET_DYN
+    uint64_t text_size;     // Executable PT_LOAD bytes
+    uint64_t rodata_size;   // Read-only, non-executable PT_LOAD bytes
+    uint64_t data_size;     // Writable PT_LOAD bytes, including .bss
+    uint64_t tls_size;      // PT_TLS memory size
+    size_t relative;        // Relocations that only add the load base (incl. RELR)
+    size_t symbolic;        // Relocations that need a symbol lookup, PLT slots aside
+    size_t plt;             // PLT slots: resolved on first call, or at startup with BIND_NOW
+    size_t tls_relocs;
+    size_t copy_relocs;
+    size_t irelative;       // Run an IFUNC resolver at startup
+    int gnu_hash;
+    int sysv_hash;
+    int bind_now;
+    int static_tls;         // DF_STATIC_TLS: needs room in the static TLS block
+    int nodeflib;
+    size_t initializers;    // DT_INIT + DT_INIT_ARRAY + DT_PREINIT_ARRAY entries
+    char *rpath;            // DT_RPATH, NULL if none
+    char *runpath;          // DT_RUNPATH, NULL if none
+    char **needed;          // DT_NEEDED names
+    size_t num_needed;
+} elf_object_t;
+
+typedef struct {
+    elf_object_t *objects;
+    size_t count;
+    size_t capacity;
+    uint16_t machine;       // Every object must match the executable's
+    unsigned char *cache;   // ld.so.cache, NULL if unavailable
+    size_t cache_size;
+} elf_set_t;
+
+static const void *file_at(const elf_file_t *file, uint64_t offset, uint64_t size) {
+    if (offset > file->size || size > file->size - offset) {
+        return NULL;
+    }
+    return file->data + offset;
+}
+
+static int elf_map(const char *path, elf_file_t *file) {
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(Elf64_Ehdr)) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    file->data = data;
+    file->size = (size_t)st.st_size;
+    file->ehdr = data;
+    const unsigned char *ident = file->ehdr->e_ident;
+    if (memcmp(ident, ELFMAG, SELFMAG) != 0 || ident[EI_CLASS] != ELFCLASS64 || ident[EI_DATA] != ELFDATA2LSB ||
+        file->ehdr->e_phentsize != sizeof(Elf64_Phdr)) {
+        munmap(data, file->size);
+        return -1;
+    }
+    file->num_phdrs = file->ehdr->e_phnum;
+    file->phdrs = file_at(file, file->ehdr->e_phoff, file->num_phdrs * sizeof(Elf64_Phdr));
+    if (file->phdrs == NULL) {
+        munmap(data, file->size);
+        return -1;
+    }
+    return 0;
+}
+
+static void elf_unmap(elf_file_t *file) {
+    munmap((void *)file->data, file->size);
+}
+
+// Dynamic-section addresses are virtual; find the file bytes behind one
+static const void *vaddr_at(const elf_file_t *file, uint64_t vaddr, uint64_t size) {
+    for (size_t i = 0; i < file->num_phdrs; i++) {
+        const Elf64_Phdr *ph = &file->phdrs[i];
+        if (ph->p_type == PT_LOAD && vaddr >= ph->p_vaddr && vaddr - ph->p_vaddr < ph->p_filesz &&
+            size <= ph->p_filesz - (vaddr - ph->p_vaddr)) {
+            return file_at(file, ph->p_offset + (vaddr - ph->p_vaddr), size);
+        }
+    }
+    return NULL;
+}
+
+// Whether a candidate library could be loaded for this executable
+static int elf_matches(const char *path, uint16_t machine) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    Elf64_Ehdr ehdr;
+    ssize_t n = read(fd, &ehdr, sizeof(ehdr));
+    close(fd);
+    return n == (ssize_t)sizeof(ehdr) && memcmp(ehdr.e_ident, ELFMAG, SELFMAG) == 0 &&
+           ehdr.e_ident[EI_CLASS] == ELFCLASS64 && ehdr.e_machine == machine;
+}
+
+typedef enum {
+    RELOC_RELATIVE,
+    RELOC_SYMBOLIC,
+    RELOC_PLT,
+    RELOC_TLS,
+    RELOC_COPY,
+    RELOC_IRELATIVE,
+} reloc_kind_t;
+
+static reloc_kind_t classify_reloc(uint16_t machine, uint32_t type, uint32_t symbol) {
+    if (machine == EM_X86_64) {
+        switch (type) {
+        case R_X86_64_RELATIVE: return RELOC_RELATIVE;
+        case R_X86_64_JUMP_SLOT: return RELOC_PLT;
+        case R_X86_64_COPY: return RELOC_COPY;
+        case R_X86_64_IRELATIVE: return RELOC_IRELATIVE;
+        case R_X86_64_DTPMOD64:
+        case R_X86_64_DTPOFF64:
+        case R_X86_64_TPOFF64:
+        case R_X86_64_TLSDESC: return RELOC_TLS;
+        default: break;
+        }
+    } else if (machine == EM_AARCH64) {
+        switch (type) {
+        case R_AARCH64_RELATIVE: return RELOC_RELATIVE;
+        case R_AARCH64_JUMP_SLOT: return RELOC_PLT;
+        case R_AARCH64_COPY: return RELOC_COPY;
+        case R_AARCH64_IRELATIVE: return RELOC_IRELATIVE;
+        case R_AARCH64_TLS_DTPMOD:
+        case R_AARCH64_TLS_DTPREL:
+        case R_AARCH64_TLS_TPREL:
+        case R_AARCH64_TLSDESC: return RELOC_TLS;
+        default: break;
+        }
+    }
+    return symbol != 0 ? RELOC_SYMBOLIC : RELOC_RELATIVE;
+}
+
+static void count_relocs(elf_object_t *object, const elf_file_t *file, uint64_t vaddr, uint64_t size, int rela) {
+    size_t entry_size = rela ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel);
+    const unsigned char *entries = vaddr_at(file, vaddr, size);
+    if (entries == NULL) {
+        return;
+    }
+    for (size_t i = 0; i + entry_size <= size; i += entry_size) {
+        uint64_t info;
+        memcpy(&info, entries + i + sizeof(Elf64_Addr), sizeof(info)); // r_info follows r_offset in both layouts
+        switch (classify_reloc(file->ehdr->e_machine, (uint32_t)ELF64_R_TYPE(info), (uint32_t)ELF64_R_SYM(info))) {
+        case RELOC_RELATIVE: object->relative++; break;
+        case RELOC_SYMBOLIC: object->symbolic++; break;
+        case RELOC_PLT: object->plt++; break;
+        case RELOC_TLS: object->tls_relocs++; break;
+        case RELOC_COPY: object->copy_relocs++; break;
+        case RELOC_IRELATIVE: object->irelative++; break;
+        }
+    }
+}
+
+// RELR packs relative relocations: an even word is an address, an odd one a bitmap of the next 63 words
+static size_t count_relr(const elf_file_t *file, uint64_t vaddr, uint64_t size) {
+    const unsigned char *entries = vaddr_at(file, vaddr, size);
+    size_t count = 0;
+    for (size_t i = 0; entries != NULL && i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, entries + i, sizeof(word));
+        count += (word & 1) == 0 ? 1 : (size_t)__builtin_popcountll(word >> 1);
+    }
+    return count;
+}
+
+static char *dynamic_string(const elf_file_t *file, uint64_t strtab, uint64_t strsz, uint64_t offset) {
+    if (offset >= strsz) {
+        return NULL;
+    }
+    const char *base = vaddr_at(file, strtab, strsz);
+    if (base == NULL || memchr(base + offset, '\0', strsz - offset) == NULL) {
+        return NULL;
+    }
+    return strdup(base + offset);
+}
+
+// Fills in the costs of one object from its program headers and dynamic section
+static int analyze_object(elf_object_t *object, const elf_file_t *file) {
+    const Elf64_Dyn *dynamic = NULL;
+    size_t num_dynamic = 0;
+    object->type = file->ehdr->e_type;
+    for (size_t i = 0; i < file->num_phdrs; i++) {
+        const Elf64_Phdr *ph = &file->phdrs[i];
+        if (ph->p_type == PT_LOAD) {
+            if (ph->p_flags & PF_X) {
+                object->text_size += ph->p_memsz;
+            } else if (ph->p_flags & PF_W) {
+                object->data_size += ph->p_memsz;
+            } else {
+                object->rodata_size += ph->p_memsz;
+            }
+        } else if (ph->p_type == PT_TLS) {
+            object->tls_size = ph->p_memsz;
+        } else if (ph->p_type == PT_DYNAMIC) {
+            dynamic = file_at(file, ph->p_offset, ph->p_filesz);
+            num_dynamic = dynamic != NULL ? ph->p_filesz / sizeof(Elf64_Dyn) : 0;
+        }
+    }
+
+    uint64_t strtab = 0, strsz = 0, rela = 0, relasz = 0, rel = 0, relsz = 0;
+    uint64_t jmprel = 0, pltrelsz = 0, pltrel = DT_RELA, relr = 0, relrsz = 0;
+    uint64_t rpath = UINT64_MAX, runpath = UINT64_MAX;
+    size_t num_needed = 0;
+    for (size_t i = 0; i < num_dynamic && dynamic[i].d_tag != DT_NULL; i++) {
+        uint64_t value = dynamic[i].d_un.d_val;
+        switch (dynamic[i].d_tag) {
+        case DT_STRTAB: strtab = value; break;
+        case DT_STRSZ: strsz = value; break;
+        case DT_NEEDED: num_needed++; break;
+        case DT_RPATH: rpath = value; break;
+        case DT_RUNPATH: runpath = value; break;
+        case DT_RELA: rela = value; break;
+        case DT_RELASZ: relasz = value; break;
+        case DT_REL: rel = value; break;
+        case DT_RELSZ: relsz = value; break;
+        case DT_JMPREL: jmprel = value; break;
+        case DT_PLTRELSZ: pltrelsz = value; break;
+        case DT_PLTREL: pltrel = value; break;
+        case DT_RELR: relr = value; break;
+        case DT_RELRSZ: relrsz = value; break;
+        case DT_HASH: object->sysv_hash = 1; break;
+        case DT_GNU_HASH: object->gnu_hash = 1; break;
+        case DT_BIND_NOW: object->bind_now = 1; break;
+        case DT_FLAGS:
+            object->bind_now |= (value & DF_BIND_NOW) != 0;
+            object->static_tls |= (value & DF_STATIC_TLS) != 0;
+            break;
+        case DT_FLAGS_1:
+            object->bind_now |= (value & DF_1_NOW) != 0;
+            object->nodeflib |= (value & DF_1_NODEFLIB) != 0;
+            break;
+        case DT_INIT: object->initializers++; break;
+        case DT_INIT_ARRAYSZ:
+        case DT_PREINIT_ARRAYSZ: object->initializers += value / sizeof(Elf64_Addr); break;
+        default: break;
+        }
+    }
+
+    if (rela != 0) {
+        count_relocs(object, file, rela, relasz, 1);
+    }
+    if (rel != 0) {
+        count_relocs(object, file, rel, relsz, 0);
+    }
+    if (jmprel != 0) {
+        count_relocs(object, file, jmprel, pltrelsz, pltrel == DT_RELA);
+    }
+    if (relr != 0) {
+        object->relative += count_relr(file, relr, relrsz);
+    }
+
+    if (rpath != UINT64_MAX) {
+        object->rpath = dynamic_string(file, strtab, strsz, rpath);
+    }
+    if (runpath != UINT64_MAX) {
+        object->runpath = dynamic_string(file, strtab, strsz, runpath);
+    }
+    if (num_needed > 0) {
+        object->needed = calloc(num_needed, sizeof(char *));
+        if (object->needed == NULL) {
+            return -1;
+        }
+        for (size_t i = 0; i < num_dynamic && dynamic[i].d_tag != DT_NULL; i++) {
+            if (dynamic[i].d_tag == DT_NEEDED) {
+                char *name = dynamic_string(file, strtab, strsz, dynamic[i].d_un.d_val);
+                if (name != NULL) {
+                    object->needed[object->num_needed++] = name;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Tries every directory of a colon-separated list, expanding $ORIGIN
+static char *search_path_list(const char *list, const char *origin, const char *name, uint16_t machine) {
+    const char *p = list;
+    while (p != NULL) {
+        const char *colon = strchr(p, ':');
+        size_t len = colon != NULL ? (size_t)(colon - p) : strlen(p);
+        char dir[4096];
+        size_t used = 0;
+        for (size_t i = 0; i < len && used + 1 < sizeof(dir);) {
+            if (strncmp(p + i, "$ORIGIN", 7) == 0 || strncmp(p + i, "${ORIGIN}", 9) == 0) {
+                used += (size_t)snprintf(dir + used, sizeof(dir) - used, "%s", origin);
+                i += p[i + 1] == '{' ? 9 : 7;
+            } else {
+                dir[used++] = p[i++];
+            }
+        }
+        dir[used < sizeof(dir) ? used : sizeof(dir) - 1] = '\0';
+
+        char candidate[8192];
+        snprintf(candidate, sizeof(candidate), "%s%s%s", dir, used > 0 ? "/" : "", name);
+        if (elf_matches(candidate, machine)) {
+            return strdup(candidate);
+        }
+        p = colon != NULL ? colon + 1 : NULL;
+    }
+    return NULL;
+}
+
+// ld.so.cache, new format: a header, then {flags, key, value, osversion, hwcap} entries with file offsets
+static char *search_cache(const elf_set_t *set, const char *name) {
+    size_t header_size = sizeof(CACHE_MAGIC) - 1 + 28;
+    if (set->cache == NULL || set->cache_size < header_size) {
+        return NULL;
+    }
+    uint32_t num_libs;
+    memcpy(&num_libs, set->cache + sizeof(CACHE_MAGIC) - 1, sizeof(num_libs));
+    const size_t entry_size = 24;
+    for (uint32_t i = 0; i < num_libs && header_size + (i + 1) * (size_t)entry_size <= set->cache_size; i++) {
+        const unsigned char *entry = set->cache + header_size + i * (size_t)entry_size;
+        uint32_t key, value;
+        memcpy(&key, entry + 4, sizeof(key));
+        memcpy(&value, entry + 8, sizeof(value));
+        if (key >= set->cache_size || value >= set->cache_size ||
+            memchr(set->cache + key, '\0', set->cache_size - key) == NULL ||
+            memchr(set->cache + value, '\0', set->cache_size - value) == NULL) {
+            continue;
+        }
+        if (strcmp((const char *)set->cache + key, name) == 0 && elf_matches((const char *)set->cache + value, set->machine)) {
+            return strdup((const char *)set->cache + value);
+        }
+    }
+    return NULL;
+}
+
+// The loader's search order for a DT_NEEDED name requested by an object
+static char *resolve_needed(const elf_set_t *set, size_t loader_index, const char *name) {
+    if (strchr(name, '/') != NULL) {
+        return elf_matches(name, set->machine) ? strdup(name) : NULL;
+    }
+    const elf_object_t *loader = &set->objects[loader_index];
+    char origin[4096];
+    char *found = NULL;
+
+    // DT_RPATH of the loader and of the objects that loaded it, unless the loader has DT_RUNPATH
+    if (loader->runpath == NULL) {
+        for (long i = (long)loader_index; i >= 0 && found == NULL; i = set->objects[i].parent) {
+            const elf_object_t *object = &set->objects[i];
+            if (object->rpath != NULL && object->path != NULL) {
+                snprintf(origin, sizeof(origin), "%s", object->path);
+                char *slash = strrchr(origin, '/');
+                *(slash != NULL ? slash : origin) = '\0';
+                found = search_path_list(object->rpath, origin, name, set->machine);
+            }
+        }
+    }
+    snprintf(origin, sizeof(origin), "%s", loader->path != NULL ? loader->path : ".");
+    char *slash = strrchr(origin, '/');
+    *(slash != NULL ? slash : origin) = '\0';
+    const char *library_path = getenv("LD_LIBRARY_PATH");
+    if (found == NULL && library_path != NULL && library_path[0] != '\0') {
+        found = search_path_list(library_path, origin, name, set->machine);
+    }
+    if (found == NULL && loader->runpath != NULL) {
+        found = search_path_list(loader->runpath, origin, name, set->machine);
+    }
+    if (found == NULL && !loader->nodeflib) {
+        found = search_cache(set, name);
+        for (size_t i = 0; found == NULL && i < sizeof(default_dirs) / sizeof(default_dirs[0]); i++) {
+            found = search_path_list(default_dirs[i], origin, name, set->machine);
+        }
+    }
+    return found;
+}
+
+// Adds an object unless the same name or file is already loaded; returns its index, or -1
+static long add_object(elf_set_t *set, const char *name, char *path, long parent, int depth) {
+    char canonical[4096];
+    if (path != NULL && realpath(path, canonical) != NULL) {
+        free(path);
+        path = strdup(canonical);
+    }
+    for (size_t i = 0; i < set->count; i++) {
+        const elf_object_t *object = &set->objects[i];
+        if (strcmp(object->name, name) == 0 || (path != NULL && object->path != NULL && strcmp(object->path, path) == 0)) {
+            free(path);
+            return (long)i;
+        }
+    }
+    if (set->count == set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 32;
+        elf_object_t *grown = realloc(set->objects, capacity * sizeof(elf_object_t));
+        if (grown == NULL) {
+            free(path);
+            return -1;
+        }
+        set->objects = grown;
+        set->capacity = capacity;
+    }
+    elf_object_t *object = &set->objects[set->count];
+    memset(object, 0, sizeof(*object));
+    object->name = strdup(name);
+    object->path = path;
+    object->parent = parent;
+    object->depth = depth;
+    if (object->name == NULL) {
+        free(path);
+        return -1;
+    }
+    return (long)set->count++;
+}
+
+static int load_object(elf_set_t *set, size_t index) {
+    elf_file_t file;
+    elf_object_t *object = &set->objects[index];
+    if (object->path == NULL || elf_map(object->path, &file) == -1) {
+        return 0; // Reported as not found
+    }
+    int result = analyze_object(object, &file);
+    elf_unmap(&file);
+    return result;
+}
+
+static void load_cache(elf_set_t *set) {
+    int fd = open(LD_SO_CACHE, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd == -1) {
+        return;
+    }
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size > sizeof(CACHE_MAGIC)) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // The new format may follow an old-format block; it starts at its magic
+            const unsigned char *start = memmem(data, (size_t)st.st_size, CACHE_MAGIC, sizeof(CACHE_MAGIC) - 1);
+            if (start == NULL) {
+                munmap(data, (size_t)st.st_size);
+            } else {
+                set->cache = data;
+                set->cache_size = (size_t)st.st_size;
+                if (start != data) {
+                    // Entries are offsets from the new header; rebase the view onto it
+                    set->cache = (unsigned char *)start;
+                    set->cache_size -= (size_t)(start - (const unsigned char *)data);
+                }
+            }
+        }
+    }
+    close(fd);
+}
+
+static const char *format_size(uint64_t bytes, char *buf, size_t size) {
+    if (bytes >= 1024 * 1024) {
+        snprintf(buf, size, "%.1fM", (double)bytes / (1024.0 * 1024.0));
+    } else if (bytes >= 1024) {
+        snprintf(buf, size, "%.1fK", (double)bytes / 1024.0);
+    } else {
+        snprintf(buf, size, "%lluB", (unsigned long long)bytes);
+    }
+    return buf;
+}
+
+static void print_report(const elf_set_t *set, const char *executable_path, const char *interpreter, FILE *out) {
+    const elf_object_t *exe = &set->objects[0];
+    char text[16], rodata[16], data[16], tls[16];
+    fprintf(out, "\n--- ELF startup analysis: %s ---\n", executable_path);
+    fprintf(out, "Type: %s, %s\n",
+            exe->type == ET_DYN ? (interpreter != NULL ? "PIE executable" : "shared object") : "position-dependent executable",
+            set->machine == EM_X86_64 ? "x86-64" : set->machine == EM_AARCH64 ? "AArch64" : "64-bit");
+    fprintf(out, "Interpreter: %s\n", interpreter != NULL ? interpreter : "none (statically linked)");
+
+    fprintf(out, "%5s %8s %8s %8s %9s %9s %7s %5s %5s %5s %4s %-9s %-5s  %s\n", "depth", "text", "rodata", "data",
+            "relative", "symbolic", "plt", "tls", "copy", "ifunc", "init", "hash", "bind", "object");
+    size_t missing = 0, sysv_only = 0, lazy_plt = 0, startup_lookups = 0, irelative = 0, initializers = 0;
+    size_t static_tls = 0, with_tls = 0, relocations = 0;
+    uint64_t total_text = 0, total_data = 0, tls_bytes = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        const elf_object_t *object = &set->objects[i];
+        if (object->path == NULL) {
+            fprintf(out, "%5d %8s %8s %8s %9s %9s %7s %5s %5s %5s %4s %-9s %-5s  %s (not found)\n", object->depth, "-",
+                    "-", "-", "-", "-", "-", "-", "-", "-", "-", "-", "-", object->name);
+            missing++;
+            continue;
+        }
+        const char *hash = object->gnu_hash && object->sysv_hash ? "gnu+sysv"
+                           : object->gnu_hash ? "gnu" : object->sysv_hash ? "sysv" : "none";
+        fprintf(out, "%5d %8s %8s %8s %9zu %9zu %7zu %5s %5zu %5zu %4zu %-9s %-5s  %s%s\n", object->depth,
+                format_size(object->text_size, text, sizeof(text)), format_size(object->rodata_size, rodata, sizeof(rodata)),
+                format_size(object->data_size, data, sizeof(data)), object->relative, object->symbolic, object->plt,
+                object->tls_size > 0 ? format_size(object->tls_size, tls, sizeof(tls)) : "-", object->copy_relocs,
+                object->irelative, object->initializers, hash, object->bind_now ? "now" : "lazy", object->path,
+                object->is_interpreter ? " (interpreter)" : "");
+        sysv_only += !object->gnu_hash && object->sysv_hash;
+        if (object->bind_now) {
+            startup_lookups += object->plt;
+        } else {
+            lazy_plt += object->plt;
+        }
+        startup_lookups += object->symbolic + object->copy_relocs + object->tls_relocs;
+        relocations += object->relative + object->symbolic + object->plt + object->tls_relocs + object->copy_relocs +
+                       object->irelative;
+        irelative += object->irelative;
+        initializers += object->initializers;
+        with_tls += object->tls_size > 0;
+        static_tls += object->static_tls;
+        tls_bytes += object->tls_size;
+        total_text += object->text_size;
+        total_data += object->data_size;
+    }
+
+    fprintf(out, "Totals: %zu objects, %zu relocations, %s text, %s writable data, %zu initializers\n",
+            set->count, relocations, format_size(total_text, text, sizeof(text)),
+            format_size(total_data, data, sizeof(data)), initializers);
+    fprintf(out, "Startup cost factors:\n");
+    fprintf(out, "  %zu shared objects to open and map (each costs an open, several mmaps and mprotects)\n",
+            set->count - 1 - missing);
+    fprintf(out, "  %zu symbol lookups at load time (symbolic, copy and TLS relocations, PLT slots of BIND_NOW objects)\n",
+            startup_lookups);
+    fprintf(out, "  %zu PLT slots bound lazily on first call%s\n", lazy_plt,
+            getenv("LD_BIND_NOW") != NULL ? " (but LD_BIND_NOW is set: all are bound at startup)" : "");
+    if (irelative > 0) {
+        fprintf(out, "  %zu IFUNC resolvers run during relocation\n", irelative);
+    }
+    if (with_tls > 0) {
+        fprintf(out, "  %zu objects with TLS (%s per thread)%s\n", with_tls, format_size(tls_bytes, tls, sizeof(tls)),
+                static_tls > 0 ? ", some in the static TLS block" : "");
+    }
+    if (sysv_only > 0) {
+        fprintf(out, "  %zu objects only have a SysV hash table: lookups in them walk longer chains without a Bloom filter\n",
+                sysv_only);
+    }
+    if (missing > 0) {
+        fprintf(out, "  %zu shared objects not found with the loader's search rules: the program would not start\n",
+                missing);
+    }
+}
+
+static void free_set(elf_set_t *set) {
+    for (size_t i = 0; i < set->count; i++) {
+        elf_object_t *object = &set->objects[i];
+        for (size_t j = 0; j < object->num_needed; j++) {
+            free(object->needed[j]);
+        }
+        free(object->needed);
+        free(object->name);
+        free(object->path);
+        free(object->rpath);
+        free(object->runpath);
+    }
+    free(set->objects);
+    if (set->cache != NULL) {
+        // cache may point past the start of the mapping; the mapping is page-aligned
+        uintptr_t base = (uintptr_t)set->cache & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+        munmap((void *)base, set->cache_size + ((uintptr_t)set->cache - base));
+    }
+}
+
+int rune_elf_report(const char *executable_path, FILE *out) {
+    elf_file_t file;
+    if (elf_map(executable_path, &file) == -1) {
+        fprintf(stderr, "runescope: Error: %s is not a readable 64-bit little-endian ELF file.\n", executable_path);
+        return -1;
+    }
+    elf_set_t set;
+    memset(&set, 0, sizeof(set));
+    set.machine = file.ehdr->e_machine;
+
+    char *interpreter = NULL;
+    for (size_t i = 0; i < file.num_phdrs; i++) {
+        const Elf64_Phdr *ph = &file.phdrs[i];
+        const char *interp = ph->p_type == PT_INTERP ? file_at(&file, ph->p_offset, ph->p_filesz) : NULL;
+        if (interp != NULL && ph->p_filesz > 0 && interp[ph->p_filesz - 1] == '\0') {
+            interpreter = strdup(interp);
+        }
+    }
+    elf_unmap(&file);
+    load_cache(&set);
+
+    int result = add_object(&set, executable_path, strdup(executable_path), -1, 0) == -1 ? -1 : 0;
+    // Breadth-first, as the loader does: every object's DT_NEEDED in order, level by level
+    for (size_t i = 0; result == 0 && i < set.count && set.count < MAX_DEPENDENCIES; i++) {
+        if (load_object(&set, i) == -1) {
+            result = -1;
+            break;
+        }
+        for (size_t j = 0; j < set.objects[i].num_needed; j++) {
+            const char *name = set.objects[i].needed[j];
+            char *path = resolve_needed(&set, i, name);
+            if (add_object(&set, name, path, (long)i, set.objects[i].depth + 1) == -1) {
+                result = -1;
+                break;
+            }
+        }
+    }
+    if (result == 0 && interpreter != NULL) {
+        // The interpreter is usually also in libc's DT_NEEDED; otherwise add it here
+        long index = add_object(&set, interpreter, strdup(interpreter), 0, 1);
+        if (index == -1) {
+            result = -1;
+        } else {
+            set.objects[index].is_interpreter = 1;
+            if ((size_t)index == set.count - 1 && load_object(&set, (size_t)index) == -1) {
+                result = -1;
+            }
+        }
+    }
+
+    if (result == 0) {
+        flockfile(out);
+        print_report(&set, executable_path, interpreter, out);
+        funlockfile(out);
+    } else {
+        perror("runescope: malloc failed for ELF analysis");
+    }
+    free(interpreter);
+    free_set(&set);
+    return result;
+}
+
+int rune_elf_lookup(const char *path, const char *symbol, uint64_t *offset) {
+    elf_file_t file;
+    if (elf_map(path, &file) == -1) {
+        return -1;
+    }
+    uint64_t load_address = UINT64_MAX;
+    for (size_t i = 0; i < file.num_phdrs; i++) {
+        if (file.phdrs[i].p_type == PT_LOAD && file.phdrs[i].p_vaddr < load_address) {
+            load_address = file.phdrs[i].p_vaddr & ~(uint64_t)0xfff;
+        }
+    }
+    int result = -1;
+    if (load_address != UINT64_MAX && symbol == NULL) {
+        *offset = file.ehdr->e_entry - load_address;
+        result = 0;
+    }
+
+    const Elf64_Shdr *shdrs = file_at(&file, file.ehdr->e_shoff, (uint64_t)file.ehdr->e_shnum * sizeof(Elf64_Shdr));
+    for (size_t i = 0; load_address != UINT64_MAX && symbol != NULL && shdrs != NULL && result == -1 &&
+                       file.ehdr->e_shentsize == sizeof(Elf64_Shdr) && i < file.ehdr->e_shnum; i++) {
+        const Elf64_Shdr *sh = &shdrs[i];
+        if ((sh->sh_type != SHT_SYMTAB && sh->sh_type != SHT_DYNSYM) || sh->sh_link >= file.ehdr->e_shnum) {
+            continue;
+        }
+        const Elf64_Sym *syms = file_at(&file, sh->sh_offset, sh->sh_size);
+        const Elf64_Shdr *strtab = &shdrs[sh->sh_link];
+        const char *names = file_at(&file, strtab->sh_offset, strtab->sh_size);
+        if (syms == NULL || names == NULL) {
+            continue;
+        }
+        size_t symbol_len = strlen(symbol);
+        for (size_t j = 0; j < sh->sh_size / sizeof(Elf64_Sym); j++) {
+            const Elf64_Sym *sym = &syms[j];
+            if (ELF64_ST_TYPE(sym->st_info) == STT_FUNC && sym->st_shndx != SHN_UNDEF &&
+                sym->st_name + symbol_len < strtab->sh_size &&
+                memcmp(names + sym->st_name, symbol, symbol_len + 1) == 0) {
+                *offset = sym->st_value - load_address;
+                result = 0;
+                break;
+            }
+        }
+    }
+    elf_unmap(&file);
+    return result;
+}
+
+static int compare_symbols(const void *a, const void *b) {
+    const rune_elf_symbol_t *x = a, *y = b;
+    if (x->address != y->address) {
+        return x->address < y->address ? -1 : 1;
+    }
+    return (x->size < y->size) - (x->size > y->size); // Sized symbols first among aliases
+}
+
+int rune_elf_symtab_load(const char *path, rune_elf_symtab_t *symtab) {
+    memset(symtab, 0, sizeof(*symtab));
+    elf_file_t file;
+    if (elf_map(path, &file) == -1) {
+        return -1;
+    }
+    const Elf64_Shdr *shdrs = file.ehdr->e_shentsize == sizeof(Elf64_Shdr)
+                                  ? file_at(&file, file.ehdr->e_shoff, (uint64_t)file.ehdr->e_shnum * sizeof(Elf64_Shdr))
+                                  : NULL;
+    size_t num_shdrs = shdrs != NULL ? file.ehdr->e_shnum : 0;
+    // .symtab is a superset of .dynsym; only fall back to .dynsym without it
+    uint32_t wanted = SHT_DYNSYM;
+    for (size_t i = 0; i < num_shdrs; i++) {
+        wanted = shdrs[i].sh_type == SHT_SYMTAB ? SHT_SYMTAB : wanted;
+    }
+    const Elf64_Shdr *table = NULL;
+    for (size_t i = 0; i < num_shdrs && table == NULL; i++) {
+        table = shdrs[i].sh_type == wanted && shdrs[i].sh_link < num_shdrs ? &shdrs[i] : NULL;
+    }
+    const Elf64_Sym *syms = table != NULL ? file_at(&file, table->sh_offset, table->sh_size) : NULL;
+    const Elf64_Shdr *strtab = table != NULL ? &shdrs[table->sh_link] : NULL;
+    const char *names = strtab != NULL ? file_at(&file, strtab->sh_offset, strtab->sh_size) : NULL;
+    size_t num_syms = syms != NULL && names != NULL ? table->sh_size / sizeof(Elf64_Sym) : 0;
+
+    int result = 0;
+    symtab->segments = calloc(file.num_phdrs + 1, sizeof(rune_elf_segment_t));
+    symtab->symbols = calloc(num_syms + 1, sizeof(rune_elf_symbol_t));
+    symtab->names = malloc(num_syms > 0 ? strtab->sh_size + 1 : 1);
+    if (symtab->segments == NULL || symtab->symbols == NULL || symtab->names == NULL) {
+        perror("runescope: malloc failed for symbol table");
+        result = -1;
+    }
+    for (size_t i = 0; result == 0 && i < file.num_phdrs; i++) {
+        const Elf64_Phdr *ph = &file.phdrs[i];
+        if (ph->p_type == PT_LOAD) {
+            rune_elf_segment_t *segment = &symtab->segments[symtab->num_segments++];
+            segment->offset = ph->p_offset;
+            segment->vaddr = ph->p_vaddr;
+            segment->filesz = ph->p_filesz;
+        }
+    }
+    if (result == 0 && num_syms > 0) {
+        memcpy(symtab->names, names, strtab->sh_size);
+        symtab->names[strtab->sh_size] = '\0';
+        for (size_t i = 0; i < num_syms; i++) {
+            const Elf64_Sym *sym = &syms[i];
+            if (ELF64_ST_TYPE(sym->st_info) == STT_FUNC && sym->st_shndx != SHN_UNDEF && sym->st_value != 0 &&
+                sym->st_name < strtab->sh_size) {
+                rune_elf_symbol_t *symbol = &symtab->symbols[symtab->count++];
+                symbol->address = sym->st_value;
+                symbol->size = sym->st_size;
+                symbol->name = sym->st_name;
+            }
+        }
+        qsort(symtab->symbols, symtab->count, sizeof(rune_elf_symbol_t), compare_symbols);
+    }
+    elf_unmap(&file);
+    if (result == -1) {
+        rune_elf_symtab_free(symtab);
+    }
+    return result;
+}
+
+const char *rune_elf_symtab_find(const rune_elf_symtab_t *symtab, uint64_t file_offset) {
+    uint64_t address = 0;
+    int mapped = 0;
+    for (size_t i = 0; i < symtab->num_segments && !mapped; i++) {
+        const rune_elf_segment_t *segment = &symtab->segments[i];
+        if (file_offset >= segment->offset && file_offset - segment->offset < segment->filesz) {
+            address = segment->vaddr + (file_offset - segment->offset);
+            mapped = 1;
+        }
+    }
+    if (!mapped || symtab->count == 0) {
+        return NULL;
+    }
+    // The last symbol starting at or before the address
+    size_t low = 0, high = symtab->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (symtab->symbols[mid].address <= address) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return NULL;
+    }
+    const rune_elf_symbol_t *symbol = &symtab->symbols[low - 1];
+    // Among aliases at that address, binary search lands on the last; walk back to a sized one
+    while (symbol > symtab->symbols && symbol->size == 0 && symbol[-1].address == symbol->address) {
+        symbol--;
+    }
+    if (symbol->size != 0 && address - symbol->address >= symbol->size) {
+        return NULL; // In a gap between functions
+    }
+    return symtab->names + symbol->name;
+}
+
+void rune_elf_symtab_free(rune_elf_symtab_t *symtab) {
+    free(symtab->symbols);
+    free(symtab->names);
+    free(symtab->segments);
+    memset(symtab, 0, sizeof(*symtab));
+}
@@ -0,0 +1,98 @@
+#ifndef RUNE_ELF_H
+#define RUNE_ELF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Static analysis of what it costs to load an executable.
+ *
+ * The executable and every shared object it needs are memory-mapped and
+ * read without running anything. DT_NEEDED entries are resolved breadth-first
+ * with the dynamic loader's rules: DT_RPATH (when there is no DT_RUNPATH),
+ * LD_LIBRARY_PATH, DT_RUNPATH, /etc/ld.so.cache and the default directories,
+ * with $ORIGIN expanded and candidates of another class or machine skipped.
+ * Only 64-bit little-endian ELF files are analyzed.
+ */
+
+/**
+ * @brief Prints the startup-cost factors of an executable and its shared objects.
+ *
+ * For every object: its depth in the dependency graph, code, read-only and
+ * writable sizes, relocations by kind (relative ones, symbolic ones that need
+ * a symbol lookup, PLT slots, TLS, copy and IRELATIVE relocations), GNU and
+ * SysV hash tables, lazy binding or BIND_NOW, the TLS segment and the number
+ * of initializers. Then totals and the factors that dominate.
+ *
+ * @param executable_path The executable to analyze.
+ * @param out The stream to print to.
+ * @return 0 on success, -1 if the executable cannot be read or is not a supported ELF file.
+ */
+int rune_elf_report(const char *executable_path, FILE *out);
+
+/**
+ * @brief Finds a function symbol or the entry point of an ELF file.
+ *
+ * Both .symtab and .dynsym are searched, so stripped shared libraries still
+ * resolve their exported functions. The result is relative to the address
+ * the lowest PT_LOAD segment is mapped at, which is the start of the file's
+ * first mapping in /proc/<pid>/maps.
+ *
+ * @param path The ELF file.
+ * @param symbol The function to find, or NULL for the entry point.
+ * @param offset Receives the address relative to the load address.
+ * @return 0 on success, -1 if the file is not supported or the symbol is not defined in it.
+ */
+int rune_elf_lookup(const char *path, const char *symbol, uint64_t *offset);
+
+// A function symbol, by its virtual address in the ELF file
+typedef struct {
+    uint64_t address;
+    uint64_t size;
+    uint32_t name;           // Offset into names
+} rune_elf_symbol_t;
+
+// A file's PT_LOAD segment, to turn file offsets into virtual addresses
+typedef struct {
+    uint64_t offset;
+    uint64_t vaddr;
+    uint64_t filesz;
+} rune_elf_segment_t;
+
+// The function symbols of one ELF file, sorted by address
+typedef struct {
+    rune_elf_symbol_t *symbols;
+    size_t count;
+    char *names;             // The file's symbol string tables, copied
+    rune_elf_segment_t *segments;
+    size_t num_segments;
+} rune_elf_symtab_t;
+
+/**
+ * @brief Loads the function symbols of an ELF file.
+ *
+ * Symbols come from .symtab when the file has one and from .dynsym
+ * otherwise, which is all a stripped shared library exports. A file
+ * without either still loads, with no symbols.
+ *
+ * @param path The ELF file.
+ * @param symtab Receives the symbols.
+ * @return 0 on success, -1 if the file is not supported or on allocation failure.
+ */
+int rune_elf_symtab_load(const char *path, rune_elf_symtab_t *symtab);
+
+/**
+ * @brief Finds the function that contains a byte of the file, as mapped into memory.
+ *
+ * @param symtab The symbols.
+ * @param file_offset The offset in the file, as /proc/<pid>/maps gives it for the mapping.
+ * @return The function's name, or NULL if no symbol covers it.
+ */
+const char *rune_elf_symtab_find(const rune_elf_symtab_t *symtab, uint64_t file_offset);
+
+/**
+ * @brief Releases the memory held by a symbol table.
+ */
+void rune_elf_symtab_free(rune_elf_symtab_t *symtab);
+
+#endif // RUNE_ELF_H
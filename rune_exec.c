@@ -33,132 +33,483 @@
  * may be limited or unavailable until this underlying dependency issue is resolved.
  */
 
+#define _GNU_SOURCE // For sched_setaffinity, wait4 and syscall
 #include "rune_exec.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h> // For fork, execve, _exit
 #include <sys/wait.h> // For waitpid
 #include <errno.h> // For errno
-#include <string.h> // For strlen, strcpy, strcat
+#include <string.h> // For strcmp, memcpy
+#include <time.h> // For clock_gettime
+#include <fcntl.h> // For open
+#include <sched.h> // For sched_setaffinity
+#include <sys/resource.h> // For struct rusage
+#include <sys/timerfd.h> // For timerfd_create
+#include <sys/syscall.h> // For SYS_pidfd_open
+#include <poll.h> // For poll
 #include "rune_path_finder.h" // Include for path finding
+#include "rune_pool.h" // For rune_pool_cpu_count
+#include "rune_preload_ring.h" // For RUNE_PRELOAD_ENV
 
-// Max arguments for any combination of tools + target program
+// Max arguments for one tool + target program
 #define MAX_TOOL_ARGS 256
 
-int rune_exec_run_target(const char *executable_path, char *const argv_target[], 
-                         int use_strace, const char *strace_output_path, 
-                         int use_ltrace, const char *ltrace_output_path, 
-                         int use_valgrind, const char *valgrind_output_path) {
+// How often to check for exited jobs while sampling when pidfds are not available
+#define EXIT_POLL_MS 10
+
+// A tool about to run, or running, the target
+typedef struct {
+    const char *tool;           // NULL runs the target itself
+    char *path;                 // Resolved tool path (owned), or the target's path
+    char *argv[MAX_TOOL_ARGS];
+    char log_arg[4352];         // valgrind's --log-file=PATH
+    char tool_arg[64];          // valgrind's --tool=NAME
+    char profile_arg[4352];     // --cachegrind-out-file=PATH or --callgrind-out-file=PATH
+    char **envp;                // Environment with the preload library added (owned), NULL for runescope's own
+    pid_t pid;
+    int pidfd;                  // Readable once the job exits; -1 when not sampling or not supported
+    struct timespec started;
+} exec_job_t;
+
+static int64_t elapsed_ns(const struct timespec *from, const struct timespec *to) {
+    return (int64_t)(to->tv_sec - from->tv_sec) * 1000000000 + (to->tv_nsec - from->tv_nsec);
+}
+
+// Frees an environment built by preload_environment
+static void free_environment(char **envp) {
+    if (envp == NULL) {
+        return;
+    }
+    for (size_t i = 0; envp[i] != NULL; i++) {
+        free(envp[i]);
+    }
+    free(envp);
+}
+
+// Copies runescope's environment, with the library put first in LD_PRELOAD and the region path added
+static char **preload_environment(const char *library, const char *region_path) {
+    extern char **environ;
+    size_t count = 0;
+    while (environ[count] != NULL) {
+        count++;
+    }
+    char **envp = calloc(count + 3, sizeof(char *));
+    if (envp == NULL) {
+        goto fail;
+    }
+    const char *preload = getenv("LD_PRELOAD");
+    size_t n = 0;
+    size_t size = strlen(library) + (preload != NULL ? strlen(preload) : 0) + sizeof("LD_PRELOAD= ");
+    if ((envp[n] = malloc(size)) == NULL) {
+        goto fail;
+    }
+    snprintf(envp[n++], size, "LD_PRELOAD=%s%s%s", library, preload != NULL && *preload ? " " : "",
+             preload != NULL ? preload : "");
+    size = strlen(region_path) + sizeof(RUNE_PRELOAD_ENV "=");
+    if ((envp[n] = malloc(size)) == NULL) {
+        goto fail;
+    }
+    snprintf(envp[n++], size, "%s=%s", RUNE_PRELOAD_ENV, region_path);
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(environ[i], "LD_PRELOAD=", 11) == 0 ||
+            strncmp(environ[i], RUNE_PRELOAD_ENV "=", sizeof(RUNE_PRELOAD_ENV)) == 0) {
+            continue;
+        }
+        if ((envp[n++] = strdup(environ[i])) == NULL) {
+            goto fail;
+        }
+    }
+    return envp;
+
+fail:
+    perror("runescope: allocation failed for preload environment");
+    free_environment(envp);
+    return NULL;
+}
+
+// Fills in the command line of one tool running the target on its own
+static int build_job(exec_job_t *job, const char *tool, const char *output_path, const char *executable_path,
+                     char *const argv_target[], const rune_exec_options_t *options) {
+    int arg_idx = 0;
+    job->tool = tool;
+    job->path = NULL;
+    job->envp = NULL;
+    job->pid = -1;
+    job->pidfd = -1;
+
+    if (tool == NULL) {
+        job->path = (char *)executable_path;
+        for (int i = 0; argv_target[i] != NULL && arg_idx < MAX_TOOL_ARGS - 1; i++) {
+            job->argv[arg_idx++] = argv_target[i];
+        }
+        job->argv[arg_idx] = NULL;
+        if (options != NULL && options->preload_library != NULL) {
+            job->envp = preload_environment(options->preload_library, options->preload_region_path);
+            if (job->envp == NULL) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    job->path = rune_path_finder_find_executable(tool);
+    if (job->path == NULL) {
+        fprintf(stderr, "runescope: Error: Tool '%s' not found in PATH or not executable.\n", tool);
+        return -1;
+    }
+    job->argv[arg_idx++] = (char *)tool;
+    if (strcmp(tool, "valgrind") == 0) {
+        const char *valgrind_tool = options != NULL ? options->valgrind_tool : NULL;
+        snprintf(job->log_arg, sizeof(job->log_arg), "--log-file=%s", output_path);
+        snprintf(job->tool_arg, sizeof(job->tool_arg), "--tool=%s", valgrind_tool != NULL ? valgrind_tool : "memcheck");
+        job->argv[arg_idx++] = job->tool_arg; // Default to memcheck
+        job->argv[arg_idx++] = job->log_arg;
+        if (valgrind_tool == NULL) {
+            job->argv[arg_idx++] = "--leak-check=full";
+            job->argv[arg_idx++] = "--show-leak-kinds=all";
+            job->argv[arg_idx++] = "--track-origins=yes";
+        } else {
+            // Profilers: a fixed output file, and the cache and branch simulations, which are off by default
+            snprintf(job->profile_arg, sizeof(job->profile_arg), "--%s-out-file=%s", valgrind_tool,
+                     options->valgrind_profile_path);
+            job->argv[arg_idx++] = job->profile_arg;
+            job->argv[arg_idx++] = "--cache-sim=yes";
+            job->argv[arg_idx++] = "--branch-sim=yes";
+        }
+        job->argv[arg_idx++] = "--"; // End of valgrind's options
+    } else {
+        job->argv[arg_idx++] = "-o";
+        job->argv[arg_idx++] = (char *)output_path;
+        job->argv[arg_idx++] = "-f"; // Trace child processes
+        if (strcmp(tool, "strace") == 0 && options != NULL && options->strace_timing) {
+            job->argv[arg_idx++] = "-ttt"; // Absolute timestamps with microseconds
+            job->argv[arg_idx++] = "-T"; // Time spent in each syscall
+        } else if (strcmp(tool, "ltrace") == 0 && options != NULL && options->ltrace_timing) {
+            job->argv[arg_idx++] = "-ttt"; // Absolute timestamps with microseconds
+        }
+    }
+
+    // Add the target executable and its arguments
+    job->argv[arg_idx++] = (char *)executable_path;
+    for (int i = 1; argv_target[i] != NULL && arg_idx < MAX_TOOL_ARGS - 1; i++) {
+        job->argv[arg_idx++] = argv_target[i];
+    }
+    job->argv[arg_idx] = NULL; // Null-terminate the argument list
+    return 0;
+}
+
+// Forks and execs one job; with counters, they are attached before the exec
+static int start_job(exec_job_t *job, int keep_stdin, rune_counters_t *counters) {
+    int ready_pipe[2] = { -1, -1 }; // Holds the child back until its counters are attached
+    if (counters != NULL && pipe(ready_pipe) == -1) {
+        perror("runescope: pipe failed for counter setup");
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &job->started);
     pid_t pid = fork();
 
     if (pid == -1) {
         perror("runescope: fork failed");
+        if (counters != NULL) {
+            close(ready_pipe[0]);
+            close(ready_pipe[1]);
+        }
         return -1;
     } else if (pid == 0) {
         // Child process
         extern char **environ;
-        char *exec_argv[MAX_TOOL_ARGS];
-        int arg_idx = 0;
-
-        // Determine the primary tool to execute
-        const char *primary_tool_name = NULL;
-        char *resolved_tool_path = NULL;
-
-        if (use_valgrind) {
-            primary_tool_name = "valgrind";
-            exec_argv[arg_idx++] = (char *)primary_tool_name;
-            exec_argv[arg_idx++] = "--tool=memcheck"; // Default to memcheck
-            
-            // Construct the --log-file argument correctly
-            char *log_file_arg = (char *)malloc(strlen("--log-file=") + strlen(valgrind_output_path) + 1);
-            if (log_file_arg == NULL) {
-                perror("runescope: malloc failed for valgrind log file arg");
-                _exit(EXIT_FAILURE);
+        if (!keep_stdin) {
+            int null_fd = open("/dev/null", O_RDONLY);
+            if (null_fd != -1) {
+                dup2(null_fd, STDIN_FILENO);
+                close(null_fd);
             }
-            strcpy(log_file_arg, "--log-file=");
-            strcat(log_file_arg, valgrind_output_path);
-            exec_argv[arg_idx++] = log_file_arg;
-
-            exec_argv[arg_idx++] = "--leak-check=full";
-            exec_argv[arg_idx++] = "--show-leak-kinds=all";
-            exec_argv[arg_idx++] = "--track-origins=yes";
+        }
+        if (counters != NULL) {
+            char go;
+            close(ready_pipe[1]);
+            if (read(ready_pipe[0], &go, 1) != 1) {
+                _exit(EXIT_FAILURE); // The parent could not set up the counters
+            }
+            close(ready_pipe[0]);
+        }
+        execve(job->path, job->argv, job->envp != NULL ? job->envp : environ);
+        perror(job->tool != NULL ? "runescope: execve tool failed" : "runescope: execve target failed");
+        _exit(EXIT_FAILURE);
+    }
 
-            // Add the -- separator for valgrind to indicate end of its options
-            exec_argv[arg_idx++] = "--";
+    // Parent process
+    job->pid = pid;
+    if (counters != NULL) {
+        close(ready_pipe[0]);
+        if (rune_counters_open(counters, pid) == -1) {
+            int status;
+            close(ready_pipe[1]); // The child sees EOF and exits
+            waitpid(pid, &status, 0);
+            job->pid = -1;
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &job->started);
+        if (write(ready_pipe[1], "", 1) != 1) {
+            perror("runescope: write failed for counter setup");
         }
+        close(ready_pipe[1]);
+    }
+    return 0;
+}
+
+// A pidfd for a child, or -1 if the kernel has none (before Linux 5.3)
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
 
-        if (use_ltrace) {
-            // If valgrind is also used, ltrace is an argument to valgrind
-            if (use_valgrind) {
-                exec_argv[arg_idx++] = "ltrace"; // Pass 'ltrace' as an argument to valgrind
-            } else if (!primary_tool_name) { // If ltrace is the primary tool
-                primary_tool_name = "ltrace";
-                exec_argv[arg_idx++] = (char *)primary_tool_name;
+// Like waitpid(-1, status, 0), but samples the tree of the first job at every tick of timer_fd meanwhile
+static pid_t wait_sampling(rune_sampler_t *sampler, int timer_fd, const exec_job_t *jobs, size_t num_started,
+                           int *status) {
+    for (;;) {
+        siginfo_t info;
+        info.si_pid = 0;
+        // Leave the child a zombie for now, so that the sampler gets a last look at it
+        if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) == -1) {
+            if (errno == EINTR) {
+                continue;
             }
-            exec_argv[arg_idx++] = "-o";
-            exec_argv[arg_idx++] = (char *)ltrace_output_path;
-            exec_argv[arg_idx++] = "-f"; // Trace child processes
-        }
-
-        if (use_strace) {
-            // If valgrind or ltrace is also used, strace is an argument to the preceding tool
-            if (use_valgrind || use_ltrace) {
-                exec_argv[arg_idx++] = "strace"; // Pass 'strace' as an argument to valgrind/ltrace
-            } else if (!primary_tool_name) { // If strace is the primary tool
-                primary_tool_name = "strace";
-                exec_argv[arg_idx++] = (char *)primary_tool_name;
+            return -1;
+        }
+        if (info.si_pid != 0) {
+            if (info.si_pid == sampler->root) {
+                rune_sampler_sample(sampler); // Its CPU times and I/O counts are final now
             }
-            exec_argv[arg_idx++] = "-o";
-            exec_argv[arg_idx++] = (char *)strace_output_path;
-            exec_argv[arg_idx++] = "-f"; // Trace child processes
+            return waitpid(info.si_pid, status, 0);
         }
 
-        // Resolve the path of the primary tool
-        resolved_tool_path = rune_path_finder_find_executable(primary_tool_name);
-        if (resolved_tool_path == NULL) {
-            fprintf(stderr, "runescope: Error: Tool '%s' not found in PATH or not executable.\n", primary_tool_name);
-            _exit(EXIT_FAILURE);
+        struct pollfd fds[1 + RUNE_EXEC_MAX_JOBS];
+        nfds_t num_fds = 0;
+        int timeout = -1;
+        fds[num_fds].fd = timer_fd;
+        fds[num_fds++].events = POLLIN;
+        for (size_t j = 0; j < num_started; j++) {
+            if (jobs[j].pid == -1) {
+                continue;
+            }
+            if (jobs[j].pidfd == -1) {
+                timeout = EXIT_POLL_MS;
+                continue;
+            }
+            fds[num_fds].fd = jobs[j].pidfd;
+            fds[num_fds++].events = POLLIN;
         }
+        if (poll(fds, num_fds, timeout) == -1 && errno != EINTR) {
+            return -1;
+        }
+        if (fds[0].revents & POLLIN) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                rune_sampler_sample(sampler);
+            }
+        }
+    }
+}
 
-        // The first argument to execve must be the path to the executable itself
-        // This is already handled by setting exec_argv[0] to resolved_tool_path
+int rune_exec_run_target(const char *executable_path, char *const argv_target[], 
+                         int use_strace, const char *strace_output_path, 
+                         int use_ltrace, const char *ltrace_output_path, 
+                         int use_valgrind, const char *valgrind_output_path,
+                         const rune_exec_options_t *options) {
+    rune_counters_t *counters = options != NULL ? options->counters : NULL;
+    exec_job_t jobs[RUNE_EXEC_MAX_JOBS];
+    rune_exec_job_t results[RUNE_EXEC_MAX_JOBS];
+    size_t num_jobs = 0;
+    int failed = 0;
 
-        // Add the target executable and its arguments
-        exec_argv[arg_idx++] = (char *)executable_path;
-        for (int i = 1; argv_target[i] != NULL && arg_idx < MAX_TOOL_ARGS - 1; i++) {
-            exec_argv[arg_idx++] = argv_target[i];
+    // Slowest tool first, so that with fewer slots than tools it does not start last
+    if (use_valgrind) {
+        failed |= build_job(&jobs[num_jobs++], "valgrind", valgrind_output_path, executable_path, argv_target, options);
+    }
+    if (use_ltrace && !failed) {
+        failed |= build_job(&jobs[num_jobs++], "ltrace", ltrace_output_path, executable_path, argv_target, options);
+    }
+    if (use_strace && !failed) {
+        failed |= build_job(&jobs[num_jobs++], "strace", strace_output_path, executable_path, argv_target, options);
+    }
+    if (num_jobs == 0) {
+        failed |= build_job(&jobs[num_jobs++], NULL, NULL, executable_path, argv_target, options);
+    }
+
+    rune_sampler_t *sampler = options != NULL ? options->sampler : NULL;
+    int timer_fd = -1;
+    if (sampler != NULL && !failed) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        struct itimerspec tick = {0};
+        tick.it_interval.tv_sec = sampler->interval_ms / 1000;
+        tick.it_interval.tv_nsec = (long)(sampler->interval_ms % 1000) * 1000000;
+        tick.it_value = tick.it_interval;
+        if (timer_fd == -1 || timerfd_settime(timer_fd, 0, &tick, NULL) == -1) {
+            perror("runescope: timerfd setup failed for process sampler");
+            failed = 1;
         }
-        exec_argv[arg_idx] = NULL; // Null-terminate the argument list
+    }
 
-        execve(resolved_tool_path, exec_argv, environ);
-        perror("runescope: execve tool failed");
-        free(resolved_tool_path); // Free the dynamically allocated path
-        // Free the valgrind log_file_arg if it was allocated
-        if (use_valgrind) {
-            // The log_file_arg is at index 2 if valgrind is the primary tool
-            // and we added --tool=memcheck at index 1.
-            // This is fragile, a better way is to store the pointer.
-            free(exec_argv[2]); 
+    size_t max_running = options != NULL && options->max_jobs > 0 ? (size_t)options->max_jobs
+                                                                  : (size_t)rune_pool_cpu_count();
+    size_t next = 0;
+    size_t running = 0;
+    for (;;) {
+        while (!failed && next < num_jobs && running < max_running) {
+            if (start_job(&jobs[next], next == 0, next == 0 ? counters : NULL) == -1) {
+                failed = 1;
+                break;
+            }
+            if (sampler != NULL) {
+                jobs[next].pidfd = open_pidfd(jobs[next].pid);
+                if (next == 0) {
+                    rune_sampler_attach(sampler, jobs[0].pid, jobs[0].tool != NULL);
+                }
+            }
+            next++;
+            running++;
         }
-        _exit(EXIT_FAILURE);
-    } else {
-        // Parent process
+        if (running == 0) {
+            break;
+        }
+
         int status;
-        if (waitpid(pid, &status, 0) == -1) {
+        pid_t pid = sampler != NULL ? wait_sampling(sampler, timer_fd, jobs, next, &status)
+                                    : waitpid(-1, &status, 0);
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
             // Defensive programming: Handle waitpid failure
             perror("runescope: waitpid failed");
-            return -1; // Indicate an error in runescope itself
+            failed = 1;
+            break;
+        }
+        size_t j = 0;
+        while (j < next && jobs[j].pid != pid) {
+            j++;
+        }
+        if (j == next) {
+            continue; // Not one of ours
+        }
+
+        struct timespec finished;
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        running--;
+        jobs[j].pid = -1;
+        if (jobs[j].pidfd != -1) {
+            close(jobs[j].pidfd);
+            jobs[j].pidfd = -1;
+        }
+        results[j].tool = jobs[j].tool;
+        results[j].wall_ns = elapsed_ns(&jobs[j].started, &finished);
+        results[j].counted = j == 0 && counters != NULL;
+        if (results[j].counted) {
+            counters->wall_ns = results[j].wall_ns;
+            rune_counters_read(counters);
         }
 
         if (WIFEXITED(status)) {
-            return WEXITSTATUS(status); // Return the exit status of the child
-        } else if (WIFSIGNALED(status)) {
-            fprintf(stderr, "runescope: Target program terminated by signal %d\n", WTERMSIG(status));
-            return -1; // Or a specific error code for signal termination
+            results[j].exit_status = WEXITSTATUS(status);
         } else {
-            // Defensive programming: Handle other unexpected termination scenarios
-            fprintf(stderr, "runescope: Target program terminated abnormally.\n");
+            results[j].exit_status = -1;
+            if (WIFSIGNALED(status)) {
+                fprintf(stderr, "runescope: Target program%s%s terminated by signal %d\n",
+                        jobs[j].tool != NULL ? " under " : "", jobs[j].tool != NULL ? jobs[j].tool : "",
+                        WTERMSIG(status));
+            } else {
+                // Defensive programming: Handle other unexpected termination scenarios
+                fprintf(stderr, "runescope: Target program terminated abnormally.\n");
+            }
+        }
+    }
+
+    for (size_t j = 0; j < num_jobs; j++) {
+        if (jobs[j].tool != NULL) {
+            free(jobs[j].path);
+        }
+        free_environment(jobs[j].envp);
+        if (jobs[j].pidfd != -1) {
+            close(jobs[j].pidfd);
+        }
+    }
+    if (timer_fd != -1) {
+        close(timer_fd);
+    }
+    if (failed || next < num_jobs) {
+        if (counters != NULL && next > 0 && counters->wall_ns == 0) {
+            rune_counters_close(counters);
+        }
+        return -1; // Indicate an error in runescope itself
+    }
+    if (options != NULL && options->jobs != NULL) {
+        memcpy(options->jobs->jobs, results, num_jobs * sizeof(results[0]));
+        options->jobs->count = num_jobs;
+    }
+    return results[0].exit_status;
+}
+
+static int64_t timeval_ns(const struct timeval *tv) {
+    return (int64_t)tv->tv_sec * 1000000000 + (int64_t)tv->tv_usec * 1000;
+}
+
+int rune_exec_run_measured(const char *executable_path, char *const argv_target[], int cpu, int quiet,
+                           rune_exec_usage_t *usage) {
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        perror("runescope: fork failed");
+        return -1;
+    } else if (pid == 0) {
+        extern char **environ;
+        if (cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+                perror("runescope: sched_setaffinity failed");
+                _exit(EXIT_FAILURE);
+            }
+        }
+        if (quiet) {
+            int null_fd = open("/dev/null", O_WRONLY);
+            if (null_fd != -1) {
+                dup2(null_fd, STDOUT_FILENO);
+                close(null_fd);
+            }
+        }
+        execve(executable_path, argv_target, environ);
+        perror("runescope: execve target failed");
+        _exit(EXIT_FAILURE);
+    }
+
+    int status;
+    struct rusage ru;
+    while (wait4(pid, &status, 0, &ru) == -1) {
+        if (errno != EINTR) {
+            perror("runescope: wait4 failed");
             return -1;
         }
     }
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    usage->wall_ns = elapsed_ns(&started, &finished);
+    usage->user_ns = timeval_ns(&ru.ru_utime);
+    usage->sys_ns = timeval_ns(&ru.ru_stime);
+    usage->max_rss_kb = ru.ru_maxrss;
+    usage->minor_faults = ru.ru_minflt;
+    usage->major_faults = ru.ru_majflt;
+    usage->voluntary_switches = ru.ru_nvcsw;
+    usage->involuntary_switches = ru.ru_nivcsw;
+    usage->exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return 0;
 }
@@ -1,12 +1,49 @@
 #ifndef RUNE_EXEC_H
 #define RUNE_EXEC_H
 
+#include <stdint.h>
+#include "rune_counters.h"
+#include "rune_sampler.h"
+
+#define RUNE_EXEC_MAX_JOBS 3
+
+// One tool's run of the target
+typedef struct {
+    const char *tool;  // "strace", "ltrace", "valgrind", or NULL for the untraced target
+    int exit_status;   // The target's exit status under the tool, -1 if killed by a signal
+    int64_t wall_ns;   // From fork to exit
+    int counted;       // The performance counters were attached to this job
+} rune_exec_job_t;
+
+// What happened to every job of a run
+typedef struct {
+    rune_exec_job_t jobs[RUNE_EXEC_MAX_JOBS];
+    size_t count;
+} rune_exec_jobs_t;
+
+// Extra settings for the tracing tools
+typedef struct {
+    int strace_timing; // Run strace with -ttt -T: a timestamp and the time spent on every syscall
+    int ltrace_timing; // Run ltrace with -ttt: a timestamp on every library call
+    rune_counters_t *counters; // If set, count performance events of the first job from its execve on
+    int max_jobs; // Tools running at the same time, 0 = one per CPU
+    rune_exec_jobs_t *jobs; // If set, receives the exit status and wall time of every job
+    const char *valgrind_tool; // "cachegrind" or "callgrind" instead of memcheck, NULL for memcheck
+    const char *valgrind_profile_path; // With valgrind_tool: where the tool writes its profile
+    rune_sampler_t *sampler; // If set, samples the process tree of the first job from /proc until it exits
+    const char *preload_library; // If set, the untraced target runs with this library in LD_PRELOAD...
+    const char *preload_region_path; // ...and this path in RUNESCOPE_PRELOAD_SHM
+} rune_exec_options_t;
+
 /**
  * @brief Executes a target program with its arguments, optionally using strace, ltrace, and valgrind.
  *
- * This function forks a new process and uses execve to run the target executable.
- * It can chain strace, ltrace, and valgrind based on the provided flags.
- * It includes basic error checking for fork and execve.
+ * Every selected tool runs the target on its own, as a separate child with
+ * its own log, so that no tool traces another and the overheads do not
+ * multiply. Up to options->max_jobs tools run in parallel; the slowest
+ * (valgrind, then ltrace) are started first. With no tool, the target is
+ * executed directly. Only the first job reads runescope's stdin, the others
+ * read /dev/null.
  *
  * @param executable_path The absolute path to the target executable.
  * @param argv_target An array of strings representing the arguments for the target executable,
@@ -17,11 +54,44 @@
  * @param ltrace_output_path If use_ltrace is true, the path to the file where ltrace output will be written.
  * @param use_valgrind If true, the target program will be run under valgrind (memcheck).
  * @param valgrind_output_path If use_valgrind is true, the path to the file where valgrind output will be written.
- * @return The exit status of the executed program, or -1 if an error occurred in runescope itself.
+ * @param options Extra tool settings, or NULL for the defaults. With options->counters,
+ *                the first job waits until the counters are attached before it execs,
+ *                and the counters are read once it has exited. With options->sampler,
+ *                runescope waits on a timerfd and pidfds instead of blocking in waitpid,
+ *                and samples the first job's processes at every tick.
+ * @return The exit status of the target under the first job, or -1 if an error occurred
+ *         in runescope itself or the target was killed.
  */
 int rune_exec_run_target(const char *executable_path, char *const argv_target[], 
                          int use_strace, const char *strace_output_path, 
                          int use_ltrace, const char *ltrace_output_path, 
-                         int use_valgrind, const char *valgrind_output_path);
+                         int use_valgrind, const char *valgrind_output_path,
+                         const rune_exec_options_t *options);
+
+// Resource usage of one run, as reported by wait4
+typedef struct {
+    int64_t wall_ns;             // From fork to exit
+    int64_t user_ns;
+    int64_t sys_ns;
+    long max_rss_kb;
+    long minor_faults;
+    long major_faults;
+    long voluntary_switches;     // The target blocked
+    long involuntary_switches;   // The target was preempted
+    int exit_status;             // Exit code, or -1 if the target was killed by a signal
+} rune_exec_usage_t;
+
+/**
+ * @brief Runs a target directly (no tools) and measures it.
+ *
+ * @param executable_path The absolute path to the target executable.
+ * @param argv_target The target's arguments, starting with argv[0].
+ * @param cpu The CPU to pin the target to, or -1 to let it run anywhere.
+ * @param quiet If non-zero, the target's stdout goes to /dev/null.
+ * @param usage Receives the wall clock time and resource usage of the run.
+ * @return 0 on success, -1 if the target could not be run or waited for.
+ */
+int rune_exec_run_measured(const char *executable_path, char *const argv_target[], int cpu, int quiet,
+                           rune_exec_usage_t *usage);
 
 #endif // RUNE_EXEC_H
@@ -0,0 +1,413 @@
+#define _POSIX_C_SOURCE 200809L // For flockfile
+#include "rune_futex.h"
+#include "rune_latency.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TOP_WAKERS_WORDS 5 // Futex words whose wakers are listed
+#define TOP_WAKER_PAIRS 3  // Waker -> waiter pairs listed per word
+
+// Futex commands, as in <linux/futex.h>
+enum {
+    FUTEX_CMD_WAIT = 0,
+    FUTEX_CMD_WAKE = 1,
+    FUTEX_CMD_REQUEUE = 3,
+    FUTEX_CMD_CMP_REQUEUE = 4,
+    FUTEX_CMD_WAKE_OP = 5,
+    FUTEX_CMD_LOCK_PI = 6,
+    FUTEX_CMD_UNLOCK_PI = 7,
+    FUTEX_CMD_TRYLOCK_PI = 8,
+    FUTEX_CMD_WAIT_BITSET = 9,
+    FUTEX_CMD_WAKE_BITSET = 10,
+    FUTEX_CMD_WAIT_REQUEUE_PI = 11,
+    FUTEX_CMD_CMP_REQUEUE_PI = 12,
+    FUTEX_CMD_LOCK_PI2 = 13
+};
+
+#define FUTEX_CMD_MASK 0x7f // Drops FUTEX_PRIVATE_FLAG and FUTEX_CLOCK_REALTIME
+
+// Longer names first, so that FUTEX_WAIT doesn't match FUTEX_WAIT_BITSET
+static const struct {
+    const char *name;
+    int cmd;
+} futex_commands[] = {
+    { "WAIT_REQUEUE_PI", FUTEX_CMD_WAIT_REQUEUE_PI },
+    { "WAIT_BITSET", FUTEX_CMD_WAIT_BITSET },
+    { "WAIT", FUTEX_CMD_WAIT },
+    { "WAKE_BITSET", FUTEX_CMD_WAKE_BITSET },
+    { "WAKE_OP", FUTEX_CMD_WAKE_OP },
+    { "WAKE", FUTEX_CMD_WAKE },
+    { "CMP_REQUEUE_PI", FUTEX_CMD_CMP_REQUEUE_PI },
+    { "CMP_REQUEUE", FUTEX_CMD_CMP_REQUEUE },
+    { "REQUEUE", FUTEX_CMD_REQUEUE },
+    { "LOCK_PI2", FUTEX_CMD_LOCK_PI2 },
+    { "LOCK_PI", FUTEX_CMD_LOCK_PI },
+    { "UNLOCK_PI", FUTEX_CMD_UNLOCK_PI },
+    { "TRYLOCK_PI", FUTEX_CMD_TRYLOCK_PI },
+};
+
+typedef enum {
+    FUTEX_OP_OTHER,
+    FUTEX_OP_WAIT,
+    FUTEX_OP_WAKE
+} futex_op_kind_t;
+
+// One futex call on a lock word
+typedef struct {
+    uint64_t uaddr;
+    int64_t order;   // When the wait returned or the wake was issued
+    size_t event;    // Index in the store
+    futex_op_kind_t kind;
+} futex_op_t;
+
+// Aggregates for one lock word
+typedef struct {
+    uint64_t uaddr;
+    size_t first;    // Its ops are ops[first..first + num_ops)
+    size_t num_ops;
+    unsigned long waits;
+    unsigned long eagain;
+    unsigned long timeouts;
+    unsigned long threads;  // Distinct waiting threads
+    unsigned long wakes;
+    unsigned long woken;    // Sum of the wake return values
+    int64_t blocked_ns;     // Total duration of the waits
+    int64_t max_ns;
+} futex_word_t;
+
+// A waker -> waiter pair and how often it occurred
+typedef struct {
+    int32_t waker;
+    int32_t waiter;
+    unsigned long count;
+} waker_pair_t;
+
+// Parses "0x7f3a...", as strace prints addresses and the native tracer prints every argument
+static const char *parse_number(const char *p, const char *end, uint64_t *value) {
+    int base = 10;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        base = 16;
+        p += 2;
+    }
+    const char *start = p;
+    uint64_t v = 0;
+    while (p < end && isxdigit((unsigned char)*p)) {
+        int digit = isdigit((unsigned char)*p) ? *p - '0' : (tolower((unsigned char)*p) - 'a' + 10);
+        if (digit >= base) {
+            break;
+        }
+        v = v * (uint64_t)base + (uint64_t)digit;
+        p++;
+    }
+    *value = v;
+    return p > start ? p : NULL;
+}
+
+// Returns the FUTEX_CMD_* of an operation argument (symbolic or numeric), or -1
+static int parse_command(const char *p, const char *end) {
+    uint64_t numeric;
+    if (end - p > 6 && memcmp(p, "FUTEX_", 6) == 0) {
+        p += 6;
+        for (size_t i = 0; i < sizeof(futex_commands) / sizeof(futex_commands[0]); i++) {
+            size_t len = strlen(futex_commands[i].name);
+            if ((size_t)(end - p) < len || memcmp(p, futex_commands[i].name, len) != 0) {
+                continue;
+            }
+            const char *rest = p + len;
+            if (rest == end || *rest == ',' || *rest == '|' || (end - rest >= 8 && memcmp(rest, "_PRIVATE", 8) == 0)) {
+                return futex_commands[i].cmd;
+            }
+        }
+        return -1;
+    }
+    if (parse_number(p, end, &numeric) != NULL) {
+        return (int)(numeric & FUTEX_CMD_MASK);
+    }
+    return -1;
+}
+
+// Classifies one futex call from its argument text; returns 0 if it is not a wait or wake
+static int parse_futex_call(rune_strview_t args, uint64_t *uaddr, futex_op_kind_t *kind) {
+    const char *p = args.ptr;
+    const char *end = args.ptr + args.len;
+    p = parse_number(p, end, uaddr);
+    if (p == NULL || p == end || *p != ',') {
+        return 0;
+    }
+    p++;
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    switch (parse_command(p, end)) {
+        case FUTEX_CMD_WAIT:
+        case FUTEX_CMD_WAIT_BITSET:
+        case FUTEX_CMD_WAIT_REQUEUE_PI:
+        case FUTEX_CMD_LOCK_PI:
+        case FUTEX_CMD_LOCK_PI2:
+            *kind = FUTEX_OP_WAIT;
+            return 1;
+        case FUTEX_CMD_WAKE:
+        case FUTEX_CMD_WAKE_BITSET:
+        case FUTEX_CMD_WAKE_OP:
+        case FUTEX_CMD_UNLOCK_PI:
+        case FUTEX_CMD_REQUEUE:
+        case FUTEX_CMD_CMP_REQUEUE:
+        case FUTEX_CMD_CMP_REQUEUE_PI:
+            *kind = FUTEX_OP_WAKE;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int compare_ops(const void *a, const void *b) {
+    const futex_op_t *oa = a;
+    const futex_op_t *ob = b;
+    if (oa->uaddr != ob->uaddr) {
+        return oa->uaddr < ob->uaddr ? -1 : 1;
+    }
+    if (oa->order != ob->order) {
+        return oa->order < ob->order ? -1 : 1;
+    }
+    // A wake issued when a wait returns comes first, so it can be its waker
+    return (int)ob->kind - (int)oa->kind;
+}
+
+static int compare_words(const void *a, const void *b) {
+    const futex_word_t *wa = a;
+    const futex_word_t *wb = b;
+    if (wa->blocked_ns != wb->blocked_ns) {
+        return wa->blocked_ns < wb->blocked_ns ? 1 : -1;
+    }
+    if (wa->waits != wb->waits) {
+        return wa->waits < wb->waits ? 1 : -1;
+    }
+    return (wa->uaddr > wb->uaddr) - (wa->uaddr < wb->uaddr);
+}
+
+static int compare_int32(const void *a, const void *b) {
+    int32_t ia = *(const int32_t *)a;
+    int32_t ib = *(const int32_t *)b;
+    return (ia > ib) - (ia < ib);
+}
+
+static int compare_pairs(const void *a, const void *b) {
+    const waker_pair_t *pa = a;
+    const waker_pair_t *pb = b;
+    if (pa->waker != pb->waker) {
+        return pa->waker < pb->waker ? -1 : 1;
+    }
+    return (pa->waiter > pb->waiter) - (pa->waiter < pb->waiter);
+}
+
+static int compare_pair_counts(const void *a, const void *b) {
+    const waker_pair_t *pa = a;
+    const waker_pair_t *pb = b;
+    if (pa->count != pb->count) {
+        return pa->count < pb->count ? 1 : -1;
+    }
+    return compare_pairs(a, b);
+}
+
+// Fills in the counters of a word from its ops, which are sorted by order
+static void aggregate_word(const rune_store_t *store, const futex_op_t *ops, futex_word_t *word, int32_t *scratch) {
+    size_t num_waiters = 0;
+    for (size_t i = 0; i < word->num_ops; i++) {
+        size_t e = ops[i].event;
+        if (ops[i].kind == FUTEX_OP_WAKE) {
+            word->wakes++;
+            if (!(store->flags[e] & RUNE_EVENT_ERROR) && store->ret[e] > 0) {
+                word->woken += (unsigned long)store->ret[e];
+            }
+            continue;
+        }
+        word->waits++;
+        if (store->flags[e] & RUNE_EVENT_ERROR) {
+            word->eagain += store->err[e] == EAGAIN;
+            word->timeouts += store->err[e] == ETIMEDOUT;
+        }
+        if (store->duration_ns[e] >= 0) {
+            word->blocked_ns += store->duration_ns[e];
+            if (store->duration_ns[e] > word->max_ns) {
+                word->max_ns = store->duration_ns[e];
+            }
+        }
+        scratch[num_waiters++] = store->pid[e];
+    }
+    qsort(scratch, num_waiters, sizeof(int32_t), compare_int32);
+    for (size_t i = 0; i < num_waiters; i++) {
+        word->threads += i == 0 || scratch[i] != scratch[i - 1];
+    }
+}
+
+// Pairs each successful wait with the last wake by another thread before it returned
+static size_t collect_wakers(const rune_store_t *store, const futex_op_t *ops, size_t num_ops, waker_pair_t *pairs) {
+    int32_t last = 0, other = 0; // Last waker, and last waker other than it
+    int have_last = 0, have_other = 0;
+    size_t num_pairs = 0;
+    for (size_t i = 0; i < num_ops; i++) {
+        size_t e = ops[i].event;
+        int32_t pid = store->pid[e];
+        if (ops[i].kind == FUTEX_OP_WAKE) {
+            if (have_last && last != pid) {
+                other = last;
+                have_other = 1;
+            }
+            last = pid;
+            have_last = 1;
+            continue;
+        }
+        if (store->flags[e] & (RUNE_EVENT_ERROR | RUNE_EVENT_UNFINISHED)) {
+            continue;
+        }
+        if (have_last && last != pid) {
+            pairs[num_pairs].waker = last;
+        } else if (have_other && other != pid) {
+            pairs[num_pairs].waker = other;
+        } else {
+            continue;
+        }
+        pairs[num_pairs].waiter = pid;
+        pairs[num_pairs].count = 1;
+        num_pairs++;
+    }
+
+    // Count identical pairs
+    qsort(pairs, num_pairs, sizeof(waker_pair_t), compare_pairs);
+    size_t distinct = 0;
+    for (size_t i = 0; i < num_pairs; i++) {
+        if (distinct > 0 && compare_pairs(&pairs[distinct - 1], &pairs[i]) == 0) {
+            pairs[distinct - 1].count++;
+        } else {
+            pairs[distinct++] = pairs[i];
+        }
+    }
+    qsort(pairs, distinct, sizeof(waker_pair_t), compare_pair_counts);
+    return distinct;
+}
+
+// Returns the name ID of the futex syscall, or -1 if the trace has none
+static long futex_name_id(const rune_store_t *store) {
+    for (uint32_t id = 0; id < store->names.count; id++) {
+        if (strcmp(rune_store_name(store, id), "futex") == 0) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+int rune_futex_report(const rune_store_t *store, FILE *out, size_t top_n) {
+    long futex_id = futex_name_id(store);
+    size_t num_ops = 0;
+    int timed = 1; // Whether every futex call has a timestamp to order by
+    int64_t other_ns = 0; // Time in every other syscall
+    for (size_t i = 0; i < store->count; i++) {
+        if ((long)store->name_id[i] == futex_id) {
+            num_ops++;
+            timed &= store->timestamp_ns[i] != 0;
+        } else if (store->duration_ns[i] > 0) {
+            other_ns += store->duration_ns[i];
+        }
+    }
+
+    futex_op_t *ops = malloc((num_ops + 1) * sizeof(futex_op_t));
+    futex_word_t *words = malloc((num_ops + 1) * sizeof(futex_word_t));
+    int32_t *scratch = malloc((num_ops + 1) * sizeof(int32_t));
+    waker_pair_t *pairs = malloc((num_ops + 1) * sizeof(waker_pair_t));
+    if (ops == NULL || words == NULL || scratch == NULL || pairs == NULL) {
+        perror("runescope: malloc failed for futex analysis");
+        free(ops);
+        free(words);
+        free(scratch);
+        free(pairs);
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < store->count && futex_id >= 0; i++) {
+        if ((long)store->name_id[i] != futex_id ||
+            !parse_futex_call(rune_store_args(store, i), &ops[n].uaddr, &ops[n].kind)) {
+            continue;
+        }
+        ops[n].event = i;
+        ops[n].order = (int64_t)i; // A resumed wait is stored where it returned
+        if (timed) {
+            ops[n].order = store->timestamp_ns[i];
+            if (ops[n].kind == FUTEX_OP_WAIT && store->duration_ns[i] > 0) {
+                ops[n].order += store->duration_ns[i];
+            }
+        }
+        n++;
+    }
+    num_ops = n;
+    qsort(ops, num_ops, sizeof(futex_op_t), compare_ops);
+
+    size_t num_words = 0;
+    unsigned long total_waits = 0, total_wakes = 0;
+    int64_t total_blocked = 0;
+    for (size_t i = 0; i < num_ops; i++) {
+        if (num_words == 0 || ops[i].uaddr != words[num_words - 1].uaddr) {
+            memset(&words[num_words], 0, sizeof(futex_word_t));
+            words[num_words].uaddr = ops[i].uaddr;
+            words[num_words].first = i;
+            num_words++;
+        }
+        words[num_words - 1].num_ops++;
+    }
+    for (size_t w = 0; w < num_words; w++) {
+        aggregate_word(store, &ops[words[w].first], &words[w], scratch);
+        total_waits += words[w].waits;
+        total_wakes += words[w].wakes;
+        total_blocked += words[w].blocked_ns;
+    }
+    qsort(words, num_words, sizeof(futex_word_t), compare_words);
+
+    flockfile(out);
+    fprintf(out, "\n--- Futex contention: %zu futex words, %lu waits, %lu wakes ---\n", num_words, total_waits,
+            total_wakes);
+    if (total_waits > 0) {
+        fprintf(out, "Blocked in futex waits: %.6fs; in all other syscalls: %.6fs (futex waits are %.1f%% of syscall time)\n",
+                (double)total_blocked / 1e9, (double)other_ns / 1e9,
+                total_blocked + other_ns > 0 ? 100.0 * (double)total_blocked / (double)(total_blocked + other_ns) : 0.0);
+        size_t shown = top_n == 0 || top_n > num_words ? num_words : top_n;
+        fprintf(out, "%10s %8s %8s %8s %12s %9s %10s %8s  %s\n", "waits", "eagain", "timeout", "threads", "blocked(s)",
+                "max", "wakes", "woken", "uaddr");
+        for (size_t w = 0; w < shown; w++) {
+            char max[16];
+            fprintf(out, "%10lu %8lu %8lu %8lu %12.6f %9s %10lu %8lu  0x%llx\n", words[w].waits, words[w].eagain,
+                    words[w].timeouts, words[w].threads, (double)words[w].blocked_ns / 1e9,
+                    rune_latency_format(words[w].max_ns, max, sizeof(max)), words[w].wakes, words[w].woken,
+                    (unsigned long long)words[w].uaddr);
+        }
+        if (shown < num_words) {
+            fprintf(out, "%10s %8s  (%zu more)\n", "...", "", num_words - shown);
+        }
+
+        size_t wakers_shown = shown < TOP_WAKERS_WORDS ? shown : TOP_WAKERS_WORDS;
+        fprintf(out, "\nWakers of the hottest futex words (waker -> waiter x times, by %s):\n",
+                timed ? "timestamp" : "log order");
+        for (size_t w = 0; w < wakers_shown; w++) {
+            size_t num_pairs = collect_wakers(store, &ops[words[w].first], words[w].num_ops, pairs);
+            fprintf(out, "  0x%llx:", (unsigned long long)words[w].uaddr);
+            if (num_pairs == 0) {
+                fprintf(out, " no wakes seen from other threads");
+            }
+            for (size_t p = 0; p < num_pairs && p < TOP_WAKER_PAIRS; p++) {
+                fprintf(out, "%s %d -> %d x%lu", p > 0 ? "," : "", pairs[p].waker, pairs[p].waiter, pairs[p].count);
+            }
+            if (num_pairs > TOP_WAKER_PAIRS) {
+                fprintf(out, ", (%zu more pairs)", num_pairs - TOP_WAKER_PAIRS);
+            }
+            fprintf(out, "\n");
+        }
+    }
+    funlockfile(out);
+
+    free(ops);
+    free(words);
+    free(scratch);
+    free(pairs);
+    return 0;
+}
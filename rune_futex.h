@@ -0,0 +1,35 @@
+#ifndef RUNE_FUTEX_H
+#define RUNE_FUTEX_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "rune_store.h"
+
+/**
+ * @brief Lock contention analysis of futex calls.
+ *
+ * Contended mutexes, condition variables and joins all end up as futex
+ * waits on the address of a lock word. Grouping the waits of a trace by that
+ * address shows which locks threads queue on, how long they stay blocked and
+ * which threads release them, as opposed to time blocked in real I/O.
+ */
+
+/**
+ * @brief Prints the futex words of a store ranked by time blocked on them.
+ *
+ * For every word: waits, waits that found the value already changed
+ * (EAGAIN), timeouts, distinct waiting threads, total and maximum blocked
+ * time and wakes. For the hottest words, each successful wait is paired with
+ * the last wake on the same word by another thread before it returned, to
+ * show which threads wake which. Blocked times need durations (strace -T or
+ * the native tracer); waker pairing uses timestamps if the trace has them
+ * and log order otherwise.
+ *
+ * @param store The events; only futex calls are considered.
+ * @param out The stream to print to.
+ * @param top_n The number of futex words to list.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_futex_report(const rune_store_t *store, FILE *out, size_t top_n);
+
+#endif // RUNE_FUTEX_H
@@ -0,0 +1,654 @@
+#define _POSIX_C_SOURCE 200809L // For getline and flockfile
+#include "rune_grind.h"
+#include "rune_intern.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_EVENTS 32
+#define MAX_POSITIONS 2
+#define INITIAL_TABLE_BITS 10
+#define TOP_MISSES 5
+#define NUM_METRICS 4
+#define NO_NAME UINT32_MAX
+#define READ_BUFFER (1 << 20)
+
+// Name compression ids live in three separate spaces
+typedef enum {
+    SPACE_FILE,  // fl=, fi=, fe=, cfi=, cfl=
+    SPACE_FN,    // fn=, cfn=
+    SPACE_OBJ,   // ob=, cob=
+    NUM_SPACES,
+} name_space_t;
+
+// Rows of costs keyed by a 64-bit key, found through an open-addressing index
+typedef struct {
+    size_t width;       // Costs per row
+    uint64_t *keys;     // Row -> key
+    uint64_t *costs;    // Row * width
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;    // Row + 1, 0 = empty
+    unsigned slot_bits;
+} cost_table_t;
+
+// A derived column: the sum of up to three events
+typedef struct {
+    const char *title;
+    int events[3];
+    int num_events;
+} metric_t;
+
+typedef struct {
+    size_t num_events;
+    char *event_names[MAX_EVENTS];
+    size_t num_positions;
+    int line_position;          // Which position is the line number, -1 if none
+    uint64_t last[MAX_POSITIONS];
+    rune_intern_t names;
+    uint32_t *compressed[NUM_SPACES]; // Compression id -> interned name
+    size_t compressed_capacity[NUM_SPACES];
+    uint32_t file;              // fl=: the current function's file
+    uint32_t source;            // fi=/fe=: where the following lines are, for inlined code
+    uint32_t function;
+    size_t function_row;        // Row of (function, file), valid while function_valid
+    int function_valid;
+    int pending_call;           // The next cost line is the inclusive cost of a call
+    int has_calls;
+    uint64_t totals[MAX_EVENTS];
+    uint64_t summary[MAX_EVENTS];      // From "summary:", the whole program
+    uint64_t part_totals[MAX_EVENTS];  // Sum of the "totals:" of every part
+    int has_summary;
+    int has_part_totals;
+    char *command;
+    cost_table_t functions;     // width 2 * num_events: self costs, then costs of calls made
+    cost_table_t lines;         // width NUM_METRICS: source lines keep only the reported sums
+    metric_t metrics[NUM_METRICS]; // Ir (or the first event), D1 misses, LL misses, branch mispredicts
+} grind_t;
+
+static int table_init(cost_table_t *table, size_t width) {
+    memset(table, 0, sizeof(*table));
+    table->width = width;
+    table->slot_bits = INITIAL_TABLE_BITS;
+    table->slots = calloc((size_t)1 << table->slot_bits, sizeof(uint32_t));
+    return table->slots != NULL ? 0 : -1;
+}
+
+static void table_free(cost_table_t *table) {
+    free(table->keys);
+    free(table->costs);
+    free(table->slots);
+}
+
+static size_t table_hash(uint64_t key, unsigned bits) {
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits)); // Fibonacci hashing
+}
+
+static int table_grow_slots(cost_table_t *table) {
+    unsigned bits = table->slot_bits + 1;
+    size_t mask = ((size_t)1 << bits) - 1;
+    uint32_t *slots = calloc(mask + 1, sizeof(uint32_t));
+    if (slots == NULL) {
+        return -1;
+    }
+    for (size_t row = 0; row < table->count; row++) {
+        size_t i = table_hash(table->keys[row], bits);
+        while (slots[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = (uint32_t)row + 1;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_bits = bits;
+    return 0;
+}
+
+// Returns the row of a key, adding a zeroed row if it is new; (size_t)-1 on allocation failure
+static size_t table_row(cost_table_t *table, uint64_t key) {
+    size_t mask = ((size_t)1 << table->slot_bits) - 1;
+    size_t i = table_hash(key, table->slot_bits);
+    while (table->slots[i] != 0) {
+        size_t row = table->slots[i] - 1;
+        if (table->keys[row] == key) {
+            return row;
+        }
+        i = (i + 1) & mask;
+    }
+
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 1024;
+        uint64_t *keys = realloc(table->keys, capacity * sizeof(uint64_t));
+        if (keys == NULL) {
+            return (size_t)-1;
+        }
+        table->keys = keys;
+        uint64_t *costs = realloc(table->costs, capacity * table->width * sizeof(uint64_t));
+        if (costs == NULL) {
+            return (size_t)-1;
+        }
+        table->costs = costs;
+        table->capacity = capacity;
+    }
+    size_t row = table->count++;
+    table->keys[row] = key;
+    memset(&table->costs[row * table->width], 0, table->width * sizeof(uint64_t));
+    table->slots[i] = (uint32_t)row + 1;
+    if (table->count * 4 > (mask + 1) * 3 && table_grow_slots(table) == -1) {
+        return (size_t)-1;
+    }
+    return row;
+}
+
+static const char *skip_spaces(const char *p) {
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+static uint64_t parse_number(const char **pp) {
+    const char *p = *pp;
+    uint64_t value = 0;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        for (p += 2; isxdigit((unsigned char)*p); p++) {
+            value = value * 16 + (uint64_t)(isdigit((unsigned char)*p) ? *p - '0' : (tolower((unsigned char)*p) - 'a' + 10));
+        }
+    } else {
+        for (; isdigit((unsigned char)*p); p++) {
+            value = value * 10 + (uint64_t)(*p - '0');
+        }
+    }
+    *pp = p;
+    return value;
+}
+
+// "(12) name" defines id 12, "(12)" refers to it, "name" is uncompressed
+static uint32_t resolve_name(grind_t *grind, name_space_t space, const char *p, const char *end) {
+    size_t id = 0;
+    int compressed = *p == '(';
+    if (compressed) {
+        p++;
+        id = (size_t)parse_number(&p);
+        if (*p == ')') {
+            p++;
+        }
+        p = skip_spaces(p);
+        if (p == end) {
+            return id < grind->compressed_capacity[space] ? grind->compressed[space][id] : NO_NAME;
+        }
+    }
+    long name = rune_intern_id(&grind->names, p, (size_t)(end - p));
+    if (name == -1) {
+        return NO_NAME;
+    }
+    if (compressed) {
+        if (id >= grind->compressed_capacity[space]) {
+            size_t capacity = grind->compressed_capacity[space] ? grind->compressed_capacity[space] : 256;
+            while (capacity <= id) {
+                capacity *= 2;
+            }
+            uint32_t *grown = realloc(grind->compressed[space], capacity * sizeof(uint32_t));
+            if (grown == NULL) {
+                return NO_NAME;
+            }
+            for (size_t i = grind->compressed_capacity[space]; i < capacity; i++) {
+                grown[i] = NO_NAME;
+            }
+            grind->compressed[space] = grown;
+            grind->compressed_capacity[space] = capacity;
+        }
+        grind->compressed[space][id] = (uint32_t)name;
+    }
+    return (uint32_t)name;
+}
+
+static void parse_events(grind_t *grind, const char *p, const char *end) {
+    for (size_t i = 0; i < grind->num_events; i++) {
+        free(grind->event_names[i]);
+    }
+    grind->num_events = 0;
+    while (p < end && grind->num_events < MAX_EVENTS) {
+        p = skip_spaces(p);
+        const char *start = p;
+        while (p < end && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        char *name = p > start ? strndup(start, (size_t)(p - start)) : NULL;
+        if (name != NULL) {
+            grind->event_names[grind->num_events++] = name;
+        }
+    }
+}
+
+static void parse_positions(grind_t *grind, const char *p, const char *end) {
+    grind->num_positions = 0;
+    grind->line_position = -1;
+    while (p < end && grind->num_positions < MAX_POSITIONS) {
+        p = skip_spaces(p);
+        const char *start = p;
+        while (p < end && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        if (p - start == 4 && memcmp(start, "line", 4) == 0) {
+            grind->line_position = (int)grind->num_positions;
+        }
+        if (p > start) {
+            grind->num_positions++;
+        }
+    }
+}
+
+static void parse_costs(const char *p, uint64_t *costs, size_t num_events) {
+    for (size_t i = 0; i < num_events; i++) {
+        p = skip_spaces(p);
+        costs[i] = isdigit((unsigned char)*p) ? parse_number(&p) : 0;
+    }
+}
+
+static int find_event(const grind_t *grind, const char *name) {
+    for (size_t e = 0; e < grind->num_events; e++) {
+        if (strcmp(grind->event_names[e], name) == 0) {
+            return (int)e;
+        }
+    }
+    return -1;
+}
+
+// Builds a metric from the events of a profile that exist
+static metric_t make_metric(const grind_t *grind, const char *title, const char *a, const char *b, const char *c) {
+    metric_t metric = { title, { -1, -1, -1 }, 0 };
+    const char *names[3] = { a, b, c };
+    for (int i = 0; i < 3; i++) {
+        int e = names[i] != NULL ? find_event(grind, names[i]) : -1;
+        if (e >= 0) {
+            metric.events[metric.num_events++] = e;
+        }
+    }
+    return metric;
+}
+
+static uint64_t metric_value(const metric_t *metric, const uint64_t *costs) {
+    uint64_t value = 0;
+    for (int i = 0; i < metric->num_events; i++) {
+        value += costs[metric->events[i]];
+    }
+    return value;
+}
+
+static int cost_line(grind_t *grind, const char *p) {
+    // Positions: absolute, "+N"/"-N" relative to the previous line, "*" unchanged
+    for (size_t k = 0; k < grind->num_positions; k++) {
+        p = skip_spaces(p);
+        if (*p == '*') {
+            p++;
+        } else if (*p == '+' || *p == '-') {
+            int negative = *p++ == '-';
+            uint64_t delta = parse_number(&p);
+            grind->last[k] = negative ? grind->last[k] - delta : grind->last[k] + delta;
+        } else {
+            grind->last[k] = parse_number(&p);
+        }
+    }
+    uint64_t costs[MAX_EVENTS];
+    parse_costs(p, costs, grind->num_events);
+
+    if (!grind->function_valid) {
+        uint64_t key = ((uint64_t)grind->function << 32) | grind->file;
+        grind->function_row = table_row(&grind->functions, key);
+        if (grind->function_row == (size_t)-1) {
+            return -1;
+        }
+        grind->function_valid = 1;
+    }
+    uint64_t *function = &grind->functions.costs[grind->function_row * grind->functions.width];
+    if (grind->pending_call) {
+        // The inclusive cost of a call counts towards the caller's inclusive cost only
+        grind->pending_call = 0;
+        for (size_t e = 0; e < grind->num_events; e++) {
+            function[grind->num_events + e] += costs[e];
+        }
+        return 0;
+    }
+    for (size_t e = 0; e < grind->num_events; e++) {
+        function[e] += costs[e];
+        grind->totals[e] += costs[e];
+    }
+    if (grind->line_position >= 0) {
+        uint32_t source = grind->source != NO_NAME ? grind->source : grind->file;
+        uint64_t key = ((uint64_t)source << 32) | (uint32_t)grind->last[grind->line_position];
+        size_t row = table_row(&grind->lines, key);
+        if (row == (size_t)-1) {
+            return -1;
+        }
+        uint64_t *line = &grind->lines.costs[row * grind->lines.width];
+        for (int m = 0; m < NUM_METRICS; m++) {
+            line[m] += metric_value(&grind->metrics[m], costs);
+        }
+    }
+    return 0;
+}
+
+static int starts_with(const char *line, const char *prefix) {
+    return strncmp(line, prefix, strlen(prefix)) == 0;
+}
+
+static int parse_line(grind_t *grind, const char *line, const char *end) {
+    char c = line[0];
+    if (isdigit((unsigned char)c) || c == '+' || c == '-' || c == '*') {
+        if (grind->functions.slots == NULL) {
+            // First cost line: the events are known now
+            if (grind->num_events == 0) {
+                return 0;
+            }
+            grind->metrics[0] = make_metric(grind, "Ir", "Ir", NULL, NULL);
+            grind->metrics[1] = make_metric(grind, "D1 miss", "D1mr", "D1mw", NULL);
+            grind->metrics[2] = make_metric(grind, "LL miss", "ILmr", "DLmr", "DLmw");
+            grind->metrics[3] = make_metric(grind, "Br miss", "Bcm", "Bim", NULL);
+            if (grind->metrics[0].num_events == 0) {
+                metric_t first = { grind->event_names[0], { 0, -1, -1 }, 1 };
+                grind->metrics[0] = first;
+            }
+            if (table_init(&grind->functions, 2 * grind->num_events) == -1 ||
+                table_init(&grind->lines, NUM_METRICS) == -1) {
+                return -1;
+            }
+        }
+        return cost_line(grind, line);
+    }
+
+    const char *eq = memchr(line, '=', (size_t)(end - line));
+    if (eq != NULL && eq - line <= 5) { // Keys are at most "calls" long
+        const char *value = eq + 1;
+        size_t key_len = (size_t)(eq - line);
+        if (key_len == 2 && memcmp(line, "fl", 2) == 0) {
+            grind->file = resolve_name(grind, SPACE_FILE, value, end);
+            grind->source = NO_NAME;
+            grind->function_valid = 0;
+        } else if (key_len == 2 && (memcmp(line, "fi", 2) == 0 || memcmp(line, "fe", 2) == 0)) {
+            grind->source = resolve_name(grind, SPACE_FILE, value, end);
+        } else if (key_len == 2 && memcmp(line, "fn", 2) == 0) {
+            grind->function = resolve_name(grind, SPACE_FN, value, end);
+            grind->source = NO_NAME;
+            grind->function_valid = 0;
+        } else if (key_len == 3 && memcmp(line, "cfn", 3) == 0) {
+            resolve_name(grind, SPACE_FN, value, end);
+        } else if (key_len == 3 && (memcmp(line, "cfi", 3) == 0 || memcmp(line, "cfl", 3) == 0)) {
+            resolve_name(grind, SPACE_FILE, value, end);
+        } else if ((key_len == 2 && memcmp(line, "ob", 2) == 0) || (key_len == 3 && memcmp(line, "cob", 3) == 0)) {
+            resolve_name(grind, SPACE_OBJ, value, end);
+        } else if (key_len == 5 && memcmp(line, "calls", 5) == 0) {
+            grind->pending_call = 1;
+            grind->has_calls = 1;
+        }
+        // jump= and jcnd= carry no costs we report
+        return 0;
+    }
+
+    if (starts_with(line, "events:")) {
+        if (grind->functions.slots != NULL) {
+            return 0; // A later part repeats the header
+        }
+        parse_events(grind, line + 7, end);
+    } else if (starts_with(line, "positions:")) {
+        parse_positions(grind, line + 10, end);
+    } else if (starts_with(line, "summary:")) {
+        parse_costs(line + 8, grind->summary, grind->num_events);
+        grind->has_summary = 1;
+    } else if (starts_with(line, "totals:")) {
+        uint64_t costs[MAX_EVENTS];
+        parse_costs(line + 7, costs, grind->num_events);
+        for (size_t e = 0; e < grind->num_events; e++) {
+            grind->part_totals[e] += costs[e];
+        }
+        grind->has_part_totals = 1;
+    } else if (starts_with(line, "cmd:") && grind->command == NULL) {
+        const char *p = skip_spaces(line + 4);
+        grind->command = strndup(p, (size_t)(end - p));
+    }
+    return 0;
+}
+
+typedef struct {
+    uint64_t value;
+    size_t row;
+} ranked_t;
+
+static int compare_ranked(const void *a, const void *b) {
+    const ranked_t *x = a;
+    const ranked_t *y = b;
+    if (x->value != y->value) {
+        return x->value < y->value ? 1 : -1;
+    }
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+// Rows sorted by a metric, largest first; rows where it is zero are left out
+static ranked_t *rank_rows(const cost_table_t *table, const metric_t *metric, size_t *count) {
+    ranked_t *ranked = malloc((table->count ? table->count : 1) * sizeof(ranked_t));
+    if (ranked == NULL) {
+        return NULL;
+    }
+    size_t n = 0;
+    for (size_t row = 0; row < table->count; row++) {
+        uint64_t value = metric_value(metric, &table->costs[row * table->width]);
+        if (value > 0) {
+            ranked[n].value = value;
+            ranked[n].row = row;
+            n++;
+        }
+    }
+    qsort(ranked, n, sizeof(ranked_t), compare_ranked);
+    *count = n;
+    return ranked;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole > 0 ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+static void print_function_name(const grind_t *grind, uint64_t key, FILE *out) {
+    const char *function = rune_intern_string(&grind->names, (uint32_t)(key >> 32));
+    const char *file = rune_intern_string(&grind->names, (uint32_t)key);
+    fprintf(out, "%s", function != NULL ? function : "???");
+    if (file != NULL && strcmp(file, "???") != 0) {
+        fprintf(out, " (%s)", file);
+    }
+}
+
+static void print_line_name(const grind_t *grind, uint64_t key, FILE *out) {
+    const char *file = rune_intern_string(&grind->names, (uint32_t)(key >> 32));
+    fprintf(out, "%s:%u", file != NULL ? file : "???", (unsigned)(uint32_t)key);
+}
+
+static int print_report(const grind_t *grind, FILE *out, size_t top_n) {
+    const metric_t *metrics = grind->metrics;
+    metric_t data_refs = make_metric(grind, "data refs", "Dr", "Dw", NULL);
+    metric_t branches = make_metric(grind, "branches", "Bc", "Bi", NULL);
+    const uint64_t *totals = grind->has_summary ? grind->summary
+                             : grind->has_part_totals ? grind->part_totals : grind->totals;
+
+    fprintf(out, "\n--- %s profile%s%s ---\n", grind->has_calls ? "Callgrind" : "Cachegrind",
+            grind->command != NULL ? ": " : "", grind->command != NULL ? grind->command : "");
+    fprintf(out, "Events:");
+    for (size_t e = 0; e < grind->num_events; e++) {
+        fprintf(out, " %s", grind->event_names[e]);
+    }
+    fprintf(out, "\nTotals:");
+    for (int m = 0; m < NUM_METRICS; m++) {
+        if (metrics[m].num_events == 0) {
+            continue;
+        }
+        uint64_t value = metric_value(&metrics[m], totals);
+        fprintf(out, "%s %llu %s", m > 0 ? "," : "", (unsigned long long)value, metrics[m].title);
+        if (m == 1 && data_refs.num_events > 0) {
+            fprintf(out, " (%.2f%% of data refs)", percent(value, metric_value(&data_refs, totals)));
+        } else if (m == 2 && find_event(grind, "Ir") >= 0 && data_refs.num_events > 0) {
+            fprintf(out, " (%.2f%% of refs)", percent(value, metric_value(&metrics[0], totals) +
+                                                             metric_value(&data_refs, totals)));
+        } else if (m == 3 && branches.num_events > 0) {
+            fprintf(out, " (%.2f%% of branches)", percent(value, metric_value(&branches, totals)));
+        }
+    }
+    fprintf(out, "\n");
+    if (metrics[1].num_events == 0 && metrics[3].num_events == 0) {
+        fprintf(out, "(No cache or branch events: run valgrind with --cache-sim=yes --branch-sim=yes for them.)\n");
+    }
+
+    // Functions by Ir, or by the first event when there is no Ir
+    const metric_t *primary = &metrics[0];
+    uint64_t primary_total = metric_value(primary, totals);
+    size_t count;
+    ranked_t *ranked = rank_rows(&grind->functions, primary, &count);
+    if (ranked == NULL) {
+        perror("runescope: malloc failed for profile report");
+        return -1;
+    }
+    fprintf(out, "\nTop %zu functions by %s (of %zu):\n", count < top_n ? count : top_n, primary->title,
+            grind->functions.count);
+    fprintf(out, "%16s %7s", primary->title, "self%");
+    if (grind->has_calls) {
+        fprintf(out, " %16s %7s", "inclusive", "incl%");
+    }
+    for (int m = 1; m < NUM_METRICS; m++) {
+        if (metrics[m].num_events > 0) {
+            fprintf(out, " %12s", metrics[m].title);
+        }
+    }
+    fprintf(out, "  function\n");
+    for (size_t i = 0; i < count && i < top_n; i++) {
+        const uint64_t *costs = &grind->functions.costs[ranked[i].row * grind->functions.width];
+        fprintf(out, "%16llu %6.2f%%", (unsigned long long)ranked[i].value, percent(ranked[i].value, primary_total));
+        if (grind->has_calls) {
+            uint64_t inclusive = ranked[i].value + metric_value(primary, costs + grind->num_events);
+            fprintf(out, " %16llu %6.2f%%", (unsigned long long)inclusive, percent(inclusive, primary_total));
+        }
+        for (int m = 1; m < NUM_METRICS; m++) {
+            if (metrics[m].num_events > 0) {
+                fprintf(out, " %12llu", (unsigned long long)metric_value(&metrics[m], costs));
+            }
+        }
+        fprintf(out, "  ");
+        print_function_name(grind, grind->functions.keys[ranked[i].row], out);
+        fprintf(out, "\n");
+    }
+    free(ranked);
+
+    // The worst functions and lines for each kind of miss
+    for (int m = 1; m < NUM_METRICS; m++) {
+        uint64_t total = metric_value(&metrics[m], totals);
+        if (metrics[m].num_events == 0 || total == 0) {
+            continue;
+        }
+        for (int lines = 0; lines < 2; lines++) {
+            const cost_table_t *table = lines ? &grind->lines : &grind->functions;
+            metric_t column = { metrics[m].title, { m, -1, -1 }, 1 }; // Lines store the sums
+            ranked = rank_rows(table, lines ? &column : &metrics[m], &count);
+            if (ranked == NULL) {
+                perror("runescope: malloc failed for profile report");
+                return -1;
+            }
+            fprintf(out, "\nTop %s by %s:\n", lines ? "source lines" : "functions", metrics[m].title);
+            for (size_t i = 0; i < count && i < TOP_MISSES; i++) {
+                fprintf(out, "%16llu %6.2f%%  ", (unsigned long long)ranked[i].value, percent(ranked[i].value, total));
+                if (lines) {
+                    print_line_name(grind, table->keys[ranked[i].row], out);
+                } else {
+                    print_function_name(grind, table->keys[ranked[i].row], out);
+                }
+                fprintf(out, "\n");
+            }
+            free(ranked);
+        }
+    }
+
+    metric_t primary_column = { primary->title, { 0, -1, -1 }, 1 };
+    ranked = rank_rows(&grind->lines, &primary_column, &count);
+    if (ranked == NULL) {
+        perror("runescope: malloc failed for profile report");
+        return -1;
+    }
+    fprintf(out, "\nTop %zu source lines by %s (of %zu):\n", count < top_n ? count : top_n, primary->title,
+            grind->lines.count);
+    for (size_t i = 0; i < count && i < top_n; i++) {
+        const uint64_t *costs = &grind->lines.costs[ranked[i].row * grind->lines.width];
+        fprintf(out, "%16llu %6.2f%%", (unsigned long long)ranked[i].value, percent(ranked[i].value, primary_total));
+        for (int m = 1; m < NUM_METRICS; m++) {
+            if (metrics[m].num_events > 0) {
+                fprintf(out, " %12llu", (unsigned long long)costs[m]);
+            }
+        }
+        fprintf(out, "  ");
+        print_line_name(grind, grind->lines.keys[ranked[i].row], out);
+        fprintf(out, "\n");
+    }
+    free(ranked);
+    return 0;
+}
+
+static void grind_free(grind_t *grind) {
+    for (size_t i = 0; i < grind->num_events; i++) {
+        free(grind->event_names[i]);
+    }
+    for (int s = 0; s < NUM_SPACES; s++) {
+        free(grind->compressed[s]);
+    }
+    rune_intern_free(&grind->names);
+    table_free(&grind->functions);
+    table_free(&grind->lines);
+    free(grind->command);
+}
+
+int rune_grind_report(const char *profile_path, FILE *out, size_t top_n) {
+    FILE *f = fopen(profile_path, "r");
+    if (f == NULL) {
+        perror("runescope: fopen failed for valgrind profile");
+        return -1;
+    }
+    setvbuf(f, NULL, _IOFBF, READ_BUFFER);
+
+    grind_t grind;
+    memset(&grind, 0, sizeof(grind));
+    grind.num_positions = 1;
+    grind.line_position = 0; // "positions: line" is the default
+    grind.file = NO_NAME;
+    grind.source = NO_NAME;
+    grind.function = NO_NAME;
+    if (rune_intern_init(&grind.names) == -1) {
+        fclose(f);
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    int result = 0;
+    while (result == 0 && (len = getline(&line, &capacity, f)) != -1) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len == 0 || line[0] == '#') {
+            continue;
+        }
+        result = parse_line(&grind, line, line + len);
+        if (result == -1) {
+            perror("runescope: malloc failed for valgrind profile");
+        }
+    }
+    free(line);
+    fclose(f);
+
+    if (result == 0 && (grind.num_events == 0 || grind.functions.slots == NULL)) {
+        fprintf(stderr, "runescope: Error: %s has no events or costs; is it a cachegrind/callgrind output file?\n",
+                profile_path);
+        result = -1;
+    }
+    if (result == 0) {
+        flockfile(out);
+        result = print_report(&grind, out, top_n);
+        funlockfile(out);
+    }
+    grind_free(&grind);
+    return result;
+}
@@ -0,0 +1,34 @@
+#ifndef RUNE_GRIND_H
+#define RUNE_GRIND_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @brief Hot-spot report from cachegrind and callgrind profiles.
+ *
+ * Both tools write the same line-oriented format: an "events:" header
+ * naming the cost columns, then fl=/fn= lines selecting a file and function
+ * and cost lines "<position> <costs...>". Callgrind adds name and position
+ * compression ("fn=(12)", "+3") and calls= lines whose following cost line
+ * is the inclusive cost of a call. The file is read one line at a time, so
+ * memory is proportional to the distinct functions and source lines, not
+ * to the size of the profile.
+ */
+
+/**
+ * @brief Parses a cachegrind.out or callgrind.out file and prints its hot spots.
+ *
+ * Prints the totals, the top functions by instructions (Ir) with their D1
+ * and last-level cache misses and branch mispredicts, inclusive costs when
+ * the profile has a call graph, the top functions by each kind of miss, and
+ * the top source lines. Columns whose events were not collected are left out.
+ *
+ * @param profile_path The profile file.
+ * @param out The stream to print to.
+ * @param top_n The number of functions and lines to list by instructions.
+ * @return 0 on success, -1 if the file cannot be read or on allocation failure.
+ */
+int rune_grind_report(const char *profile_path, FILE *out, size_t top_n);
+
+#endif // RUNE_GRIND_H
@@ -0,0 +1,100 @@
+#include "rune_histogram.h"
+#include <string.h>
+
+#define SUB_BUCKETS (1 << RUNE_HISTOGRAM_SUB_BITS)
+
+void rune_histogram_init(rune_histogram_t *histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->min = INT64_MAX;
+}
+
+static int bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+    if (value >> RUNE_HISTOGRAM_MAX_EXPONENT) {
+        return RUNE_HISTOGRAM_BUCKETS - 1;
+    }
+    int exponent = 63 - __builtin_clzll(value); // Position of the leading bit, >= SUB_BITS
+    int sub = (int)(value >> (exponent - RUNE_HISTOGRAM_SUB_BITS)) & (SUB_BUCKETS - 1);
+    return ((exponent - RUNE_HISTOGRAM_SUB_BITS + 1) << RUNE_HISTOGRAM_SUB_BITS) + sub;
+}
+
+// Largest value that lands in a bucket
+static int64_t bucket_upper_bound(int index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int exponent = (index >> RUNE_HISTOGRAM_SUB_BITS) + RUNE_HISTOGRAM_SUB_BITS - 1;
+    int sub = index & (SUB_BUCKETS - 1);
+    int shift = exponent - RUNE_HISTOGRAM_SUB_BITS;
+    return ((int64_t)(SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void rune_histogram_record(rune_histogram_t *histogram, int64_t value) {
+    if (value < 0) {
+        value = 0;
+    }
+    histogram->buckets[bucket_index((uint64_t)value)]++;
+    histogram->count++;
+    histogram->total += value;
+    if (value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+void rune_histogram_merge(rune_histogram_t *dest, const rune_histogram_t *src) {
+    for (int i = 0; i < RUNE_HISTOGRAM_BUCKETS; i++) {
+        dest->buckets[i] += src->buckets[i];
+    }
+    dest->count += src->count;
+    dest->total += src->total;
+    if (src->min < dest->min) {
+        dest->min = src->min;
+    }
+    if (src->max > dest->max) {
+        dest->max = src->max;
+    }
+}
+
+int64_t rune_histogram_percentile(const rune_histogram_t *histogram, double percentile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    // Rank of the value, 1-based: p50 of 4 values is the 2nd
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > histogram->count) {
+        rank = histogram->count;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < RUNE_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            int64_t bound = bucket_upper_bound(i);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+double rune_histogram_trimmed_mean(const rune_histogram_t *histogram, double percentile) {
+    uint64_t keep = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (keep < 1) {
+        keep = histogram->count < 1 ? 0 : 1;
+    }
+    double sum = 0.0;
+    uint64_t taken = 0;
+    for (int i = 0; i < RUNE_HISTOGRAM_BUCKETS && taken < keep; i++) {
+        uint64_t n = histogram->buckets[i] < keep - taken ? histogram->buckets[i] : keep - taken;
+        int64_t lower = i > 0 ? bucket_upper_bound(i - 1) + 1 : 0;
+        sum += (double)n * ((double)lower + (double)bucket_upper_bound(i)) / 2.0;
+        taken += n;
+    }
+    return taken > 0 ? sum / (double)taken : 0.0;
+}
@@ -0,0 +1,68 @@
+#ifndef RUNE_HISTOGRAM_H
+#define RUNE_HISTOGRAM_H
+
+#include <stdint.h>
+
+/**
+ * @brief Log-bucketed latency histogram in the style of HdrHistogram.
+ *
+ * Values below 16 ns get a bucket each. Above that, every power of two is
+ * split into 16 linear sub-buckets, so any recorded value is known to within
+ * 1/16 (6.25%). That holds from nanoseconds up to days in a fixed 6 KB per
+ * histogram, with no allocation on the recording path.
+ */
+
+#define RUNE_HISTOGRAM_SUB_BITS 4
+#define RUNE_HISTOGRAM_MAX_EXPONENT 48 // Values are clamped below 2^48 ns (about 78 hours)
+#define RUNE_HISTOGRAM_BUCKETS ((RUNE_HISTOGRAM_MAX_EXPONENT - RUNE_HISTOGRAM_SUB_BITS + 1) << RUNE_HISTOGRAM_SUB_BITS)
+
+typedef struct {
+    uint64_t buckets[RUNE_HISTOGRAM_BUCKETS];
+    uint64_t count;
+    int64_t total;         // Sum of all recorded values
+    int64_t min;
+    int64_t max;
+} rune_histogram_t;
+
+/**
+ * @brief Initializes an empty histogram.
+ */
+void rune_histogram_init(rune_histogram_t *histogram);
+
+/**
+ * @brief Records one value.
+ *
+ * @param histogram The histogram.
+ * @param value The value, in nanoseconds; negative values are recorded as 0.
+ */
+void rune_histogram_record(rune_histogram_t *histogram, int64_t value);
+
+/**
+ * @brief Adds all values of one histogram to another.
+ */
+void rune_histogram_merge(rune_histogram_t *dest, const rune_histogram_t *src);
+
+/**
+ * @brief Returns the value below which a given share of the recorded values fall.
+ *
+ * @param histogram The histogram.
+ * @param percentile The share, from 0 to 100 (e.g. 99 for p99).
+ * @return The upper bound of the bucket holding that value (never above the
+ *         maximum recorded), or 0 if the histogram is empty.
+ */
+int64_t rune_histogram_percentile(const rune_histogram_t *histogram, double percentile);
+
+/**
+ * @brief Returns the mean of the values up to a given percentile.
+ *
+ * Leaves out the slowest values, such as a short call that was preempted in
+ * the middle, which can pull the plain mean far above the typical value.
+ * Values are taken at the middle of their bucket.
+ *
+ * @param histogram The histogram.
+ * @param percentile The share of the values to keep, from 0 to 100.
+ * @return The mean, or 0 if the histogram is empty.
+ */
+double rune_histogram_trimmed_mean(const rune_histogram_t *histogram, double percentile);
+
+#endif // RUNE_HISTOGRAM_H
@@ -0,0 +1,101 @@
+#include "rune_intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_INTERN_CAPACITY 64
+
+// FNV-1a over the string bytes
+static size_t hash_string(const char *str, size_t len) {
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+    }
+    return hash;
+}
+
+int rune_intern_init(rune_intern_t *intern) {
+    memset(intern, 0, sizeof(*intern));
+    intern->slots = calloc(INITIAL_INTERN_CAPACITY, sizeof(uint32_t));
+    intern->strings = malloc(INITIAL_INTERN_CAPACITY * sizeof(char *));
+    if (intern->slots == NULL || intern->strings == NULL) {
+        perror("runescope: malloc failed for intern table");
+        free(intern->slots);
+        free(intern->strings);
+        return -1;
+    }
+    intern->slots_capacity = INITIAL_INTERN_CAPACITY;
+    intern->strings_capacity = INITIAL_INTERN_CAPACITY;
+    return 0;
+}
+
+static int intern_grow(rune_intern_t *intern) {
+    size_t capacity = intern->slots_capacity * 2;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    if (slots == NULL) {
+        perror("runescope: calloc failed for intern table");
+        return -1;
+    }
+    for (size_t id = 0; id < intern->count; id++) {
+        size_t j = hash_string(intern->strings[id], strlen(intern->strings[id])) & (capacity - 1);
+        while (slots[j] != 0) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = (uint32_t)id + 1;
+    }
+    free(intern->slots);
+    intern->slots = slots;
+    intern->slots_capacity = capacity;
+    return 0;
+}
+
+long rune_intern_id(rune_intern_t *intern, const char *str, size_t len) {
+    size_t i = hash_string(str, len) & (intern->slots_capacity - 1);
+    while (intern->slots[i] != 0) {
+        const char *candidate = intern->strings[intern->slots[i] - 1];
+        if (strncmp(candidate, str, len) == 0 && candidate[len] == '\0') {
+            return (long)intern->slots[i] - 1;
+        }
+        i = (i + 1) & (intern->slots_capacity - 1);
+    }
+
+    if ((intern->count + 1) * 2 > intern->slots_capacity) {
+        if (intern_grow(intern) == -1) {
+            return -1;
+        }
+        return rune_intern_id(intern, str, len); // Slot moved
+    }
+    if (intern->count == intern->strings_capacity) {
+        char **strings = realloc(intern->strings, intern->strings_capacity * 2 * sizeof(char *));
+        if (strings == NULL) {
+            perror("runescope: realloc failed for intern table");
+            return -1;
+        }
+        intern->strings = strings;
+        intern->strings_capacity *= 2;
+    }
+    char *copy = malloc(len + 1);
+    if (copy == NULL) {
+        perror("runescope: malloc failed for interned string");
+        return -1;
+    }
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    intern->strings[intern->count] = copy;
+    intern->slots[i] = (uint32_t)intern->count + 1;
+    return (long)intern->count++;
+}
+
+const char *rune_intern_string(const rune_intern_t *intern, uint32_t id) {
+    return id < intern->count ? intern->strings[id] : NULL;
+}
+
+void rune_intern_free(rune_intern_t *intern) {
+    for (size_t id = 0; id < intern->count; id++) {
+        free(intern->strings[id]);
+    }
+    free(intern->strings);
+    free(intern->slots);
+    memset(intern, 0, sizeof(*intern));
+}
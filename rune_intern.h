@@ -0,0 +1,51 @@
+#ifndef RUNE_INTERN_H
+#define RUNE_INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Maps strings to small, dense integer IDs.
+ *
+ * Syscall and function names repeat millions of times in a trace but only a
+ * few hundred are distinct, so events store the ID and the text lives here
+ * once. IDs are assigned in order of first appearance, starting at 0.
+ */
+typedef struct {
+    char **strings;          // ID -> owned, NUL-terminated copy
+    size_t count;
+    size_t strings_capacity;
+    uint32_t *slots;         // Open-addressing table of ID + 1, 0 = empty
+    size_t slots_capacity;   // Always a power of two
+} rune_intern_t;
+
+/**
+ * @brief Initializes an empty intern table.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_intern_init(rune_intern_t *intern);
+
+/**
+ * @brief Returns the ID of a string, adding it if it is new.
+ *
+ * @param intern The intern table.
+ * @param str The string (not necessarily NUL-terminated).
+ * @param len The length of str.
+ * @return The ID, or -1 on allocation failure.
+ */
+long rune_intern_id(rune_intern_t *intern, const char *str, size_t len);
+
+/**
+ * @brief Returns the string of an ID.
+ *
+ * @return The NUL-terminated string, or NULL if the ID was never assigned.
+ */
+const char *rune_intern_string(const rune_intern_t *intern, uint32_t id);
+
+/**
+ * @brief Releases all memory held by an intern table.
+ */
+void rune_intern_free(rune_intern_t *intern);
+
+#endif // RUNE_INTERN_H
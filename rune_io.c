@@ -0,0 +1,738 @@
+#define _POSIX_C_SOURCE 200809L // For flockfile
+#include "rune_io.h"
+#include "rune_scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ARGS 6
+#define MAX_FD (1 << 20)        // Larger descriptor numbers are treated as unknown
+#define SMALL_IO_BYTES 64       // Transfers below this size count as tiny
+#define SMALL_IO_MIN_CALLS 100  // Flag tiny I/O on a target with at least this many calls...
+#define SMALL_IO_SHARE 2        // ...of which at least 1/SMALL_IO_SHARE are tiny
+#define SEEK_IO_MIN 10          // Flag at least this many lseek + read/write pairs on a target
+#define REOPEN_MIN 100          // Flag paths opened at least this many times
+#define SPIN_MIN_POLLS 100      // Flag threads with at least this many empty zero-timeout polls
+#define MAX_PATTERNS 10         // Findings listed per pattern
+#define CLONE_FILES_FLAG 0x400  // CLONE_FILES, for the native tracer's numeric flags
+
+// What a syscall does to the descriptor table or with a descriptor
+typedef enum {
+    IO_NONE,
+    IO_OPEN,       // arg: index of the path argument
+    IO_SOCKET,
+    IO_ACCEPT,
+    IO_DUP,
+    IO_DUP2,       // dup2, dup3: the new descriptor is the second argument
+    IO_FCNTL,      // Only F_DUPFD and F_DUPFD_CLOEXEC create a descriptor
+    IO_PIPE,
+    IO_SOCKETPAIR,
+    IO_NAMED_FD,   // eventfd, epoll_create, memfd_create, ...: labelled by the syscall name
+    IO_CLOSE,
+    IO_READ,       // arg: index of the requested size argument, or -1 to use the return value
+    IO_WRITE,
+    IO_PREAD,
+    IO_PWRITE,
+    IO_SENDFILE,
+    IO_LSEEK,
+    IO_POLL,       // arg: index of the timeout argument
+    IO_CLONE
+} io_role_t;
+
+static const struct {
+    const char *name;
+    io_role_t role;
+    int arg;
+} io_syscalls[] = {
+    { "open", IO_OPEN, 0 },
+    { "creat", IO_OPEN, 0 },
+    { "openat", IO_OPEN, 1 },
+    { "openat2", IO_OPEN, 1 },
+    { "socket", IO_SOCKET, 0 },
+    { "accept", IO_ACCEPT, 0 },
+    { "accept4", IO_ACCEPT, 0 },
+    { "dup", IO_DUP, 0 },
+    { "dup2", IO_DUP2, 0 },
+    { "dup3", IO_DUP2, 0 },
+    { "fcntl", IO_FCNTL, 0 },
+    { "pipe", IO_PIPE, 0 },
+    { "pipe2", IO_PIPE, 0 },
+    { "socketpair", IO_SOCKETPAIR, 0 },
+    { "eventfd", IO_NAMED_FD, 0 },
+    { "eventfd2", IO_NAMED_FD, 0 },
+    { "epoll_create", IO_NAMED_FD, 0 },
+    { "epoll_create1", IO_NAMED_FD, 0 },
+    { "timerfd_create", IO_NAMED_FD, 0 },
+    { "signalfd", IO_NAMED_FD, 0 },
+    { "signalfd4", IO_NAMED_FD, 0 },
+    { "inotify_init", IO_NAMED_FD, 0 },
+    { "inotify_init1", IO_NAMED_FD, 0 },
+    { "memfd_create", IO_NAMED_FD, 0 },
+    { "pidfd_open", IO_NAMED_FD, 0 },
+    { "close", IO_CLOSE, 0 },
+    { "read", IO_READ, 2 },
+    { "recvfrom", IO_READ, 2 },
+    { "recv", IO_READ, 2 },
+    { "readv", IO_READ, -1 },
+    { "recvmsg", IO_READ, -1 },
+    { "write", IO_WRITE, 2 },
+    { "sendto", IO_WRITE, 2 },
+    { "send", IO_WRITE, 2 },
+    { "writev", IO_WRITE, -1 },
+    { "sendmsg", IO_WRITE, -1 },
+    { "pread64", IO_PREAD, 2 },
+    { "preadv", IO_PREAD, -1 },
+    { "preadv2", IO_PREAD, -1 },
+    { "pwrite64", IO_PWRITE, 2 },
+    { "pwritev", IO_PWRITE, -1 },
+    { "pwritev2", IO_PWRITE, -1 },
+    { "sendfile", IO_SENDFILE, -1 },
+    { "lseek", IO_LSEEK, 0 },
+    { "_llseek", IO_LSEEK, 0 },
+    { "poll", IO_POLL, 2 },
+    { "ppoll", IO_POLL, 2 },
+    { "select", IO_POLL, 4 },
+    { "pselect6", IO_POLL, 4 },
+    { "epoll_wait", IO_POLL, 3 },
+    { "epoll_pwait", IO_POLL, 3 },
+    { "epoll_pwait2", IO_POLL, 3 },
+    { "clone", IO_CLONE, 0 },
+    { "clone3", IO_CLONE, 0 },
+    { "fork", IO_CLONE, 0 },
+    { "vfork", IO_CLONE, 0 },
+};
+
+// Totals for one path, socket kind or other descriptor target
+typedef struct {
+    unsigned long opens;
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long small_reads;
+    unsigned long small_writes;
+    unsigned long seek_io;    // read/write right after an lseek on the same descriptor
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+} io_target_t;
+
+// The descriptor table of a process, shared by its threads
+typedef struct {
+    uint32_t *targets;   // Target ID + 1 per descriptor, 0 = not known
+    uint8_t *seeked;     // The last call on the descriptor was an lseek
+    size_t capacity;
+} fd_table_t;
+
+// Poll-family calls of one thread
+typedef struct {
+    unsigned long polls;
+    unsigned long empty;       // Returned with nothing ready
+    unsigned long empty_spin;  // ...and had a zero timeout
+} io_poller_t;
+
+typedef struct {
+    long pid;
+    uint32_t index;
+} pid_slot_t;
+
+typedef struct {
+    const rune_store_t *store;
+    rune_intern_t labels;       // Target ID -> label
+    io_target_t *targets;
+    size_t targets_capacity;
+    fd_table_t *tables;
+    size_t num_tables;
+    size_t tables_capacity;
+    uint32_t *table_of;         // Per pid index: index into tables + 1, 0 = none yet
+    pid_slot_t *pid_slots;      // Sorted by pid, to find a clone child's pid index
+    size_t num_pids;
+    io_poller_t *pollers;       // Per pid index
+    unsigned long created;      // Pipes, sockets and accepted connections so far; numbers their labels
+    int failed;
+} io_state_t;
+
+static long lookup_target(io_state_t *state, const char *label, size_t len) {
+    long id = rune_intern_id(&state->labels, label, len);
+    if (id < 0) {
+        state->failed = 1;
+        return -1;
+    }
+    if ((size_t)id >= state->targets_capacity) {
+        size_t capacity = state->targets_capacity * 2;
+        io_target_t *targets = realloc(state->targets, capacity * sizeof(io_target_t));
+        if (targets == NULL) {
+            perror("runescope: realloc failed for I/O targets");
+            state->failed = 1;
+            return -1;
+        }
+        memset(targets + state->targets_capacity, 0, (capacity - state->targets_capacity) * sizeof(io_target_t));
+        state->targets = targets;
+        state->targets_capacity = capacity;
+    }
+    return id;
+}
+
+// Adds an empty table, or a copy of table copy_index if it is not negative
+static long new_table(io_state_t *state, long copy_index) {
+    if (state->num_tables == state->tables_capacity) {
+        size_t capacity = state->tables_capacity ? state->tables_capacity * 2 : 16;
+        fd_table_t *tables = realloc(state->tables, capacity * sizeof(fd_table_t));
+        if (tables == NULL) {
+            perror("runescope: realloc failed for descriptor tables");
+            state->failed = 1;
+            return -1;
+        }
+        state->tables = tables;
+        state->tables_capacity = capacity;
+    }
+    fd_table_t *table = &state->tables[state->num_tables];
+    memset(table, 0, sizeof(*table));
+    const fd_table_t *copy_of = copy_index >= 0 ? &state->tables[copy_index] : NULL;
+    if (copy_of != NULL && copy_of->capacity > 0) {
+        table->targets = malloc(copy_of->capacity * sizeof(uint32_t));
+        table->seeked = malloc(copy_of->capacity);
+        if (table->targets == NULL || table->seeked == NULL) {
+            perror("runescope: malloc failed for descriptor table");
+            free(table->targets);
+            free(table->seeked);
+            state->failed = 1;
+            return -1;
+        }
+        memcpy(table->targets, copy_of->targets, copy_of->capacity * sizeof(uint32_t));
+        memcpy(table->seeked, copy_of->seeked, copy_of->capacity);
+        table->capacity = copy_of->capacity;
+    }
+    return (long)state->num_tables++;
+}
+
+// Returns the table of a pid index, giving a pid seen for the first time a table of its own
+static fd_table_t *table_for(io_state_t *state, uint32_t pid_index) {
+    if (state->table_of[pid_index] == 0) {
+        long t = new_table(state, -1);
+        if (t < 0) {
+            return NULL;
+        }
+        state->table_of[pid_index] = (uint32_t)t + 1;
+    }
+    return &state->tables[state->table_of[pid_index] - 1];
+}
+
+// Returns the slot of a descriptor, growing the table as needed; NULL for implausible descriptors
+static uint32_t *fd_slot(io_state_t *state, fd_table_t *table, long fd) {
+    if (fd < 0 || fd >= MAX_FD) {
+        return NULL;
+    }
+    if ((size_t)fd >= table->capacity) {
+        size_t capacity = table->capacity ? table->capacity : 64;
+        while (capacity <= (size_t)fd) {
+            capacity *= 2;
+        }
+        uint32_t *targets = realloc(table->targets, capacity * sizeof(uint32_t));
+        if (targets == NULL) {
+            perror("runescope: realloc failed for descriptor table");
+            state->failed = 1;
+            return NULL;
+        }
+        table->targets = targets;
+        uint8_t *seeked = realloc(table->seeked, capacity);
+        if (seeked == NULL) {
+            perror("runescope: realloc failed for descriptor table");
+            state->failed = 1;
+            return NULL;
+        }
+        table->seeked = seeked;
+        memset(table->targets + table->capacity, 0, (capacity - table->capacity) * sizeof(uint32_t));
+        memset(table->seeked + table->capacity, 0, capacity - table->capacity);
+        table->capacity = capacity;
+    }
+    return &table->targets[fd];
+}
+
+static int parse_fd(rune_strview_t arg, long *fd) {
+    return rune_scan_number(arg.ptr, arg.ptr + arg.len, fd) != NULL;
+}
+
+// Resolves a descriptor argument to a target ID; strace -y annotations ("3</etc/passwd>") win
+static long resolve_fd(io_state_t *state, fd_table_t *table, rune_strview_t arg, long *fd_out) {
+    long fd;
+    if (!parse_fd(arg, &fd)) {
+        return -1;
+    }
+    *fd_out = fd;
+    const char *open = memchr(arg.ptr, '<', arg.len);
+    if (open != NULL && arg.ptr[arg.len - 1] == '>') {
+        return lookup_target(state, open + 1, (size_t)(arg.ptr + arg.len - 1 - (open + 1)));
+    }
+    uint32_t *slot = fd_slot(state, table, fd);
+    if (slot != NULL && *slot != 0) {
+        return (long)*slot - 1;
+    }
+    char label[64];
+    static const char *const std_names[] = { "stdin", "stdout", "stderr" };
+    int len = fd >= 0 && fd < 3 ? snprintf(label, sizeof(label), "%s", std_names[fd])
+                     : snprintf(label, sizeof(label), "fd %ld (opened before the trace)", fd);
+    long id = lookup_target(state, label, (size_t)len);
+    if (slot != NULL && id >= 0) {
+        *slot = (uint32_t)id + 1;
+    }
+    return id;
+}
+
+static void bind_fd(io_state_t *state, fd_table_t *table, long fd, long target) {
+    uint32_t *slot = fd_slot(state, table, fd);
+    if (slot != NULL && target >= 0) {
+        *slot = (uint32_t)target + 1;
+        table->seeked[fd] = 0;
+    }
+}
+
+// Strips the quotes (and a truncation "...") of a strace string argument
+static rune_strview_t unquote(rune_strview_t arg) {
+    if (arg.len >= 2 && arg.ptr[0] == '"') {
+        const char *close = arg.ptr + arg.len - 1;
+        while (close > arg.ptr && *close != '"') {
+            close--;
+        }
+        if (close > arg.ptr) {
+            return rune_strview_make(arg.ptr + 1, (size_t)(close - arg.ptr - 1));
+        }
+    }
+    return arg;
+}
+
+// Returns the first flag of an argument such as "SOCK_STREAM|SOCK_CLOEXEC"
+static rune_strview_t first_flag(rune_strview_t arg) {
+    const char *bar = memchr(arg.ptr, '|', arg.len);
+    return bar != NULL ? rune_strview_make(arg.ptr, (size_t)(bar - arg.ptr)) : arg;
+}
+
+static int is_zero_timeout(rune_strview_t arg) {
+    return rune_strview_equals(arg, "0") || rune_strview_equals(arg, "0x0") ||
+           rune_strview_equals(arg, "{tv_sec=0, tv_nsec=0}") || rune_strview_equals(arg, "{tv_sec=0, tv_usec=0}");
+}
+
+static uint32_t find_pid_index(const io_state_t *state, long pid, int *found) {
+    size_t lo = 0, hi = state->num_pids;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (state->pid_slots[mid].pid < pid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = lo < state->num_pids && state->pid_slots[lo].pid == pid;
+    return *found ? state->pid_slots[lo].index : 0;
+}
+
+static int compare_pid_slots(const void *a, const void *b) {
+    const pid_slot_t *sa = a;
+    const pid_slot_t *sb = b;
+    return (sa->pid > sb->pid) - (sa->pid < sb->pid);
+}
+
+static void record_transfer(io_state_t *state, fd_table_t *table, long fd, long target, int is_write, int after_seek_counts,
+                            long ret, const rune_strview_t *args, size_t nargs, int size_arg) {
+    if (target < 0) {
+        return;
+    }
+    io_target_t *t = &state->targets[target];
+    long size = ret;
+    if (size_arg >= 0 && (size_t)size_arg < nargs) {
+        parse_fd(args[size_arg], &size); // The requested size, so a short read near EOF isn't "tiny"
+    }
+    int small = size > 0 && size < SMALL_IO_BYTES;
+    if (is_write) {
+        t->writes++;
+        t->write_bytes += ret > 0 ? (uint64_t)ret : 0;
+        t->small_writes += small;
+    } else {
+        t->reads++;
+        t->read_bytes += ret > 0 ? (uint64_t)ret : 0;
+        t->small_reads += small;
+    }
+    if (fd >= 0 && (size_t)fd < table->capacity) {
+        t->seek_io += after_seek_counts && table->seeked[fd];
+        table->seeked[fd] = 0;
+    }
+}
+
+static void replay_event(io_state_t *state, size_t i, io_role_t role, int role_arg, uint32_t pid_index) {
+    const rune_store_t *store = state->store;
+    fd_table_t *table = table_for(state, pid_index);
+    if (table == NULL) {
+        return;
+    }
+    rune_strview_t text = rune_store_args(store, i);
+    rune_strview_t args[MAX_ARGS];
+    size_t nargs = rune_scan_split_args(text.ptr, text.ptr + text.len, args, MAX_ARGS);
+    int ok = !(store->flags[i] & (RUNE_EVENT_ERROR | RUNE_EVENT_UNFINISHED));
+    long ret = (long)store->ret[i];
+    const char *name = rune_store_name(store, store->name_id[i]);
+    char label[256];
+    long fd = -1, target = -1;
+    int len;
+
+    switch (role) {
+    case IO_OPEN:
+        if (ok && (size_t)role_arg < nargs) {
+            rune_strview_t path = args[role_arg];
+            if (path.len > 0 && path.ptr[0] == '"') {
+                path = unquote(path);
+            } else {
+                path = rune_strview_make("(path not traced)", 17); // The native tracer only sees pointers
+            }
+            target = lookup_target(state, path.ptr, path.len);
+            if (target >= 0) {
+                state->targets[target].opens++;
+                bind_fd(state, table, ret, target);
+            }
+        }
+        break;
+    case IO_SOCKET:
+    case IO_SOCKETPAIR:
+        if (ok && nargs >= 2) {
+            // Each socket is a target of its own, told apart by its number and descriptors
+            rune_strview_t type = first_flag(args[1]);
+            long fds[2] = { ret, -1 };
+            if (role == IO_SOCKETPAIR) {
+                const char *p = NULL;
+                if (nargs >= 4 && args[3].len > 0 && args[3].ptr[0] == '[') {
+                    p = rune_scan_number(args[3].ptr + 1, args[3].ptr + args[3].len, &fds[0]);
+                }
+                if (p == NULL || rune_scan_number(rune_scan_skip_spaces(p + 1, args[3].ptr + args[3].len),
+                                                  args[3].ptr + args[3].len, &fds[1]) == NULL) {
+                    break;
+                }
+                len = snprintf(label, sizeof(label), "%s %.*s %.*s #%lu [%ld, %ld]", name, (int)args[0].len,
+                               args[0].ptr, (int)type.len, type.ptr, ++state->created, fds[0], fds[1]);
+            } else {
+                len = snprintf(label, sizeof(label), "%s %.*s %.*s #%lu (fd %ld)", name, (int)args[0].len,
+                               args[0].ptr, (int)type.len, type.ptr, ++state->created, fds[0]);
+            }
+            target = lookup_target(state, label, (size_t)len < sizeof(label) ? (size_t)len : sizeof(label) - 1);
+            if (target < 0) {
+                break;
+            }
+            state->targets[target].opens++;
+            bind_fd(state, table, fds[0], target);
+            if (fds[1] >= 0) {
+                bind_fd(state, table, fds[1], target);
+            }
+        }
+        break;
+    case IO_ACCEPT:
+        if (ok && nargs >= 1 && (target = resolve_fd(state, table, args[0], &fd)) >= 0) {
+            len = snprintf(label, sizeof(label), "accepted #%lu (fd %ld) on %s", ++state->created, ret,
+                           rune_intern_string(&state->labels, (uint32_t)target));
+            target = lookup_target(state, label, (size_t)len < sizeof(label) ? (size_t)len : sizeof(label) - 1);
+            if (target >= 0) {
+                state->targets[target].opens++;
+                bind_fd(state, table, ret, target);
+            }
+        }
+        break;
+    case IO_DUP:
+    case IO_DUP2:
+        if (ok && nargs >= 1 && (target = resolve_fd(state, table, args[0], &fd)) >= 0) {
+            bind_fd(state, table, ret, target);
+        }
+        break;
+    case IO_FCNTL:
+        if (ok && nargs >= 2 && rune_scan_find(args[1].ptr, args[1].ptr + args[1].len, "F_DUPFD") != NULL &&
+            (target = resolve_fd(state, table, args[0], &fd)) >= 0) {
+            bind_fd(state, table, ret, target);
+        }
+        break;
+    case IO_PIPE:
+        if (ok && nargs >= 1 && args[0].len > 0 && args[0].ptr[0] == '[') {
+            long fds[2];
+            const char *end = args[0].ptr + args[0].len;
+            const char *p = rune_scan_number(args[0].ptr + 1, end, &fds[0]);
+            if (p == NULL || rune_scan_number(rune_scan_skip_spaces(p + 1, end), end, &fds[1]) == NULL) {
+                break;
+            }
+            len = snprintf(label, sizeof(label), "pipe #%lu [%ld, %ld]", ++state->created, fds[0], fds[1]);
+            if ((target = lookup_target(state, label, (size_t)len)) >= 0) {
+                state->targets[target].opens++;
+                bind_fd(state, table, fds[0], target);
+                bind_fd(state, table, fds[1], target);
+            }
+        }
+        break;
+    case IO_NAMED_FD:
+        if (ok) {
+            if (strcmp(name, "memfd_create") == 0 && nargs >= 1 && args[0].len > 0 && args[0].ptr[0] == '"') {
+                rune_strview_t memfd_name = unquote(args[0]);
+                len = snprintf(label, sizeof(label), "memfd:%.*s", (int)memfd_name.len, memfd_name.ptr);
+            } else {
+                len = snprintf(label, sizeof(label), "%s", name);
+            }
+            target = lookup_target(state, label, (size_t)len < sizeof(label) ? (size_t)len : sizeof(label) - 1);
+            if (target >= 0) {
+                state->targets[target].opens++;
+                bind_fd(state, table, ret, target);
+            }
+        }
+        break;
+    case IO_CLOSE:
+        if (ok && nargs >= 1 && parse_fd(args[0], &fd)) {
+            uint32_t *slot = fd_slot(state, table, fd);
+            if (slot != NULL) {
+                *slot = 0;
+                table->seeked[fd] = 0;
+            }
+        }
+        break;
+    case IO_READ:
+    case IO_WRITE:
+    case IO_PREAD:
+    case IO_PWRITE:
+        if (ok && nargs >= 1) {
+            target = resolve_fd(state, table, args[0], &fd);
+            record_transfer(state, table, fd, target, role == IO_WRITE || role == IO_PWRITE,
+                            role == IO_READ || role == IO_WRITE, ret, args, nargs, role_arg);
+        }
+        break;
+    case IO_SENDFILE:
+        if (ok && nargs >= 2) {
+            target = resolve_fd(state, table, args[0], &fd);
+            record_transfer(state, table, fd, target, 1, 0, ret, args, nargs, -1);
+            target = resolve_fd(state, table, args[1], &fd);
+            record_transfer(state, table, fd, target, 0, 0, ret, args, nargs, -1);
+        }
+        break;
+    case IO_LSEEK:
+        if (ok && nargs >= 1 && parse_fd(args[0], &fd) && fd_slot(state, table, fd) != NULL) {
+            table->seeked[fd] = 1;
+        }
+        break;
+    case IO_POLL: {
+        io_poller_t *poller = &state->pollers[pid_index];
+        poller->polls++;
+        if (ok && ret == 0) {
+            poller->empty++;
+            poller->empty_spin += (size_t)role_arg < nargs && is_zero_timeout(args[role_arg]);
+        }
+        break;
+    }
+    case IO_CLONE:
+        if (ok && ret > 0) {
+            int found;
+            uint32_t child = find_pid_index(state, ret, &found);
+            if (!found) {
+                break; // The child never made a call
+            }
+            // strace prints flags symbolically; the native tracer sees clone's raw flags and
+            // only a pointer for clone3, whose main use is creating threads
+            long flags;
+            int shares;
+            if (strcmp(name, "fork") == 0 || strcmp(name, "vfork") == 0) {
+                shares = 0;
+            } else if (rune_scan_find(text.ptr, text.ptr + text.len, "CLONE_FILES") != NULL) {
+                shares = 1;
+            } else if (nargs == 0 || args[0].len == 0 || args[0].ptr[0] != '0') {
+                shares = 0;
+            } else if (strcmp(name, "clone3") == 0) {
+                shares = 1;
+            } else {
+                shares = parse_fd(args[0], &flags) && (flags & CLONE_FILES_FLAG) != 0;
+            }
+            uint32_t parent_table = state->table_of[pid_index];
+            if (shares) {
+                state->table_of[child] = parent_table;
+            } else {
+                long t = new_table(state, (long)parent_table - 1);
+                if (t >= 0) {
+                    state->table_of[child] = (uint32_t)t + 1;
+                }
+            }
+        }
+        break;
+    case IO_NONE:
+        break;
+    }
+}
+
+static int compare_targets(const void *a, const void *b) {
+    const io_target_t *ta = *(const io_target_t *const *)a;
+    const io_target_t *tb = *(const io_target_t *const *)b;
+    uint64_t bytes_a = ta->read_bytes + ta->write_bytes;
+    uint64_t bytes_b = tb->read_bytes + tb->write_bytes;
+    if (bytes_a != bytes_b) {
+        return bytes_a < bytes_b ? 1 : -1;
+    }
+    unsigned long calls_a = ta->reads + ta->writes;
+    unsigned long calls_b = tb->reads + tb->writes;
+    if (calls_a != calls_b) {
+        return calls_a < calls_b ? 1 : -1;
+    }
+    if (ta->opens != tb->opens) {
+        return ta->opens < tb->opens ? 1 : -1;
+    }
+    return (ta > tb) - (ta < tb);
+}
+
+static const char *target_label(const io_state_t *state, const io_target_t *target) {
+    return rune_intern_string(&state->labels, (uint32_t)(target - state->targets));
+}
+
+// order has room for one pointer per target
+static void print_report(const io_state_t *state, FILE *out, size_t top_n, const long *pids,
+                         const io_target_t **order) {
+    size_t num_targets = state->labels.count;
+    unsigned long reads = 0, writes = 0;
+    uint64_t read_bytes = 0, write_bytes = 0;
+    for (size_t i = 0; i < num_targets; i++) {
+        order[i] = &state->targets[i];
+        reads += state->targets[i].reads;
+        writes += state->targets[i].writes;
+        read_bytes += state->targets[i].read_bytes;
+        write_bytes += state->targets[i].write_bytes;
+    }
+    qsort(order, num_targets, sizeof(order[0]), compare_targets);
+
+    fprintf(out, "\n--- File descriptor I/O: %zu targets, %lu reads (%llu bytes), %lu writes (%llu bytes) ---\n",
+            num_targets, reads, (unsigned long long)read_bytes, writes, (unsigned long long)write_bytes);
+    size_t shown = top_n == 0 || top_n > num_targets ? num_targets : top_n;
+    fprintf(out, "%8s %10s %14s %8s %10s %14s %8s %8s  %s\n", "opens", "reads", "read bytes", "avg", "writes",
+            "write bytes", "avg", "tiny", "target");
+    for (size_t k = 0; k < shown; k++) {
+        const io_target_t *t = order[k];
+        fprintf(out, "%8lu %10lu %14llu %8.1f %10lu %14llu %8.1f %8lu  %s\n", t->opens, t->reads,
+                (unsigned long long)t->read_bytes, t->reads ? (double)t->read_bytes / (double)t->reads : 0.0,
+                t->writes, (unsigned long long)t->write_bytes,
+                t->writes ? (double)t->write_bytes / (double)t->writes : 0.0, t->small_reads + t->small_writes,
+                target_label(state, order[k]));
+    }
+    if (shown < num_targets) {
+        fprintf(out, "%8s %10s  (%zu more)\n", "...", "", num_targets - shown);
+    }
+
+    fprintf(out, "\n--- I/O patterns ---\n");
+    size_t findings = 0, listed;
+    listed = 0;
+    for (size_t k = 0; k < num_targets && listed < MAX_PATTERNS; k++) {
+        const io_target_t *t = order[k];
+        const char *label = target_label(state, order[k]);
+        if (t->reads >= SMALL_IO_MIN_CALLS && t->small_reads * SMALL_IO_SHARE >= t->reads) {
+            fprintf(out, "Tiny reads: %lu of %lu reads from %s asked for under %d bytes (avg %.1f bytes read)\n",
+                    t->small_reads, t->reads, label, SMALL_IO_BYTES, (double)t->read_bytes / (double)t->reads);
+            listed++;
+        }
+        if (t->writes >= SMALL_IO_MIN_CALLS && t->small_writes * SMALL_IO_SHARE >= t->writes) {
+            fprintf(out, "Tiny writes: %lu of %lu writes to %s were under %d bytes (avg %.1f bytes); buffer them\n",
+                    t->small_writes, t->writes, label, SMALL_IO_BYTES, (double)t->write_bytes / (double)t->writes);
+            listed++;
+        }
+    }
+    findings += listed;
+    listed = 0;
+    for (size_t k = 0; k < num_targets && listed < MAX_PATTERNS; k++) {
+        const io_target_t *t = order[k];
+        if (t->seek_io >= SEEK_IO_MIN) {
+            fprintf(out, "lseek + read/write: %lu pairs on %s; pread/pwrite save a syscall each\n", t->seek_io,
+                    target_label(state, order[k]));
+            listed++;
+        }
+    }
+    findings += listed;
+    listed = 0;
+    for (size_t k = 0; k < num_targets && listed < MAX_PATTERNS; k++) {
+        const io_target_t *t = order[k];
+        if (t->opens >= REOPEN_MIN) {
+            fprintf(out, "Reopened: %s opened %lu times\n", target_label(state, order[k]), t->opens);
+            listed++;
+        }
+    }
+    findings += listed;
+    listed = 0;
+    for (size_t p = 0; p < state->num_pids && listed < MAX_PATTERNS; p++) {
+        const io_poller_t *poller = &state->pollers[p];
+        if (poller->empty_spin >= SPIN_MIN_POLLS) {
+            fprintf(out, "Poll spin: pid %ld made %lu poll/select/epoll calls, %lu returned nothing ready with a zero timeout\n",
+                    pids[p], poller->polls, poller->empty_spin);
+            listed++;
+        }
+    }
+    findings += listed;
+    if (findings == 0) {
+        fprintf(out, "No tiny I/O, lseek + read/write, reopened files or poll spinning found\n");
+    }
+}
+
+int rune_io_report(const rune_store_t *store, FILE *out, size_t top_n) {
+    io_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.store = store;
+    long *pids;
+    uint32_t *pid_index = rune_store_pid_index(store, &pids, &state.num_pids);
+    if (pid_index == NULL) {
+        return -1;
+    }
+    io_role_t *roles = calloc(store->names.count + 1, sizeof(io_role_t));
+    int *role_args = calloc(store->names.count + 1, sizeof(int));
+    state.targets_capacity = 64;
+    state.targets = calloc(state.targets_capacity, sizeof(io_target_t));
+    state.table_of = calloc(state.num_pids + 1, sizeof(uint32_t));
+    state.pid_slots = malloc((state.num_pids + 1) * sizeof(pid_slot_t));
+    state.pollers = calloc(state.num_pids + 1, sizeof(io_poller_t));
+    int result = -1;
+    if (roles == NULL || role_args == NULL || state.targets == NULL || state.table_of == NULL ||
+        state.pid_slots == NULL || state.pollers == NULL) {
+        perror("runescope: allocation failed for I/O analysis");
+        goto out;
+    }
+    if (rune_intern_init(&state.labels) == -1) {
+        goto out;
+    }
+
+    for (uint32_t id = 0; id < store->names.count; id++) {
+        const char *name = rune_store_name(store, id);
+        for (size_t k = 0; k < sizeof(io_syscalls) / sizeof(io_syscalls[0]); k++) {
+            if (strcmp(name, io_syscalls[k].name) == 0) {
+                roles[id] = io_syscalls[k].role;
+                role_args[id] = io_syscalls[k].arg;
+                break;
+            }
+        }
+    }
+    for (size_t p = 0; p < state.num_pids; p++) {
+        state.pid_slots[p].pid = pids[p];
+        state.pid_slots[p].index = (uint32_t)p;
+    }
+    qsort(state.pid_slots, state.num_pids, sizeof(pid_slot_t), compare_pid_slots);
+
+    for (size_t i = 0; i < store->count && !state.failed; i++) {
+        io_role_t role = roles[store->name_id[i]];
+        if (role != IO_NONE) {
+            replay_event(&state, i, role, role_args[store->name_id[i]], pid_index[i]);
+        }
+    }
+    if (!state.failed) {
+        const io_target_t **order = malloc((state.labels.count + 1) * sizeof(io_target_t *));
+        if (order == NULL) {
+            perror("runescope: malloc failed for I/O report");
+        } else {
+            flockfile(out);
+            print_report(&state, out, top_n, pids, order);
+            funlockfile(out);
+            free(order);
+            result = 0;
+        }
+    }
+
+out:
+    rune_intern_free(&state.labels);
+    for (size_t t = 0; t < state.num_tables; t++) {
+        free(state.tables[t].targets);
+        free(state.tables[t].seeked);
+    }
+    free(state.tables);
+    free(state.targets);
+    free(state.table_of);
+    free(state.pid_slots);
+    free(state.pollers);
+    free(roles);
+    free(role_args);
+    free(pid_index);
+    free(pids);
+    return result;
+}
@@ -0,0 +1,37 @@
+#ifndef RUNE_IO_H
+#define RUNE_IO_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "rune_store.h"
+
+/**
+ * @brief File-descriptor I/O pattern analysis.
+ *
+ * Replays the syscalls of a trace against a model of every process's file
+ * descriptor table (open, openat, socket, accept, dup, pipe, close, ...;
+ * threads created with CLONE_FILES share one table, forked children get a
+ * copy) and attributes the bytes of read/write/pread/pwrite/send/recv calls
+ * to the paths and sockets behind the descriptors.
+ */
+
+/**
+ * @brief Prints per-target I/O totals and the patterns that hurt throughput.
+ *
+ * The table lists bytes, calls and average size per path, pipe or socket;
+ * every pipe, socket and accepted connection is listed apart, numbered in
+ * the order they were made. The
+ * pattern report flags tiny reads and writes (unbuffered stdio), lseek
+ * followed by read or write where pread/pwrite would do, files reopened
+ * many times, and threads spinning on poll/select/epoll_wait with a zero
+ * timeout. Paths are taken from strace's arguments, or from the fd
+ * annotations of strace -y when present.
+ *
+ * @param store The events.
+ * @param out The stream to print to.
+ * @param top_n The number of targets to list.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_io_report(const rune_store_t *store, FILE *out, size_t top_n);
+
+#endif // RUNE_IO_H
@@ -0,0 +1,157 @@
+#define _POSIX_C_SOURCE 200809L // For flockfile
+#include "rune_latency.h"
+#include "rune_histogram.h"
+#include <stdlib.h>
+
+// One row of a latency table
+typedef struct {
+    const char *name;          // Syscall name, or NULL for a pid row
+    long pid;
+    const rune_histogram_t *histogram;
+} latency_row_t;
+
+const char *rune_latency_format(int64_t ns, char *buf, size_t size) {
+    if (ns < 1000) {
+        snprintf(buf, size, "%lldns", (long long)ns);
+    } else if (ns < 1000000) {
+        snprintf(buf, size, "%.1fus", (double)ns / 1e3);
+    } else if (ns < 1000000000) {
+        snprintf(buf, size, "%.2fms", (double)ns / 1e6);
+    } else {
+        snprintf(buf, size, "%.2fs", (double)ns / 1e9);
+    }
+    return buf;
+}
+
+const char *rune_latency_format_bytes(uint64_t bytes, char *buf, size_t size) {
+    if (bytes < 1024) {
+        snprintf(buf, size, "%lluB", (unsigned long long)bytes);
+    } else if (bytes < 1024 * 1024) {
+        snprintf(buf, size, "%.1fK", (double)bytes / 1024);
+    } else if (bytes < 1024ull * 1024 * 1024) {
+        snprintf(buf, size, "%.1fM", (double)bytes / (1024 * 1024));
+    } else {
+        snprintf(buf, size, "%.1fG", (double)bytes / (1024.0 * 1024 * 1024));
+    }
+    return buf;
+}
+
+static int compare_by_total(const void *a, const void *b) {
+    const latency_row_t *ra = a;
+    const latency_row_t *rb = b;
+    if (ra->histogram->total != rb->histogram->total) {
+        return ra->histogram->total < rb->histogram->total ? 1 : -1;
+    }
+    return (ra->pid > rb->pid) - (ra->pid < rb->pid);
+}
+
+static void print_rows(FILE *out, latency_row_t *rows, size_t n, size_t limit, int64_t grand_total,
+                       const char *name_header) {
+    char p50[16], p90[16], p99[16], max[16];
+    qsort(rows, n, sizeof(latency_row_t), compare_by_total);
+    if (limit == 0 || limit > n) {
+        limit = n;
+    }
+    fprintf(out, "%12s %12s %6s %9s %9s %9s %9s  %s\n", "calls", "total(s)", "time%", "p50", "p90", "p99", "max",
+            name_header);
+    for (size_t i = 0; i < limit; i++) {
+        const rune_histogram_t *h = rows[i].histogram;
+        fprintf(out, "%12llu %12.6f %6.2f %9s %9s %9s %9s  ", (unsigned long long)h->count, (double)h->total / 1e9,
+                grand_total > 0 ? 100.0 * (double)h->total / (double)grand_total : 0.0,
+                rune_latency_format(rune_histogram_percentile(h, 50), p50, sizeof(p50)),
+                rune_latency_format(rune_histogram_percentile(h, 90), p90, sizeof(p90)),
+                rune_latency_format(rune_histogram_percentile(h, 99), p99, sizeof(p99)),
+                rune_latency_format(h->max, max, sizeof(max)));
+        if (rows[i].name != NULL) {
+            fprintf(out, "%s\n", rows[i].name);
+        } else {
+            fprintf(out, "%ld\n", rows[i].pid);
+        }
+    }
+    if (limit < n) {
+        fprintf(out, "%12s %12s  (%zu more)\n", "...", "", n - limit);
+    }
+}
+
+int rune_latency_report(const rune_store_t *store, FILE *out, const char *name_header, size_t top_pids) {
+    long *pids;
+    size_t num_pids;
+    uint32_t *pid_index = rune_store_pid_index(store, &pids, &num_pids);
+    if (pid_index == NULL) {
+        return -1;
+    }
+    size_t num_names = store->names.count;
+    rune_histogram_t *by_name = malloc((num_names + 1) * sizeof(rune_histogram_t));
+    rune_histogram_t *by_pid = malloc((num_pids + 1) * sizeof(rune_histogram_t));
+    latency_row_t *rows = malloc((num_names + num_pids + 1) * sizeof(latency_row_t));
+    if (by_name == NULL || by_pid == NULL || rows == NULL) {
+        perror("runescope: malloc failed for latency histograms");
+        free(by_name);
+        free(by_pid);
+        free(rows);
+        free(pid_index);
+        free(pids);
+        return -1;
+    }
+    for (size_t i = 0; i < num_names; i++) {
+        rune_histogram_init(&by_name[i]);
+    }
+    for (size_t i = 0; i < num_pids; i++) {
+        rune_histogram_init(&by_pid[i]);
+    }
+
+    rune_histogram_t all;
+    rune_histogram_init(&all);
+    for (size_t i = 0; i < store->count; i++) {
+        int64_t duration = store->duration_ns[i];
+        if (duration < 0) {
+            continue;
+        }
+        rune_histogram_record(&by_name[store->name_id[i]], duration);
+        rune_histogram_record(&by_pid[pid_index[i]], duration);
+    }
+    for (size_t i = 0; i < num_names; i++) {
+        rune_histogram_merge(&all, &by_name[i]);
+    }
+
+    flockfile(out);
+    if (all.count == 0) {
+        fprintf(out, "\n--- Latency: no call durations in this trace (trace with --latency) ---\n");
+    } else {
+        char p50[16], p99[16];
+        fprintf(out, "\n--- Latency: %llu timed calls, %.6fs in calls, p50 %s, p99 %s ---\n",
+                (unsigned long long)all.count, (double)all.total / 1e9,
+                rune_latency_format(rune_histogram_percentile(&all, 50), p50, sizeof(p50)),
+                rune_latency_format(rune_histogram_percentile(&all, 99), p99, sizeof(p99)));
+        size_t n = 0;
+        for (size_t i = 0; i < num_names; i++) {
+            if (by_name[i].count > 0) {
+                rows[n].name = rune_store_name(store, (uint32_t)i);
+                rows[n].pid = 0;
+                rows[n].histogram = &by_name[i];
+                n++;
+            }
+        }
+        print_rows(out, rows, n, 0, all.total, name_header);
+
+        n = 0;
+        for (size_t i = 0; i < num_pids; i++) {
+            if (by_pid[i].count > 0) {
+                rows[n].name = NULL;
+                rows[n].pid = pids[i];
+                rows[n].histogram = &by_pid[i];
+                n++;
+            }
+        }
+        fprintf(out, "\n--- Latency by pid: %zu pids ---\n", n);
+        print_rows(out, rows, n, top_pids, all.total, "pid");
+    }
+    funlockfile(out);
+
+    free(by_name);
+    free(by_pid);
+    free(rows);
+    free(pid_index);
+    free(pids);
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef RUNE_LATENCY_H
+#define RUNE_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "rune_store.h"
+
+/**
+ * @brief Per-syscall and per-pid latency analysis.
+ *
+ * Builds a log-bucketed histogram of call durations (strace -T, or the
+ * native tracer) for every syscall and every pid, and reports where the
+ * time goes: total time per syscall and its p50/p90/p99/max.
+ */
+
+/**
+ * @brief Prints latency tables for the timed events of a store.
+ *
+ * @param store The events; those without a duration are skipped.
+ * @param out The stream to print to.
+ * @param name_header Column header for the names (e.g. "syscall").
+ * @param top_pids The number of pids to list, ordered by time spent in calls.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_latency_report(const rune_store_t *store, FILE *out, const char *name_header, size_t top_pids);
+
+/**
+ * @brief Formats a duration with a unit that keeps it short (ns, us, ms, s).
+ *
+ * @param ns The duration in nanoseconds.
+ * @param buf The buffer to format into.
+ * @param size The size of buf.
+ * @return buf.
+ */
+const char *rune_latency_format(int64_t ns, char *buf, size_t size);
+
+/**
+ * @brief Formats a size the same way, in B, K, M or G (powers of 1024).
+ *
+ * @param bytes The size in bytes.
+ * @param buf The buffer to format into.
+ * @param size The size of buf.
+ * @return buf.
+ */
+const char *rune_latency_format_bytes(uint64_t bytes, char *buf, size_t size);
+
+#endif // RUNE_LATENCY_H
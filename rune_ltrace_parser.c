@@ -1,70 +1,390 @@
 #include "rune_ltrace_parser.h"
+#include "rune_scan.h"
+#include "rune_pool.h"
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_LINE_LENGTH 1024
+#define UNFINISHED_MARKER " <unfinished ...>"
+#define RESUMED_PREFIX "<... "
+#define RESUMED_SUFFIX "resumed>"
 
-int rune_ltrace_parser_parse_file(const char *file_path) {
-    FILE *fp = fopen(file_path, "r");
-    if (fp == NULL) {
-        perror("runescope: Failed to open ltrace log file");
-        return -1;
+// Library function names may carry a library prefix, e.g. "libc.so.6->malloc"
+static int is_name_char(char c) {
+    return c != '(' && c != ' ' && c != '<' && c != '\n';
+}
+
+rune_line_kind_t rune_ltrace_parser_parse_line(const char *line, size_t len, ltrace_entry_t *entry) {
+    const char *current_pos = line;
+    const char *end = line + len;
+    rune_line_kind_t kind = RUNE_LINE_COMPLETE;
+
+    memset(entry, 0, sizeof(*entry)); // Initialize structure
+    if (end > line && end[-1] == '\n') {
+        end--;
     }
 
-    char line[MAX_LINE_LENGTH];
-    while (fgets(line, sizeof(line), fp) != NULL) {
-        ltrace_entry_t entry = {0}; // Initialize structure
-        char *current_pos = line;
-        char *func_name_start = NULL;
-        char *args_start = NULL;
-        char *return_start = NULL;
+    // Attempt to parse lines like: PID [TIMESTAMP] FUNCTION(ARGS) = RETURN_VALUE
+    // Or the halves of a split call: PID FUNCTION(ARGS <unfinished ...>
+    //                            and: PID <... FUNCTION resumed> ARGS) = RETURN_VALUE
 
-        // Skip leading whitespace and PID
-        while (*current_pos && (*current_pos == ' ' || (*current_pos >= '0' && *current_pos <= '9'))) {
-            current_pos++;
+    // Skip leading whitespace and PID, which ltrace may print as "[pid N]"
+    current_pos = rune_scan_skip_spaces(current_pos, end);
+    if (end - current_pos > 5 && memcmp(current_pos, "[pid ", 5) == 0) {
+        current_pos += 5;
+    }
+    if (current_pos < end && *current_pos >= '0' && *current_pos <= '9') {
+        const char *number_end = rune_scan_number(current_pos, end, &entry->pid);
+        if (number_end < end && *number_end == '.') {
+            entry->pid = 0; // No pid, the number was the timestamp
+        } else {
+            current_pos = number_end;
+            if (current_pos < end && *current_pos == ']') {
+                current_pos++;
+            }
+            current_pos = rune_scan_skip_spaces(current_pos, end);
         }
-        if (!*current_pos) continue; // Skip if line is empty or only PID
+    }
 
-        // Find function name
-        func_name_start = current_pos;
-        while (*current_pos && *current_pos != '(') {
-            current_pos++;
+    // Timestamp (with -ttt)
+    if (current_pos < end && *current_pos >= '0' && *current_pos <= '9') {
+        current_pos = rune_scan_seconds(current_pos, end, &entry->timestamp_ns);
+        current_pos = rune_scan_skip_spaces(current_pos, end);
+    }
+
+    size_t prefix_len = strlen(RESUMED_PREFIX);
+    if ((size_t)(end - current_pos) > prefix_len && memcmp(current_pos, RESUMED_PREFIX, prefix_len) == 0) {
+        kind = RUNE_LINE_RESUMED;
+        current_pos += prefix_len;
+    }
+
+    // Find function name
+    const char *func_name_start = current_pos;
+    while (current_pos < end && is_name_char(*current_pos)) {
+        current_pos++;
+    }
+    if (current_pos == func_name_start || current_pos == end ||
+        *func_name_start == '-' || *func_name_start == '+') {
+        return RUNE_LINE_INVALID; // Signal, exit notice or malformed line
+    }
+    entry->function_name = rune_strview_make(func_name_start, current_pos - func_name_start);
+
+    if (kind == RUNE_LINE_RESUMED) {
+        size_t suffix_len = strlen(RESUMED_SUFFIX);
+        current_pos = rune_scan_skip_spaces(current_pos, end);
+        if ((size_t)(end - current_pos) < suffix_len || memcmp(current_pos, RESUMED_SUFFIX, suffix_len) != 0) {
+            return RUNE_LINE_INVALID;
         }
-        if (!*current_pos) continue; // Malformed line
-        strncpy(entry.function_name, func_name_start, current_pos - func_name_start);
-        entry.function_name[current_pos - func_name_start] = '\0';
-
-        // Find arguments
-        args_start = current_pos + 1; // Skip '('
-        while (*current_pos && *current_pos != ')') {
-            current_pos++;
+        current_pos = rune_scan_skip_spaces(current_pos + suffix_len, end);
+    } else if (*current_pos == '(') {
+        current_pos++;
+    } else {
+        return RUNE_LINE_INVALID;
+    }
+
+    // Find arguments, up to the matching ')'
+    const char *args_start = current_pos;
+    current_pos = rune_scan_args_end(args_start, end);
+    if (current_pos == NULL) {
+        const char *marker = rune_scan_find(args_start, end, UNFINISHED_MARKER);
+        if (marker == NULL || kind == RUNE_LINE_RESUMED) {
+            return RUNE_LINE_INVALID;
         }
-        if (!*current_pos) continue; // Malformed line
-        strncpy(entry.args, args_start, current_pos - args_start);
-        entry.args[current_pos - args_start] = '\0';
-
-        // Find return value
-        current_pos++; // Skip ')'
-        while (*current_pos && *current_pos == ' ') {
-            current_pos++;
+        entry->args = rune_strview_make(args_start, marker - args_start);
+        entry->unfinished = 1;
+        return RUNE_LINE_UNFINISHED;
+    }
+    entry->args = rune_strview_make(args_start, current_pos - args_start);
+
+    // Find return value; "<void>" and string results leave it at 0
+    current_pos = rune_scan_skip_spaces(current_pos + 1, end);
+    if (current_pos == end || *current_pos != '=') {
+        return RUNE_LINE_INVALID; // Malformed line
+    }
+    current_pos = rune_scan_skip_spaces(current_pos + 1, end);
+    rune_scan_number(current_pos, end, &entry->return_value);
+
+    return kind;
+}
+
+int rune_ltrace_parser_init(rune_ltrace_parser_t *parser, rune_ltrace_entry_cb on_entry, void *user_data) {
+    memset(parser, 0, sizeof(*parser));
+    parser->on_entry = on_entry;
+    parser->user_data = user_data;
+    if (rune_stitcher_init(&parser->stitcher) == -1) {
+        return -1;
+    }
+    if (rune_stitcher_init(&parser->held) == -1) {
+        rune_stitcher_free(&parser->stitcher);
+        return -1;
+    }
+    return 0;
+}
+
+static void add_orphan(rune_ltrace_parser_t *parser, const ltrace_entry_t *entry, int replaces) {
+    if (parser->orphan_count == parser->orphan_capacity) {
+        size_t capacity = parser->orphan_capacity ? parser->orphan_capacity * 2 : 16;
+        rune_ltrace_orphan_t *orphans = realloc(parser->orphans, capacity * sizeof(rune_ltrace_orphan_t));
+        if (orphans == NULL) {
+            perror("runescope: realloc failed for resumed calls");
+            return;
         }
-        if (!*current_pos || *current_pos != '=') continue; // Malformed line
-        current_pos++; // Skip '='
-        while (*current_pos && *current_pos == ' ') {
-            current_pos++;
+        parser->orphans = orphans;
+        parser->orphan_capacity = capacity;
+    }
+    parser->orphans[parser->orphan_count].entry = *entry;
+    parser->orphans[parser->orphan_count].position = parser->delivered;
+    parser->orphans[parser->orphan_count].replaces = replaces;
+    parser->orphan_count++;
+}
+
+static void make_unfinished(const rune_pending_call_t *call, ltrace_entry_t *entry) {
+    memset(entry, 0, sizeof(*entry));
+    entry->pid = call->pid;
+    entry->function_name = rune_strview_make(call->name, call->name_len);
+    entry->args = rune_strview_make(call->args, call->args_len);
+    entry->timestamp_ns = call->timestamp_ns;
+    entry->unfinished = 1;
+}
+
+static void deliver(rune_ltrace_parser_t *parser, const ltrace_entry_t *entry) {
+    parser->on_entry(entry, parser->user_data);
+    parser->delivered++;
+}
+
+// A call replaced by a later unfinished half of the same pid never resumed
+static void deliver_replaced(const rune_pending_call_t *call, void *user_data) {
+    ltrace_entry_t entry;
+    make_unfinished(call, &entry);
+    deliver(user_data, &entry);
+}
+
+void rune_ltrace_parser_feed_line(rune_ltrace_parser_t *parser, const char *line, size_t len) {
+    ltrace_entry_t entry;
+    rune_strview_t name, joined_args;
+    int64_t started;
+
+    switch (rune_ltrace_parser_parse_line(line, len, &entry)) {
+    case RUNE_LINE_COMPLETE:
+        deliver(parser, &entry);
+        break;
+    case RUNE_LINE_UNFINISHED:
+        if (parser->defer_orphans && !rune_stitcher_pending(&parser->held, entry.pid)) {
+            // From here on, a call pending in an earlier chunk is replaced; the join delivers it here
+            rune_stitcher_hold(&parser->held, entry.pid, rune_strview_make("", 0), rune_strview_make("", 0), 0, NULL,
+                               NULL);
+            add_orphan(parser, &entry, 1);
         }
-        if (!*current_pos) continue; // Malformed line
-        return_start = current_pos;
-        while (*current_pos && *current_pos != '\n') {
-            current_pos++;
+        rune_stitcher_hold(&parser->stitcher, entry.pid, entry.function_name, entry.args, entry.timestamp_ns,
+                           deliver_replaced, parser);
+        break;
+    case RUNE_LINE_RESUMED:
+        if (rune_stitcher_resume(&parser->stitcher, entry.pid, entry.args, &name, &joined_args, &started) == 1) {
+            entry.args = joined_args;
+            entry.timestamp_ns = started; // The call started with its first half
+            deliver(parser, &entry);
+        } else if (parser->defer_orphans && !rune_stitcher_pending(&parser->held, entry.pid)) {
+            add_orphan(parser, &entry, 0); // The first half may be in an earlier chunk
+        } else {
+            deliver(parser, &entry); // Trace started mid-call
         }
-        entry.return_value = atol(return_start);
+        break;
+    default:
+        break; // Malformed or unsupported line
+    }
+}
+
+typedef struct {
+    rune_ltrace_entry_cb on_entry;
+    void *user_data;
+} unfinished_sink_t;
+
+static void deliver_unfinished(const rune_pending_call_t *call, void *user_data) {
+    unfinished_sink_t *sink = user_data;
+    ltrace_entry_t entry;
+    make_unfinished(call, &entry);
+    sink->on_entry(&entry, sink->user_data);
+}
+
+static void free_parser(rune_ltrace_parser_t *parser) {
+    rune_stitcher_free(&parser->stitcher);
+    rune_stitcher_free(&parser->held);
+    free(parser->orphans);
+    memset(parser, 0, sizeof(*parser));
+}
 
-        // Print parsed information (for testing)
-        printf("Parsed Ltrace: PID=%ld, Function=%s, Args='%s', Return=%ld\n",
-               entry.pid, entry.function_name, entry.args, entry.return_value);
+void rune_ltrace_parser_finish(rune_ltrace_parser_t *parser) {
+    unfinished_sink_t sink = { parser->on_entry, parser->user_data };
+    rune_stitcher_drain(&parser->stitcher, deliver_unfinished, &sink);
+    free_parser(parser);
+}
+
+static void feed_lines(rune_ltrace_parser_t *parser, const char *data, size_t len) {
+    const char *line = data;
+    const char *end = data + len;
+
+    while (line < end) {
+        const char *newline = memchr(line, '\n', end - line);
+        const char *line_end = newline != NULL ? newline : end;
+        rune_ltrace_parser_feed_line(parser, line, line_end - line);
+        line = line_end + 1;
     }
+}
 
-    fclose(fp);
+int rune_ltrace_parser_parse_buffer(const char *data, size_t len, rune_ltrace_entry_cb on_entry, void *user_data) {
+    rune_ltrace_parser_t parser;
+    if (rune_ltrace_parser_init(&parser, on_entry, user_data) == -1) {
+        return -1;
+    }
+    feed_lines(&parser, data, len);
+    rune_ltrace_parser_finish(&parser);
     return 0;
 }
+
+int rune_ltrace_parser_parse_file(const char *file_path, rune_ltrace_entry_cb on_entry, void *user_data) {
+    const char *data;
+    size_t len;
+    if (rune_scan_map_file(file_path, "ltrace log file", &data, &len) == -1) {
+        return -1;
+    }
+    if (data == NULL) {
+        return 0; // An empty log has no entries
+    }
+
+    int result = rune_ltrace_parser_parse_buffer(data, len, on_entry, user_data);
+    rune_scan_unmap_file(data, len);
+    return result;
+}
+
+typedef struct {
+    const char *data;
+    const size_t *offsets;
+    rune_ltrace_parser_t *parsers;
+} parallel_parse_t;
+
+static void parse_chunk(size_t index, void *arg) {
+    parallel_parse_t *job = arg;
+    feed_lines(&job->parsers[index], job->data + job->offsets[index], job->offsets[index + 1] - job->offsets[index]);
+}
+
+// Where entries completed after the workers go, and the cross-chunk stitcher
+typedef struct {
+    rune_stitcher_t *carry;
+    rune_ltrace_late_entry_cb on_late;
+    void *user_data;
+    size_t position;
+} late_sink_t;
+
+// Moves a call left pending at the end of a chunk into the cross-chunk stitcher
+static void carry_pending(const rune_pending_call_t *call, void *user_data) {
+    late_sink_t *sink = user_data;
+    rune_stitcher_hold(sink->carry, call->pid, rune_strview_make(call->name, call->name_len),
+                       rune_strview_make(call->args, call->args_len), call->timestamp_ns, NULL, NULL);
+}
+
+static void deliver_late_unfinished(const rune_pending_call_t *call, void *user_data) {
+    late_sink_t *sink = user_data;
+    ltrace_entry_t entry;
+    make_unfinished(call, &entry);
+    sink->on_late(&entry, sink->position, sink->user_data);
+}
+
+int rune_ltrace_parser_parse_file_parallel(const char *file_path, int num_threads, size_t num_chunks,
+                                           rune_ltrace_entry_cb on_entry, rune_ltrace_late_entry_cb on_late,
+                                           void *const chunk_user_data[]) {
+    if (num_chunks == 0) {
+        return 0;
+    }
+
+    const char *data;
+    size_t len;
+    if (rune_scan_map_file(file_path, "ltrace log file", &data, &len) == -1) {
+        return -1;
+    }
+    if (data == NULL) {
+        return 0; // An empty log has no entries
+    }
+
+    size_t *offsets = malloc((num_chunks + 1) * sizeof(size_t));
+    rune_ltrace_parser_t *parsers = calloc(num_chunks, sizeof(rune_ltrace_parser_t));
+    rune_stitcher_t carry_stitcher;
+    int carry_ready = rune_stitcher_init(&carry_stitcher) == 0;
+    if (offsets == NULL || parsers == NULL || !carry_ready) {
+        perror("runescope: allocation failed for parallel parse");
+        if (carry_ready) {
+            rune_stitcher_free(&carry_stitcher);
+        }
+        free(offsets);
+        free(parsers);
+        rune_scan_unmap_file(data, len);
+        return -1;
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < num_chunks; i++) {
+        if (rune_ltrace_parser_init(&parsers[i], on_entry, chunk_user_data[i]) == -1) {
+            result = -1;
+        }
+        parsers[i].defer_orphans = 1;
+    }
+    rune_scan_split_lines(data, len, num_chunks, offsets);
+
+    parallel_parse_t job = { data, offsets, parsers };
+    if (result == 0) {
+        result = rune_pool_run(num_chunks, num_threads, parse_chunk, &job);
+    }
+
+    // Join calls split across chunk boundaries, walking the chunks in log order
+    for (size_t i = 0; i < num_chunks && result == 0; i++) {
+        rune_ltrace_parser_t *parser = &parsers[i];
+        late_sink_t sink = { &carry_stitcher, on_late, chunk_user_data[i], parser->delivered };
+        for (size_t j = 0; j < parser->orphan_count; j++) {
+            ltrace_entry_t *entry = &parser->orphans[j].entry;
+            rune_strview_t name, joined_args;
+            if (parser->orphans[j].replaces) {
+                // The chunk's first unfinished half of the pid replaced the call carried into the chunk
+                ltrace_entry_t replaced;
+                memset(&replaced, 0, sizeof(replaced));
+                if (rune_stitcher_resume(&carry_stitcher, entry->pid, rune_strview_make("", 0), &name, &joined_args,
+                                         &replaced.timestamp_ns) == 1) {
+                    replaced.pid = entry->pid;
+                    replaced.function_name = name;
+                    replaced.args = joined_args;
+                    replaced.unfinished = 1;
+                    on_late(&replaced, parser->orphans[j].position, chunk_user_data[i]);
+                }
+                continue;
+            }
+            int64_t started;
+            if (rune_stitcher_resume(&carry_stitcher, entry->pid, entry->args, &name, &joined_args, &started) == 1) {
+                entry->args = joined_args;
+                entry->timestamp_ns = started;
+            }
+            on_late(entry, parser->orphans[j].position, chunk_user_data[i]);
+        }
+        rune_stitcher_drain(&parser->stitcher, carry_pending, &sink);
+        if (i == num_chunks - 1) {
+            rune_stitcher_drain(&carry_stitcher, deliver_late_unfinished, &sink);
+        }
+    }
+
+    rune_stitcher_free(&carry_stitcher);
+    for (size_t i = 0; i < num_chunks; i++) {
+        free_parser(&parsers[i]);
+    }
+    free(parsers);
+    free(offsets);
+    rune_scan_unmap_file(data, len);
+    return result;
+}
+
+void rune_ltrace_parser_print_entry(const ltrace_entry_t *entry, void *user_data) {
+    (void)user_data;
+    printf("Parsed Ltrace: PID=%ld, Function=%.*s, Args='%.*s', Return=%ld",
+           entry->pid, (int)entry->function_name.len, entry->function_name.ptr,
+           (int)entry->args.len, entry->args.ptr, entry->return_value);
+    if (entry->timestamp_ns != 0) {
+        printf(", Time=%lld.%06lld", (long long)(entry->timestamp_ns / 1000000000),
+               (long long)(entry->timestamp_ns % 1000000000 / 1000));
+    }
+    printf("%s\n", entry->unfinished ? " (unfinished)" : "");
+}
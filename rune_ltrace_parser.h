@@ -1,28 +1,153 @@
 #ifndef RUNE_LTRACE_PARSER_H
 #define RUNE_LTRACE_PARSER_H
 
+#include <stdint.h>
 #include <stdio.h>
+#include "rune_strview.h"
+#include "rune_stitch.h"
 
-// Structure to hold parsed ltrace entry data
+// Structure to hold parsed ltrace entry data. The views point into the
+// buffer the entry was parsed from and are only valid as long as it is.
 typedef struct {
     long pid;
-    char function_name[128]; // Max length for function name
-    char args[512];          // Arguments as a raw string
-    long return_value;
+    rune_strview_t function_name;
+    rune_strview_t args;     // Arguments as raw text
+    long return_value;       // 0 when the function returns void or a non-numeric value; pointers are parsed from hex
+    int64_t timestamp_ns;    // Wall clock time of the call (ltrace -ttt), 0 if the trace has none
+    int unfinished;          // The call never returned before the trace ended
 } ltrace_entry_t;
 
 /**
- * @brief Parses an ltrace log file and prints the extracted information.
+ * @brief Callback invoked for every library call entry produced by a trace source.
  *
- * This function reads the specified ltrace log file line by line,
- * attempts to parse each line into an ltrace_entry_t structure,
- * and prints the parsed details.
- * In future iterations, this function will store the parsed data
- * in a more robust data structure for further analysis.
+ * @param entry The entry. It is only valid for the duration of the call.
+ * @param user_data The opaque pointer given to the trace source.
+ */
+typedef void (*rune_ltrace_entry_cb)(const ltrace_entry_t *entry, void *user_data);
+
+/**
+ * @brief Callback for an entry a parallel parse delivers after the rest of its chunk.
+ *
+ * @param entry The entry. It is only valid for the duration of the call.
+ * @param position How many of the entries the chunk delivered to on_entry precede it in the log.
+ * @param user_data The chunk's opaque pointer.
+ */
+typedef void (*rune_ltrace_late_entry_cb)(const ltrace_entry_t *entry, size_t position, void *user_data);
+
+// A resumed half kept back by a chunk parser, or the first unfinished half of a pid in the chunk
+typedef struct {
+    ltrace_entry_t entry;
+    size_t position;         // Entries the chunk delivered before it
+    int replaces;            // The unfinished half: a call pending from earlier chunks never resumed
+} rune_ltrace_orphan_t;
+
+// Line-by-line parsing state: joins unfinished/resumed halves before delivering entries
+typedef struct {
+    rune_ltrace_entry_cb on_entry;
+    void *user_data;
+    rune_stitcher_t stitcher;
+    size_t delivered;        // Entries passed to on_entry so far
+    int defer_orphans;       // Keep resumed halves whose first half may be in an earlier chunk
+    rune_stitcher_t held;    // With defer_orphans, the pids that logged an unfinished half
+    rune_ltrace_orphan_t *orphans; // Those halves, in log order; their views must outlive the parser
+    size_t orphan_count;
+    size_t orphan_capacity;
+} rune_ltrace_parser_t;
+
+/**
+ * @brief Parses a single line of ltrace output.
+ *
+ * For an unfinished line, entry->args holds the arguments logged so far;
+ * for a resumed line, the arguments logged after "resumed>".
+ *
+ * @param line The line. It does not need to be NUL-terminated.
+ * @param len The length of the line, with or without its trailing newline.
+ * @param entry Receives the parsed entry, whose views point into line.
+ * @return The kind of line, or RUNE_LINE_INVALID if it is not a library call record.
+ */
+rune_line_kind_t rune_ltrace_parser_parse_line(const char *line, size_t len, ltrace_entry_t *entry);
+
+/**
+ * @brief Prepares a parser that turns lines into complete entries.
+ *
+ * @param parser The parser to initialize.
+ * @param on_entry Callback invoked for every complete entry.
+ * @param user_data Opaque pointer passed to on_entry.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_ltrace_parser_init(rune_ltrace_parser_t *parser, rune_ltrace_entry_cb on_entry, void *user_data);
+
+/**
+ * @brief Parses one line and delivers the entry it completes, if any.
+ *
+ * An unfinished half that replaces a call still pending for the same pid
+ * first delivers that call as an unfinished entry.
+ *
+ * @param parser The parser.
+ * @param line The line. It does not need to be NUL-terminated.
+ * @param len The length of the line.
+ */
+void rune_ltrace_parser_feed_line(rune_ltrace_parser_t *parser, const char *line, size_t len);
+
+/**
+ * @brief Delivers calls that never resumed as unfinished entries and frees the parser.
+ *
+ * @param parser The parser.
+ */
+void rune_ltrace_parser_finish(rune_ltrace_parser_t *parser);
+
+/**
+ * @brief Parses every line of an in-memory ltrace log.
+ *
+ * @param data The log contents.
+ * @param len The length of data in bytes.
+ * @param on_entry Callback invoked for every parsed entry.
+ * @param user_data Opaque pointer passed to on_entry.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_ltrace_parser_parse_buffer(const char *data, size_t len, rune_ltrace_entry_cb on_entry, void *user_data);
+
+/**
+ * @brief Parses an ltrace log file.
+ *
+ * The file is memory-mapped and parsed in place, so entries passed to the
+ * callback point directly into the mapping.
  *
  * @param file_path The path to the ltrace log file.
+ * @param on_entry Callback invoked for every parsed entry.
+ * @param user_data Opaque pointer passed to on_entry.
  * @return 0 on success, -1 on failure (e.g., file not found).
  */
-int rune_ltrace_parser_parse_file(const char *file_path);
+int rune_ltrace_parser_parse_file(const char *file_path, rune_ltrace_entry_cb on_entry, void *user_data);
+
+/**
+ * @brief Parses an ltrace log file on several threads.
+ *
+ * Works like rune_strace_parser_parse_file_parallel: entries of chunk i are
+ * delivered with chunk_user_data[i], and calls split across chunks or left
+ * unfinished are passed to on_late with their place in the chunk once all
+ * workers are done.
+ *
+ * @param file_path The path to the ltrace log file.
+ * @param num_threads The number of worker threads, or 0 for one per CPU.
+ * @param num_chunks The number of chunks, and of entries in chunk_user_data.
+ * @param on_entry Callback invoked for every entry parsed by a worker.
+ * @param on_late Callback invoked for every entry completed after the workers.
+ * @param chunk_user_data Opaque pointers passed to both callbacks, one per chunk.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_ltrace_parser_parse_file_parallel(const char *file_path, int num_threads, size_t num_chunks,
+                                           rune_ltrace_entry_cb on_entry, rune_ltrace_late_entry_cb on_late,
+                                           void *const chunk_user_data[]);
+
+/**
+ * @brief Prints a single ltrace entry in runescope's "Parsed Ltrace:" format.
+ *
+ * Matches rune_ltrace_entry_cb so it can be handed to any trace source.
+ *
+ * @param entry The entry to print.
+ * @param user_data Unused.
+ */
+void rune_ltrace_parser_print_entry(const ltrace_entry_t *entry, void *user_data);
 
 #endif // RUNE_LTRACE_PARSER_H
@@ -0,0 +1,659 @@
+#define _GNU_SOURCE // For pipe2, vmsplice, splice, ppoll, memrchr and F_SETPIPE_SZ
+#include "rune_pipe.h"
+#include "rune_latency.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#define PIPE_BYTES (1024 * 1024)            // Asked for both pipes; unprivileged users may get less
+#define GENERATED_BYTES (4 * 1024 * 1024)   // Generated input, repeated as needed
+#define GENERATED_LINE_MAX 512
+#define RATE_BURST (64 * 1024)              // With a rate, input is let through in steps of this size
+#define PAGE_BYTES 4096                     // A pipe counts as full when less than a page is left
+#define LABEL_MAX 72
+#define MB (1024.0 * 1024.0)
+#define STOPS_SCALING 0.75 // A step whose marginal throughput falls below this share of the best is not linear
+
+// The bytes fed to the target, repeated as needed
+typedef struct {
+    char *data;       // Mapped input file or generated lines
+    size_t length;
+    size_t mapped;    // Bytes to unmap
+    uint64_t lines;   // Line breaks in data
+} pipe_input_t;
+
+// What one run measured
+typedef struct {
+    uint64_t size;            // Bytes offered: the requested size, cut at a line break
+    uint64_t lines;           // Line breaks in them, or in the part the target took
+    uint64_t fed;             // Bytes the target took
+    uint64_t drained;         // Bytes of output
+    int64_t wall_ns;          // From fork to exit
+    int64_t first_byte_ns;    // From fork to the first byte of output, -1 if there was none
+    uint64_t input_full;      // Times the input pipe filled up
+    int64_t input_full_ns;    // Time it stayed full
+    uint64_t output_full;     // Times the output pipe was found full when drained
+    int64_t user_ns;
+    int64_t sys_ns;
+    int exit_status;          // Exit code, or -1 if the target was killed by a signal
+    int closed_early;         // The target closed its stdin before taking all input
+} pipe_run_t;
+
+// Where feeding stands in a run
+typedef struct {
+    const pipe_input_t *input;
+    int fd;
+    size_t offset;            // Position in the input
+    uint64_t remaining;       // Bytes still to feed
+    uint64_t fed;
+    int use_vmsplice;         // Cleared if the kernel refuses vmsplice on the pipe
+} pipe_feeder_t;
+
+enum {
+    FEED_FULL,    // The pipe took all it could
+    FEED_PAUSED,  // Everything was fed, or everything the rate allows
+    FEED_CLOSED   // The target closed its stdin
+};
+
+static int64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int64_t timeval_ns(const struct timeval *tv) {
+    return (int64_t)tv->tv_sec * 1000000000 + (int64_t)tv->tv_usec * 1000;
+}
+
+int64_t rune_pipe_parse_size(const char *text) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0.0) {
+        return -1;
+    }
+    double scale = 1.0;
+    switch (*end) {
+    case 'k': case 'K': scale = 1024.0; end++; break;
+    case 'm': case 'M': scale = MB; end++; break;
+    case 'g': case 'G': scale = MB * 1024.0; end++; break;
+    default: break;
+    }
+    if (*end == 'B' || *end == 'b') {
+        end++;
+    }
+    if (*end != '\0' || value * scale >= 9.0e18) {
+        return -1;
+    }
+    return (int64_t)(value * scale);
+}
+
+static const char *format_count(double count, char *buf, size_t size) {
+    if (count >= 1e6) {
+        snprintf(buf, size, "%.2fM", count / 1e6);
+    } else if (count >= 1e4) {
+        snprintf(buf, size, "%.1fk", count / 1e3);
+    } else {
+        snprintf(buf, size, "%.0f", count);
+    }
+    return buf;
+}
+
+static void format_command(char *const argv[], char *buf, size_t size) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (size_t i = 0; argv[i] != NULL && used + 1 < size; i++) {
+        int n = snprintf(buf + used, size - used, "%s%s", i > 0 ? " " : "", argv[i]);
+        if (n < 0) {
+            break;
+        }
+        used += (size_t)n;
+    }
+    if (used >= size && size > 4) {
+        snprintf(buf + size - 4, 4, "...");
+    }
+}
+
+static uint64_t count_lines(const char *data, size_t length) {
+    uint64_t lines = 0;
+    const char *end = data + length;
+    for (const char *p = data; (p = memchr(p, '\n', (size_t)(end - p))) != NULL; p++) {
+        lines++;
+    }
+    return lines;
+}
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Log-like text lines of 40 to 400 bytes, the same on every run
+static int generate_input(pipe_input_t *input) {
+    static const char *const levels[] = { "DEBUG", "INFO", "INFO", "INFO", "INFO", "WARN", "ERROR" };
+    static const char *const keys[] = { "user", "session", "path", "status", "bytes", "upstream", "cache", "retry" };
+    static const char *const values[] = { "alice", "bob", "/api/v1/items", "/static/app.js", "200", "404", "503",
+                                          "hit", "miss", "eu-west-1", "us-east-2", "0", "3" };
+    char *data = mmap(NULL, GENERATED_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        perror("runescope: mmap failed for generated input");
+        return -1;
+    }
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    size_t used = 0;
+    uint64_t lines = 0;
+    while (used + GENERATED_LINE_MAX <= GENERATED_BYTES) {
+        uint64_t r = next_random(&state);
+        // Mostly short lines with a long tail, as in real logs
+        size_t target = 40 + (r % 8 == 0 ? next_random(&state) % 360 : next_random(&state) % 100);
+        size_t start = used;
+        used += (size_t)snprintf(data + used, GENERATED_LINE_MAX, "2024-05-%02u %02u:%02u:%02u.%03u %-5s worker-%u",
+                                 (unsigned)(lines / 86400 % 28 + 1), (unsigned)(lines / 3600 % 24),
+                                 (unsigned)(lines / 60 % 60), (unsigned)(lines % 60), (unsigned)(r >> 20) % 1000,
+                                 levels[(r >> 8) % (sizeof(levels) / sizeof(levels[0]))], (unsigned)(r >> 40) % 32);
+        while (used - start < target) {
+            r = next_random(&state);
+            used += (size_t)snprintf(data + used, GENERATED_LINE_MAX - (used - start) - 1, " %s=%s",
+                                     keys[r % (sizeof(keys) / sizeof(keys[0]))],
+                                     values[(r >> 16) % (sizeof(values) / sizeof(values[0]))]);
+        }
+        data[used++] = '\n';
+        lines++;
+    }
+    input->data = data;
+    input->length = used;
+    input->mapped = GENERATED_BYTES;
+    input->lines = lines;
+    return 0;
+}
+
+static int map_input(const char *path, pipe_input_t *input) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        perror("runescope: Failed to open pipe input");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        fprintf(stderr, "runescope: Error: Pipe input '%s' must be a non-empty regular file.\n", path);
+        close(fd);
+        return -1;
+    }
+    char *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("runescope: mmap failed for pipe input");
+        return -1;
+    }
+    input->data = data;
+    input->length = (size_t)st.st_size;
+    input->mapped = input->length;
+    input->lines = count_lines(data, input->length); // Also reads the file into the page cache before any run
+    return 0;
+}
+
+// Cuts a requested size at the last line break within it; returns the bytes and sets their line count
+static uint64_t cut_size(const pipe_input_t *input, int64_t requested, uint64_t *lines) {
+    if (requested <= 0) {
+        *lines = input->lines;
+        return input->length;
+    }
+    uint64_t cycles = (uint64_t)requested / input->length;
+    size_t rest = (size_t)((uint64_t)requested % input->length);
+    const char *last = rest > 0 ? memrchr(input->data, '\n', rest) : NULL;
+    if (last != NULL) {
+        rest = (size_t)(last - input->data) + 1;
+    } else if (cycles > 0) {
+        rest = 0;
+    }
+    *lines = cycles * input->lines + count_lines(input->data, rest);
+    return cycles * input->length + rest;
+}
+
+// Asks for a bigger pipe so that every wakeup moves more data; returns the size granted
+static int grow_pipe(int fd) {
+    fcntl(fd, F_SETPIPE_SZ, PIPE_BYTES); // Fails above /proc/sys/fs/pipe-max-size; the default is kept then
+    int size = fcntl(fd, F_GETPIPE_SZ);
+    return size > 0 ? size : 65536;
+}
+
+// Bytes the rate lets through now; when it lets nothing through, *wait_ns is the time until the next step
+static uint64_t rate_allowance(double rate_mb, int64_t elapsed_ns, const pipe_feeder_t *feeder, int64_t *wait_ns) {
+    if (rate_mb <= 0.0) {
+        return feeder->remaining;
+    }
+    double per_ns = rate_mb * MB / 1e9;
+    double allowed = RATE_BURST + per_ns * (double)elapsed_ns - (double)feeder->fed;
+    double step = feeder->remaining < RATE_BURST ? (double)feeder->remaining : RATE_BURST;
+    if (allowed >= step) {
+        return (uint64_t)allowed;
+    }
+    *wait_ns = (int64_t)ceil((step - allowed) / per_ns);
+    return 0;
+}
+
+// Hands the pipe as much input as it takes and the rate allows, without copying it
+static int feed_input(pipe_feeder_t *feeder, uint64_t allowed) {
+    const pipe_input_t *input = feeder->input;
+    while (feeder->remaining > 0 && allowed > 0) {
+        size_t length = input->length - feeder->offset;
+        if (length > feeder->remaining) {
+            length = (size_t)feeder->remaining;
+        }
+        if (length > allowed) {
+            length = (size_t)allowed;
+        }
+        ssize_t n;
+        if (feeder->use_vmsplice) {
+            struct iovec iov = { input->data + feeder->offset, length };
+            n = vmsplice(feeder->fd, &iov, 1, SPLICE_F_NONBLOCK);
+            if (n == -1 && (errno == EINVAL || errno == ENOSYS)) {
+                feeder->use_vmsplice = 0;
+                continue;
+            }
+        } else {
+            n = write(feeder->fd, input->data + feeder->offset, length);
+        }
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return FEED_FULL;
+            }
+            if (errno != EPIPE) {
+                perror("runescope: feeding the target's stdin failed");
+            }
+            return FEED_CLOSED;
+        }
+        feeder->offset += (size_t)n;
+        if (feeder->offset == input->length) {
+            feeder->offset = 0;
+        }
+        feeder->remaining -= (uint64_t)n;
+        feeder->fed += (uint64_t)n;
+        allowed -= (uint64_t)n;
+    }
+    return FEED_PAUSED;
+}
+
+// Moves everything the target has written into the sink; returns 0 at the end of its output
+static int drain_output(int fd, int null_fd, int capacity, int64_t started, char **buffer, pipe_run_t *run) {
+    int available;
+    if (ioctl(fd, FIONREAD, &available) == 0 && available > capacity - PAGE_BYTES) {
+        run->output_full++;
+    }
+    for (;;) {
+        ssize_t n;
+        if (*buffer == NULL) {
+            n = splice(fd, NULL, null_fd, NULL, (size_t)capacity, SPLICE_F_NONBLOCK);
+            if (n == -1 && errno == EINVAL) {
+                // No splice into /dev/null on this kernel: read and throw away instead
+                if ((*buffer = malloc((size_t)capacity)) == NULL) {
+                    perror("runescope: malloc failed for the output buffer");
+                    return 0;
+                }
+                continue;
+            }
+        } else {
+            n = read(fd, *buffer, (size_t)capacity);
+        }
+        if (n > 0) {
+            if (run->drained == 0) {
+                run->first_byte_ns = clock_ns() - started;
+            }
+            run->drained += (uint64_t)n;
+        } else if (n == 0) {
+            return 0;
+        } else if (errno == EAGAIN) {
+            return 1;
+        } else if (errno != EINTR) {
+            perror("runescope: draining the target's stdout failed");
+            return 0;
+        }
+    }
+}
+
+// Runs the target once with its stdin and stdout on pipes to runescope
+static int run_once(const char *executable_path, char *const argv_target[], const pipe_input_t *input,
+                    double rate_mb, pipe_run_t *run) {
+    int in_pipe[2];
+    int out_pipe[2];
+    if (pipe2(in_pipe, O_CLOEXEC) == -1) {
+        perror("runescope: pipe2 failed");
+        return -1;
+    }
+    if (pipe2(out_pipe, O_CLOEXEC) == -1) {
+        perror("runescope: pipe2 failed");
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        return -1;
+    }
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (null_fd == -1) {
+        perror("runescope: Failed to open /dev/null");
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return -1;
+    }
+    grow_pipe(in_pipe[1]);
+    int out_capacity = grow_pipe(out_pipe[0]);
+
+    int64_t started = clock_ns();
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("runescope: fork failed");
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(null_fd);
+        return -1;
+    } else if (pid == 0) {
+        extern char **environ;
+        signal(SIGPIPE, SIG_DFL); // Ignored signals stay ignored across execve
+        if (dup2(in_pipe[0], STDIN_FILENO) == -1 || dup2(out_pipe[1], STDOUT_FILENO) == -1) {
+            perror("runescope: dup2 failed");
+            _exit(EXIT_FAILURE);
+        }
+        execve(executable_path, argv_target, environ);
+        perror("runescope: execve target failed");
+        _exit(EXIT_FAILURE);
+    }
+
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+    int in_fd = in_pipe[1];
+    int out_fd = out_pipe[0];
+    fcntl(in_fd, F_SETFL, O_NONBLOCK);
+    fcntl(out_fd, F_SETFL, O_NONBLOCK);
+
+    pipe_feeder_t feeder = { input, in_fd, 0, run->size, 0, 1 };
+    char *buffer = NULL;
+    int64_t full_since = -1;
+    if (feeder.remaining == 0) {
+        close(in_fd);
+        in_fd = -1;
+    }
+    while (in_fd != -1 || out_fd != -1) {
+        int64_t wait_ns = -1;
+        uint64_t allowed = in_fd != -1 ? rate_allowance(rate_mb, clock_ns() - started, &feeder, &wait_ns) : 0;
+        struct pollfd fds[2];
+        nfds_t nfds = 0;
+        int out_index = -1;
+        int in_index = -1;
+        if (out_fd != -1) {
+            out_index = (int)nfds;
+            fds[nfds++] = (struct pollfd){ out_fd, POLLIN, 0 };
+        }
+        if (allowed > 0) {
+            in_index = (int)nfds;
+            fds[nfds++] = (struct pollfd){ in_fd, POLLOUT, 0 };
+        }
+        struct timespec timeout = { wait_ns / 1000000000, wait_ns % 1000000000 };
+        if (ppoll(fds, nfds, wait_ns >= 0 ? &timeout : NULL, NULL) == -1 && errno != EINTR) {
+            perror("runescope: ppoll failed");
+            break;
+        }
+
+        if (in_index >= 0 && fds[in_index].revents != 0) {
+            uint64_t before = feeder.fed;
+            int state = feed_input(&feeder, allowed);
+            int64_t now = clock_ns();
+            if (feeder.fed > before && full_since >= 0) {
+                run->input_full_ns += now - full_since;
+                full_since = -1;
+            }
+            if (state == FEED_FULL && full_since < 0) {
+                full_since = now;
+                run->input_full++;
+            }
+            if (state == FEED_CLOSED || feeder.remaining == 0) {
+                if (full_since >= 0) {
+                    run->input_full_ns += now - full_since;
+                    full_since = -1;
+                }
+                run->closed_early = feeder.remaining > 0;
+                close(in_fd); // The target sees the end of its input
+                in_fd = -1;
+            }
+        }
+        if (out_index >= 0 && fds[out_index].revents != 0 &&
+            drain_output(out_fd, null_fd, out_capacity, started, &buffer, run) == 0) {
+            close(out_fd);
+            out_fd = -1;
+        }
+    }
+    if (in_fd != -1) {
+        close(in_fd);
+    }
+    if (out_fd != -1) {
+        close(out_fd);
+    }
+    close(null_fd);
+    free(buffer);
+    run->fed = feeder.fed;
+    if (run->closed_early) {
+        run->lines = feeder.fed / input->length * input->lines + count_lines(input->data, feeder.offset);
+    }
+
+    int status;
+    struct rusage ru;
+    while (wait4(pid, &status, 0, &ru) == -1) {
+        if (errno != EINTR) {
+            perror("runescope: wait4 failed");
+            return -1;
+        }
+    }
+    run->wall_ns = clock_ns() - started;
+    run->user_ns = timeval_ns(&ru.ru_utime);
+    run->sys_ns = timeval_ns(&ru.ru_stime);
+    run->exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return 0;
+}
+
+static double per_second(double amount, int64_t ns) {
+    return ns > 0 ? amount * 1e9 / (double)ns : 0.0;
+}
+
+static void print_warnings(const pipe_run_t *run, FILE *out) {
+    char fed[32];
+    char size[32];
+    if (run->closed_early) {
+        fprintf(out, "Warning: The target closed its stdin after %s of %s.\n",
+                rune_latency_format_bytes(run->fed, fed, sizeof(fed)), rune_latency_format_bytes(run->size, size, sizeof(size)));
+    }
+    if (run->exit_status != 0) {
+        fprintf(out, "Warning: The target exited with status %d%s.\n", run->exit_status,
+                run->exit_status == -1 ? " (killed by a signal)" : "");
+    }
+}
+
+static void print_run(const pipe_run_t *run, const char *label, const char *source, double rate_mb,
+                      FILE *out) {
+    char cells[4][32];
+    fprintf(out, "\n--- Pipe throughput: %s ---\n", label);
+    fprintf(out, "Input: %s in %llu lines of %s, ", rune_latency_format_bytes(run->fed, cells[0], sizeof(cells[0])),
+            (unsigned long long)run->lines, source);
+    if (rate_mb > 0.0) {
+        fprintf(out, "fed at up to %.1f MB/s\n", rate_mb);
+    } else {
+        fprintf(out, "fed as fast as the target reads\n");
+    }
+    fprintf(out, "  %-20s %s\n", "wall time", rune_latency_format(run->wall_ns, cells[0], sizeof(cells[0])));
+    fprintf(out, "  %-20s %.1f MB/s, %s lines/s\n", "input", per_second((double)run->fed / MB, run->wall_ns),
+            format_count(per_second((double)run->lines, run->wall_ns), cells[0], sizeof(cells[0])));
+    fprintf(out, "  %-20s %s at %.1f MB/s\n", "output", rune_latency_format_bytes(run->drained, cells[0], sizeof(cells[0])),
+            per_second((double)run->drained / MB, run->wall_ns));
+    fprintf(out, "  %-20s %s\n", "first output byte",
+            run->first_byte_ns >= 0 ? rune_latency_format(run->first_byte_ns, cells[0], sizeof(cells[0])) : "none");
+
+    double full_share = run->wall_ns > 0 ? 100.0 * (double)run->input_full_ns / (double)run->wall_ns : 0.0;
+    fprintf(out, "  %-20s %.1f%% of the run (%llu times, %s)", "input pipe full", full_share,
+            (unsigned long long)run->input_full, rune_latency_format(run->input_full_ns, cells[0], sizeof(cells[0])));
+    if (full_share >= 50.0) {
+        fprintf(out, ": %s\n", rate_mb > 0.0 ? "the target cannot keep up with the rate" : "the target reads slower than it is fed");
+    } else {
+        fprintf(out, "\n");
+    }
+    fprintf(out, "  %-20s %llu times when drained\n", "output pipe full", (unsigned long long)run->output_full);
+    fprintf(out, "  %-20s user %s, sys %s\n", "CPU", rune_latency_format(run->user_ns, cells[0], sizeof(cells[0])),
+            rune_latency_format(run->sys_ns, cells[1], sizeof(cells[1])));
+    print_warnings(run, out);
+}
+
+static void print_sweep(const pipe_run_t *runs, size_t count, const char *label, const char *source, double rate_mb,
+                        FILE *out) {
+    char cells[6][32];
+    fprintf(out, "\n--- Pipe throughput sweep: %s (%s, ", label, source);
+    if (rate_mb > 0.0) {
+        fprintf(out, "fed at up to %.1f MB/s) ---\n", rate_mb);
+    } else {
+        fprintf(out, "fed as fast as the target reads) ---\n");
+    }
+    fprintf(out, "%10s %10s %10s %10s %10s %11s %8s %14s\n", "input", "lines", "wall", "MB/s", "lines/s", "first byte",
+            "in full", "marginal MB/s");
+
+    // Marginal throughput between consecutive sizes is free of the fixed startup cost
+    double best = runs[0].wall_ns > 0 ? per_second((double)runs[0].fed / MB, runs[0].wall_ns) : 0.0;
+    size_t knee = 0;
+    double knee_share = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        const pipe_run_t *run = &runs[i];
+        fprintf(out, "%10s %10s %10s %10.1f %10s %11s %7.1f%% ", rune_latency_format_bytes(run->size, cells[0], sizeof(cells[0])),
+                format_count((double)run->lines, cells[1], sizeof(cells[1])),
+                rune_latency_format(run->wall_ns, cells[2], sizeof(cells[2])),
+                per_second((double)run->fed / MB, run->wall_ns),
+                format_count(per_second((double)run->lines, run->wall_ns), cells[3], sizeof(cells[3])),
+                run->first_byte_ns >= 0 ? rune_latency_format(run->first_byte_ns, cells[4], sizeof(cells[4])) : "none",
+                run->wall_ns > 0 ? 100.0 * (double)run->input_full_ns / (double)run->wall_ns : 0.0);
+        if (i == 0 || run->wall_ns <= runs[i - 1].wall_ns || run->fed <= runs[i - 1].fed) {
+            fprintf(out, "%14s\n", "-");
+            continue;
+        }
+        double marginal = per_second((double)(run->fed - runs[i - 1].fed) / MB, run->wall_ns - runs[i - 1].wall_ns);
+        fprintf(out, "%14.1f\n", marginal);
+        if (knee == 0 && best > 0.0 && marginal < STOPS_SCALING * best) {
+            knee = i;
+            knee_share = marginal / best;
+        }
+        if (marginal > best) {
+            best = marginal;
+        }
+    }
+
+    // Least squares fit of wall time against bytes: the intercept is the fixed cost, the slope the steady rate
+    double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double x = (double)runs[i].fed;
+        double y = (double)runs[i].wall_ns;
+        n += 1.0;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double denominator = n * sxx - sx * sx;
+    if (count >= 2 && denominator > 0.0) {
+        double slope = (n * sxy - sx * sy) / denominator;
+        double intercept = (sy - slope * sx) / n;
+        fprintf(out, "Linear fit: %s fixed + %s per MB",
+                rune_latency_format(intercept > 0.0 ? (int64_t)intercept : 0, cells[0], sizeof(cells[0])),
+                rune_latency_format((int64_t)(slope * MB), cells[1], sizeof(cells[1])));
+        if (slope > 0.0) {
+            fprintf(out, " (%.1f MB/s once started)", 1e9 / (slope * MB));
+        }
+        fprintf(out, "\n");
+    }
+    if (knee > 0) {
+        fprintf(out, "Scaling: linear up to %s; from there to %s the marginal throughput falls to %.0f%% of the best before it.\n",
+                rune_latency_format_bytes(runs[knee - 1].size, cells[0], sizeof(cells[0])),
+                rune_latency_format_bytes(runs[knee].size, cells[1], sizeof(cells[1])), 100.0 * knee_share);
+    } else if (count >= 2) {
+        fprintf(out, "Scaling: linear over the whole sweep.\n");
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (runs[i].closed_early || runs[i].exit_status != 0) {
+            fprintf(out, "At %s:\n", rune_latency_format_bytes(runs[i].size, cells[0], sizeof(cells[0])));
+            print_warnings(&runs[i], out);
+        }
+    }
+}
+
+static int compare_sizes(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+int rune_pipe_run(const char *executable_path, char *const argv_target[], const rune_pipe_options_t *options,
+                  FILE *out) {
+    pipe_input_t input;
+    if ((options->input_path != NULL ? map_input(options->input_path, &input) : generate_input(&input)) == -1) {
+        return -1;
+    }
+    size_t count = options->num_sizes;
+    int64_t *sizes = malloc(count * sizeof(*sizes));
+    pipe_run_t *runs = calloc(count, sizeof(*runs));
+    if (sizes == NULL || runs == NULL) {
+        perror("runescope: malloc failed for pipe runs");
+        free(sizes);
+        free(runs);
+        munmap(input.data, input.mapped);
+        return -1;
+    }
+    memcpy(sizes, options->sizes, count * sizeof(*sizes));
+    qsort(sizes, count, sizeof(*sizes), compare_sizes);
+
+    // A target that exits early must not kill runescope while it feeds
+    struct sigaction ignore = { .sa_handler = SIG_IGN };
+    struct sigaction saved;
+    sigaction(SIGPIPE, &ignore, &saved);
+
+    char label[LABEL_MAX];
+    format_command(argv_target, label, sizeof(label));
+    char source[LABEL_MAX + 16];
+    if (options->input_path != NULL) {
+        snprintf(source, sizeof(source), "%.*s", LABEL_MAX, options->input_path);
+    } else {
+        snprintf(source, sizeof(source), "generated text");
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < count && result == 0; i++) {
+        runs[i].size = cut_size(&input, sizes[i], &runs[i].lines);
+        runs[i].first_byte_ns = -1;
+        if (count > 1) {
+            char size[32];
+            fprintf(out, "Feeding %s...\n", rune_latency_format_bytes(runs[i].size, size, sizeof(size)));
+            fflush(out);
+        }
+        result = run_once(executable_path, argv_target, &input, options->rate_mb, &runs[i]);
+    }
+    sigaction(SIGPIPE, &saved, NULL);
+
+    if (result == 0 && count == 1) {
+        print_run(&runs[0], label, source, options->rate_mb, out);
+    } else if (result == 0) {
+        print_sweep(runs, count, label, source, options->rate_mb, out);
+    }
+    free(sizes);
+    free(runs);
+    munmap(input.data, input.mapped);
+    return result;
+}
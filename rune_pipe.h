@@ -0,0 +1,54 @@
+#ifndef RUNE_PIPE_H
+#define RUNE_PIPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Throughput of filter-style targets that read stdin and write stdout.
+ *
+ * The target's stdin and stdout are pipes to runescope. Input, either a
+ * file or generated text lines, is mapped into memory once and handed to
+ * the input pipe with vmsplice, so feeding copies nothing; the output is
+ * spliced into /dev/null, so draining copies nothing either. A single
+ * poll loop feeds and drains without blocking, as fast as the target reads
+ * or at a fixed rate, and measures throughput, the time to the first byte
+ * of output and how long the target kept the input pipe full.
+ */
+
+// How to feed the target
+typedef struct {
+    const char *input_path;  // Feed this file, repeated as needed; NULL for generated text lines
+    double rate_mb;          // Feed at most this many MB a second, 0 = as fast as the target reads
+    const int64_t *sizes;    // Bytes to feed per run, 0 = the input file once; more than one runs a sweep
+    size_t num_sizes;
+} rune_pipe_options_t;
+
+/**
+ * @brief Parses a byte count with an optional K, M or G suffix (powers of 1024).
+ *
+ * @param text The count, such as "4096", "64M" or "1.5G".
+ * @return The number of bytes, or -1 if the text is not a count.
+ */
+int64_t rune_pipe_parse_size(const char *text);
+
+/**
+ * @brief Runs the target once per input size with its stdin and stdout on pipes, and prints its throughput.
+ *
+ * Every run is cut at the last line break within its size, so the target
+ * always sees whole lines. A single run gets a detailed report; a sweep
+ * gets a table with the marginal throughput between consecutive sizes, a
+ * linear fit of wall time against input size, and the first size at which
+ * the target stops scaling linearly.
+ *
+ * @param executable_path The absolute path to the target executable.
+ * @param argv_target The target's arguments, starting with argv[0], NULL-terminated.
+ * @param options The input, rate and sizes.
+ * @param out The stream to print to.
+ * @return 0 on success, -1 if the input could not be prepared or a run could not be started.
+ */
+int rune_pipe_run(const char *executable_path, char *const argv_target[], const rune_pipe_options_t *options,
+                  FILE *out);
+
+#endif // RUNE_PIPE_H
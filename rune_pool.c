@@ -0,0 +1,73 @@
+#define _POSIX_C_SOURCE 200809L // For sysconf
+#include "rune_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct {
+    atomic_size_t next_task;
+    size_t num_tasks;
+    rune_pool_task_fn task;
+    void *arg;
+} pool_t;
+
+static void *pool_worker(void *arg) {
+    pool_t *pool = arg;
+    for (;;) {
+        size_t index = atomic_fetch_add(&pool->next_task, 1);
+        if (index >= pool->num_tasks) {
+            return NULL;
+        }
+        pool->task(index, pool->arg);
+    }
+}
+
+int rune_pool_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+int rune_pool_run(size_t num_tasks, int num_threads, rune_pool_task_fn task, void *arg) {
+    pool_t pool;
+    atomic_init(&pool.next_task, 0);
+    pool.num_tasks = num_tasks;
+    pool.task = task;
+    pool.arg = arg;
+
+    if (num_threads <= 0) {
+        num_threads = rune_pool_cpu_count();
+    }
+    if ((size_t)num_threads > num_tasks) {
+        num_threads = (int)num_tasks;
+    }
+    if (num_threads <= 1) {
+        pool_worker(&pool);
+        return 0;
+    }
+
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (threads == NULL) {
+        perror("runescope: malloc failed for worker threads");
+        return -1;
+    }
+    int started = 0;
+    for (int i = 0; i < num_threads; i++) {
+        int err = pthread_create(&threads[i], NULL, pool_worker, &pool);
+        if (err != 0) {
+            fprintf(stderr, "runescope: pthread_create failed: %s\n", strerror(err));
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        pool_worker(&pool); // Fall back to doing the work here
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    return 0;
+}
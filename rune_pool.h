@@ -0,0 +1,32 @@
+#ifndef RUNE_POOL_H
+#define RUNE_POOL_H
+
+#include <stddef.h>
+
+/**
+ * @brief A minimal worker pool for data-parallel work.
+ *
+ * Runs a fixed number of independent tasks on a set of threads that pull the
+ * next task index from a shared counter, so uneven tasks balance out.
+ */
+
+typedef void (*rune_pool_task_fn)(size_t index, void *arg);
+
+/**
+ * @brief Returns the number of online CPUs (at least 1).
+ */
+int rune_pool_cpu_count(void);
+
+/**
+ * @brief Runs task(0) .. task(num_tasks - 1) and waits for all of them.
+ *
+ * @param num_tasks The number of tasks.
+ * @param num_threads The number of worker threads, or 0 for one per CPU.
+ *                    With a single thread the tasks run on the calling thread.
+ * @param task The function to run for every task index.
+ * @param arg Opaque pointer passed to task.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_pool_run(size_t num_tasks, int num_threads, rune_pool_task_fn task, void *arg);
+
+#endif // RUNE_POOL_H
@@ -0,0 +1,331 @@
+#define _GNU_SOURCE // For mkostemp
+#include "rune_preload.h"
+#include "rune_preload_ring.h"
+#include "rune_histogram.h"
+#include "rune_latency.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LIBRARY_NAME "librunescope_preload.so"
+#define LIBRARY_ENV "RUNESCOPE_PRELOAD_LIB"
+#define IDLE_SLEEP_NS 200000       // Between passes that found every ring empty
+#define REAP_INTERVAL_NS 10000000  // Between checks for rings of threads that are gone
+#define MAX_PROCESSES 1024         // Distinct pids counted for the summary
+#define TRIMMED_PERCENTILE 99
+
+static const char *const function_names[RUNE_PRELOAD_NUM_FUNCTIONS] = {
+    [RUNE_PRELOAD_MALLOC] = "malloc",
+    [RUNE_PRELOAD_CALLOC] = "calloc",
+    [RUNE_PRELOAD_REALLOC] = "realloc",
+    [RUNE_PRELOAD_FREE] = "free",
+    [RUNE_PRELOAD_POSIX_MEMALIGN] = "posix_memalign",
+    [RUNE_PRELOAD_ALIGNED_ALLOC] = "aligned_alloc",
+    [RUNE_PRELOAD_MEMALIGN] = "memalign",
+    [RUNE_PRELOAD_MEMCPY] = "memcpy",
+    [RUNE_PRELOAD_MEMMOVE] = "memmove",
+    [RUNE_PRELOAD_MEMSET] = "memset",
+    [RUNE_PRELOAD_MEMCMP] = "memcmp",
+    [RUNE_PRELOAD_STRLEN] = "strlen",
+    [RUNE_PRELOAD_STRCMP] = "strcmp",
+    [RUNE_PRELOAD_STRNCMP] = "strncmp",
+    [RUNE_PRELOAD_STRCPY] = "strcpy",
+    [RUNE_PRELOAD_STRNCPY] = "strncpy",
+    [RUNE_PRELOAD_STRCAT] = "strcat",
+    [RUNE_PRELOAD_STRCHR] = "strchr",
+    [RUNE_PRELOAD_STRSTR] = "strstr",
+    [RUNE_PRELOAD_STRDUP] = "strdup",
+    [RUNE_PRELOAD_FOPEN] = "fopen",
+    [RUNE_PRELOAD_FCLOSE] = "fclose",
+    [RUNE_PRELOAD_FREAD] = "fread",
+    [RUNE_PRELOAD_FWRITE] = "fwrite",
+    [RUNE_PRELOAD_FGETS] = "fgets",
+    [RUNE_PRELOAD_FPUTS] = "fputs",
+    [RUNE_PRELOAD_PUTS] = "puts",
+    [RUNE_PRELOAD_FFLUSH] = "fflush",
+    [RUNE_PRELOAD_PRINTF] = "printf",
+    [RUNE_PRELOAD_FPRINTF] = "fprintf",
+};
+
+// Whether the bytes column means anything for a function
+static const unsigned char has_bytes[RUNE_PRELOAD_NUM_FUNCTIONS] = {
+    [RUNE_PRELOAD_MALLOC] = 1, [RUNE_PRELOAD_CALLOC] = 1, [RUNE_PRELOAD_REALLOC] = 1,
+    [RUNE_PRELOAD_POSIX_MEMALIGN] = 1, [RUNE_PRELOAD_ALIGNED_ALLOC] = 1, [RUNE_PRELOAD_MEMALIGN] = 1,
+    [RUNE_PRELOAD_MEMCPY] = 1, [RUNE_PRELOAD_MEMMOVE] = 1, [RUNE_PRELOAD_MEMSET] = 1, [RUNE_PRELOAD_MEMCMP] = 1,
+    [RUNE_PRELOAD_STRLEN] = 1, [RUNE_PRELOAD_STRCPY] = 1, [RUNE_PRELOAD_STRNCPY] = 1, [RUNE_PRELOAD_STRDUP] = 1,
+    [RUNE_PRELOAD_FREAD] = 1, [RUNE_PRELOAD_FWRITE] = 1, [RUNE_PRELOAD_FGETS] = 1, [RUNE_PRELOAD_FPUTS] = 1,
+    [RUNE_PRELOAD_PUTS] = 1, [RUNE_PRELOAD_PRINTF] = 1, [RUNE_PRELOAD_FPRINTF] = 1,
+};
+
+typedef struct {
+    uint64_t calls;
+    uint64_t bytes;
+    rune_histogram_t durations; // Of the timed calls only
+} function_stats_t;
+
+struct rune_preload {
+    char region_path[64];
+    rune_preload_region_t *region;
+    pthread_t thread;
+    atomic_int stop;
+    function_stats_t functions[RUNE_PRELOAD_NUM_FUNCTIONS];
+    int32_t ring_tids[RUNE_PRELOAD_RINGS]; // Thread last seen writing each ring
+    int64_t reaped_at;                     // When the last check for threads that are gone ran
+    uint64_t threads;
+    int32_t pids[MAX_PROCESSES];
+    size_t num_pids;
+};
+
+char *rune_preload_find_library(void) {
+    const char *override = getenv(LIBRARY_ENV);
+    if (override != NULL && *override != '\0') {
+        return realpath(override, NULL);
+    }
+    char exe[4096];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0) {
+        return NULL;
+    }
+    exe[len] = '\0';
+    char *slash = strrchr(exe, '/');
+    size_t dir_len = slash != NULL ? (size_t)(slash - exe) : 0;
+    size_t size = dir_len + sizeof(LIBRARY_NAME) + 1;
+    char *path = malloc(size);
+    if (path == NULL) {
+        return NULL;
+    }
+    snprintf(path, size, "%.*s/%s", (int)dir_len, exe, LIBRARY_NAME);
+    if (access(path, R_OK) != 0) {
+        free(path);
+        return NULL;
+    }
+    return path;
+}
+
+// Counts the thread and process behind a ring the first time they show up
+static void note_writer(rune_preload_t *preload, size_t index, const rune_preload_ring_t *ring) {
+    if (preload->ring_tids[index] == ring->tid) {
+        return;
+    }
+    preload->ring_tids[index] = ring->tid;
+    preload->threads++;
+    for (size_t i = 0; i < preload->num_pids; i++) {
+        if (preload->pids[i] == ring->pid) {
+            return;
+        }
+    }
+    if (preload->num_pids < MAX_PROCESSES) {
+        preload->pids[preload->num_pids++] = ring->pid;
+    }
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// A thread that ended without closing its ring: killed with its process, or one of the other threads at exit()
+static int writer_gone(const rune_preload_ring_t *ring) {
+    return syscall(SYS_tgkill, ring->pid, ring->tid, 0) == -1 && errno == ESRCH;
+}
+
+// One pass over every ring; the number of events read
+static uint64_t drain(rune_preload_t *preload) {
+    uint64_t drained = 0;
+    int64_t now = now_ns();
+    int reap = now - preload->reaped_at >= REAP_INTERVAL_NS;
+    if (reap) {
+        preload->reaped_at = now;
+    }
+    for (size_t i = 0; i < RUNE_PRELOAD_RINGS; i++) {
+        rune_preload_ring_t *ring = &preload->region->rings[i];
+        uint32_t state = atomic_load_explicit(&ring->state, memory_order_acquire);
+        if (state == RUNE_PRELOAD_RING_FREE || state == RUNE_PRELOAD_RING_CLAIMED) {
+            continue;
+        }
+        // Checked before reading head: a thread that is gone has written its last event
+        int gone = reap && state == RUNE_PRELOAD_RING_ACTIVE && writer_gone(ring);
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head != tail) {
+            note_writer(preload, i, ring);
+        }
+        for (; tail != head; tail++) {
+            const rune_preload_event_t *event = &ring->events[tail & (RUNE_PRELOAD_RING_EVENTS - 1)];
+            if (event->function >= RUNE_PRELOAD_NUM_FUNCTIONS) {
+                continue;
+            }
+            function_stats_t *stats = &preload->functions[event->function];
+            stats->calls++;
+            stats->bytes += event->bytes;
+            if (event->timed) {
+                rune_histogram_record(&stats->durations, event->duration_ns);
+            }
+            drained++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        // The thread set CLOSED after its last event, so a closed ring that is empty now stays empty
+        if (state == RUNE_PRELOAD_RING_CLOSED || gone) {
+            uint32_t expected = state;
+            atomic_compare_exchange_strong(&ring->state, &expected, RUNE_PRELOAD_RING_FREE);
+        }
+    }
+    return drained;
+}
+
+static void *collect(void *arg) {
+    rune_preload_t *preload = arg;
+    const struct timespec idle = { 0, IDLE_SLEEP_NS };
+    while (!atomic_load(&preload->stop)) {
+        if (drain(preload) == 0) {
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+rune_preload_t *rune_preload_start(void) {
+    rune_preload_t *preload = calloc(1, sizeof(rune_preload_t));
+    if (preload == NULL) {
+        perror("runescope: allocation failed for preload collector");
+        return NULL;
+    }
+    for (size_t f = 0; f < RUNE_PRELOAD_NUM_FUNCTIONS; f++) {
+        rune_histogram_init(&preload->functions[f].durations);
+    }
+    // /dev/shm is memory backed; the file is sparse, so only the rings in use take memory
+    snprintf(preload->region_path, sizeof(preload->region_path), "/dev/shm/runescope_preload_%d_XXXXXX",
+             (int)getpid());
+    int fd = mkostemp(preload->region_path, O_CLOEXEC);
+    if (fd == -1) {
+        snprintf(preload->region_path, sizeof(preload->region_path), "/tmp/runescope_preload_%d_XXXXXX",
+                 (int)getpid());
+        fd = mkostemp(preload->region_path, O_CLOEXEC);
+    }
+    if (fd == -1) {
+        perror("runescope: mkostemp failed for preload region");
+        free(preload);
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(rune_preload_region_t)) == -1) {
+        perror("runescope: ftruncate failed for preload region");
+        close(fd);
+        unlink(preload->region_path);
+        free(preload);
+        return NULL;
+    }
+    preload->region = mmap(NULL, sizeof(rune_preload_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (preload->region == MAP_FAILED) {
+        perror("runescope: mmap failed for preload region");
+        unlink(preload->region_path);
+        free(preload);
+        return NULL;
+    }
+    // The file starts zeroed: every ring is free and empty
+    preload->region->magic = RUNE_PRELOAD_MAGIC;
+    atomic_store(&preload->region->collector_alive, 1);
+    atomic_init(&preload->stop, 0);
+    if (pthread_create(&preload->thread, NULL, collect, preload) != 0) {
+        perror("runescope: pthread_create failed for preload collector");
+        munmap(preload->region, sizeof(rune_preload_region_t));
+        unlink(preload->region_path);
+        free(preload);
+        return NULL;
+    }
+    return preload;
+}
+
+const char *rune_preload_region_path(const rune_preload_t *preload) {
+    return preload->region_path;
+}
+
+// Estimated total time of a function: the mean of its timed calls times all its calls. The slowest
+// timed calls are left out: on a busy CPU, a few calls of a few nanoseconds each get preempted and
+// measure whole milliseconds, which would dominate the mean.
+static double estimated_ns(const function_stats_t *stats) {
+    return rune_histogram_trimmed_mean(&stats->durations, TRIMMED_PERCENTILE) * (double)stats->calls;
+}
+
+static int compare_by_time(const void *a, const void *b, void *arg) {
+    const rune_preload_t *preload = arg;
+    const function_stats_t *fa = &preload->functions[*(const int *)a];
+    const function_stats_t *fb = &preload->functions[*(const int *)b];
+    double ta = estimated_ns(fa), tb = estimated_ns(fb);
+    if (ta != tb) {
+        return ta < tb ? 1 : -1;
+    }
+    return (fa->calls < fb->calls) - (fa->calls > fb->calls);
+}
+
+static void print_summary(const rune_preload_t *preload, FILE *out) {
+    int order[RUNE_PRELOAD_NUM_FUNCTIONS];
+    int n = 0;
+    uint64_t calls = 0;
+    double total_ns = 0.0;
+    for (int f = 0; f < RUNE_PRELOAD_NUM_FUNCTIONS; f++) {
+        if (preload->functions[f].calls > 0) {
+            order[n++] = f;
+            calls += preload->functions[f].calls;
+            total_ns += estimated_ns(&preload->functions[f]);
+        }
+    }
+    qsort_r(order, (size_t)n, sizeof(int), compare_by_time, (void *)preload);
+
+    fprintf(out, "\n--- Preload Summary: %llu calls from %llu threads in %zu processes ---\n",
+            (unsigned long long)calls, (unsigned long long)preload->threads, preload->num_pids);
+    if (n == 0) {
+        fprintf(out, "No interposed calls were recorded. Statically linked targets cannot load the preload\n"
+                     "library, and calls that the compiler inlined never reach it.\n");
+    } else {
+        fprintf(out, "Times are estimated from 1 call in %d per thread, without the slowest %d%% of those.\n",
+                RUNE_PRELOAD_TIMING_PERIOD, 100 - TRIMMED_PERCENTILE);
+        fprintf(out, "%12s %10s %12s %6s %9s %9s %9s  %s\n", "calls", "bytes", "est.time(s)", "time%", "p50", "p99",
+                "max", "function");
+        char bytes[16], p50[16], p99[16], max[16];
+        for (int i = 0; i < n; i++) {
+            const function_stats_t *stats = &preload->functions[order[i]];
+            const rune_histogram_t *h = &stats->durations;
+            double ns = estimated_ns(stats);
+            fprintf(out, "%12llu %10s %12.6f %6.2f %9s %9s %9s  %s\n", (unsigned long long)stats->calls,
+                    has_bytes[order[i]] ? rune_latency_format_bytes(stats->bytes, bytes, sizeof(bytes)) : "-", ns / 1e9,
+                    total_ns > 0 ? 100.0 * ns / total_ns : 0.0,
+                    h->count ? rune_latency_format(rune_histogram_percentile(h, 50), p50, sizeof(p50)) : "-",
+                    h->count ? rune_latency_format(rune_histogram_percentile(h, 99), p99, sizeof(p99)) : "-",
+                    h->count ? rune_latency_format(h->max, max, sizeof(max)) : "-", function_names[order[i]]);
+        }
+    }
+    uint64_t ringless = atomic_load(&preload->region->ringless);
+    uint64_t dropped = atomic_load(&preload->region->dropped);
+    if (ringless > 0) {
+        fprintf(out, "Warning: %llu calls were not recorded: their threads found all %d rings taken, by threads\n"
+                     "alive at the same time or by exited ones whose rings were not freed yet. Those threads\n"
+                     "record nothing for the rest of their life.\n",
+                (unsigned long long)ringless, RUNE_PRELOAD_RINGS);
+    }
+    if (dropped > 0) {
+        fprintf(out, "Warning: %llu calls made after the collector stopped were not recorded.\n",
+                (unsigned long long)dropped);
+    }
+}
+
+int rune_preload_finish(rune_preload_t *preload) {
+    atomic_store(&preload->stop, 1);
+    pthread_join(preload->thread, NULL);
+    // Processes that outlive the target must not wait for a collector that is gone
+    atomic_store(&preload->region->collector_alive, 0);
+    drain(preload);
+    print_summary(preload, stdout);
+    munmap(preload->region, sizeof(rune_preload_region_t));
+    unlink(preload->region_path);
+    free(preload);
+    return 0;
+}
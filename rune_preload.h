@@ -0,0 +1,54 @@
+#ifndef RUNE_PRELOAD_H
+#define RUNE_PRELOAD_H
+
+/**
+ * @brief Library call counts and timings from librunescope_preload.so, without ltrace.
+ *
+ * ltrace stops the target on a breakpoint at every call, which makes
+ * allocation- and string-heavy programs a hundred times slower or more.
+ * Instead, the target is started with librunescope_preload.so in
+ * LD_PRELOAD, whose wrappers write one small event per call into lock-free
+ * per-thread rings in shared memory (see rune_preload_ring.h). A collector
+ * thread in runescope drains the rings while the target runs and adds the
+ * events up per function: calls, bytes, and the time of one call in
+ * RUNE_PRELOAD_TIMING_PERIOD, from which the total time is estimated.
+ */
+
+typedef struct rune_preload rune_preload_t;
+
+/**
+ * @brief Finds librunescope_preload.so.
+ *
+ * Looks at $RUNESCOPE_PRELOAD_LIB, then next to the runescope executable.
+ *
+ * @return The absolute path of the library (to be freed by the caller), or NULL if it is missing.
+ */
+char *rune_preload_find_library(void);
+
+/**
+ * @brief Creates the shared memory region and starts the collector thread.
+ *
+ * @return The new collector, or NULL on failure.
+ */
+rune_preload_t *rune_preload_start(void);
+
+/**
+ * @brief Returns the path of the region, for the RUNESCOPE_PRELOAD_SHM variable of the target.
+ *
+ * @param preload The collector.
+ * @return The path. It stays valid until rune_preload_finish is called.
+ */
+const char *rune_preload_region_path(const rune_preload_t *preload);
+
+/**
+ * @brief Drains the rings, stops the collector thread and prints the per-function summary.
+ *
+ * Must be called once the target and all its processes have exited.
+ * Removes the region and frees the collector.
+ *
+ * @param preload The collector to finish.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_preload_finish(rune_preload_t *preload);
+
+#endif // RUNE_PRELOAD_H
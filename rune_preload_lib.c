@@ -0,0 +1,770 @@
+/**
+ * @brief librunescope_preload.so: counts and times library calls from inside the target.
+ *
+ * Loaded into the target with LD_PRELOAD, it defines malloc, the str and
+ * mem functions and some stdio calls, which the dynamic linker then binds
+ * the program's calls to. Each wrapper calls the real function, found with
+ * dlsym(RTLD_NEXT), and appends a 16-byte event to its thread's ring in the
+ * region shared with runescope (see rune_preload_ring.h). Nothing else is
+ * done on the calling thread: no lock, no system call, no allocation.
+ *
+ * Only calls that go through the PLT are seen. Calls that the compiler
+ * inlined (a memcpy of a constant size, a strlen of a literal) and calls
+ * that glibc makes internally are not.
+ *
+ * Built with -fno-builtin and -fno-tree-loop-distribute-patterns, so that
+ * the compiler turns neither the fallback loops below nor anything else in
+ * this file into calls to the very functions it defines.
+ */
+
+#define _GNU_SOURCE // For RTLD_NEXT
+#include "rune_preload_ring.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TLS_INITIAL_EXEC __attribute__((tls_model("initial-exec"))) // No __tls_get_addr, which may malloc
+#define BOOTSTRAP_SIZE 65536 // Serves dlsym's own allocations while the real malloc is looked up
+#define CALIBRATION_ROUNDS 64
+
+enum { UNRESOLVED, RESOLVING, RESOLVED };
+
+static rune_preload_region_t *region; // NULL when runescope did not pass a region: nothing is recorded
+static pthread_key_t ring_key;
+static int64_t clock_overhead_ns;
+static _Atomic int resolve_state;
+
+static _Thread_local rune_preload_ring_t *tls_ring TLS_INITIAL_EXEC;
+static _Thread_local int tls_ringless TLS_INITIAL_EXEC;   // Every ring was taken, or the thread is exiting
+static _Thread_local int tls_busy TLS_INITIAL_EXEC;       // Inside a wrapper: what the real function calls is not recorded
+static _Thread_local int tls_resolving TLS_INITIAL_EXEC;
+static _Thread_local uint32_t tls_calls TLS_INITIAL_EXEC;
+
+static alignas(16) char bootstrap[BOOTSTRAP_SIZE];
+static _Atomic size_t bootstrap_used;
+
+static struct {
+    void *(*malloc)(size_t);
+    void *(*calloc)(size_t, size_t);
+    void *(*realloc)(void *, size_t);
+    void (*free)(void *);
+    int (*posix_memalign)(void **, size_t, size_t);
+    void *(*aligned_alloc)(size_t, size_t);
+    void *(*memalign)(size_t, size_t);
+    void *(*memcpy)(void *, const void *, size_t);
+    void *(*memmove)(void *, const void *, size_t);
+    void *(*memset)(void *, int, size_t);
+    int (*memcmp)(const void *, const void *, size_t);
+    void *(*memcpy_chk)(void *, const void *, size_t, size_t);
+    void *(*memmove_chk)(void *, const void *, size_t, size_t);
+    void *(*memset_chk)(void *, int, size_t, size_t);
+    size_t (*strlen)(const char *);
+    int (*strcmp)(const char *, const char *);
+    int (*strncmp)(const char *, const char *, size_t);
+    char *(*stpcpy)(char *, const char *);
+    char *(*strncpy)(char *, const char *, size_t);
+    char *(*strcat)(char *, const char *);
+    char *(*strchr)(const char *, int);
+    char *(*strstr)(const char *, const char *);
+    char *(*strdup)(const char *);
+    FILE *(*fopen)(const char *, const char *);
+    int (*fclose)(FILE *);
+    size_t (*fread)(void *, size_t, size_t, FILE *);
+    size_t (*fwrite)(const void *, size_t, size_t, FILE *);
+    char *(*fgets)(char *, int, FILE *);
+    int (*fputs)(const char *, FILE *);
+    int (*puts)(const char *);
+    int (*fflush)(FILE *);
+    int (*vfprintf)(FILE *, const char *, va_list);
+    int (*vfprintf_chk)(FILE *, int, const char *, va_list);
+} real;
+
+// Looks up the next definition of every interposed function, once
+static void resolve(void) {
+    int expected = UNRESOLVED;
+    if (!atomic_compare_exchange_strong(&resolve_state, &expected, RESOLVING)) {
+        // Another thread is resolving: wait for it, unless this thread is the one (dlsym calling malloc)
+        while (!tls_resolving && atomic_load(&resolve_state) != RESOLVED) {
+            sched_yield();
+        }
+        return;
+    }
+    tls_resolving = 1;
+    real.malloc = dlsym(RTLD_NEXT, "malloc");
+    real.calloc = dlsym(RTLD_NEXT, "calloc");
+    real.realloc = dlsym(RTLD_NEXT, "realloc");
+    real.free = dlsym(RTLD_NEXT, "free");
+    real.posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    real.aligned_alloc = dlsym(RTLD_NEXT, "aligned_alloc");
+    real.memalign = dlsym(RTLD_NEXT, "memalign");
+    real.memcpy = dlsym(RTLD_NEXT, "memcpy");
+    real.memmove = dlsym(RTLD_NEXT, "memmove");
+    real.memset = dlsym(RTLD_NEXT, "memset");
+    real.memcmp = dlsym(RTLD_NEXT, "memcmp");
+    real.memcpy_chk = dlsym(RTLD_NEXT, "__memcpy_chk");
+    real.memmove_chk = dlsym(RTLD_NEXT, "__memmove_chk");
+    real.memset_chk = dlsym(RTLD_NEXT, "__memset_chk");
+    real.strlen = dlsym(RTLD_NEXT, "strlen");
+    real.strcmp = dlsym(RTLD_NEXT, "strcmp");
+    real.strncmp = dlsym(RTLD_NEXT, "strncmp");
+    real.stpcpy = dlsym(RTLD_NEXT, "stpcpy");
+    real.strncpy = dlsym(RTLD_NEXT, "strncpy");
+    real.strcat = dlsym(RTLD_NEXT, "strcat");
+    real.strchr = dlsym(RTLD_NEXT, "strchr");
+    real.strstr = dlsym(RTLD_NEXT, "strstr");
+    real.strdup = dlsym(RTLD_NEXT, "strdup");
+    real.fopen = dlsym(RTLD_NEXT, "fopen");
+    real.fclose = dlsym(RTLD_NEXT, "fclose");
+    real.fread = dlsym(RTLD_NEXT, "fread");
+    real.fwrite = dlsym(RTLD_NEXT, "fwrite");
+    real.fgets = dlsym(RTLD_NEXT, "fgets");
+    real.fputs = dlsym(RTLD_NEXT, "fputs");
+    real.puts = dlsym(RTLD_NEXT, "puts");
+    real.fflush = dlsym(RTLD_NEXT, "fflush");
+    real.vfprintf = dlsym(RTLD_NEXT, "vfprintf");
+    real.vfprintf_chk = dlsym(RTLD_NEXT, "__vfprintf_chk");
+    tls_resolving = 0;
+    atomic_store(&resolve_state, RESOLVED);
+}
+
+// 0 while this thread is still resolving, and the wrapper has to make do without the real function
+static inline int ready(void) {
+    if (atomic_load_explicit(&resolve_state, memory_order_acquire) == RESOLVED) {
+        return 1;
+    }
+    resolve();
+    return atomic_load(&resolve_state) == RESOLVED;
+}
+
+static void *bootstrap_alloc(size_t size) {
+    size_t need = 16 + ((size + 15) & ~(size_t)15);
+    size_t offset = atomic_fetch_add(&bootstrap_used, need);
+    if (offset + need > BOOTSTRAP_SIZE) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    *(size_t *)(bootstrap + offset) = size; // For realloc
+    return bootstrap + offset + 16;
+}
+
+static int is_bootstrap(const void *ptr) {
+    return (const char *)ptr >= bootstrap && (const char *)ptr < bootstrap + BOOTSTRAP_SIZE;
+}
+
+// Plain versions for the short time before the real functions are known
+
+static void *fallback_memmove(void *dest, const void *src, size_t n) {
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+    if (d < s) {
+        for (size_t i = 0; i < n; i++) {
+            d[i] = s[i];
+        }
+    } else {
+        for (size_t i = n; i > 0; i--) {
+            d[i - 1] = s[i - 1];
+        }
+    }
+    return dest;
+}
+
+static void *fallback_memset(void *dest, int c, size_t n) {
+    unsigned char *d = dest;
+    for (size_t i = 0; i < n; i++) {
+        d[i] = (unsigned char)c;
+    }
+    return dest;
+}
+
+static int fallback_strncmp(const char *a, const char *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char ca = (unsigned char)a[i], cb = (unsigned char)b[i];
+        if (ca != cb || ca == '\0') {
+            return ca - cb;
+        }
+    }
+    return 0;
+}
+
+static int fallback_memcmp(const void *a, const void *b, size_t n) {
+    const unsigned char *pa = a, *pb = b;
+    for (size_t i = 0; i < n; i++) {
+        if (pa[i] != pb[i]) {
+            return pa[i] - pb[i];
+        }
+    }
+    return 0;
+}
+
+static size_t fallback_strlen(const char *s) {
+    size_t n = 0;
+    while (s[n] != '\0') {
+        n++;
+    }
+    return n;
+}
+
+static char *fallback_strchr(const char *s, int c) {
+    for (;; s++) {
+        if (*s == (char)c) {
+            return (char *)s;
+        }
+        if (*s == '\0') {
+            return NULL;
+        }
+    }
+}
+
+static char *fallback_strstr(const char *haystack, const char *needle) {
+    size_t len = fallback_strlen(needle);
+    for (; *haystack != '\0' || len == 0; haystack++) {
+        if (fallback_strncmp(haystack, needle, len) == 0) {
+            return (char *)haystack;
+        }
+        if (*haystack == '\0') {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Marks the ring of an exiting thread closed, so that the collector can hand it to a new thread
+static void release_ring(void *ring) {
+    tls_ring = NULL;
+    tls_ringless = 1; // Later calls of this thread, from other destructors, are only counted
+    atomic_store_explicit(&((rune_preload_ring_t *)ring)->state, RUNE_PRELOAD_RING_CLOSED, memory_order_release);
+}
+
+// The child of a fork must not write into the ring of the thread that forked
+static void reset_after_fork(void) {
+    tls_ring = NULL;
+    tls_ringless = 0;
+}
+
+static rune_preload_ring_t *claim_ring(void) {
+    for (int i = 0; i < RUNE_PRELOAD_RINGS; i++) {
+        rune_preload_ring_t *ring = &region->rings[i];
+        uint32_t expected = RUNE_PRELOAD_RING_FREE;
+        if (atomic_compare_exchange_strong(&ring->state, &expected, RUNE_PRELOAD_RING_CLAIMED)) {
+            // The collector reads pid and tid only once it sees the ring active
+            ring->pid = (int32_t)getpid();
+            ring->tid = (int32_t)syscall(SYS_gettid);
+            atomic_store_explicit(&ring->state, RUNE_PRELOAD_RING_ACTIVE, memory_order_release);
+            pthread_setspecific(ring_key, ring);
+            tls_ring = ring;
+            return ring;
+        }
+    }
+    return NULL;
+}
+
+static void push(const rune_preload_event_t *event) {
+    rune_preload_ring_t *ring = tls_ring;
+    if (ring == NULL && (tls_ringless || (ring = claim_ring()) == NULL)) {
+        tls_ringless = 1;
+        atomic_fetch_add_explicit(&region->ringless, 1, memory_order_relaxed);
+        return;
+    }
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    // A full ring waits for the collector rather than losing calls, unless the collector is gone
+    while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= RUNE_PRELOAD_RING_EVENTS) {
+        if (!atomic_load_explicit(&region->collector_alive, memory_order_relaxed)) {
+            atomic_fetch_add_explicit(&region->dropped, 1, memory_order_relaxed);
+            return;
+        }
+        sched_yield();
+    }
+    ring->events[head & (RUNE_PRELOAD_RING_EVENTS - 1)] = *event;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Starts recording a call: its start time, 0 if it is not timed, or -1 if it is not recorded at all
+static inline int64_t enter(void) {
+    if (region == NULL || tls_busy) {
+        return -1;
+    }
+    tls_busy = 1;
+    return ++tls_calls % RUNE_PRELOAD_TIMING_PERIOD == 0 ? now_ns() : 0;
+}
+
+static inline void leave(rune_preload_function_t function, uint64_t bytes, int64_t start) {
+    if (start < 0) {
+        return;
+    }
+    rune_preload_event_t event;
+    event.function = (uint16_t)function;
+    event.timed = start > 0;
+    event.duration_ns = 0;
+    event.bytes = bytes;
+    if (start > 0) {
+        int64_t duration = now_ns() - start - clock_overhead_ns;
+        event.duration_ns = duration <= 0 ? 0 : duration >= UINT32_MAX ? UINT32_MAX : (uint32_t)duration;
+    }
+    push(&event);
+    tls_busy = 0;
+}
+
+// The cheapest back-to-back clock reading, which every timed call pays once
+static int64_t calibrate_clock(void) {
+    int64_t best = INT64_MAX;
+    for (int i = 0; i < CALIBRATION_ROUNDS; i++) {
+        int64_t start = now_ns();
+        int64_t delta = now_ns() - start;
+        if (delta < best) {
+            best = delta;
+        }
+    }
+    return best;
+}
+
+// The thread that called execve kept its ring active; this image starts with a ring of its own
+static void close_ring_before_exec(rune_preload_region_t *map) {
+    int32_t tid = (int32_t)syscall(SYS_gettid);
+    for (int i = 0; i < RUNE_PRELOAD_RINGS; i++) {
+        rune_preload_ring_t *ring = &map->rings[i];
+        uint32_t expected = RUNE_PRELOAD_RING_ACTIVE;
+        if (atomic_load_explicit(&ring->state, memory_order_acquire) == RUNE_PRELOAD_RING_ACTIVE &&
+            ring->tid == tid) {
+            atomic_compare_exchange_strong(&ring->state, &expected, RUNE_PRELOAD_RING_CLOSED);
+        }
+    }
+}
+
+__attribute__((constructor)) static void preload_init(void) {
+    resolve();
+    const char *path = getenv(RUNE_PRELOAD_ENV);
+    if (path == NULL) {
+        return;
+    }
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+    rune_preload_region_t *map = mmap(NULL, sizeof(rune_preload_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+    if (map->magic != RUNE_PRELOAD_MAGIC || pthread_key_create(&ring_key, release_ring) != 0) {
+        munmap(map, sizeof(rune_preload_region_t));
+        return;
+    }
+    pthread_atfork(NULL, NULL, reset_after_fork);
+    clock_overhead_ns = calibrate_clock();
+    close_ring_before_exec(map);
+    region = map; // Recording starts here
+}
+
+// exit() runs no thread-specific destructors for the thread that calls it
+__attribute__((destructor)) static void preload_fini(void) {
+    if (tls_ring != NULL) {
+        release_ring(tls_ring);
+    }
+}
+
+// The malloc family
+
+void *malloc(size_t size) {
+    if (!ready()) {
+        return bootstrap_alloc(size);
+    }
+    int64_t start = enter();
+    void *result = real.malloc(size);
+    leave(RUNE_PRELOAD_MALLOC, size, start);
+    return result;
+}
+
+void *calloc(size_t count, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!ready()) {
+        return bootstrap_alloc(total); // Static memory, still zero
+    }
+    int64_t start = enter();
+    void *result = real.calloc(count, size);
+    leave(RUNE_PRELOAD_CALLOC, total, start);
+    return result;
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (is_bootstrap(ptr)) {
+        void *moved = malloc(size);
+        if (moved != NULL) {
+            size_t old_size = *(size_t *)((char *)ptr - 16);
+            fallback_memmove(moved, ptr, old_size < size ? old_size : size);
+        }
+        return moved;
+    }
+    if (!ready()) {
+        return ptr == NULL ? bootstrap_alloc(size) : NULL;
+    }
+    int64_t start = enter();
+    void *result = real.realloc(ptr, size);
+    leave(RUNE_PRELOAD_REALLOC, size, start);
+    return result;
+}
+
+void free(void *ptr) {
+    if (ptr == NULL || is_bootstrap(ptr) || !ready()) {
+        return;
+    }
+    int64_t start = enter();
+    real.free(ptr);
+    leave(RUNE_PRELOAD_FREE, 0, start);
+}
+
+int posix_memalign(void **result, size_t alignment, size_t size) {
+    if (!ready()) {
+        *result = bootstrap_alloc(size);
+        return *result != NULL ? 0 : ENOMEM;
+    }
+    int64_t start = enter();
+    int error = real.posix_memalign(result, alignment, size);
+    leave(RUNE_PRELOAD_POSIX_MEMALIGN, size, start);
+    return error;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    if (!ready()) {
+        return bootstrap_alloc(size);
+    }
+    int64_t start = enter();
+    void *result = real.aligned_alloc(alignment, size);
+    leave(RUNE_PRELOAD_ALIGNED_ALLOC, size, start);
+    return result;
+}
+
+void *memalign(size_t alignment, size_t size) {
+    if (!ready()) {
+        return bootstrap_alloc(size);
+    }
+    int64_t start = enter();
+    void *result = real.memalign(alignment, size);
+    leave(RUNE_PRELOAD_MEMALIGN, size, start);
+    return result;
+}
+
+// The mem and str families
+
+void *memcpy(void *dest, const void *src, size_t n) {
+    if (!ready()) {
+        return fallback_memmove(dest, src, n);
+    }
+    int64_t start = enter();
+    void *result = real.memcpy(dest, src, n);
+    leave(RUNE_PRELOAD_MEMCPY, n, start);
+    return result;
+}
+
+void *__memcpy_chk(void *dest, const void *src, size_t n, size_t dest_len) {
+    if (!ready()) {
+        return fallback_memmove(dest, src, n);
+    }
+    int64_t start = enter();
+    void *result = real.memcpy_chk(dest, src, n, dest_len);
+    leave(RUNE_PRELOAD_MEMCPY, n, start);
+    return result;
+}
+
+void *memmove(void *dest, const void *src, size_t n) {
+    if (!ready()) {
+        return fallback_memmove(dest, src, n);
+    }
+    int64_t start = enter();
+    void *result = real.memmove(dest, src, n);
+    leave(RUNE_PRELOAD_MEMMOVE, n, start);
+    return result;
+}
+
+void *__memmove_chk(void *dest, const void *src, size_t n, size_t dest_len) {
+    if (!ready()) {
+        return fallback_memmove(dest, src, n);
+    }
+    int64_t start = enter();
+    void *result = real.memmove_chk(dest, src, n, dest_len);
+    leave(RUNE_PRELOAD_MEMMOVE, n, start);
+    return result;
+}
+
+void *memset(void *dest, int c, size_t n) {
+    if (!ready()) {
+        return fallback_memset(dest, c, n);
+    }
+    int64_t start = enter();
+    void *result = real.memset(dest, c, n);
+    leave(RUNE_PRELOAD_MEMSET, n, start);
+    return result;
+}
+
+void *__memset_chk(void *dest, int c, size_t n, size_t dest_len) {
+    if (!ready()) {
+        return fallback_memset(dest, c, n);
+    }
+    int64_t start = enter();
+    void *result = real.memset_chk(dest, c, n, dest_len);
+    leave(RUNE_PRELOAD_MEMSET, n, start);
+    return result;
+}
+
+int memcmp(const void *a, const void *b, size_t n) {
+    if (!ready()) {
+        return fallback_memcmp(a, b, n);
+    }
+    int64_t start = enter();
+    int result = real.memcmp(a, b, n);
+    leave(RUNE_PRELOAD_MEMCMP, n, start);
+    return result;
+}
+
+size_t strlen(const char *s) {
+    if (!ready()) {
+        return fallback_strlen(s);
+    }
+    int64_t start = enter();
+    size_t result = real.strlen(s);
+    leave(RUNE_PRELOAD_STRLEN, result, start);
+    return result;
+}
+
+int strcmp(const char *a, const char *b) {
+    if (!ready()) {
+        return fallback_strncmp(a, b, SIZE_MAX);
+    }
+    int64_t start = enter();
+    int result = real.strcmp(a, b);
+    leave(RUNE_PRELOAD_STRCMP, 0, start);
+    return result;
+}
+
+int strncmp(const char *a, const char *b, size_t n) {
+    if (!ready()) {
+        return fallback_strncmp(a, b, n);
+    }
+    int64_t start = enter();
+    int result = real.strncmp(a, b, n);
+    leave(RUNE_PRELOAD_STRNCMP, 0, start);
+    return result;
+}
+
+char *strcpy(char *dest, const char *src) {
+    if (!ready()) {
+        return fallback_memmove(dest, src, fallback_strlen(src) + 1);
+    }
+    int64_t start = enter();
+    char *end = real.stpcpy(dest, src); // Same copy, and the end gives the length for free
+    leave(RUNE_PRELOAD_STRCPY, (uint64_t)(end - dest) + 1, start);
+    return dest;
+}
+
+char *strncpy(char *dest, const char *src, size_t n) {
+    if (!ready()) {
+        size_t len = fallback_strlen(src);
+        fallback_memmove(dest, src, len < n ? len : n);
+        if (len < n) {
+            fallback_memset(dest + len, 0, n - len);
+        }
+        return dest;
+    }
+    int64_t start = enter();
+    char *result = real.strncpy(dest, src, n);
+    leave(RUNE_PRELOAD_STRNCPY, n, start);
+    return result;
+}
+
+char *strcat(char *dest, const char *src) {
+    if (!ready()) {
+        fallback_memmove(dest + fallback_strlen(dest), src, fallback_strlen(src) + 1);
+        return dest;
+    }
+    int64_t start = enter();
+    char *result = real.strcat(dest, src);
+    leave(RUNE_PRELOAD_STRCAT, 0, start);
+    return result;
+}
+
+char *strchr(const char *s, int c) {
+    if (!ready()) {
+        return fallback_strchr(s, c);
+    }
+    int64_t start = enter();
+    char *result = real.strchr(s, c);
+    leave(RUNE_PRELOAD_STRCHR, 0, start);
+    return result;
+}
+
+char *strstr(const char *haystack, const char *needle) {
+    if (!ready()) {
+        return fallback_strstr(haystack, needle);
+    }
+    int64_t start = enter();
+    char *result = real.strstr(haystack, needle);
+    leave(RUNE_PRELOAD_STRSTR, 0, start);
+    return result;
+}
+
+char *strdup(const char *s) {
+    if (!ready()) {
+        size_t size = fallback_strlen(s) + 1;
+        char *copy = bootstrap_alloc(size);
+        return copy != NULL ? fallback_memmove(copy, s, size) : NULL;
+    }
+    int64_t start = enter();
+    char *result = real.strdup(s);
+    leave(RUNE_PRELOAD_STRDUP, result != NULL && start >= 0 ? real.strlen(result) + 1 : 0, start);
+    return result;
+}
+
+// Selected stdio calls; nothing in the dynamic linker needs them before they are resolved
+
+FILE *fopen(const char *path, const char *mode) {
+    if (!ready()) {
+        errno = EAGAIN;
+        return NULL;
+    }
+    int64_t start = enter();
+    FILE *result = real.fopen(path, mode);
+    leave(RUNE_PRELOAD_FOPEN, 0, start);
+    return result;
+}
+
+int fclose(FILE *stream) {
+    if (!ready()) {
+        return EOF;
+    }
+    int64_t start = enter();
+    int result = real.fclose(stream);
+    leave(RUNE_PRELOAD_FCLOSE, 0, start);
+    return result;
+}
+
+size_t fread(void *buf, size_t size, size_t count, FILE *stream) {
+    if (!ready()) {
+        return 0;
+    }
+    int64_t start = enter();
+    size_t result = real.fread(buf, size, count, stream);
+    leave(RUNE_PRELOAD_FREAD, result * size, start);
+    return result;
+}
+
+size_t fwrite(const void *buf, size_t size, size_t count, FILE *stream) {
+    if (!ready()) {
+        return 0;
+    }
+    int64_t start = enter();
+    size_t result = real.fwrite(buf, size, count, stream);
+    leave(RUNE_PRELOAD_FWRITE, result * size, start);
+    return result;
+}
+
+char *fgets(char *buf, int size, FILE *stream) {
+    if (!ready()) {
+        return NULL;
+    }
+    int64_t start = enter();
+    char *result = real.fgets(buf, size, stream);
+    leave(RUNE_PRELOAD_FGETS, result != NULL && start >= 0 ? real.strlen(result) : 0, start);
+    return result;
+}
+
+int fputs(const char *s, FILE *stream) {
+    if (!ready()) {
+        return EOF;
+    }
+    int64_t start = enter();
+    int result = real.fputs(s, stream);
+    leave(RUNE_PRELOAD_FPUTS, result >= 0 && start >= 0 ? real.strlen(s) : 0, start);
+    return result;
+}
+
+int puts(const char *s) {
+    if (!ready()) {
+        return EOF;
+    }
+    int64_t start = enter();
+    int result = real.puts(s);
+    leave(RUNE_PRELOAD_PUTS, result >= 0 && start >= 0 ? real.strlen(s) + 1 : 0, start);
+    return result;
+}
+
+int fflush(FILE *stream) {
+    if (!ready()) {
+        return EOF;
+    }
+    int64_t start = enter();
+    int result = real.fflush(stream);
+    leave(RUNE_PRELOAD_FFLUSH, 0, start);
+    return result;
+}
+
+int printf(const char *format, ...) {
+    if (!ready()) {
+        return -1;
+    }
+    va_list args;
+    va_start(args, format);
+    int64_t start = enter();
+    int result = real.vfprintf(stdout, format, args);
+    leave(RUNE_PRELOAD_PRINTF, result > 0 ? (uint64_t)result : 0, start);
+    va_end(args);
+    return result;
+}
+
+int __printf_chk(int flag, const char *format, ...) {
+    if (!ready()) {
+        return -1;
+    }
+    va_list args;
+    va_start(args, format);
+    int64_t start = enter();
+    int result = real.vfprintf_chk(stdout, flag, format, args);
+    leave(RUNE_PRELOAD_PRINTF, result > 0 ? (uint64_t)result : 0, start);
+    va_end(args);
+    return result;
+}
+
+int fprintf(FILE *stream, const char *format, ...) {
+    if (!ready()) {
+        return -1;
+    }
+    va_list args;
+    va_start(args, format);
+    int64_t start = enter();
+    int result = real.vfprintf(stream, format, args);
+    leave(RUNE_PRELOAD_FPRINTF, result > 0 ? (uint64_t)result : 0, start);
+    va_end(args);
+    return result;
+}
+
+int __fprintf_chk(FILE *stream, int flag, const char *format, ...) {
+    if (!ready()) {
+        return -1;
+    }
+    va_list args;
+    va_start(args, format);
+    int64_t start = enter();
+    int result = real.vfprintf_chk(stream, flag, format, args);
+    leave(RUNE_PRELOAD_FPRINTF, result > 0 ? (uint64_t)result : 0, start);
+    va_end(args);
+    return result;
+}
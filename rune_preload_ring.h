@@ -0,0 +1,103 @@
+#ifndef RUNE_PRELOAD_RING_H
+#define RUNE_PRELOAD_RING_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+/**
+ * @brief Layout of the shared memory region between librunescope_preload.so and runescope.
+ *
+ * Runescope creates the region as a file in /dev/shm and passes its path to
+ * the target in RUNE_PRELOAD_ENV. Every thread of the target that makes an
+ * interposed call claims one ring of the region and is its only writer;
+ * runescope's collector thread is the only reader of all rings. A ring is a
+ * single-producer single-consumer queue of fixed-size events, so neither
+ * side takes a lock: the writer publishes an event by advancing head with
+ * release ordering, and the collector frees the slot by advancing tail.
+ *
+ * When a thread exits, its ring is marked closed. The collector drains it
+ * and marks it free again, so programs that create many short-lived threads
+ * do not run out of rings. Threads that end without running their
+ * destructors (the other threads of a process that calls exit, or of one
+ * killed by a signal) cannot close their ring; the collector frees the
+ * rings of threads that no longer exist once it has drained them. Forked
+ * children claim rings of their own, and programs they exec load the
+ * library again, map the same region and close the ring the thread used
+ * before the exec.
+ */
+
+#define RUNE_PRELOAD_ENV "RUNESCOPE_PRELOAD_SHM"
+#define RUNE_PRELOAD_MAGIC 0x314c5250454e5552ull // "RUNEPRL1"
+#define RUNE_PRELOAD_RINGS 128
+#define RUNE_PRELOAD_RING_EVENTS 16384 // A power of two
+#define RUNE_PRELOAD_TIMING_PERIOD 16 // One call in this many, per thread, is timed
+
+// The interposed functions; __*_chk variants count as the function they check
+typedef enum {
+    RUNE_PRELOAD_MALLOC,
+    RUNE_PRELOAD_CALLOC,
+    RUNE_PRELOAD_REALLOC,
+    RUNE_PRELOAD_FREE,
+    RUNE_PRELOAD_POSIX_MEMALIGN,
+    RUNE_PRELOAD_ALIGNED_ALLOC,
+    RUNE_PRELOAD_MEMALIGN,
+    RUNE_PRELOAD_MEMCPY,
+    RUNE_PRELOAD_MEMMOVE,
+    RUNE_PRELOAD_MEMSET,
+    RUNE_PRELOAD_MEMCMP,
+    RUNE_PRELOAD_STRLEN,
+    RUNE_PRELOAD_STRCMP,
+    RUNE_PRELOAD_STRNCMP,
+    RUNE_PRELOAD_STRCPY,
+    RUNE_PRELOAD_STRNCPY,
+    RUNE_PRELOAD_STRCAT,
+    RUNE_PRELOAD_STRCHR,
+    RUNE_PRELOAD_STRSTR,
+    RUNE_PRELOAD_STRDUP,
+    RUNE_PRELOAD_FOPEN,
+    RUNE_PRELOAD_FCLOSE,
+    RUNE_PRELOAD_FREAD,
+    RUNE_PRELOAD_FWRITE,
+    RUNE_PRELOAD_FGETS,
+    RUNE_PRELOAD_FPUTS,
+    RUNE_PRELOAD_PUTS,
+    RUNE_PRELOAD_FFLUSH,
+    RUNE_PRELOAD_PRINTF,
+    RUNE_PRELOAD_FPRINTF,
+    RUNE_PRELOAD_NUM_FUNCTIONS
+} rune_preload_function_t;
+
+// One call, 16 bytes
+typedef struct {
+    uint16_t function;      // rune_preload_function_t
+    uint16_t timed;         // duration_ns was measured
+    uint32_t duration_ns;   // Saturated at UINT32_MAX
+    uint64_t bytes;         // Bytes requested, copied, compared or written; 0 when not known cheaply
+} rune_preload_event_t;
+
+enum {
+    RUNE_PRELOAD_RING_FREE,
+    RUNE_PRELOAD_RING_CLAIMED, // Taken by a thread that has not filled in pid and tid yet
+    RUNE_PRELOAD_RING_ACTIVE,
+    RUNE_PRELOAD_RING_CLOSED   // Its thread exited; free once drained
+};
+
+typedef struct {
+    _Atomic uint32_t state;
+    int32_t pid;                                 // Of the thread that claimed it
+    int32_t tid;
+    alignas(64) _Atomic uint64_t head;           // Next slot to write, advanced by the thread
+    alignas(64) _Atomic uint64_t tail;           // Next slot to read, advanced by the collector
+    alignas(64) rune_preload_event_t events[RUNE_PRELOAD_RING_EVENTS];
+} rune_preload_ring_t;
+
+typedef struct {
+    uint64_t magic;
+    _Atomic uint32_t collector_alive;            // Writers wait for a full ring to drain only while set
+    _Atomic uint64_t dropped;                    // Events lost to a full ring with no collector
+    _Atomic uint64_t ringless;                   // Calls of threads that found every ring taken
+    rune_preload_ring_t rings[RUNE_PRELOAD_RINGS];
+} rune_preload_region_t;
+
+#endif // RUNE_PRELOAD_RING_H
@@ -0,0 +1,805 @@
+#define _GNU_SOURCE // For __WALL and process_vm_readv
+#include "rune_profile.h"
+#include "rune_elf.h" // For the symbol tables
+#include "rune_intern.h"
+#include "rune_latency.h" // For rune_latency_format
+#include <elf.h> // For NT_PRSTATUS
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h> // For getrusage
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+
+#if defined(__x86_64__)
+#define RUNE_PROFILE_ARCH
+#define REG_PC(regs) ((regs).rip)
+#define REG_SP(regs) ((regs).rsp)
+#define REG_FP(regs) ((regs).rbp)
+#elif defined(__aarch64__)
+#define RUNE_PROFILE_ARCH
+#define REG_PC(regs) ((regs).pc)
+#define REG_SP(regs) ((regs).sp)
+#define REG_FP(regs) ((regs).regs[29])
+#endif
+
+#define MAX_FRAMES 128
+#define STACK_CHUNK 32768      // Stack copied in one read from sp; frames beyond it are read one by one
+#define STACK_PIECE 4096       // process_vm_readv never splits an iovec, so read the chunk page by page
+#define MAX_STACK_TEXT 16384
+#define TOP_FUNCTIONS 15
+
+typedef struct {
+    pid_t tid;
+    pid_t tgid;
+    int stat_fd;      // /proc/<tgid>/task/<tid>/stat, read with pread; -1 = always sample
+    int seen;         // Set once the first ptrace stop has been handled
+    int interrupted;  // PTRACE_INTERRUPT sent, waiting for the stop
+} profile_thread_t;
+
+typedef struct {
+    uint64_t start, end, offset;
+    const rune_elf_symtab_t *symtab; // NULL for anonymous memory and unreadable files
+    char *name;
+} profile_mapping_t;
+
+// The executable mappings of one process
+typedef struct {
+    pid_t tgid;
+    char comm[64];
+    profile_mapping_t *maps;
+    size_t count;
+    int stale;               // Exec'd or forked since the maps were read
+    unsigned long read_tick; // Tick of the last read, to read at most once per tick
+} profile_process_t;
+
+typedef struct {
+    char *path;
+    rune_elf_symtab_t symtab;
+    int loaded;
+} profile_symtab_t;
+
+typedef struct {
+    profile_thread_t *threads;
+    size_t num_threads;
+    size_t threads_capacity;
+    profile_process_t *processes;
+    size_t num_processes;
+    size_t processes_capacity;
+    profile_symtab_t **symtabs; // Pointers, since mappings point into them
+    size_t num_symtabs;
+    size_t symtabs_capacity;
+    rune_intern_t stacks;       // Collapsed stack text -> ID
+    uint64_t *stack_counts;
+    size_t stack_counts_capacity;
+    rune_intern_t functions;    // Innermost function -> ID
+    uint64_t *self_counts;
+    size_t self_counts_capacity;
+    unsigned long tick;
+    uint64_t samples;
+    uint64_t shallow_samples;   // Stacks of a single frame, the sign of missing frame pointers
+    unsigned char *stack;       // STACK_CHUNK bytes of scratch
+    char text[MAX_STACK_TEXT];
+} profiler_t;
+
+#ifdef RUNE_PROFILE_ARCH
+
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// CPU time of the reaped descendants, which covers every process of the target once it has exited
+static int64_t children_cpu_ns(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    return ((int64_t)usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000 +
+           ((int64_t)usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+}
+
+static int grow_array(void **array, size_t *capacity, size_t needed, size_t size) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    size_t capacity_new = *capacity > 0 ? *capacity : 16;
+    while (capacity_new < needed) {
+        capacity_new *= 2;
+    }
+    void *grown = realloc(*array, capacity_new * size);
+    if (grown == NULL) {
+        perror("runescope: realloc failed for profile");
+        return -1;
+    }
+    memset((char *)grown + *capacity * size, 0, (capacity_new - *capacity) * size);
+    *array = grown;
+    *capacity = capacity_new;
+    return 0;
+}
+
+static int open_stat(pid_t tgid, pid_t tid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", (int)tgid, (int)tid);
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+static pid_t read_tgid(pid_t tid) {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)tid);
+    FILE *status = fopen(path, "r");
+    pid_t tgid = tid;
+    while (status != NULL && fgets(line, sizeof(line), status) != NULL) {
+        if (strncmp(line, "Tgid:", 5) == 0) {
+            tgid = (pid_t)atoi(line + 5);
+            break;
+        }
+    }
+    if (status != NULL) {
+        fclose(status);
+    }
+    return tgid;
+}
+
+static profile_thread_t *thread_find(profiler_t *profiler, pid_t tid) {
+    for (size_t i = 0; i < profiler->num_threads; i++) {
+        if (profiler->threads[i].tid == tid) {
+            return &profiler->threads[i];
+        }
+    }
+    return NULL;
+}
+
+static profile_process_t *process_find(profiler_t *profiler, pid_t tgid) {
+    for (size_t i = 0; i < profiler->num_processes; i++) {
+        if (profiler->processes[i].tgid == tgid) {
+            return &profiler->processes[i];
+        }
+    }
+    return NULL;
+}
+
+static profile_thread_t *thread_add(profiler_t *profiler, pid_t tid) {
+    if (grow_array((void **)&profiler->threads, &profiler->threads_capacity, profiler->num_threads + 1,
+                   sizeof(profile_thread_t)) == -1) {
+        return NULL;
+    }
+    profile_thread_t *thread = &profiler->threads[profiler->num_threads++];
+    memset(thread, 0, sizeof(*thread));
+    thread->tid = tid;
+    thread->tgid = read_tgid(tid);
+    thread->stat_fd = open_stat(thread->tgid, tid);
+    profile_process_t *process = thread->tgid == tid ? process_find(profiler, tid) : NULL;
+    if (process != NULL) {
+        process->stale = 1; // A new process reusing the pid of an earlier one
+    }
+    return thread;
+}
+
+static void thread_remove(profiler_t *profiler, profile_thread_t *thread) {
+    if (thread->stat_fd != -1) {
+        close(thread->stat_fd);
+    }
+    *thread = profiler->threads[--profiler->num_threads];
+}
+
+// Running or waiting for a CPU, from the state field after the parenthesized comm
+static int thread_running(const profile_thread_t *thread) {
+    char buf[512];
+    ssize_t len = thread->stat_fd != -1 ? pread(thread->stat_fd, buf, sizeof(buf) - 1, 0) : -1;
+    if (len <= 0) {
+        return 1;
+    }
+    buf[len] = '\0';
+    const char *paren = strrchr(buf, ')');
+    return paren == NULL || paren[1] == '\0' || paren[2] == 'R';
+}
+
+static const rune_elf_symtab_t *symtab_for(profiler_t *profiler, const char *path) {
+    for (size_t i = 0; i < profiler->num_symtabs; i++) {
+        if (strcmp(profiler->symtabs[i]->path, path) == 0) {
+            return profiler->symtabs[i]->loaded ? &profiler->symtabs[i]->symtab : NULL;
+        }
+    }
+    if (grow_array((void **)&profiler->symtabs, &profiler->symtabs_capacity, profiler->num_symtabs + 1,
+                   sizeof(profile_symtab_t *)) == -1) {
+        return NULL;
+    }
+    profile_symtab_t *entry = calloc(1, sizeof(profile_symtab_t));
+    char *path_copy = strdup(path);
+    if (entry == NULL || path_copy == NULL) {
+        perror("runescope: malloc failed for symbol cache");
+        free(entry);
+        free(path_copy);
+        return NULL;
+    }
+    entry->path = path_copy;
+    entry->loaded = rune_elf_symtab_load(path, &entry->symtab) == 0; // Failures are cached too
+    profiler->symtabs[profiler->num_symtabs++] = entry;
+    return entry->loaded ? &entry->symtab : NULL;
+}
+
+static void free_maps(profile_process_t *process) {
+    for (size_t i = 0; i < process->count; i++) {
+        free(process->maps[i].name);
+    }
+    free(process->maps);
+    process->maps = NULL;
+    process->count = 0;
+}
+
+static void read_maps(profiler_t *profiler, profile_process_t *process) {
+    free_maps(process);
+    process->stale = 0;
+    process->read_tick = profiler->tick;
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/comm", (int)process->tgid);
+    FILE *comm = fopen(path, "r");
+    if (comm == NULL || fgets(process->comm, sizeof(process->comm), comm) == NULL) {
+        snprintf(process->comm, sizeof(process->comm), "%d", (int)process->tgid);
+    }
+    if (comm != NULL) {
+        fclose(comm);
+    }
+    process->comm[strcspn(process->comm, "\n")] = '\0';
+
+    snprintf(path, sizeof(path), "/proc/%d/maps", (int)process->tgid);
+    FILE *maps = fopen(path, "r");
+    if (maps == NULL) {
+        return;
+    }
+    size_t capacity = 0;
+    char line[4096 + 128];
+    while (fgets(line, sizeof(line), maps) != NULL) {
+        unsigned long start, end, offset;
+        char perms[8];
+        int path_start = 0;
+        if (sscanf(line, "%lx-%lx %7s %lx %*s %*s %n", &start, &end, perms, &offset, &path_start) < 4 ||
+            perms[2] != 'x') {
+            continue; // Return addresses only ever point into executable mappings
+        }
+        if (grow_array((void **)&process->maps, &capacity, process->count + 1, sizeof(profile_mapping_t)) == -1) {
+            break;
+        }
+        char *name = path_start > 0 ? line + path_start : line + strlen(line);
+        name[strcspn(name, "\n")] = '\0';
+        profile_mapping_t *mapping = &process->maps[process->count];
+        mapping->start = start;
+        mapping->end = end;
+        mapping->offset = offset;
+        mapping->name = strdup(name);
+        mapping->symtab = name[0] == '/' ? symtab_for(profiler, name) : NULL;
+        if (mapping->name != NULL) {
+            process->count++;
+        }
+    }
+    fclose(maps);
+}
+
+static profile_process_t *process_get(profiler_t *profiler, pid_t tgid) {
+    profile_process_t *process = process_find(profiler, tgid);
+    if (process == NULL) {
+        if (grow_array((void **)&profiler->processes, &profiler->processes_capacity, profiler->num_processes + 1,
+                       sizeof(profile_process_t)) == -1) {
+            return NULL;
+        }
+        process = &profiler->processes[profiler->num_processes++];
+        memset(process, 0, sizeof(*process));
+        process->tgid = tgid;
+        process->stale = 1;
+    }
+    if (process->stale) {
+        read_maps(profiler, process);
+    }
+    return process;
+}
+
+static const profile_mapping_t *find_mapping(const profile_process_t *process, uint64_t address) {
+    size_t low = 0, high = process->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (address < process->maps[mid].start) {
+            high = mid;
+        } else if (address >= process->maps[mid].end) {
+            low = mid + 1;
+        } else {
+            return &process->maps[mid];
+        }
+    }
+    return NULL;
+}
+
+// Names the function at an address; buf holds names made up for code without symbols
+static const char *symbolize(profiler_t *profiler, profile_process_t *process, uint64_t address, char *buf,
+                             size_t size) {
+    const profile_mapping_t *mapping = find_mapping(process, address);
+    if (mapping == NULL && process->read_tick != profiler->tick) {
+        read_maps(profiler, process); // Code mapped since the last read, such as a dlopen'ed library
+        mapping = find_mapping(process, address);
+    }
+    if (mapping == NULL || mapping->name[0] == '\0') {
+        return "[unknown]";
+    }
+    const char *name = mapping->symtab != NULL
+                           ? rune_elf_symtab_find(mapping->symtab, address - mapping->start + mapping->offset)
+                           : NULL;
+    if (name != NULL || mapping->name[0] == '[') {
+        return name != NULL ? name : mapping->name;
+    }
+    const char *slash = strrchr(mapping->name, '/');
+    snprintf(buf, size, "[%s]", slash != NULL ? slash + 1 : mapping->name);
+    return buf;
+}
+
+static int read_remote(pid_t tid, uint64_t address, void *buf, size_t len) {
+    struct iovec local = { buf, len };
+    struct iovec remote = { (void *)(uintptr_t)address, len };
+    return process_vm_readv(tid, &local, 1, &remote, 1, 0) == (ssize_t)len ? 0 : -1;
+}
+
+// Walks the frame records {previous frame pointer, return address} from the frame pointer register
+static size_t unwind(pid_t tid, const struct user_regs_struct *regs, unsigned char *chunk, uint64_t *frames) {
+    uint64_t sp = REG_SP(*regs);
+    uint64_t fp = REG_FP(*regs);
+    size_t num_frames = 0;
+    frames[num_frames++] = REG_PC(*regs);
+
+    // Copy the top of the stack in one syscall; it stops at the first unmapped page
+    struct iovec local = { chunk, STACK_CHUNK };
+    struct iovec remote[STACK_CHUNK / STACK_PIECE + 1];
+    size_t pieces = 0;
+    for (uint64_t at = sp; at < sp + STACK_CHUNK; pieces++) {
+        uint64_t next = (at & ~(uint64_t)(STACK_PIECE - 1)) + STACK_PIECE;
+        next = next < sp + STACK_CHUNK ? next : sp + STACK_CHUNK;
+        remote[pieces].iov_base = (void *)(uintptr_t)at;
+        remote[pieces].iov_len = next - at;
+        at = next;
+    }
+    ssize_t copied = process_vm_readv(tid, &local, 1, remote, pieces, 0);
+    uint64_t copied_len = copied > 0 ? (uint64_t)copied : 0;
+
+    uint64_t lowest = sp;
+    while (num_frames < MAX_FRAMES && fp != 0 && (fp & (sizeof(uint64_t) - 1)) == 0 && fp >= lowest) {
+        uint64_t record[2];
+        if (fp - sp + sizeof(record) <= copied_len) {
+            memcpy(record, chunk + (fp - sp), sizeof(record));
+        } else if (read_remote(tid, fp, record, sizeof(record)) == -1) {
+            break;
+        }
+        if (record[1] == 0) {
+            break;
+        }
+        frames[num_frames++] = record[1] - 1; // Inside the call instruction, not after it
+        lowest = fp + sizeof(record); // Frames only ever move towards the stack's base
+        fp = record[0];
+    }
+    return num_frames;
+}
+
+static int count_id(uint64_t **counts, size_t *capacity, long id) {
+    if (id < 0 || grow_array((void **)counts, capacity, (size_t)id + 1, sizeof(uint64_t)) == -1) {
+        return -1;
+    }
+    (*counts)[id]++;
+    return 0;
+}
+
+// Appends a frame to the collapsed line; ';' separates frames, so it may not appear in one
+static size_t append_frame(char *text, size_t len, const char *name) {
+    if (len > 0 && len < MAX_STACK_TEXT - 1) {
+        text[len++] = ';';
+    }
+    for (; *name != '\0' && len < MAX_STACK_TEXT - 1; name++) {
+        text[len++] = *name == ';' || *name == '\n' ? ':' : *name;
+    }
+    text[len] = '\0';
+    return len;
+}
+
+static void take_sample(profiler_t *profiler, profile_thread_t *thread) {
+    struct user_regs_struct regs;
+    struct iovec iov = { &regs, sizeof(regs) };
+    if (ptrace(PTRACE_GETREGSET, thread->tid, (void *)(uintptr_t)NT_PRSTATUS, &iov) == -1) {
+        return;
+    }
+    profile_process_t *process = process_get(profiler, thread->tgid);
+    if (process == NULL) {
+        return;
+    }
+    uint64_t frames[MAX_FRAMES];
+    size_t num_frames = unwind(thread->tid, &regs, profiler->stack, frames);
+
+    char buf[300];
+    size_t len = append_frame(profiler->text, 0, process->comm);
+    for (size_t i = num_frames; i-- > 0;) {
+        len = append_frame(profiler->text, len, symbolize(profiler, process, frames[i], buf, sizeof(buf)));
+    }
+    const char *leaf = symbolize(profiler, process, frames[0], buf, sizeof(buf));
+    count_id(&profiler->stack_counts, &profiler->stack_counts_capacity,
+             rune_intern_id(&profiler->stacks, profiler->text, len));
+    count_id(&profiler->self_counts, &profiler->self_counts_capacity,
+             rune_intern_id(&profiler->functions, leaf, strlen(leaf)));
+    profiler->samples++;
+    profiler->shallow_samples += num_frames == 1;
+}
+
+// Handles a ptrace stop and returns the ptrace request that resumes the thread
+static int handle_stop(profiler_t *profiler, profile_thread_t *thread, int status, int *inject_signal) {
+    int sig = WSTOPSIG(status);
+    int event = (unsigned int)status >> 16;
+    int first_stop = !thread->seen;
+    unsigned long message = 0;
+
+    thread->seen = 1;
+    *inject_signal = 0;
+
+    if (event == PTRACE_EVENT_STOP) {
+        int interrupted = thread->interrupted;
+        thread->interrupted = 0;
+        if (!first_stop && (sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU)) {
+            return PTRACE_LISTEN; // Group-stop, which also ends a pending interrupt: stay stopped until SIGCONT
+        }
+        if (interrupted) {
+            take_sample(profiler, thread);
+        }
+    } else if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
+        // The new thread may have reported its first stop already; thread_add may move thread
+        ptrace(PTRACE_GETEVENTMSG, thread->tid, NULL, &message);
+        if ((pid_t)message > 0 && thread_find(profiler, (pid_t)message) == NULL) {
+            thread_add(profiler, (pid_t)message);
+        }
+    } else if (event == PTRACE_EVENT_EXEC) {
+        // A thread other than the leader that execs takes over the leader's tid without an exit
+        ptrace(PTRACE_GETEVENTMSG, thread->tid, NULL, &message);
+        pid_t tid = thread->tid;
+        profile_thread_t *former = (pid_t)message != tid ? thread_find(profiler, (pid_t)message) : NULL;
+        if (former != NULL) {
+            thread_remove(profiler, former);
+        }
+        thread = thread_find(profiler, tid);
+        if (thread == NULL) {
+            return PTRACE_CONT;
+        }
+        if (thread->stat_fd != -1) {
+            close(thread->stat_fd);
+        }
+        thread->stat_fd = open_stat(thread->tgid, tid);
+        profile_process_t *process = process_find(profiler, thread->tgid);
+        if (process != NULL) {
+            process->stale = 1;
+        }
+    } else if (event == 0) {
+        *inject_signal = sig; // Signal-delivery-stop: pass the signal on
+    }
+    return PTRACE_CONT;
+}
+
+// Handles one waitpid result; returns 1 if it ended an interrupt
+static int process_status(profiler_t *profiler, pid_t tid, int status, pid_t root, int *root_status) {
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+        if (tid == root) {
+            *root_status = status;
+        }
+        profile_thread_t *thread = thread_find(profiler, tid);
+        int interrupted = thread != NULL && thread->interrupted;
+        if (thread != NULL) {
+            thread_remove(profiler, thread);
+        }
+        return interrupted;
+    }
+    if (!WIFSTOPPED(status)) {
+        return 0;
+    }
+    profile_thread_t *thread = thread_find(profiler, tid);
+    if (thread == NULL) {
+        thread = thread_add(profiler, tid); // Reported before the event of the call that created it
+    }
+    if (thread == NULL) {
+        kill(root, SIGKILL); // Out of memory, PTRACE_O_EXITKILL cannot help here
+        return 0;
+    }
+    int interrupted = thread->interrupted && ((unsigned int)status >> 16) == PTRACE_EVENT_STOP;
+    int inject_signal;
+    int request = handle_stop(profiler, thread, status, &inject_signal);
+    // ESRCH just means the thread was killed meanwhile; its exit is reported next
+    ptrace(request, tid, NULL, (void *)(long)inject_signal);
+    return interrupted;
+}
+
+static int any_interrupted(const profiler_t *profiler) {
+    for (size_t i = 0; i < profiler->num_threads; i++) {
+        if (profiler->threads[i].interrupted) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Stops every thread that is on a CPU or waiting for one, samples it and lets it go again
+static void sample_tick(profiler_t *profiler, pid_t root, int *root_status) {
+    profiler->tick++;
+    for (size_t i = 0; i < profiler->num_threads; i++) {
+        profile_thread_t *thread = &profiler->threads[i];
+        if (thread->seen && thread_running(thread) && ptrace(PTRACE_INTERRUPT, thread->tid, NULL, NULL) == 0) {
+            thread->interrupted = 1;
+        }
+    }
+    while (any_interrupted(profiler)) {
+        int status;
+        pid_t tid = waitpid(-1, &status, __WALL);
+        if (tid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        process_status(profiler, tid, status, root, root_status);
+    }
+}
+
+static const rune_intern_t *sort_intern; // For the qsort comparators
+static const uint64_t *sort_counts;
+
+static int compare_text(const void *a, const void *b) {
+    return strcmp(rune_intern_string(sort_intern, *(const uint32_t *)a),
+                  rune_intern_string(sort_intern, *(const uint32_t *)b));
+}
+
+static int compare_counts(const void *a, const void *b) {
+    uint64_t x = sort_counts[*(const uint32_t *)a], y = sort_counts[*(const uint32_t *)b];
+    return (x < y) - (x > y);
+}
+
+static uint32_t *sorted_ids(const rune_intern_t *intern, const uint64_t *counts,
+                            int (*compare)(const void *, const void *)) {
+    uint32_t *ids = malloc((intern->count + 1) * sizeof(uint32_t));
+    if (ids == NULL) {
+        perror("runescope: malloc failed for profile report");
+        return NULL;
+    }
+    for (size_t i = 0; i < intern->count; i++) {
+        ids[i] = (uint32_t)i;
+    }
+    sort_intern = intern;
+    sort_counts = counts;
+    qsort(ids, intern->count, sizeof(uint32_t), compare);
+    return ids;
+}
+
+static int write_folded(const profiler_t *profiler, const char *path) {
+    uint32_t *ids = sorted_ids(&profiler->stacks, profiler->stack_counts, compare_text);
+    if (ids == NULL) {
+        return -1;
+    }
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror("runescope: Failed to create collapsed stacks file");
+        free(ids);
+        return -1;
+    }
+    for (size_t i = 0; i < profiler->stacks.count; i++) {
+        fprintf(file, "%s %llu\n", rune_intern_string(&profiler->stacks, ids[i]),
+                (unsigned long long)profiler->stack_counts[ids[i]]);
+    }
+    free(ids);
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed) {
+        perror("runescope: Failed to write collapsed stacks file");
+        return -1;
+    }
+    return 0;
+}
+
+static void print_report(const profiler_t *profiler, const char *executable_path,
+                         const rune_profile_options_t *options, int64_t elapsed_ns, int64_t own_cpu_ns,
+                         int64_t target_cpu_ns, FILE *out) {
+    char elapsed[32], own_cpu[32], target_cpu[32];
+    rune_latency_format(elapsed_ns, elapsed, sizeof(elapsed));
+    rune_latency_format(own_cpu_ns, own_cpu, sizeof(own_cpu));
+    rune_latency_format(target_cpu_ns, target_cpu, sizeof(target_cpu));
+    fprintf(out, "\n--- CPU Profile: %s ---\n", executable_path);
+    fprintf(out, "%llu samples at %d Hz over %s, %zu distinct stacks written to %s\n",
+            (unsigned long long)profiler->samples, options->frequency, elapsed, profiler->stacks.count,
+            options->output_path);
+    fprintf(out, "Sampling cost %s of CPU in runescope, %.2f%% of the target's %s\n", own_cpu,
+            target_cpu_ns > 0 ? 100.0 * (double)own_cpu_ns / (double)target_cpu_ns : 0.0, target_cpu);
+    if (profiler->samples > 0 && profiler->shallow_samples * 2 > profiler->samples) {
+        fprintf(out, "Most stacks are one frame deep; build the target with -fno-omit-frame-pointer for full stacks.\n");
+    }
+    if (profiler->samples == 0) {
+        return;
+    }
+
+    uint32_t *ids = sorted_ids(&profiler->functions, profiler->self_counts, compare_counts);
+    if (ids == NULL) {
+        return;
+    }
+    fprintf(out, "\nTop functions by self samples:\n");
+    fprintf(out, "  %8s %7s  %s\n", "Samples", "Self %", "Function");
+    for (size_t i = 0; i < profiler->functions.count && i < TOP_FUNCTIONS; i++) {
+        uint64_t count = profiler->self_counts[ids[i]];
+        fprintf(out, "  %8llu %6.2f%%  %s\n", (unsigned long long)count,
+                100.0 * (double)count / (double)profiler->samples, rune_intern_string(&profiler->functions, ids[i]));
+    }
+    free(ids);
+}
+
+static void free_profiler(profiler_t *profiler) {
+    for (size_t i = 0; i < profiler->num_threads; i++) {
+        if (profiler->threads[i].stat_fd != -1) {
+            close(profiler->threads[i].stat_fd);
+        }
+    }
+    for (size_t i = 0; i < profiler->num_processes; i++) {
+        free_maps(&profiler->processes[i]);
+    }
+    for (size_t i = 0; i < profiler->num_symtabs; i++) {
+        if (profiler->symtabs[i]->loaded) {
+            rune_elf_symtab_free(&profiler->symtabs[i]->symtab);
+        }
+        free(profiler->symtabs[i]->path);
+        free(profiler->symtabs[i]);
+    }
+    free(profiler->threads);
+    free(profiler->processes);
+    free(profiler->symtabs);
+    free(profiler->stack_counts);
+    free(profiler->self_counts);
+    free(profiler->stack);
+    rune_intern_free(&profiler->stacks);
+    rune_intern_free(&profiler->functions);
+    free(profiler);
+}
+
+int rune_profile_run(const char *executable_path, char *const argv_target[],
+                     const rune_profile_options_t *options, FILE *out) {
+    profiler_t *profiler = calloc(1, sizeof(profiler_t));
+    if (profiler == NULL || (profiler->stack = malloc(STACK_CHUNK)) == NULL) {
+        perror("runescope: malloc failed for profiler");
+        free(profiler);
+        return -1;
+    }
+    if (rune_intern_init(&profiler->stacks) == -1 || rune_intern_init(&profiler->functions) == -1) {
+        free_profiler(profiler);
+        return -1;
+    }
+
+    // SIGCHLD stays blocked so the loop can sleep until the next tick or the next ptrace stop
+    sigset_t chld, saved_mask;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, &saved_mask);
+
+    // The child waits on this pipe until the parent has seized it
+    int sync_pipe[2];
+    if (pipe(sync_pipe) == -1) {
+        perror("runescope: pipe failed");
+        sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+        free_profiler(profiler);
+        return -1;
+    }
+
+    fflush(stdout); // Don't let the child inherit unflushed output
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        perror("runescope: fork failed");
+        close(sync_pipe[0]);
+        close(sync_pipe[1]);
+        sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+        free_profiler(profiler);
+        return -1;
+    } else if (pid == 0) {
+        // Child process
+        extern char **environ;
+        char go;
+
+        sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+        close(sync_pipe[1]);
+        if (read(sync_pipe[0], &go, 1) != 1) {
+            _exit(EXIT_FAILURE); // Parent could not seize us
+        }
+        close(sync_pipe[0]);
+        execve(executable_path, argv_target, environ);
+        perror("runescope: execve failed");
+        _exit(EXIT_FAILURE);
+    }
+
+    // Parent process
+    close(sync_pipe[0]);
+    long trace_options = PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE |
+                         PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL;
+    if (ptrace(PTRACE_SEIZE, pid, NULL, (void *)trace_options) == -1) {
+        perror("runescope: PTRACE_SEIZE failed");
+        close(sync_pipe[1]); // Child sees EOF and exits
+        waitpid(pid, NULL, 0);
+        sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+        free_profiler(profiler);
+        return -1;
+    }
+    profile_thread_t *root = thread_add(profiler, pid);
+    if (root != NULL) {
+        root->seen = 1; // A seized tracee gets no initial stop
+    }
+    if (write(sync_pipe[1], "g", 1) != 1) {
+        perror("runescope: failed to release traced child");
+    }
+    close(sync_pipe[1]);
+
+    int root_status = -1;
+    int64_t period_ns = 1000000000 / options->frequency;
+    int64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+    int64_t start_cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    int64_t start_children_ns = children_cpu_ns();
+    int64_t next_tick_ns = start_ns + period_ns;
+    for (;;) {
+        int status;
+        pid_t tid = waitpid(-1, &status, __WALL | WNOHANG);
+        if (tid > 0) {
+            process_status(profiler, tid, status, pid, &root_status);
+            continue;
+        }
+        if (tid == -1 && errno == EINTR) {
+            continue;
+        }
+        if (tid == -1) {
+            if (errno != ECHILD) {
+                // Defensive programming: Handle waitpid failure
+                perror("runescope: waitpid failed");
+            }
+            break; // All tracees are gone
+        }
+
+        int64_t now_ns = clock_ns(CLOCK_MONOTONIC);
+        if (now_ns >= next_tick_ns) {
+            sample_tick(profiler, pid, &root_status);
+            next_tick_ns += period_ns;
+            now_ns = clock_ns(CLOCK_MONOTONIC);
+            if (next_tick_ns <= now_ns) {
+                next_tick_ns = now_ns + period_ns; // Fell behind; skip the missed ticks
+            }
+            continue;
+        }
+        int64_t wait_ns = next_tick_ns - now_ns;
+        struct timespec timeout = { (time_t)(wait_ns / 1000000000), (long)(wait_ns % 1000000000) };
+        sigtimedwait(&chld, NULL, &timeout); // Returns early on any ptrace stop or exit
+    }
+    int64_t elapsed_ns = clock_ns(CLOCK_MONOTONIC) - start_ns;
+    int64_t own_cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - start_cpu_ns;
+    int64_t target_cpu_ns = children_cpu_ns() - start_children_ns;
+    sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+
+    int write_failed = write_folded(profiler, options->output_path) == -1;
+    print_report(profiler, executable_path, options, elapsed_ns, own_cpu_ns, target_cpu_ns, out);
+    free_profiler(profiler);
+
+    if (root_status == -1) {
+        fprintf(stderr, "runescope: Target program terminated abnormally.\n");
+        return -1;
+    } else if (WIFSIGNALED(root_status)) {
+        fprintf(stderr, "runescope: Target program terminated by signal %d\n", WTERMSIG(root_status));
+        return -1;
+    }
+    return write_failed ? -1 : WEXITSTATUS(root_status);
+}
+
+#else
+
+int rune_profile_run(const char *executable_path, char *const argv_target[],
+                     const rune_profile_options_t *options, FILE *out) {
+    (void)executable_path;
+    (void)argv_target;
+    (void)options;
+    (void)out;
+    fprintf(stderr, "runescope: Error: The sampling profiler is only supported on x86-64 and AArch64.\n");
+    return -1;
+}
+
+#endif
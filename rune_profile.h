@@ -0,0 +1,49 @@
+#ifndef RUNE_PROFILE_H
+#define RUNE_PROFILE_H
+
+#include <stdio.h>
+
+/**
+ * @brief Sampling CPU profiler producing collapsed stacks for flame graphs.
+ *
+ * The target runs under PTRACE_SEIZE but is not stopped on syscalls. At
+ * every tick, each traced thread that is running or runnable according to
+ * /proc/<tid>/stat is stopped with PTRACE_INTERRUPT, its stack is walked
+ * through the frame pointer chain with process_vm_readv, and it is resumed
+ * straight away. Sleeping threads cost one read of their stat file.
+ *
+ * Return addresses are symbolized against the .symtab (or .dynsym) of the
+ * object mapped at that address in /proc/<pid>/maps. Symbol tables are
+ * loaded once per file and shared by every process of the target; the maps
+ * of a process are read again after exec and when an address falls outside
+ * every known mapping.
+ *
+ * Frames of code built without frame pointers are skipped, so such stacks
+ * are truncated or attributed to the wrong caller. Build the target with
+ * -fno-omit-frame-pointer for complete stacks; a leaf function compiled
+ * without its own frame still hides its direct caller.
+ */
+
+typedef struct {
+    int frequency;            // Samples per second per running thread
+    const char *output_path;  // Collapsed stacks file to write
+} rune_profile_options_t;
+
+/**
+ * @brief Runs a target program under the sampling profiler.
+ *
+ * Writes one "comm;outermost;...;innermost count" line per distinct stack,
+ * the input format of flamegraph.pl, and prints the sample counts, the
+ * functions with the most self samples and the CPU time sampling cost
+ * compared to the CPU time of the target.
+ *
+ * @param executable_path The absolute path to the target executable.
+ * @param argv_target The target's arguments, starting with argv[0].
+ * @param options The sampling frequency and output file.
+ * @param out The stream to print the summary to.
+ * @return The exit status of the executed program, or -1 if an error occurred in runescope itself.
+ */
+int rune_profile_run(const char *executable_path, char *const argv_target[],
+                     const rune_profile_options_t *options, FILE *out);
+
+#endif // RUNE_PROFILE_H
@@ -0,0 +1,497 @@
+#include "rune_rtrace.h"
+#include "rune_scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RTRACE_MAGIC "RTRACE\0\1"
+#define RTRACE_VERSION 2 // Version 1 files have no durations
+#define HEADER_SIZE 64
+#define INDEX_ENTRY_SIZE 48
+#define MAX_VARINT_BYTES 10
+#define ARG_SLOTS (RUNE_RTRACE_BLOCK_EVENTS * 2)
+
+// What the index records about one block
+typedef struct {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t count;
+    int64_t ts_min;
+    int64_t ts_max;
+    uint64_t pids_offset;  // Sorted int32 pids of the block
+    uint32_t pid_count;
+} block_info_t;
+
+// Distinct argument strings of the block being encoded, keyed by their text
+typedef struct {
+    uint32_t event;        // Event that first had this text, plus one; 0 = empty slot
+    uint32_t literal;      // Its position among the block's distinct arguments
+} arg_slot_t;
+
+// Growable byte buffer for encoding
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t capacity;
+} byte_buf_t;
+
+static int buf_reserve(byte_buf_t *buf, size_t extra) {
+    if (buf->len + extra <= buf->capacity) {
+        return 0;
+    }
+    size_t capacity = buf->capacity ? buf->capacity : 65536;
+    while (capacity < buf->len + extra) {
+        capacity *= 2;
+    }
+    unsigned char *data = realloc(buf->data, capacity);
+    if (data == NULL) {
+        perror("runescope: realloc failed for rtrace buffer");
+        return -1;
+    }
+    buf->data = data;
+    buf->capacity = capacity;
+    return 0;
+}
+
+// The caller reserves MAX_VARINT_BYTES first
+static void put_varint(byte_buf_t *buf, uint64_t value) {
+    while (value >= 0x80) {
+        buf->data[buf->len++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    buf->data[buf->len++] = (unsigned char)value;
+}
+
+// Maps small negative and positive numbers to small unsigned ones
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void put_u32(unsigned char *p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static void put_u64(unsigned char *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+// Returns the position after the varint, or NULL if it runs past end
+static const unsigned char *get_varint(const unsigned char *p, const unsigned char *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char byte = *p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static int compare_pids(const void *a, const void *b) {
+    int32_t pa = *(const int32_t *)a;
+    int32_t pb = *(const int32_t *)b;
+    return (pa > pb) - (pa < pb);
+}
+
+// FNV-1a over the argument bytes
+static size_t hash_args(rune_strview_t args) {
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < args.len; i++) {
+        hash = (hash ^ (unsigned char)args.ptr[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Encodes events [first, first + count) of the store into buf
+static int encode_block(const rune_store_t *store, size_t first, size_t count, byte_buf_t *buf,
+                        block_info_t *info, int32_t *pids, arg_slot_t *arg_slots) {
+    int64_t prev_ts = 0;
+    int64_t prev_pid = 0;
+    uint32_t literals = 0;
+    memset(arg_slots, 0, ARG_SLOTS * sizeof(arg_slot_t));
+    info->ts_min = INT64_MAX;
+    info->ts_max = INT64_MIN;
+    for (size_t i = first; i < first + count; i++) {
+        if (buf_reserve(buf, 1 + 7 * MAX_VARINT_BYTES + store->args_len[i]) == -1) {
+            return -1;
+        }
+        buf->data[buf->len++] = store->flags[i];
+        put_varint(buf, zigzag(store->timestamp_ns[i] - prev_ts));
+        put_varint(buf, zigzag((int64_t)store->pid[i] - prev_pid));
+        put_varint(buf, store->name_id[i]);
+        put_varint(buf, (uint64_t)(store->duration_ns[i] + 1)); // 0 = not recorded
+        put_varint(buf, zigzag(store->ret[i]));
+        if (store->flags[i] & RUNE_EVENT_ERROR) {
+            put_varint(buf, zigzag(store->err[i]));
+        }
+
+        // Arguments repeat a lot (same fd, path, futex word), so each distinct
+        // text is stored once per block and referred to by its position after that
+        rune_strview_t args = rune_store_args(store, i);
+        size_t slot = hash_args(args) & (ARG_SLOTS - 1);
+        while (arg_slots[slot].event != 0) {
+            rune_strview_t seen = rune_store_args(store, arg_slots[slot].event - 1);
+            if (seen.len == args.len && memcmp(seen.ptr, args.ptr, args.len) == 0) {
+                break;
+            }
+            slot = (slot + 1) & (ARG_SLOTS - 1);
+        }
+        if (arg_slots[slot].event != 0) {
+            put_varint(buf, arg_slots[slot].literal + 1);
+        } else {
+            arg_slots[slot].event = (uint32_t)i + 1;
+            arg_slots[slot].literal = literals++;
+            put_varint(buf, 0);
+            put_varint(buf, args.len);
+            memcpy(buf->data + buf->len, args.ptr, args.len);
+            buf->len += args.len;
+        }
+
+        prev_ts = store->timestamp_ns[i];
+        prev_pid = store->pid[i];
+        if (prev_ts < info->ts_min) {
+            info->ts_min = prev_ts;
+        }
+        if (prev_ts > info->ts_max) {
+            info->ts_max = prev_ts;
+        }
+        pids[i - first] = store->pid[i];
+    }
+
+    // The distinct pids of the block, sorted for binary search
+    qsort(pids, count, sizeof(int32_t), compare_pids);
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (distinct == 0 || pids[distinct - 1] != pids[i]) {
+            pids[distinct++] = pids[i];
+        }
+    }
+    info->pid_count = (uint32_t)distinct;
+    info->count = (uint32_t)count;
+    return 0;
+}
+
+int rune_rtrace_write(const rune_store_t *store, rune_rtrace_kind_t kind, const char *file_path) {
+    size_t num_blocks = (store->count + RUNE_RTRACE_BLOCK_EVENTS - 1) / RUNE_RTRACE_BLOCK_EVENTS;
+    block_info_t *blocks = calloc(num_blocks + 1, sizeof(block_info_t));
+    int32_t *block_pids = malloc(RUNE_RTRACE_BLOCK_EVENTS * sizeof(int32_t));
+    arg_slot_t *arg_slots = malloc(ARG_SLOTS * sizeof(arg_slot_t));
+    byte_buf_t buf = {0};
+    byte_buf_t pid_lists = {0};
+    FILE *file = fopen(file_path, "wb");
+    int result = -1;
+
+    if (blocks == NULL || block_pids == NULL || arg_slots == NULL) {
+        perror("runescope: allocation failed for rtrace writer");
+        goto out;
+    }
+    if (file == NULL) {
+        fprintf(stderr, "runescope: Failed to create rtrace file '%s': ", file_path);
+        perror(NULL);
+        goto out;
+    }
+
+    unsigned char header[HEADER_SIZE] = {0};
+    if (fwrite(header, 1, HEADER_SIZE, file) != HEADER_SIZE) {
+        goto write_error;
+    }
+    uint64_t offset = HEADER_SIZE;
+
+    for (size_t b = 0; b < num_blocks; b++) {
+        size_t first = b * RUNE_RTRACE_BLOCK_EVENTS;
+        size_t count = store->count - first < RUNE_RTRACE_BLOCK_EVENTS ? store->count - first : RUNE_RTRACE_BLOCK_EVENTS;
+        buf.len = 0;
+        if (encode_block(store, first, count, &buf, &blocks[b], block_pids, arg_slots) == -1) {
+            goto out;
+        }
+        if (fwrite(buf.data, 1, buf.len, file) != buf.len) {
+            goto write_error;
+        }
+        blocks[b].offset = offset;
+        blocks[b].size = (uint32_t)buf.len;
+        offset += buf.len;
+
+        blocks[b].pids_offset = pid_lists.len; // Made absolute once the section is placed
+        if (buf_reserve(&pid_lists, blocks[b].pid_count * sizeof(int32_t)) == -1) {
+            goto out;
+        }
+        for (uint32_t i = 0; i < blocks[b].pid_count; i++) {
+            put_u32(pid_lists.data + pid_lists.len, (uint32_t)block_pids[i]);
+            pid_lists.len += sizeof(int32_t);
+        }
+    }
+
+    // String table: varint length and bytes of every name, in ID order
+    uint64_t strings_offset = offset;
+    buf.len = 0;
+    for (size_t id = 0; id < store->names.count; id++) {
+        size_t name_len = strlen(store->names.strings[id]);
+        if (buf_reserve(&buf, MAX_VARINT_BYTES + name_len) == -1) {
+            goto out;
+        }
+        put_varint(&buf, name_len);
+        memcpy(buf.data + buf.len, store->names.strings[id], name_len);
+        buf.len += name_len;
+    }
+    if (fwrite(buf.data, 1, buf.len, file) != buf.len) {
+        goto write_error;
+    }
+    uint64_t strings_size = buf.len;
+    offset += buf.len;
+
+    uint64_t pids_offset = offset;
+    if (fwrite(pid_lists.data, 1, pid_lists.len, file) != pid_lists.len) {
+        goto write_error;
+    }
+    offset += pid_lists.len;
+
+    uint64_t index_offset = offset;
+    for (size_t b = 0; b < num_blocks; b++) {
+        unsigned char entry[INDEX_ENTRY_SIZE] = {0};
+        put_u64(entry, blocks[b].offset);
+        put_u32(entry + 8, blocks[b].size);
+        put_u32(entry + 12, blocks[b].count);
+        put_u64(entry + 16, (uint64_t)blocks[b].ts_min);
+        put_u64(entry + 24, (uint64_t)blocks[b].ts_max);
+        put_u64(entry + 32, pids_offset + blocks[b].pids_offset);
+        put_u32(entry + 40, blocks[b].pid_count);
+        if (fwrite(entry, 1, INDEX_ENTRY_SIZE, file) != INDEX_ENTRY_SIZE) {
+            goto write_error;
+        }
+    }
+
+    memcpy(header, RTRACE_MAGIC, 8);
+    put_u32(header + 8, RTRACE_VERSION);
+    put_u32(header + 12, (uint32_t)kind);
+    put_u64(header + 16, store->count);
+    put_u64(header + 24, strings_offset);
+    put_u64(header + 32, strings_size);
+    put_u32(header + 40, (uint32_t)store->names.count);
+    put_u32(header + 44, (uint32_t)num_blocks);
+    put_u64(header + 48, pids_offset);
+    put_u64(header + 56, index_offset);
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(header, 1, HEADER_SIZE, file) != HEADER_SIZE) {
+        goto write_error;
+    }
+    result = 0;
+    goto out;
+
+write_error:
+    fprintf(stderr, "runescope: Failed to write rtrace file '%s': ", file_path);
+    perror(NULL);
+out:
+    if (file != NULL && fclose(file) != 0 && result == 0) {
+        fprintf(stderr, "runescope: Failed to write rtrace file '%s': ", file_path);
+        perror(NULL);
+        result = -1;
+    }
+    free(blocks);
+    free(block_pids);
+    free(arg_slots);
+    free(buf.data);
+    free(pid_lists.data);
+    return result;
+}
+
+// Binary search in a block's little-endian pid list
+static int block_has_pid(const unsigned char *pids, uint32_t count, long pid) {
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        long candidate = (int32_t)get_u32(pids + (size_t)mid * 4);
+        if (candidate == pid) {
+            return 1;
+        }
+        if (candidate < pid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0;
+}
+
+static int event_matches(const rune_rtrace_filter_t *filter, int64_t ts, long pid) {
+    return (filter->from_ns == 0 || ts >= filter->from_ns) &&
+           (filter->to_ns == 0 || ts <= filter->to_ns) &&
+           (filter->pid == 0 || pid == filter->pid);
+}
+
+// Decodes one block into the store; returns 0 on success, -1 if it is corrupt or
+// (with store->failed set) memory ran out
+static int decode_block(const unsigned char *p, const unsigned char *end, uint32_t count, const uint32_t *id_map,
+                        uint32_t num_names, const rune_rtrace_filter_t *filter, rune_store_t *store,
+                        rune_strview_t *literals, uint32_t version) {
+    int64_t ts = 0;
+    int64_t pid = 0;
+    uint32_t num_literals = 0;
+    if (count > RUNE_RTRACE_BLOCK_EVENTS) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t ts_delta, pid_delta, name_id, duration = 0, ret, err = 0, args_ref;
+        if (p >= end) {
+            return -1;
+        }
+        int flags = *p++;
+        if ((p = get_varint(p, end, &ts_delta)) == NULL ||
+            (p = get_varint(p, end, &pid_delta)) == NULL ||
+            (p = get_varint(p, end, &name_id)) == NULL ||
+            (version >= 2 && (p = get_varint(p, end, &duration)) == NULL) ||
+            (p = get_varint(p, end, &ret)) == NULL ||
+            ((flags & RUNE_EVENT_ERROR) && (p = get_varint(p, end, &err)) == NULL) ||
+            (p = get_varint(p, end, &args_ref)) == NULL ||
+            name_id >= num_names || args_ref > num_literals) {
+            return -1;
+        }
+        if (args_ref == 0) {
+            uint64_t args_len;
+            if ((p = get_varint(p, end, &args_len)) == NULL || args_len > (uint64_t)(end - p)) {
+                return -1;
+            }
+            literals[num_literals++] = rune_strview_make((const char *)p, args_len);
+            p += args_len;
+            args_ref = num_literals;
+        }
+        ts += unzigzag(ts_delta);
+        pid += unzigzag(pid_delta);
+        if (event_matches(filter, ts, (long)pid) &&
+            rune_store_add_interned(store, (long)pid, id_map[name_id], (long)unzigzag(ret), (int)unzigzag(err), flags,
+                                    ts, (int64_t)duration - 1, literals[args_ref - 1]) == -1) {
+            store->failed = 1;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int rune_rtrace_load(const char *file_path, const rune_rtrace_filter_t *filter, rune_store_t *store,
+                     rune_rtrace_kind_t *kind, size_t *blocks_read, size_t *blocks_total) {
+    static const rune_rtrace_filter_t no_filter = {0, 0, 0};
+    if (filter == NULL) {
+        filter = &no_filter;
+    }
+
+    const char *mapping;
+    size_t len;
+    if (rune_scan_map_file(file_path, "rtrace file", &mapping, &len) == -1) {
+        return -1;
+    }
+    if (mapping == NULL) {
+        fprintf(stderr, "runescope: rtrace file '%s' is empty.\n", file_path);
+        return -1;
+    }
+    const unsigned char *data = (const unsigned char *)mapping;
+    uint32_t *id_map = NULL;
+    rune_strview_t *literals = malloc(RUNE_RTRACE_BLOCK_EVENTS * sizeof(rune_strview_t));
+    size_t decoded = 0;
+    int result = -1;
+
+    if (literals == NULL) {
+        perror("runescope: malloc failed for rtrace arguments");
+        goto out;
+    }
+    uint32_t version = len >= HEADER_SIZE ? get_u32(data + 8) : 0;
+    if (len < HEADER_SIZE || memcmp(data, RTRACE_MAGIC, 8) != 0 || version < 1 || version > RTRACE_VERSION) {
+        fprintf(stderr, "runescope: '%s' is not an rtrace file.\n", file_path);
+        goto out;
+    }
+    uint32_t file_kind = get_u32(data + 12);
+    if (file_kind != RUNE_RTRACE_STRACE && file_kind != RUNE_RTRACE_LTRACE) {
+        goto corrupt;
+    }
+    uint64_t strings_offset = get_u64(data + 24);
+    uint64_t strings_size = get_u64(data + 32);
+    uint32_t num_names = get_u32(data + 40);
+    uint32_t num_blocks = get_u32(data + 44);
+    uint64_t index_offset = get_u64(data + 56);
+    if (strings_offset > len || strings_size > len - strings_offset || index_offset > len ||
+        (uint64_t)num_blocks * INDEX_ENTRY_SIZE > len - index_offset) {
+        goto corrupt;
+    }
+
+    // Intern the string table; IDs in the file map to IDs in the store
+    id_map = malloc(((size_t)num_names + 1) * sizeof(uint32_t));
+    if (id_map == NULL) {
+        perror("runescope: malloc failed for rtrace names");
+        goto out;
+    }
+    const unsigned char *p = data + strings_offset;
+    const unsigned char *strings_end = p + strings_size;
+    for (uint32_t id = 0; id < num_names; id++) {
+        uint64_t name_len;
+        if ((p = get_varint(p, strings_end, &name_len)) == NULL || name_len > (uint64_t)(strings_end - p)) {
+            goto corrupt;
+        }
+        long store_id = rune_intern_id(&store->names, (const char *)p, name_len);
+        if (store_id == -1) {
+            goto out;
+        }
+        id_map[id] = (uint32_t)store_id;
+        p += name_len;
+    }
+
+    for (uint32_t b = 0; b < num_blocks; b++) {
+        const unsigned char *entry = data + index_offset + (size_t)b * INDEX_ENTRY_SIZE;
+        uint64_t offset = get_u64(entry);
+        uint32_t size = get_u32(entry + 8);
+        uint32_t count = get_u32(entry + 12);
+        int64_t ts_min = (int64_t)get_u64(entry + 16);
+        int64_t ts_max = (int64_t)get_u64(entry + 24);
+        uint64_t pids_offset = get_u64(entry + 32);
+        uint32_t pid_count = get_u32(entry + 40);
+        if (offset > len || size > len - offset || pids_offset > len || (uint64_t)pid_count * 4 > len - pids_offset) {
+            goto corrupt;
+        }
+
+        // The index rules out whole blocks without touching their data
+        if ((filter->from_ns != 0 && ts_max < filter->from_ns) || (filter->to_ns != 0 && ts_min > filter->to_ns) ||
+            (filter->pid != 0 && !block_has_pid(data + pids_offset, pid_count, filter->pid))) {
+            continue;
+        }
+        if (decode_block(data + offset, data + offset + size, count, id_map, num_names, filter, store, literals, version) == -1) {
+            if (store->failed) {
+                goto out; // Out of memory, already reported by the store
+            }
+            goto corrupt;
+        }
+        decoded++;
+    }
+
+    *kind = (rune_rtrace_kind_t)file_kind;
+    if (blocks_read != NULL) {
+        *blocks_read = decoded;
+    }
+    if (blocks_total != NULL) {
+        *blocks_total = num_blocks;
+    }
+    result = 0;
+    goto out;
+
+corrupt:
+    fprintf(stderr, "runescope: rtrace file '%s' is truncated or corrupt.\n", file_path);
+out:
+    free(id_map);
+    free(literals);
+    rune_scan_unmap_file(mapping, len);
+    return result;
+}
@@ -0,0 +1,64 @@
+#ifndef RUNE_RTRACE_H
+#define RUNE_RTRACE_H
+
+#include <stdint.h>
+#include "rune_store.h"
+
+/**
+ * @brief The .rtrace binary trace format.
+ *
+ * A compact, indexed alternative to keeping strace/ltrace text logs around.
+ * Events are stored in blocks of up to RUNE_RTRACE_BLOCK_EVENTS; within a
+ * block, timestamps and pids are zigzag varints relative to the previous
+ * event, names are varint IDs into a string table stored once per file, and
+ * an argument text already seen in the block is stored as a back-reference.
+ * An index records every block's time range and the sorted set of pids it
+ * contains, so a reader can skip straight to the blocks of a time window or
+ * a pid without decoding the rest. Multi-byte fields outside the blocks are
+ * little-endian.
+ *
+ * Layout: header, blocks, string table, per-block pid lists, block index.
+ */
+
+#define RUNE_RTRACE_BLOCK_EVENTS 4096
+
+// Which tool the events came from
+typedef enum {
+    RUNE_RTRACE_STRACE = 1,
+    RUNE_RTRACE_LTRACE = 2
+} rune_rtrace_kind_t;
+
+// Selects the events to load; a zeroed filter selects everything
+typedef struct {
+    int64_t from_ns;  // Skip events before this time (0 = no lower bound)
+    int64_t to_ns;    // Skip events after this time (0 = no upper bound)
+    long pid;         // Only this pid (0 = every pid)
+} rune_rtrace_filter_t;
+
+/**
+ * @brief Writes the events of a store to a .rtrace file.
+ *
+ * @param store The events to write.
+ * @param kind The tool the events came from.
+ * @param file_path The path of the file to create or overwrite.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_rtrace_write(const rune_store_t *store, rune_rtrace_kind_t kind, const char *file_path);
+
+/**
+ * @brief Loads the events of a .rtrace file that match a filter into a store.
+ *
+ * The file is mapped, and blocks the index rules out are never decoded.
+ *
+ * @param file_path The path of the .rtrace file.
+ * @param filter The events to load, or NULL for all of them.
+ * @param store An initialized store that receives the events.
+ * @param kind Receives the tool the events came from.
+ * @param blocks_read If not NULL, receives the number of blocks decoded.
+ * @param blocks_total If not NULL, receives the number of blocks in the file.
+ * @return 0 on success, -1 on failure (missing, truncated or corrupt file).
+ */
+int rune_rtrace_load(const char *file_path, const rune_rtrace_filter_t *filter, rune_store_t *store,
+                     rune_rtrace_kind_t *kind, size_t *blocks_read, size_t *blocks_total);
+
+#endif // RUNE_RTRACE_H
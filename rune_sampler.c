@@ -0,0 +1,659 @@
+#define _POSIX_C_SOURCE 200809L // For openat and fdopendir
+#include "rune_sampler.h"
+#include "rune_latency.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define READ_BUFFER 4096
+#define TIMELINE_SLOTS 20
+#define TIMELINE_BAR 40
+#define MAX_LISTED_PROCESSES 20
+
+// The pids of the tree at one sample
+typedef struct {
+    pid_t *pids;
+    size_t count;
+    size_t capacity;
+} pid_list_t;
+
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Reads a small /proc file relative to a directory; its length, or -1 if it cannot be read
+static ssize_t read_at(int dir_fd, const char *name, char *buf, size_t size) {
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    ssize_t len = read(fd, buf, size - 1);
+    close(fd);
+    if (len < 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+// The number on the "key:   value" line of a status-like file, 0 if there is none
+static long long field_value(const char *text, const char *key) {
+    size_t key_len = strlen(key);
+    const char *line = text;
+    while (line != NULL && *line != '\0') {
+        if (strncmp(line, key, key_len) == 0 && line[key_len] == ':') {
+            return strtoll(line + key_len + 1, NULL, 10);
+        }
+        line = strchr(line, '\n');
+        if (line != NULL) {
+            line++;
+        }
+    }
+    return 0;
+}
+
+// Reads the command, parent and CPU ticks of a stat file; -1 if the process is gone
+static int read_stat(int dir_fd, const char *name, char *comm, size_t comm_size, pid_t *ppid,
+                     unsigned long long *ticks) {
+    char buf[1024];
+    if (read_at(dir_fd, name, buf, sizeof(buf)) <= 0) {
+        return -1;
+    }
+    // The command may contain spaces and parentheses; it ends at the last ')'
+    char *open_paren = strchr(buf, '(');
+    char *close_paren = strrchr(buf, ')');
+    if (open_paren == NULL || close_paren == NULL || close_paren < open_paren) {
+        return -1;
+    }
+    if (comm != NULL) {
+        size_t len = (size_t)(close_paren - open_paren - 1);
+        if (len >= comm_size) {
+            len = comm_size - 1;
+        }
+        memcpy(comm, open_paren + 1, len);
+        comm[len] = '\0';
+    }
+    // state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+    char state;
+    int parent;
+    unsigned long long utime, stime;
+    if (sscanf(close_paren + 1, " %c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &state, &parent, &utime,
+               &stime) != 4) {
+        return -1;
+    }
+    *ppid = parent;
+    if (ticks != NULL) {
+        *ticks = utime + stime;
+    }
+    return 0;
+}
+
+static int list_contains(const pid_list_t *list, pid_t pid) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (list->pids[i] == pid) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int list_add(pid_list_t *list, pid_t pid) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        pid_t *pids = realloc(list->pids, capacity * sizeof(pid_t));
+        if (pids == NULL) {
+            return -1;
+        }
+        list->pids = pids;
+        list->capacity = capacity;
+    }
+    list->pids[list->count++] = pid;
+    return 0;
+}
+
+// Adds the children of every thread of pid, from /proc/<pid>/task/<tid>/children
+static int add_children(pid_t pid, pid_list_t *list) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+    int task_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (task_fd == -1) {
+        return 0; // Already gone
+    }
+    DIR *dir = fdopendir(task_fd);
+    if (dir == NULL) {
+        close(task_fd);
+        return 0;
+    }
+    int result = 0;
+    struct dirent *entry;
+    char buf[READ_BUFFER];
+    while (result == 0 && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%.16s/children", entry->d_name);
+        if (read_at(task_fd, path, buf, sizeof(buf)) <= 0) {
+            continue;
+        }
+        char *cursor = buf;
+        for (;;) {
+            char *end;
+            long child = strtol(cursor, &end, 10);
+            if (end == cursor) {
+                break;
+            }
+            cursor = end;
+            if (!list_contains(list, (pid_t)child) && list_add(list, (pid_t)child) == -1) {
+                result = -1;
+                break;
+            }
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+// Adds every descendant of the pids already listed, from the parent of each process in /proc
+static int add_descendants_by_ppid(pid_list_t *list) {
+    DIR *proc = opendir("/proc");
+    if (proc == NULL) {
+        perror("runescope: opendir failed for /proc");
+        return -1;
+    }
+    pid_list_t pids = {0};
+    pid_list_t parents = {0};
+    int result = 0;
+    struct dirent *entry;
+    char name[64];
+    while ((entry = readdir(proc)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        pid_t ppid;
+        snprintf(name, sizeof(name), "%.32s/stat", entry->d_name);
+        if (read_stat(dirfd(proc), name, NULL, 0, &ppid, NULL) == -1) {
+            continue;
+        }
+        if (list_add(&pids, (pid_t)atoi(entry->d_name)) == -1 || list_add(&parents, ppid) == -1) {
+            result = -1;
+            break;
+        }
+    }
+    closedir(proc);
+
+    // A child can come before its parent in /proc, so repeat until nothing is added
+    int added = result == 0;
+    while (added) {
+        added = 0;
+        for (size_t i = 0; i < pids.count; i++) {
+            if (!list_contains(list, pids.pids[i]) && list_contains(list, parents.pids[i])) {
+                if (list_add(list, pids.pids[i]) == -1) {
+                    result = -1;
+                    break;
+                }
+                added = 1;
+            }
+        }
+    }
+    free(pids.pids);
+    free(parents.pids);
+    return result;
+}
+
+int rune_sampler_init(rune_sampler_t *sampler, int interval_ms) {
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->interval_ms = interval_ms;
+    sampler->root = -1;
+    sampler->ticks_per_second = sysconf(_SC_CLK_TCK);
+    if (sampler->ticks_per_second <= 0) {
+        sampler->ticks_per_second = 100;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/children", (int)getpid());
+    sampler->use_children = access(path, R_OK) == 0;
+    return 0;
+}
+
+void rune_sampler_attach(rune_sampler_t *sampler, pid_t root, int skip_root) {
+    sampler->root = root;
+    sampler->skip_root = skip_root;
+    sampler->start_ns = clock_ns(CLOCK_MONOTONIC);
+}
+
+// The thread entry of tid, added if needed; NULL on allocation failure
+static rune_sampler_thread_t *find_thread(rune_sampler_process_t *process, pid_t tid) {
+    for (size_t i = 0; i < process->num_threads; i++) {
+        if (process->threads[i].tid == tid) {
+            return &process->threads[i];
+        }
+    }
+    if (process->num_threads == process->threads_capacity) {
+        size_t capacity = process->threads_capacity ? process->threads_capacity * 2 : 8;
+        rune_sampler_thread_t *threads = realloc(process->threads, capacity * sizeof(rune_sampler_thread_t));
+        if (threads == NULL) {
+            return NULL;
+        }
+        process->threads = threads;
+        process->threads_capacity = capacity;
+    }
+    rune_sampler_thread_t *thread = &process->threads[process->num_threads++];
+    memset(thread, 0, sizeof(*thread));
+    thread->tid = tid;
+    return thread;
+}
+
+// How much a counter grew; a smaller reading means the tid was reused by a new thread
+static int64_t grown(int64_t now, int64_t before) {
+    return now >= before ? now - before : now;
+}
+
+// Adds what every thread did since the last sample to its process
+static int sample_threads(rune_sampler_process_t *process, int64_t *run_delta, int64_t *delay_delta) {
+    *run_delta = 0;
+    *delay_delta = 0;
+    int task_fd = openat(process->dir_fd, "task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (task_fd == -1) {
+        return 0;
+    }
+    DIR *dir = fdopendir(task_fd);
+    if (dir == NULL) {
+        close(task_fd);
+        return 0;
+    }
+    for (size_t i = 0; i < process->num_threads; i++) {
+        process->threads[i].seen = 0;
+    }
+    int result = 0;
+    struct dirent *entry;
+    char path[64];
+    char buf[READ_BUFFER];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        long long run = 0, delay = 0;
+        snprintf(path, sizeof(path), "%.16s/schedstat", entry->d_name);
+        if (read_at(task_fd, path, buf, sizeof(buf)) <= 0 || sscanf(buf, "%lld %lld", &run, &delay) != 2) {
+            continue; // Exited meanwhile
+        }
+        snprintf(path, sizeof(path), "%.16s/status", entry->d_name);
+        long voluntary = 0, involuntary = 0;
+        if (read_at(task_fd, path, buf, sizeof(buf)) > 0) {
+            voluntary = (long)field_value(buf, "voluntary_ctxt_switches");
+            involuntary = (long)field_value(buf, "nonvoluntary_ctxt_switches");
+        }
+
+        rune_sampler_thread_t *thread = find_thread(process, (pid_t)atoi(entry->d_name));
+        if (thread == NULL) {
+            result = -1;
+            break;
+        }
+        *run_delta += grown(run, thread->run_ns);
+        *delay_delta += grown(delay, thread->delay_ns);
+        process->voluntary_switches += (long)grown(voluntary, thread->voluntary_switches);
+        process->involuntary_switches += (long)grown(involuntary, thread->involuntary_switches);
+        thread->run_ns = run;
+        thread->delay_ns = delay;
+        thread->voluntary_switches = voluntary;
+        thread->involuntary_switches = involuntary;
+        thread->seen = 1;
+    }
+    closedir(dir);
+
+    // Forget the threads that exited
+    size_t kept = 0;
+    for (size_t i = 0; i < process->num_threads; i++) {
+        if (process->threads[i].seen) {
+            process->threads[kept++] = process->threads[i];
+        }
+    }
+    process->num_threads = kept;
+    process->run_ns += *run_delta;
+    process->delay_ns += *delay_delta;
+    return result;
+}
+
+// Samples one process; 1 if it was sampled, 0 if it is gone, -1 on allocation failure
+static int sample_process(rune_sampler_t *sampler, rune_sampler_process_t *process, int64_t now,
+                          rune_sampler_point_t *point) {
+    unsigned long long ticks;
+    if (read_stat(process->dir_fd, "stat", process->comm, sizeof(process->comm), &process->ppid, &ticks) == -1) {
+        close(process->dir_fd);
+        process->dir_fd = -1;
+        return 0;
+    }
+    process->cpu_ns = (int64_t)(ticks * 1000000000ull / (unsigned long long)sampler->ticks_per_second);
+
+    // Empty once a process has exited and released its memory
+    char buf[READ_BUFFER];
+    long rss = 0, pss = 0, swap = 0;
+    if (read_at(process->dir_fd, "smaps_rollup", buf, sizeof(buf)) > 0) {
+        rss = (long)field_value(buf, "Rss");
+        pss = (long)field_value(buf, "Pss");
+        swap = (long)field_value(buf, "Swap");
+    }
+    if (read_at(process->dir_fd, "io", buf, sizeof(buf)) > 0) {
+        process->rchar = (uint64_t)field_value(buf, "rchar");
+        process->wchar = (uint64_t)field_value(buf, "wchar");
+        process->read_bytes = (uint64_t)field_value(buf, "read_bytes");
+        process->write_bytes = (uint64_t)field_value(buf, "write_bytes");
+    }
+
+    int64_t run_delta, delay_delta;
+    int first = process->last_ns < 0;
+    if (sample_threads(process, &run_delta, &delay_delta) == -1) {
+        return -1;
+    }
+    if (first) {
+        process->first_ns = now;
+    } else {
+        // Each reading stands for the interval that ends with it
+        double dt = (double)(now - process->last_ns);
+        process->rss_area += (double)rss * dt;
+        process->pss_area += (double)pss * dt;
+        process->swap_area += (double)swap * dt;
+        if (run_delta + delay_delta > 0) {
+            double ratio = (double)delay_delta / (double)(run_delta + delay_delta);
+            if (ratio > process->peak_delay_ratio) {
+                process->peak_delay_ratio = ratio;
+            }
+        }
+    }
+    process->last_ns = now;
+    process->rss_kb = rss;
+    process->pss_kb = pss;
+    process->swap_kb = swap;
+    if (rss > process->peak_rss_kb) {
+        process->peak_rss_kb = rss;
+    }
+    if (pss > process->peak_pss_kb) {
+        process->peak_pss_kb = pss;
+    }
+    if (swap > process->peak_swap_kb) {
+        process->peak_swap_kb = swap;
+    }
+
+    point->rss_kb += rss;
+    point->pss_kb += pss;
+    point->swap_kb += swap;
+    point->cpu_ns += run_delta;
+    point->delay_ns += delay_delta;
+    point->processes++;
+    return 1;
+}
+
+// The index of the live process pid, added if needed; -1 if it is gone, -2 on allocation failure
+static long find_process(rune_sampler_t *sampler, pid_t pid) {
+    for (size_t i = 0; i < sampler->num_processes; i++) {
+        if (sampler->processes[i].pid == pid && sampler->processes[i].dir_fd != -1) {
+            return (long)i;
+        }
+    }
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d", (int)pid);
+    // Holding the directory keeps reading this process, not a later one with the same pid
+    int dir_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        return -1;
+    }
+    if (sampler->num_processes == sampler->processes_capacity) {
+        size_t capacity = sampler->processes_capacity ? sampler->processes_capacity * 2 : 16;
+        rune_sampler_process_t *processes = realloc(sampler->processes, capacity * sizeof(rune_sampler_process_t));
+        if (processes == NULL) {
+            close(dir_fd);
+            return -2;
+        }
+        sampler->processes = processes;
+        sampler->processes_capacity = capacity;
+    }
+    rune_sampler_process_t *process = &sampler->processes[sampler->num_processes];
+    memset(process, 0, sizeof(*process));
+    process->pid = pid;
+    process->dir_fd = dir_fd;
+    process->last_ns = -1;
+    return (long)sampler->num_processes++;
+}
+
+int rune_sampler_sample(rune_sampler_t *sampler) {
+    if (sampler->root <= 0) {
+        return 0;
+    }
+    int64_t cpu_before = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    int64_t now = clock_ns(CLOCK_MONOTONIC) - sampler->start_ns;
+
+    pid_list_t tree = {0};
+    int result = list_add(&tree, sampler->root);
+    if (sampler->use_children) {
+        for (size_t i = 0; result == 0 && i < tree.count; i++) {
+            result = add_children(tree.pids[i], &tree);
+        }
+    } else if (result == 0) {
+        result = add_descendants_by_ppid(&tree);
+    }
+
+    rune_sampler_point_t point = {0};
+    point.time_ns = now;
+    for (size_t i = 0; result == 0 && i < tree.count; i++) {
+        if (sampler->skip_root && tree.pids[i] == sampler->root) {
+            continue;
+        }
+        long index = find_process(sampler, tree.pids[i]);
+        if (index == -2) {
+            result = -1;
+        } else if (index >= 0) {
+            result = sample_process(sampler, &sampler->processes[index], now, &point) == -1 ? -1 : 0;
+        }
+    }
+    // Processes that left the tree, such as daemons reparented to init, are still ours
+    for (size_t i = 0; result == 0 && i < sampler->num_processes; i++) {
+        rune_sampler_process_t *process = &sampler->processes[i];
+        if (process->dir_fd != -1 && process->last_ns != now) {
+            result = sample_process(sampler, process, now, &point) == -1 ? -1 : 0;
+        }
+    }
+    free(tree.pids);
+
+    if (result == 0) {
+        if (sampler->num_points == sampler->points_capacity) {
+            size_t capacity = sampler->points_capacity ? sampler->points_capacity * 2 : 256;
+            rune_sampler_point_t *points = realloc(sampler->points, capacity * sizeof(rune_sampler_point_t));
+            if (points == NULL) {
+                result = -1;
+            } else {
+                sampler->points = points;
+                sampler->points_capacity = capacity;
+            }
+        }
+        if (result == 0) {
+            sampler->points[sampler->num_points++] = point;
+        }
+    }
+    if (result == -1) {
+        perror("runescope: allocation failed for process sampler");
+    }
+    sampler->sampling_ns += clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_before;
+    return result;
+}
+
+static const char *format_kb(long kb, char *buf, size_t size) {
+    if (kb >= 10240) {
+        snprintf(buf, size, "%.1fMB", (double)kb / 1024.0);
+    } else {
+        snprintf(buf, size, "%ldKB", kb);
+    }
+    return buf;
+}
+
+// The time-weighted average of a value, or its only reading
+static long average_kb(double area, int64_t span, long last) {
+    return span > 0 ? (long)(area / (double)span + 0.5) : last;
+}
+
+static int by_peak_pss(const void *a, const void *b) {
+    const rune_sampler_process_t *pa = *(const rune_sampler_process_t *const *)a;
+    const rune_sampler_process_t *pb = *(const rune_sampler_process_t *const *)b;
+    if (pa->peak_pss_kb != pb->peak_pss_kb) {
+        return pa->peak_pss_kb < pb->peak_pss_kb ? 1 : -1;
+    }
+    return pa->first_ns < pb->first_ns ? -1 : pa->first_ns > pb->first_ns;
+}
+
+static void print_tree(const rune_sampler_t *sampler, FILE *out) {
+    const rune_sampler_point_t *points = sampler->points;
+    size_t count = sampler->num_points;
+    long peak[3] = {0};
+    double area[3] = {0};
+    int64_t run = 0, delay = 0;
+    double worst_ratio = 0;
+    int64_t worst_at = 0;
+    for (size_t i = 0; i < count; i++) {
+        long values[3] = {points[i].rss_kb, points[i].pss_kb, points[i].swap_kb};
+        for (int k = 0; k < 3; k++) {
+            if (values[k] > peak[k]) {
+                peak[k] = values[k];
+            }
+            if (i > 0) {
+                area[k] += (double)values[k] * (double)(points[i].time_ns - points[i - 1].time_ns);
+            }
+        }
+        run += points[i].cpu_ns;
+        delay += points[i].delay_ns;
+        if (i > 0 && points[i].cpu_ns + points[i].delay_ns > 0) {
+            double ratio = (double)points[i].delay_ns / (double)(points[i].cpu_ns + points[i].delay_ns);
+            if (ratio > worst_ratio) {
+                worst_ratio = ratio;
+                worst_at = points[i - 1].time_ns;
+            }
+        }
+    }
+    int64_t span = count > 0 ? points[count - 1].time_ns - points[0].time_ns : 0;
+    const long last[3] = {count > 0 ? points[count - 1].rss_kb : 0, count > 0 ? points[count - 1].pss_kb : 0,
+                          count > 0 ? points[count - 1].swap_kb : 0};
+    static const char *const labels[3] = {"RSS", "PSS", "Swap"};
+    char a[32], b[32];
+
+    fprintf(out, "\nWhole tree            Peak   Average\n");
+    for (int k = 0; k < 3; k++) {
+        fprintf(out, "  %-12s %10s %9s\n", labels[k], format_kb(peak[k], a, sizeof(a)),
+                format_kb(average_kb(area[k], span, last[k]), b, sizeof(b)));
+    }
+    fprintf(out, "  Run queue wait %s, %.1f%% of the time runnable", rune_latency_format(delay, a, sizeof(a)),
+            run + delay > 0 ? 100.0 * (double)delay / (double)(run + delay) : 0.0);
+    if (worst_ratio > 0) {
+        fprintf(out, "; worst interval %.1f%% at %.3fs", 100.0 * worst_ratio, (double)worst_at / 1e9);
+    }
+    fprintf(out, "\n");
+
+    if (count < 2 || span <= 0) {
+        return;
+    }
+    // Peak PSS and run queue wait in each slot of the run
+    long slot_pss[TIMELINE_SLOTS] = {0};
+    int64_t slot_run[TIMELINE_SLOTS] = {0};
+    int64_t slot_delay[TIMELINE_SLOTS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = (size_t)((double)(points[i].time_ns - points[0].time_ns) / (double)span * TIMELINE_SLOTS);
+        if (slot >= TIMELINE_SLOTS) {
+            slot = TIMELINE_SLOTS - 1;
+        }
+        if (points[i].pss_kb > slot_pss[slot]) {
+            slot_pss[slot] = points[i].pss_kb;
+        }
+        if (i > 0) {
+            slot_run[slot] += points[i].cpu_ns;
+            slot_delay[slot] += points[i].delay_ns;
+        }
+    }
+    fprintf(out, "\nPSS of the tree over the run (peak in each 1/%d) and run queue wait:\n", TIMELINE_SLOTS);
+    for (int s = 0; s < TIMELINE_SLOTS; s++) {
+        double at = (double)s * (double)span / TIMELINE_SLOTS / 1e9;
+        int bar = peak[1] ? (int)((double)slot_pss[s] / (double)peak[1] * TIMELINE_BAR + 0.5) : 0;
+        int64_t runnable = slot_run[s] + slot_delay[s];
+        if (runnable > 0) {
+            snprintf(b, sizeof(b), "%5.1f%%", 100.0 * (double)slot_delay[s] / (double)runnable);
+        } else {
+            snprintf(b, sizeof(b), "%6s", "-");
+        }
+        fprintf(out, "  %9.3fs %9s %s  %.*s\n", at, format_kb(slot_pss[s], a, sizeof(a)), b, bar,
+                "########################################");
+    }
+}
+
+void rune_sampler_print(const rune_sampler_t *sampler, FILE *out) {
+    char a[32], b[32], c[32], d[32], e[32], f[32];
+    int64_t span = sampler->num_points > 0
+                       ? sampler->points[sampler->num_points - 1].time_ns - sampler->points[0].time_ns
+                       : 0;
+    fprintf(out, "\n--- Process Sampler ---\n");
+    fprintf(out, "%zu samples every %dms over %.3fs, %zu process%s seen\n", sampler->num_points,
+            sampler->interval_ms, (double)span / 1e9, sampler->num_processes,
+            sampler->num_processes == 1 ? "" : "es");
+    fprintf(out, "Sampling cost %s of CPU in runescope\n", rune_latency_format(sampler->sampling_ns, a, sizeof(a)));
+    if (sampler->num_processes == 0) {
+        fprintf(out, "The target exited before it could be sampled; try a shorter interval.\n");
+        return;
+    }
+    print_tree(sampler, out);
+
+    const rune_sampler_process_t **sorted = malloc(sampler->num_processes * sizeof(*sorted));
+    if (sorted == NULL) {
+        perror("runescope: allocation failed for process sampler report");
+        return;
+    }
+    for (size_t i = 0; i < sampler->num_processes; i++) {
+        sorted[i] = &sampler->processes[i];
+    }
+    qsort(sorted, sampler->num_processes, sizeof(*sorted), by_peak_pss);
+    size_t listed = sampler->num_processes < MAX_LISTED_PROCESSES ? sampler->num_processes : MAX_LISTED_PROCESSES;
+
+    fprintf(out, "\nMemory per process (averages weighted by time), largest peak PSS first:\n");
+    fprintf(out, "%8s %-16s %9s %9s %9s %9s %9s %9s\n", "PID", "Command", "Seen(s)", "Peak RSS", "Avg RSS",
+            "Peak PSS", "Avg PSS", "Peak swap");
+    for (size_t i = 0; i < listed; i++) {
+        const rune_sampler_process_t *p = sorted[i];
+        int64_t seen = p->last_ns - p->first_ns;
+        fprintf(out, "%8d %-16.16s %9.3f %9s %9s %9s %9s %9s\n", (int)p->pid, p->comm, (double)seen / 1e9,
+                format_kb(p->peak_rss_kb, a, sizeof(a)), format_kb(average_kb(p->rss_area, seen, p->rss_kb), b, sizeof(b)),
+                format_kb(p->peak_pss_kb, c, sizeof(c)), format_kb(average_kb(p->pss_area, seen, p->pss_kb), d, sizeof(d)),
+                format_kb(p->peak_swap_kb, e, sizeof(e)));
+    }
+
+    // The kernel adds the I/O of a child to its parent when it is waited for
+    fprintf(out, "\nActivity per process (read/write: storage I/O, then all read and write calls;\n"
+                 "a parent's I/O includes that of the children it has waited for):\n");
+    fprintf(out, "%8s %-16s %9s %9s %6s %9s %9s %15s %15s\n", "PID", "Command", "CPU", "RQ wait", "Worst",
+            "Vol CS", "Invol CS", "Read", "Written");
+    for (size_t i = 0; i < listed; i++) {
+        const rune_sampler_process_t *p = sorted[i];
+        char read[40], written[40];
+        snprintf(read, sizeof(read), "%s/%s", rune_latency_format_bytes(p->read_bytes, c, sizeof(c)),
+                 rune_latency_format_bytes(p->rchar, d, sizeof(d)));
+        snprintf(written, sizeof(written), "%s/%s", rune_latency_format_bytes(p->write_bytes, e, sizeof(e)),
+                 rune_latency_format_bytes(p->wchar, f, sizeof(f)));
+        fprintf(out, "%8d %-16.16s %9s %9s %5.1f%% %9ld %9ld %15s %15s\n", (int)p->pid, p->comm,
+                rune_latency_format(p->cpu_ns, a, sizeof(a)), rune_latency_format(p->delay_ns, b, sizeof(b)),
+                100.0 * p->peak_delay_ratio, p->voluntary_switches, p->involuntary_switches, read, written);
+    }
+    if (sampler->num_processes > listed) {
+        fprintf(out, "... and %zu more processes\n", sampler->num_processes - listed);
+    }
+    free(sorted);
+}
+
+void rune_sampler_free(rune_sampler_t *sampler) {
+    for (size_t i = 0; i < sampler->num_processes; i++) {
+        if (sampler->processes[i].dir_fd != -1) {
+            close(sampler->processes[i].dir_fd);
+        }
+        free(sampler->processes[i].threads);
+    }
+    free(sampler->processes);
+    free(sampler->points);
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->root = -1;
+}
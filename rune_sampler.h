@@ -0,0 +1,116 @@
+#ifndef RUNE_SAMPLER_H
+#define RUNE_SAMPLER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * @brief Memory, I/O and scheduler timeline of a process tree, read from /proc.
+ *
+ * While the target runs, every process of its tree is sampled at a fixed
+ * interval: RSS, PSS and swap from /proc/<pid>/smaps_rollup, context
+ * switches from status, bytes read and written from io, CPU time from stat
+ * and the time spent waiting on a run queue from the schedstat of each
+ * thread. Nothing is injected into the target; the cost is a few small
+ * reads per process per interval, paid by runescope.
+ *
+ * Processes are found by following /proc/<pid>/task/<tid>/children from
+ * the root, or by scanning the PPid of every process in /proc when the
+ * kernel lacks that file (CONFIG_PROC_CHILDREN). A process that lives
+ * shorter than one interval may never be seen, and what a process does
+ * between its last sample and its exit is lost, except for the root, which
+ * is sampled once more as a zombie before it is reaped.
+ */
+
+// The last readings of one thread, to add up what changed since
+typedef struct {
+    pid_t tid;
+    int64_t run_ns;             // On a CPU, from schedstat
+    int64_t delay_ns;           // Waiting on a run queue, from schedstat
+    long voluntary_switches;
+    long involuntary_switches;
+    int seen;                   // Present at the current sample
+} rune_sampler_thread_t;
+
+// What was seen of one process
+typedef struct {
+    pid_t pid;
+    pid_t ppid;
+    char comm[32];
+    int dir_fd;                 // /proc/<pid>, -1 once the process is gone
+    int64_t first_ns;           // When it was first and last sampled, from the start of the run
+    int64_t last_ns;
+    long rss_kb, pss_kb, swap_kb;                 // Latest sample
+    long peak_rss_kb, peak_pss_kb, peak_swap_kb;
+    double rss_area, pss_area, swap_area;         // kB * ns, for the time-weighted averages
+    uint64_t read_bytes, write_bytes;             // Storage I/O
+    uint64_t rchar, wchar;                        // All read() and write() traffic, cache hits and pipes included
+    long voluntary_switches, involuntary_switches; // Of every thread seen
+    int64_t cpu_ns;                               // User and system time from stat, clock tick resolution
+    int64_t run_ns;                               // Time on a CPU of every thread seen, from schedstat
+    int64_t delay_ns;                             // Run queue wait of every thread seen
+    double peak_delay_ratio;                      // Highest wait / (wait + run) over one interval
+    rune_sampler_thread_t *threads;               // Per-thread schedstat readings
+    size_t num_threads, threads_capacity;
+} rune_sampler_process_t;
+
+// Totals over the tree at one sample
+typedef struct {
+    int64_t time_ns;            // From the start of the run
+    long rss_kb, pss_kb, swap_kb;
+    int64_t cpu_ns;             // Used since the previous sample
+    int64_t delay_ns;           // Waited on a run queue since the previous sample
+    int processes;
+} rune_sampler_point_t;
+
+typedef struct {
+    int interval_ms;
+    pid_t root;
+    int skip_root;              // The root is a tracing tool: sample only what it runs
+    int64_t start_ns;           // CLOCK_MONOTONIC at attach
+    int use_children;           // /proc/<pid>/task/<tid>/children exists
+    long ticks_per_second;
+    rune_sampler_process_t *processes;
+    size_t num_processes, processes_capacity;
+    rune_sampler_point_t *points;
+    size_t num_points, points_capacity;
+    int64_t sampling_ns;        // CPU time runescope spent sampling
+} rune_sampler_t;
+
+/**
+ * @brief Prepares a sampler.
+ *
+ * @param sampler The sampler to initialize.
+ * @param interval_ms Time between samples, in milliseconds.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_sampler_init(rune_sampler_t *sampler, int interval_ms);
+
+/**
+ * @brief Starts sampling the tree of a freshly started process.
+ *
+ * @param sampler The sampler.
+ * @param root The process whose descendants, and itself unless skip_root, are sampled.
+ * @param skip_root Leave the root out, when it only runs the target (strace, ltrace).
+ */
+void rune_sampler_attach(rune_sampler_t *sampler, pid_t root, int skip_root);
+
+/**
+ * @brief Takes one sample of every process in the tree.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_sampler_sample(rune_sampler_t *sampler);
+
+/**
+ * @brief Prints the per-process peaks and averages and the tree's timeline.
+ */
+void rune_sampler_print(const rune_sampler_t *sampler, FILE *out);
+
+/**
+ * @brief Closes the /proc files and releases the memory held by a sampler.
+ */
+void rune_sampler_free(rune_sampler_t *sampler);
+
+#endif // RUNE_SAMPLER_H
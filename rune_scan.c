@@ -0,0 +1,287 @@
+#define _DEFAULT_SOURCE // For madvise
+#include "rune_scan.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Characters that open or close a nesting level or a string inside call arguments
+static int is_structural(char c) {
+    return c == '"' || c == '(' || c == ')' || c == '{' || c == '}' || c == '[' || c == ']';
+}
+
+// Finds the next structural character, 16 bytes at a time where SSE2 is available
+static const char *next_structural(const char *p, const char *end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i open_paren = _mm_set1_epi8('(');
+    const __m128i close_paren = _mm_set1_epi8(')');
+    const __m128i open_brace = _mm_set1_epi8('{');
+    const __m128i close_brace = _mm_set1_epi8('}');
+    const __m128i open_bracket = _mm_set1_epi8('[');
+    const __m128i close_bracket = _mm_set1_epi8(']');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, open_paren)),
+                         _mm_or_si128(_mm_cmpeq_epi8(chunk, close_paren), _mm_cmpeq_epi8(chunk, open_brace))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, close_brace),
+                         _mm_or_si128(_mm_cmpeq_epi8(chunk, open_bracket), _mm_cmpeq_epi8(chunk, close_bracket))));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; p++) {
+        if (is_structural(*p)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Finds the next quote or backslash inside a quoted string
+static const char *next_quote_or_escape(const char *p, const char *end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; p++) {
+        if (*p == '"' || *p == '\\') {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Returns the position just after the quote that closes a string starting at p
+static const char *skip_string(const char *p, const char *end) {
+    for (;;) {
+        const char *q = next_quote_or_escape(p, end);
+        if (q == NULL) {
+            return NULL; // Unterminated string
+        }
+        if (*q == '"') {
+            return q + 1;
+        }
+        p = q + 2; // Skip the escaped character
+        if (p > end) {
+            return NULL;
+        }
+    }
+}
+
+const char *rune_scan_args_end(const char *p, const char *end) {
+    int depth = 0;
+    for (;;) {
+        const char *q = next_structural(p, end);
+        if (q == NULL) {
+            return NULL;
+        }
+        switch (*q) {
+        case '"':
+            q = skip_string(q + 1, end);
+            if (q == NULL) {
+                return NULL;
+            }
+            p = q;
+            continue;
+        case '(':
+        case '{':
+        case '[':
+            depth++;
+            break;
+        default:
+            if (depth == 0) {
+                return *q == ')' ? q : NULL; // Unbalanced '}' or ']'
+            }
+            depth--;
+            break;
+        }
+        p = q + 1;
+    }
+}
+
+size_t rune_scan_split_args(const char *p, const char *end, rune_strview_t *args, size_t max_args) {
+    size_t count = 0;
+    p = rune_scan_skip_spaces(p, end);
+    while (p < end && count < max_args) {
+        const char *start = p;
+        int depth = 0;
+        while (p < end && (depth > 0 || *p != ',')) {
+            if (*p == '"') {
+                p = skip_string(p + 1, end);
+                if (p == NULL) {
+                    p = end; // Unterminated string: the rest is one argument
+                }
+                continue;
+            }
+            if (*p == '(' || *p == '{' || *p == '[') {
+                depth++;
+            } else if ((*p == ')' || *p == '}' || *p == ']') && depth > 0) {
+                depth--;
+            }
+            p++;
+        }
+        const char *arg_end = p;
+        while (arg_end > start && arg_end[-1] == ' ') {
+            arg_end--;
+        }
+        args[count++] = rune_strview_make(start, (size_t)(arg_end - start));
+        if (p < end) {
+            p = rune_scan_skip_spaces(p + 1, end); // Skip the comma
+        }
+    }
+    return count;
+}
+
+const char *rune_scan_find(const char *p, const char *end, const char *marker) {
+    size_t marker_len = strlen(marker);
+    while ((size_t)(end - p) >= marker_len) {
+        const char *q = memchr(p, marker[0], (end - p) - marker_len + 1);
+        if (q == NULL) {
+            return NULL;
+        }
+        if (memcmp(q, marker, marker_len) == 0) {
+            return q;
+        }
+        p = q + 1;
+    }
+    return NULL;
+}
+
+const char *rune_scan_skip_spaces(const char *p, const char *end) {
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+const char *rune_scan_number(const char *p, const char *end, long *value) {
+    int negative = 0;
+    unsigned long result = 0;
+
+    if (p < end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+    const char *digits = p;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        p += 2;
+        digits = p;
+        for (; p < end; p++) {
+            char c = *p;
+            if (c >= '0' && c <= '9') {
+                result = result * 16 + (unsigned long)(c - '0');
+            } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                result = result * 16 + (unsigned long)((c | 0x20) - 'a' + 10);
+            } else {
+                break;
+            }
+        }
+    } else {
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            result = result * 10 + (unsigned long)(*p - '0');
+        }
+    }
+    if (p == digits) {
+        return NULL;
+    }
+
+    *value = negative ? -(long)result : (long)result;
+    return p;
+}
+
+const char *rune_scan_seconds(const char *p, const char *end, int64_t *ns) {
+    const char *digits = p;
+    int64_t seconds = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        seconds = seconds * 10 + (*p - '0');
+    }
+    if (p == digits) {
+        return NULL;
+    }
+
+    int64_t fraction = 0;
+    int64_t scale = 1000000000;
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (*p - '0') * scale;
+            }
+        }
+    }
+    *ns = seconds * 1000000000 + fraction;
+    return p;
+}
+
+int rune_scan_map_file(const char *file_path, const char *what, const char **data, size_t *len) {
+    *data = NULL;
+    *len = 0;
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "runescope: Failed to open %s '%s': ", what, file_path);
+        perror(NULL);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("runescope: fstat failed");
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0; // Nothing to map
+    }
+
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "runescope: mmap failed on %s '%s': ", what, file_path);
+        perror(NULL);
+        return -1;
+    }
+    madvise(mapping, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    *data = mapping;
+    *len = (size_t)st.st_size;
+    return 0;
+}
+
+void rune_scan_unmap_file(const char *data, size_t len) {
+    if (data != NULL) {
+        munmap((void *)data, len);
+    }
+}
+
+void rune_scan_split_lines(const char *data, size_t len, size_t num_chunks, size_t *offsets) {
+    offsets[0] = 0;
+    for (size_t i = 1; i < num_chunks; i++) {
+        size_t pos = len / num_chunks * i;
+        if (pos < offsets[i - 1]) {
+            pos = offsets[i - 1]; // The previous chunk ran past this split point
+        }
+        const char *newline = memchr(data + pos, '\n', len - pos);
+        offsets[i] = newline != NULL ? (size_t)(newline - data) + 1 : len;
+    }
+    offsets[num_chunks] = len;
+}
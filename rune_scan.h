@@ -0,0 +1,107 @@
+#ifndef RUNE_SCAN_H
+#define RUNE_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rune_strview.h"
+
+/**
+ * @brief Low-level text scanning shared by the strace and ltrace parsers.
+ *
+ * All functions work on [p, end) ranges and never read past end, so they can
+ * run directly on a memory-mapped log that is not NUL-terminated.
+ */
+
+/**
+ * @brief Finds the parenthesis that closes an argument list.
+ *
+ * Quoted strings (with backslash escapes) are skipped and (), {} and []
+ * nesting is tracked, so a ')' inside a string or a nested structure does
+ * not end the list. Uses SSE2 to skip 16 bytes at a time where available.
+ *
+ * @param p The first character after the opening '('.
+ * @param end The end of the line.
+ * @return The position of the closing ')', or NULL if there is none on the line.
+ */
+const char *rune_scan_args_end(const char *p, const char *end);
+
+/**
+ * @brief Splits an argument list into its top-level arguments.
+ *
+ * Commas inside quoted strings and nested (), {} or [] do not split, so
+ * "3, \"a, b\", [4, 5]" is three arguments. Surrounding spaces are trimmed.
+ *
+ * @param p The start of the arguments (after the opening '(').
+ * @param end The end of the arguments (the closing ')').
+ * @param args Receives up to max_args arguments.
+ * @param max_args The size of args.
+ * @return The number of arguments stored in args.
+ */
+size_t rune_scan_split_args(const char *p, const char *end, rune_strview_t *args, size_t max_args);
+
+/**
+ * @brief Finds a marker such as " <unfinished ...>" in a line.
+ *
+ * @param p The start of the range to search.
+ * @param end The end of the range.
+ * @param marker The NUL-terminated marker.
+ * @return The position of the marker, or NULL if it does not occur.
+ */
+const char *rune_scan_find(const char *p, const char *end, const char *marker);
+
+/**
+ * @brief Skips spaces.
+ *
+ * @return The first position at or after p that is not a space.
+ */
+const char *rune_scan_skip_spaces(const char *p, const char *end);
+
+/**
+ * @brief Parses a decimal or 0x-prefixed hexadecimal integer, optionally negative.
+ *
+ * @param p The start of the number.
+ * @param end The end of the line.
+ * @param value Receives the parsed value.
+ * @return The position just after the number, or NULL if p does not start a number.
+ */
+const char *rune_scan_number(const char *p, const char *end, long *value);
+
+/**
+ * @brief Parses a non-negative decimal number of seconds such as "1700000000.123456".
+ *
+ * @param p The start of the number.
+ * @param end The end of the line.
+ * @param ns Receives the value in nanoseconds; digits beyond nanoseconds are ignored.
+ * @return The position just after the number, or NULL if p does not start a number.
+ */
+const char *rune_scan_seconds(const char *p, const char *end, int64_t *ns);
+
+/**
+ * @brief Maps a whole file read-only for sequential scanning.
+ *
+ * @param file_path The path of the file to map.
+ * @param what A description used in error messages (e.g. "strace log file").
+ * @param data Receives the mapping, or NULL if the file is empty. Release it
+ *             with rune_scan_unmap_file.
+ * @param len Receives the length of the file.
+ * @return 0 on success, including for an empty file, -1 on failure.
+ */
+int rune_scan_map_file(const char *file_path, const char *what, const char **data, size_t *len);
+
+/**
+ * @brief Releases a mapping obtained from rune_scan_map_file.
+ */
+void rune_scan_unmap_file(const char *data, size_t len);
+
+/**
+ * @brief Splits a buffer into chunks that each end on a line boundary.
+ *
+ * @param data The buffer.
+ * @param len The length of the buffer.
+ * @param num_chunks The number of chunks to split into.
+ * @param offsets Receives num_chunks + 1 offsets; chunk i is [offsets[i], offsets[i + 1]).
+ *                Chunks may be empty when the buffer has few lines.
+ */
+void rune_scan_split_lines(const char *data, size_t len, size_t num_chunks, size_t *offsets);
+
+#endif // RUNE_SCAN_H
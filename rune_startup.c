@@ -0,0 +1,738 @@
+#define _GNU_SOURCE // For PTRACE_GET_SYSCALL_INFO and mkdtemp
+#include "rune_startup.h"
+#include "rune_elf.h" // For rune_elf_lookup
+#include "rune_bench.h" // For rune_bench_stats
+#include "rune_latency.h" // For rune_latency_format
+#include <elf.h> // For AT_ENTRY and NT_PRSTATUS
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h> // For offsetof
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+
+#if defined(__x86_64__)
+#define RUNE_STARTUP_ARCH
+#define REG_PC(regs) ((regs).rip)
+#define REG_ARG0(regs) ((regs).rdi)
+#define BREAK_INSN 0xccUL // int3
+#define BREAK_MASK 0xffUL
+#define PC_AFTER_TRAP 1   // int3 traps with the pc past it
+#elif defined(__aarch64__)
+#define RUNE_STARTUP_ARCH
+#define REG_PC(regs) ((regs).pc)
+#define REG_ARG0(regs) ((regs).regs[0])
+#define BREAK_INSN 0xd4200000UL // brk #0
+#define BREAK_MASK 0xffffffffUL
+#define PC_AFTER_TRAP 0
+#endif
+
+#define FD_SLOTS 1024
+#define MAX_LISTED_PROBES 15
+#define CALIBRATION_NS 20000000
+
+// What the loader did for one shared object, keyed by the name it searched for
+typedef struct {
+    char *name;
+    char *path;         // Where it was found, NULL if every probe failed
+    size_t probes;      // Failed opens, stats and accesses of this name
+    int64_t probe_ns;
+    int64_t open_ns;    // The successful open or stat
+    int64_t map_ns;     // Reads, fstats, mmaps, mprotects and the close of it
+    size_t mmaps;
+    uint64_t low, high; // Address range of its mappings
+} startup_object_t;
+
+typedef struct {
+    char *path;
+    int error;
+} startup_probe_t;
+
+typedef struct {
+    startup_object_t *objects;
+    size_t count;
+    size_t capacity;
+    int fd_object[FD_SLOTS]; // Index + 1 of the object open on a descriptor, 0 = none
+    startup_probe_t listed[MAX_LISTED_PROBES];
+    size_t num_listed;
+    size_t total_probes;
+    int64_t total_probe_ns;
+    const char *skip_prefix; // LD_DEBUG output, not the target's own files
+} startup_trace_t;
+
+// The first "runtime linker statistics" block of LD_DEBUG=statistics
+typedef struct {
+    uint64_t total_cycles;
+    uint64_t relocation_cycles;
+    uint64_t load_cycles;
+    unsigned long relocations;
+    unsigned long relative;
+    unsigned long cached;
+} ld_stats_t;
+
+typedef struct {
+    const char *executable_path;
+    char *const *argv;
+    uint64_t entry_offset; // Relative to the executable's load address
+    uint64_t main_offset;
+    int have_main;
+} startup_target_t;
+
+typedef struct {
+    pid_t pid;
+    int64_t exec_ns;  // Since the target was released, minus the time runescope held it
+    int64_t entry_ns;
+    int64_t main_ns;
+    int reached_entry;
+    int reached_main;
+} startup_run_t;
+
+typedef struct {
+    uint64_t address;
+    unsigned long saved;
+    int armed;
+} breakpoint_t;
+
+#ifdef RUNE_STARTUP_ARCH
+
+static int64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static int read_string(pid_t pid, uint64_t address, char *buf, size_t size) {
+    for (size_t used = 0; used + sizeof(long) <= size; used += sizeof(long)) {
+        errno = 0;
+        long word = ptrace(PTRACE_PEEKDATA, pid, (void *)(uintptr_t)(address + used), NULL);
+        if (errno != 0) {
+            return -1;
+        }
+        memcpy(buf + used, &word, sizeof(word));
+        if (memchr(&word, '\0', sizeof(word)) != NULL) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int access_regs(pid_t pid, struct user_regs_struct *regs, int set) {
+    struct iovec iov = { regs, sizeof(*regs) };
+    return ptrace(set ? PTRACE_SETREGSET : PTRACE_GETREGSET, pid, (void *)(uintptr_t)NT_PRSTATUS, &iov) == -1 ? -1 : 0;
+}
+
+static int insert_breakpoint(pid_t pid, breakpoint_t *bp, uint64_t address) {
+    errno = 0;
+    long word = ptrace(PTRACE_PEEKTEXT, pid, (void *)(uintptr_t)address, NULL);
+    if (errno != 0) {
+        return -1;
+    }
+    unsigned long patched = ((unsigned long)word & ~BREAK_MASK) | BREAK_INSN;
+    if (ptrace(PTRACE_POKETEXT, pid, (void *)(uintptr_t)address, (void *)patched) == -1) {
+        return -1;
+    }
+    bp->address = address;
+    bp->saved = (unsigned long)word;
+    bp->armed = 1;
+    return 0;
+}
+
+static void remove_breakpoint(pid_t pid, breakpoint_t *bp) {
+    ptrace(PTRACE_POKETEXT, pid, (void *)(uintptr_t)bp->address, (void *)bp->saved);
+    bp->armed = 0;
+}
+
+static uint64_t auxv_entry(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/auxv", (int)pid);
+    FILE *auxv = fopen(path, "r");
+    uint64_t pair[2], entry = 0;
+    while (auxv != NULL && fread(pair, sizeof(pair), 1, auxv) == 1 && pair[0] != AT_NULL) {
+        if (pair[0] == AT_ENTRY) {
+            entry = pair[1];
+        }
+    }
+    if (auxv != NULL) {
+        fclose(auxv);
+    }
+    return entry;
+}
+
+// Finds the mapping of libc's first page, where its load address is
+static int find_libc(pid_t pid, char *libc_path, size_t size, uint64_t *base) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", (int)pid);
+    FILE *maps = fopen(path, "r");
+    if (maps == NULL) {
+        return -1;
+    }
+    char line[4096 + 128];
+    int found = -1;
+    while (found == -1 && fgets(line, sizeof(line), maps) != NULL) {
+        unsigned long start, end, offset;
+        int path_start = 0;
+        if (sscanf(line, "%lx-%lx %*s %lx %*s %*s %n", &start, &end, &offset, &path_start) < 3 || path_start == 0 ||
+            offset != 0) {
+            continue;
+        }
+        char *name = line + path_start;
+        name[strcspn(name, "\n")] = '\0';
+        const char *base_name = strrchr(name, '/') != NULL ? strrchr(name, '/') + 1 : name;
+        if (strncmp(base_name, "libc.so", 7) == 0 || strncmp(base_name, "libc-", 5) == 0) {
+            snprintf(libc_path, size, "%s", name);
+            *base = start;
+            found = 0;
+        }
+    }
+    fclose(maps);
+    return found;
+}
+
+static startup_object_t *object_for(startup_trace_t *trace, const char *name) {
+    for (size_t i = 0; i < trace->count; i++) {
+        if (strcmp(trace->objects[i].name, name) == 0) {
+            return &trace->objects[i];
+        }
+    }
+    if (trace->count == trace->capacity) {
+        size_t capacity = trace->capacity ? trace->capacity * 2 : 32;
+        startup_object_t *grown = realloc(trace->objects, capacity * sizeof(startup_object_t));
+        if (grown == NULL) {
+            perror("runescope: realloc failed for startup objects");
+            return NULL;
+        }
+        trace->objects = grown;
+        trace->capacity = capacity;
+    }
+    startup_object_t *object = &trace->objects[trace->count];
+    memset(object, 0, sizeof(*object));
+    object->name = strdup(name);
+    object->low = UINT64_MAX;
+    if (object->name == NULL) {
+        perror("runescope: strdup failed for startup object");
+        return NULL;
+    }
+    trace->count++;
+    return object;
+}
+
+// Index of the path argument of the syscalls the loader searches with, -1 for others
+static int path_argument(long nr) {
+    switch (nr) {
+#ifdef SYS_open
+    case SYS_open:
+#endif
+#ifdef SYS_access
+    case SYS_access:
+#endif
+#ifdef SYS_stat
+    case SYS_stat:
+#endif
+        return 0;
+    case SYS_openat:
+    case SYS_faccessat:
+#ifdef SYS_faccessat2
+    case SYS_faccessat2:
+#endif
+#ifdef SYS_newfstatat
+    case SYS_newfstatat:
+#endif
+    case SYS_statx:
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+static int is_open(long nr) {
+#ifdef SYS_open
+    if (nr == SYS_open) {
+        return 1;
+    }
+#endif
+    return nr == SYS_openat;
+}
+
+static void record_syscall(startup_trace_t *trace, pid_t pid, long nr, const uint64_t *args, long long rval,
+                           int is_error, int64_t ns) {
+    int path_arg = path_argument(nr);
+    char path[4096];
+    if (path_arg >= 0 && read_string(pid, args[path_arg], path, sizeof(path)) == 0 && path[0] != '\0') {
+        if (trace->skip_prefix != NULL && strncmp(path, trace->skip_prefix, strlen(trace->skip_prefix)) == 0) {
+            return;
+        }
+        const char *name = strrchr(path, '/') != NULL ? strrchr(path, '/') + 1 : path;
+        startup_object_t *object = object_for(trace, name);
+        if (object == NULL) {
+            return;
+        }
+        if (is_error) {
+            object->probes++;
+            object->probe_ns += ns;
+            trace->total_probes++;
+            trace->total_probe_ns += ns;
+            if (trace->num_listed < MAX_LISTED_PROBES) {
+                startup_probe_t *probe = &trace->listed[trace->num_listed];
+                probe->path = strdup(path);
+                probe->error = (int)-rval;
+                trace->num_listed += probe->path != NULL;
+            }
+        } else {
+            object->open_ns += ns;
+            if (object->path == NULL) {
+                object->path = strdup(path);
+            }
+            if (is_open(nr) && rval >= 0 && rval < FD_SLOTS) {
+                trace->fd_object[rval] = (int)(object - trace->objects) + 1;
+            }
+        }
+        return;
+    }
+
+    long fd = -1;
+    if (path_arg >= 0) {
+        fd = (long)args[0]; // AT_EMPTY_PATH: a stat of the descriptor itself
+    } else if (nr == SYS_read || nr == SYS_pread64 || nr == SYS_close
+#ifdef SYS_fstat
+               || nr == SYS_fstat
+#endif
+    ) {
+        fd = (long)args[0];
+    } else if (nr == SYS_mmap) {
+        fd = (int)args[4];
+    } else if (nr == SYS_mprotect || nr == SYS_munmap) {
+        for (size_t i = 0; i < trace->count; i++) {
+            if (args[0] >= trace->objects[i].low && args[0] < trace->objects[i].high) {
+                trace->objects[i].map_ns += ns;
+                break;
+            }
+        }
+        return;
+    }
+    if (fd < 0 || fd >= FD_SLOTS || trace->fd_object[fd] == 0) {
+        return;
+    }
+    startup_object_t *object = &trace->objects[trace->fd_object[fd] - 1];
+    object->map_ns += ns;
+    if (nr == SYS_mmap && !is_error) {
+        object->mmaps++;
+        object->low = (uint64_t)rval < object->low ? (uint64_t)rval : object->low;
+        object->high = (uint64_t)rval + args[1] > object->high ? (uint64_t)rval + args[1] : object->high;
+    } else if (nr == SYS_close) {
+        trace->fd_object[fd] = 0;
+    }
+}
+
+// Starts the target stopped before execve and follows it to main; with a trace, every syscall before the entry point is recorded
+static int run_once(startup_target_t *target, char *const envp[], startup_trace_t *trace, startup_run_t *run) {
+    memset(run, 0, sizeof(*run));
+    fflush(stdout); // Don't let the child inherit unflushed output
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("runescope: fork failed");
+        return -1;
+    } else if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd != -1) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) == -1) {
+            perror("runescope: PTRACE_TRACEME failed");
+            _exit(EXIT_FAILURE);
+        }
+        raise(SIGSTOP);
+        execve(target->executable_path, target->argv, envp);
+        perror("runescope: execve target failed");
+        _exit(EXIT_FAILURE);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) == -1 || !WIFSTOPPED(status) ||
+        ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)(PTRACE_O_TRACEEXEC | PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL)) == -1) {
+        perror("runescope: failed to trace the target");
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    run->pid = pid;
+
+    breakpoint_t entry_bp = {0}, start_bp = {0}, main_bp = {0};
+    uint64_t exe_base = 0;
+    int in_syscall = 0;
+    long nr = 0;
+    uint64_t args[6] = {0};
+    int64_t held_ns = 0;
+    int request = trace != NULL ? PTRACE_SYSCALL : PTRACE_CONT;
+    int64_t started_ns = monotonic_ns();
+    int64_t resumed_ns = started_ns;
+    ptrace(request, pid, NULL, NULL);
+    for (;;) {
+        if (waitpid(pid, &status, 0) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("runescope: waitpid failed");
+            break;
+        }
+        int64_t stopped_ns = monotonic_ns();
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            return 0; // Exited before main
+        }
+        int64_t now = stopped_ns - started_ns - held_ns;
+        int sig = WSTOPSIG(status);
+        int inject_signal = 0;
+        int done = 0;
+
+        if ((unsigned int)status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
+            run->exec_ns = now;
+            uint64_t entry = auxv_entry(pid);
+            exe_base = entry - target->entry_offset;
+            if (entry == 0 || insert_breakpoint(pid, &entry_bp, entry) == -1 ||
+                (target->have_main && insert_breakpoint(pid, &main_bp, exe_base + target->main_offset) == -1)) {
+                done = 1;
+            }
+        } else if (sig == (SIGTRAP | 0x80)) {
+            struct __ptrace_syscall_info info;
+            if (ptrace(PTRACE_GET_SYSCALL_INFO, pid, (void *)sizeof(info), &info) > 0) {
+                if (info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+                    in_syscall = 1;
+                    nr = (long)info.entry.nr;
+                    memcpy(args, info.entry.args, sizeof(args));
+                } else if (info.op == PTRACE_SYSCALL_INFO_EXIT && in_syscall) {
+                    in_syscall = 0;
+                    if (run->exec_ns > 0 && trace != NULL) {
+                        record_syscall(trace, pid, nr, args, info.exit.rval, info.exit.is_error, stopped_ns - resumed_ns);
+                    }
+                }
+            }
+        } else if (sig == SIGTRAP && (unsigned int)status >> 16 == 0) {
+            struct user_regs_struct regs;
+            uint64_t pc = 0;
+            if (access_regs(pid, &regs, 0) == 0) {
+                pc = REG_PC(regs) - PC_AFTER_TRAP;
+            }
+            breakpoint_t *hit = entry_bp.armed && entry_bp.address == pc ? &entry_bp
+                                : start_bp.armed && start_bp.address == pc ? &start_bp
+                                : main_bp.armed && main_bp.address == pc ? &main_bp : NULL;
+            if (hit == NULL) {
+                inject_signal = SIGTRAP; // Not ours
+            } else {
+                remove_breakpoint(pid, hit);
+                REG_PC(regs) = pc;
+                access_regs(pid, &regs, 1);
+                if (hit == &entry_bp) {
+                    run->entry_ns = now;
+                    run->reached_entry = 1;
+                    request = PTRACE_CONT; // The loader is done; stop recording syscalls
+                    char libc_path[4096];
+                    uint64_t libc_base, offset;
+                    if (!target->have_main && trace != NULL && find_libc(pid, libc_path, sizeof(libc_path), &libc_base) == 0 &&
+                        rune_elf_lookup(libc_path, "__libc_start_main", &offset) == 0) {
+                        insert_breakpoint(pid, &start_bp, libc_base + offset);
+                    }
+                    done = !start_bp.armed && !main_bp.armed;
+                } else if (hit == &start_bp) {
+                    // main is __libc_start_main's first argument, even in stripped executables
+                    uint64_t main_address = REG_ARG0(regs);
+                    if (insert_breakpoint(pid, &main_bp, main_address) == 0) {
+                        target->main_offset = main_address - exe_base;
+                        target->have_main = 1;
+                    } else {
+                        done = 1;
+                    }
+                } else {
+                    run->main_ns = now;
+                    run->reached_main = 1;
+                    done = 1;
+                }
+            }
+        } else if ((unsigned int)status >> 16 == 0) {
+            inject_signal = sig; // Signal-delivery-stop: pass the signal on
+        }
+
+        if (done) {
+            kill(pid, SIGKILL); // It never gets to do its real work
+            while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
+            }
+            return 0;
+        }
+        resumed_ns = monotonic_ns();
+        held_ns += resumed_ns - stopped_ns;
+        ptrace(request, pid, NULL, (void *)(long)inject_signal);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+static uint64_t read_cycles(void) {
+#if defined(__x86_64__)
+    return __builtin_ia32_rdtsc(); // What the loader's HP_TIMING counts on x86-64
+#else
+    uint64_t value;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value)); // And on AArch64
+    return value;
+#endif
+}
+
+static double ns_per_cycle(void) {
+    int64_t start_ns = monotonic_ns();
+    uint64_t start_cycles = read_cycles();
+    struct timespec pause = { 0, CALIBRATION_NS };
+    nanosleep(&pause, NULL);
+    uint64_t cycles = read_cycles() - start_cycles;
+    return cycles > 0 ? (double)(monotonic_ns() - start_ns) / (double)cycles : 0.0;
+}
+
+static void read_ld_stats(const char *path, ld_stats_t *stats) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+    static const struct {
+        const char *label;
+        size_t offset;
+        int is_cycles;
+    } fields[] = {
+        { "total startup time in dynamic loader:", offsetof(ld_stats_t, total_cycles), 1 },
+        { "time needed for relocation:", offsetof(ld_stats_t, relocation_cycles), 1 },
+        { "time needed to load objects:", offsetof(ld_stats_t, load_cycles), 1 },
+        { "number of relocations:", offsetof(ld_stats_t, relocations), 0 },
+        { "number of relative relocations:", offsetof(ld_stats_t, relative), 0 },
+        { "number of relocations from cache:", offsetof(ld_stats_t, cached), 0 },
+    };
+    char *line = NULL;
+    size_t line_size = 0;
+    while (getline(&line, &line_size, file) != -1) {
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+            const char *label = strstr(line, fields[i].label);
+            if (label == NULL || strstr(line, "final ") != NULL) {
+                continue;
+            }
+            unsigned long long value = strtoull(label + strlen(fields[i].label), NULL, 10);
+            char *field = (char *)stats + fields[i].offset;
+            if (fields[i].is_cycles && *(uint64_t *)field == 0) {
+                *(uint64_t *)field = value;
+            } else if (!fields[i].is_cycles && *(unsigned long *)field == 0) {
+                *(unsigned long *)field = (unsigned long)value;
+            }
+        }
+    }
+    free(line);
+    fclose(file);
+}
+
+static int compare_objects(const void *a, const void *b) {
+    const startup_object_t *x = a, *y = b;
+    int64_t cost_x = x->probe_ns + x->open_ns + x->map_ns;
+    int64_t cost_y = y->probe_ns + y->open_ns + y->map_ns;
+    return (cost_x < cost_y) - (cost_x > cost_y);
+}
+
+static double median(double *values, int count) {
+    rune_bench_stats_t stats;
+    rune_bench_stats(values, (size_t)count, &stats);
+    return stats.median;
+}
+
+static void print_phase(FILE *out, const char *label, double ns, double total_ns) {
+    char time[32];
+    fprintf(out, "  %-56s %10s %5.1f%%\n", label, rune_latency_format((int64_t)ns, time, sizeof(time)),
+            total_ns > 0 ? 100.0 * ns / total_ns : 0.0);
+}
+
+static void print_report(const char *executable_path, int runs, double exec, double loader, double start,
+                         int reached_main, const ld_stats_t *ld, double cycle_ns,
+                         startup_trace_t *trace, FILE *out) {
+    char time[32], label[96];
+    double total = exec + loader + (reached_main ? start : 0.0);
+    fprintf(out, "\n--- Startup timeline: %s (median of %d runs) ---\n", executable_path, runs);
+    fprintf(out, "Time to %s: %s\n", reached_main ? "main" : "the entry point (main not found)",
+            rune_latency_format((int64_t)total, time, sizeof(time)));
+    print_phase(out, "execve", exec, total);
+
+    int64_t traced_search = 0, traced_map = 0;
+    size_t found = 0;
+    for (size_t i = 0; i < trace->count; i++) {
+        traced_search += trace->objects[i].probe_ns + trace->objects[i].open_ns;
+        traced_map += trace->objects[i].map_ns;
+        found += trace->objects[i].mmaps > 0;
+    }
+    if (ld->total_cycles > 0 && cycle_ns > 0) {
+        // The loader's cycle counts split its time; syscall times split loading into search and mapping
+        double rtld = (double)ld->total_cycles * cycle_ns;
+        double load = (double)ld->load_cycles * cycle_ns;
+        double relocation = (double)ld->relocation_cycles * cycle_ns;
+        double search = traced_search + traced_map > 0 ? load * (double)traced_search / (double)(traced_search + traced_map) : 0.0;
+        snprintf(label, sizeof(label), "library search (%zu failed probes)", trace->total_probes);
+        print_phase(out, label, search, total);
+        snprintf(label, sizeof(label), "library mapping (%zu objects)", found);
+        print_phase(out, label, load - search, total);
+        snprintf(label, sizeof(label), "relocation (%lu relocations, %lu relative, %lu cached)", ld->relocations, ld->relative,
+                 ld->cached);
+        print_phase(out, label, relocation, total);
+        print_phase(out, "other dynamic loader work", rtld - load - relocation > 0 ? rtld - load - relocation : 0.0, total);
+        // Page faults and cache misses before the loader starts its clock land here too
+        print_phase(out, "library constructors and uncounted loader time", loader - rtld > 0 ? loader - rtld : 0.0, total);
+    } else {
+        print_phase(out, "dynamic loader and library constructors", loader, total);
+    }
+    if (reached_main) {
+        print_phase(out, "libc start-up and executable constructors", start, total);
+    }
+    if (ld->total_cycles == 0) {
+        fprintf(out, "No LD_DEBUG=statistics from the loader (static or set-user-ID executable).\n");
+    }
+
+    if (trace->count > 0) {
+        qsort(trace->objects, trace->count, sizeof(startup_object_t), compare_objects);
+        fprintf(out, "Files opened or probed before the entry point (syscall time under tracing):\n");
+        fprintf(out, "  %6s %10s %10s %10s %5s  %s\n", "probes", "wasted", "open", "mapping", "mmaps", "object");
+        char wasted[32], open_time[32], mapping[32];
+        for (size_t i = 0; i < trace->count; i++) {
+            const startup_object_t *object = &trace->objects[i];
+            fprintf(out, "  %6zu %10s %10s %10s %5zu  %s%s\n", object->probes,
+                    rune_latency_format(object->probe_ns, wasted, sizeof(wasted)),
+                    rune_latency_format(object->open_ns, open_time, sizeof(open_time)),
+                    rune_latency_format(object->map_ns, mapping, sizeof(mapping)), object->mmaps,
+                    object->path != NULL ? object->path : object->name, object->path != NULL ? "" : " (not found)");
+        }
+    }
+    if (trace->total_probes == 0) {
+        fprintf(out, "No wasted path probes.\n");
+        return;
+    }
+    fprintf(out, "Wasted path probes: %zu (%s under tracing)\n", trace->total_probes,
+            rune_latency_format(trace->total_probe_ns, time, sizeof(time)));
+    for (size_t i = 0; i < trace->num_listed; i++) {
+        fprintf(out, "  %s: %s\n", trace->listed[i].path, strerror(trace->listed[i].error));
+    }
+    if (trace->total_probes > trace->num_listed) {
+        fprintf(out, "  ... and %zu more\n", trace->total_probes - trace->num_listed);
+    }
+}
+
+static void free_trace(startup_trace_t *trace) {
+    for (size_t i = 0; i < trace->count; i++) {
+        free(trace->objects[i].name);
+        free(trace->objects[i].path);
+    }
+    free(trace->objects);
+    for (size_t i = 0; i < trace->num_listed; i++) {
+        free(trace->listed[i].path);
+    }
+}
+
+// The environment with LD_DEBUG=statistics written to a file under debug_dir
+static char **debug_environment(const char *debug_dir, char *output_var, size_t size) {
+    extern char **environ;
+    size_t count = 0;
+    while (environ[count] != NULL) {
+        count++;
+    }
+    char **envp = calloc(count + 3, sizeof(char *));
+    if (envp == NULL) {
+        perror("runescope: calloc failed for environment");
+        return NULL;
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(environ[i], "LD_DEBUG=", 9) != 0 && strncmp(environ[i], "LD_DEBUG_OUTPUT=", 16) != 0) {
+            envp[used++] = environ[i];
+        }
+    }
+    snprintf(output_var, size, "LD_DEBUG_OUTPUT=%s/ld", debug_dir);
+    envp[used++] = "LD_DEBUG=statistics";
+    envp[used++] = output_var;
+    return envp;
+}
+
+int rune_startup_report(const char *executable_path, char *const argv_target[], int runs, FILE *out) {
+    extern char **environ;
+    startup_target_t target = { executable_path, argv_target, 0, 0, 0 };
+    if (rune_elf_lookup(executable_path, NULL, &target.entry_offset) == -1) {
+        fprintf(stderr, "runescope: Error: %s is not a readable 64-bit little-endian ELF file.\n", executable_path);
+        return -1;
+    }
+    target.have_main = rune_elf_lookup(executable_path, "main", &target.main_offset) == 0;
+
+    char debug_dir[] = "/tmp/runescope_ld_XXXXXX";
+    if (mkdtemp(debug_dir) == NULL) {
+        perror("runescope: mkdtemp failed");
+        return -1;
+    }
+    startup_trace_t trace;
+    memset(&trace, 0, sizeof(trace));
+    trace.skip_prefix = debug_dir;
+    startup_run_t run;
+    int result = 0;
+
+    // First the syscall-level run, which also learns where main is and warms the page cache
+    if (run_once(&target, environ, &trace, &run) == -1 || !run.reached_entry) {
+        fprintf(stderr, "runescope: Error: The target never reached its entry point.\n");
+        result = -1;
+    }
+
+    ld_stats_t ld;
+    memset(&ld, 0, sizeof(ld));
+    char output_var[128];
+    char **envp = result == 0 ? debug_environment(debug_dir, output_var, sizeof(output_var)) : NULL;
+    if (envp != NULL && run_once(&target, envp, NULL, &run) == 0) {
+        char stats_path[128];
+        snprintf(stats_path, sizeof(stats_path), "%s/ld.%d", debug_dir, (int)run.pid);
+        read_ld_stats(stats_path, &ld);
+        unlink(stats_path);
+    }
+    free(envp);
+    rmdir(debug_dir);
+
+    double *times = result == 0 ? malloc(3 * (size_t)runs * sizeof(double)) : NULL;
+    if (result == 0 && times == NULL) {
+        perror("runescope: malloc failed for startup times");
+        result = -1;
+    }
+    int reached_main = 1;
+    for (int r = 0; result == 0 && r < runs; r++) {
+        if (run_once(&target, environ, NULL, &run) == -1 || !run.reached_entry) {
+            fprintf(stderr, "runescope: Error: The target never reached its entry point.\n");
+            result = -1;
+            break;
+        }
+        reached_main &= run.reached_main;
+        times[r] = (double)run.exec_ns;
+        times[runs + r] = (double)(run.entry_ns - run.exec_ns);
+        times[2 * runs + r] = run.reached_main ? (double)(run.main_ns - run.entry_ns) : 0.0;
+    }
+
+    if (result == 0) {
+        double exec = median(times, runs);
+        double loader = median(times + runs, runs);
+        double start = median(times + 2 * runs, runs);
+        print_report(executable_path, runs, exec, loader, start, reached_main, &ld, ns_per_cycle(), &trace, out);
+    }
+    free(times);
+    free_trace(&trace);
+    return result;
+}
+
+#else
+
+int rune_startup_report(const char *executable_path, char *const argv_target[], int runs, FILE *out) {
+    (void)executable_path;
+    (void)argv_target;
+    (void)runs;
+    (void)out;
+    fprintf(stderr, "runescope: Error: The startup timeline is only supported on x86-64 and AArch64.\n");
+    return -1;
+}
+
+#endif
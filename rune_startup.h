@@ -0,0 +1,42 @@
+#ifndef RUNE_STARTUP_H
+#define RUNE_STARTUP_H
+
+#include <stdio.h>
+
+/**
+ * @brief Measures where a process spends its time before main.
+ *
+ * The target is started under ptrace with one-shot breakpoints on its entry
+ * point and on main, and is killed when it reaches main, so it never does its
+ * real work. Three kinds of runs are made:
+ *
+ * - One run that stops on every syscall until the entry point, to attribute
+ *   the loader's path probes, opens and mappings to the shared objects.
+ *   When the executable has no main symbol, this run also learns main's
+ *   address from the first argument of __libc_start_main.
+ * - One run with LD_DEBUG=statistics, for the loader's own cycle counts of
+ *   loading objects and processing relocations.
+ * - The timed runs, which only stop at exec, the entry point and main. The
+ *   time runescope holds the target at a stop is subtracted.
+ *
+ * Only x86-64 and AArch64 are supported.
+ */
+
+/**
+ * @brief Prints the startup timeline of an executable.
+ *
+ * Reports the median time to main split into execve, library search,
+ * library mapping, relocation processing, other loader work, library
+ * constructors and the executable's own start-up, then per shared object
+ * the failed path probes and the syscall time spent finding and mapping it,
+ * and the probes that were wasted.
+ *
+ * @param executable_path The absolute path to the target executable.
+ * @param argv_target The target's arguments, starting with argv[0].
+ * @param runs The number of timed runs.
+ * @param out The stream to print to.
+ * @return 0 on success, -1 if the target could not be traced or never reached its entry point.
+ */
+int rune_startup_report(const char *executable_path, char *const argv_target[], int runs, FILE *out);
+
+#endif // RUNE_STARTUP_H
@@ -0,0 +1,203 @@
+#include "rune_stitch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_STITCHER_CAPACITY 64
+
+static size_t pid_hash(long pid, size_t capacity) {
+    return ((size_t)pid * 2654435761u) & (capacity - 1);
+}
+
+int rune_stitcher_init(rune_stitcher_t *stitcher) {
+    memset(stitcher, 0, sizeof(*stitcher));
+    stitcher->slots = calloc(INITIAL_STITCHER_CAPACITY, sizeof(rune_pending_call_t));
+    if (stitcher->slots == NULL) {
+        perror("runescope: calloc failed for stitcher");
+        return -1;
+    }
+    stitcher->capacity = INITIAL_STITCHER_CAPACITY;
+    return 0;
+}
+
+static rune_pending_call_t *find_pending(const rune_stitcher_t *stitcher, long pid) {
+    size_t i = pid_hash(pid, stitcher->capacity);
+    while (stitcher->slots[i].state != 0) {
+        if (stitcher->slots[i].state == 1 && stitcher->slots[i].pid == pid) {
+            return &stitcher->slots[i];
+        }
+        i = (i + 1) & (stitcher->capacity - 1);
+    }
+    return NULL;
+}
+
+// Rebuilds the table without deleted slots, doubling it if it is mostly live
+static int rehash(rune_stitcher_t *stitcher) {
+    size_t live = 0;
+    for (size_t i = 0; i < stitcher->capacity; i++) {
+        live += stitcher->slots[i].state == 1;
+    }
+    size_t capacity = live * 4 > stitcher->capacity ? stitcher->capacity * 2 : stitcher->capacity;
+
+    rune_pending_call_t *slots = calloc(capacity, sizeof(rune_pending_call_t));
+    if (slots == NULL) {
+        perror("runescope: calloc failed for stitcher");
+        return -1;
+    }
+    for (size_t i = 0; i < stitcher->capacity; i++) {
+        if (stitcher->slots[i].state != 1) {
+            continue;
+        }
+        size_t j = pid_hash(stitcher->slots[i].pid, capacity);
+        while (slots[j].state != 0) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = stitcher->slots[i];
+    }
+    free(stitcher->slots);
+    stitcher->slots = slots;
+    stitcher->capacity = capacity;
+    stitcher->used = live;
+    return 0;
+}
+
+int rune_stitcher_hold(rune_stitcher_t *stitcher, long pid, rune_strview_t name, rune_strview_t args,
+                       int64_t timestamp_ns, void (*on_replaced)(const rune_pending_call_t *call, void *user_data),
+                       void *user_data) {
+    rune_pending_call_t *call = find_pending(stitcher, pid);
+    if (call == NULL) {
+        if ((stitcher->used + 1) * 2 > stitcher->capacity && rehash(stitcher) == -1) {
+            return -1;
+        }
+        size_t i = pid_hash(pid, stitcher->capacity);
+        while (stitcher->slots[i].state == 1) {
+            i = (i + 1) & (stitcher->capacity - 1);
+        }
+        call = &stitcher->slots[i];
+        if (call->state == 0) {
+            stitcher->used++; // Reusing a deleted slot does not change the load
+        }
+        call->pid = pid;
+        call->state = 1;
+    } else {
+        if (on_replaced != NULL) {
+            on_replaced(call, user_data); // A call that never resumed
+        }
+        free(call->name);
+    }
+
+    // One allocation holds both copies
+    call->name = malloc(name.len + args.len + 1);
+    if (call->name == NULL) {
+        perror("runescope: malloc failed for unfinished call");
+        call->state = 2;
+        return -1;
+    }
+    memcpy(call->name, name.ptr, name.len);
+    call->name_len = name.len;
+    call->args = call->name + name.len;
+    memcpy(call->args, args.ptr, args.len);
+    call->args_len = args.len;
+    call->args[args.len] = '\0';
+    call->timestamp_ns = timestamp_ns;
+    call->seq = stitcher->next_seq++;
+    return 0;
+}
+
+int rune_stitcher_pending(const rune_stitcher_t *stitcher, long pid) {
+    return find_pending(stitcher, pid) != NULL;
+}
+
+int rune_stitcher_resume(rune_stitcher_t *stitcher, long pid, rune_strview_t args_tail,
+                         rune_strview_t *name, rune_strview_t *joined_args, int64_t *timestamp_ns) {
+    rune_pending_call_t *call = find_pending(stitcher, pid);
+    if (call == NULL) {
+        return 0;
+    }
+
+    // The scratch buffer holds the name followed by the joined arguments
+    size_t len = call->name_len + call->args_len + args_tail.len;
+    if (len > stitcher->joined_capacity) {
+        size_t capacity = stitcher->joined_capacity ? stitcher->joined_capacity : 256;
+        while (len > capacity) {
+            capacity *= 2;
+        }
+        char *joined = realloc(stitcher->joined, capacity);
+        if (joined == NULL) {
+            perror("runescope: realloc failed for resumed call");
+            return -1;
+        }
+        stitcher->joined = joined;
+        stitcher->joined_capacity = capacity;
+    }
+    memcpy(stitcher->joined, call->name, call->name_len);
+    memcpy(stitcher->joined + call->name_len, call->args, call->args_len);
+    memcpy(stitcher->joined + call->name_len + call->args_len, args_tail.ptr, args_tail.len);
+    *name = rune_strview_make(stitcher->joined, call->name_len);
+    *joined_args = rune_strview_make(stitcher->joined + call->name_len, call->args_len + args_tail.len);
+    *timestamp_ns = call->timestamp_ns;
+
+    free(call->name);
+    call->name = NULL;
+    call->state = 2;
+    return 1;
+}
+
+static int compare_seq(const void *a, const void *b) {
+    const rune_pending_call_t *x = *(rune_pending_call_t *const *)a;
+    const rune_pending_call_t *y = *(rune_pending_call_t *const *)b;
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+void rune_stitcher_drain(rune_stitcher_t *stitcher, void (*fn)(const rune_pending_call_t *call, void *user_data),
+                         void *user_data) {
+    size_t live = 0;
+    for (size_t i = 0; i < stitcher->capacity; i++) {
+        live += stitcher->slots[i].state == 1;
+    }
+
+    rune_pending_call_t **calls = malloc((live + 1) * sizeof(rune_pending_call_t *));
+    if (calls != NULL) {
+        size_t n = 0;
+        for (size_t i = 0; i < stitcher->capacity; i++) {
+            if (stitcher->slots[i].state == 1) {
+                calls[n++] = &stitcher->slots[i];
+            }
+        }
+        qsort(calls, n, sizeof(rune_pending_call_t *), compare_seq);
+        for (size_t i = 0; i < n; i++) {
+            fn(calls[i], user_data);
+        }
+        free(calls);
+    } else {
+        perror("runescope: malloc failed for pending calls, delivering them unordered");
+        for (size_t i = 0; i < stitcher->capacity; i++) {
+            if (stitcher->slots[i].state == 1) {
+                fn(&stitcher->slots[i], user_data);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < stitcher->capacity; i++) {
+        rune_pending_call_t *call = &stitcher->slots[i];
+        if (call->state == 1) {
+            free(call->name);
+            call->name = NULL;
+        }
+        call->state = 0;
+    }
+    stitcher->used = 0;
+}
+
+void rune_stitcher_free(rune_stitcher_t *stitcher) {
+    if (stitcher->slots != NULL) {
+        for (size_t i = 0; i < stitcher->capacity; i++) {
+            if (stitcher->slots[i].state == 1) {
+                free(stitcher->slots[i].name);
+            }
+        }
+    }
+    free(stitcher->slots);
+    free(stitcher->joined);
+    memset(stitcher, 0, sizeof(*stitcher));
+}
@@ -0,0 +1,114 @@
+#ifndef RUNE_STITCH_H
+#define RUNE_STITCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rune_strview.h"
+
+/**
+ * @brief Pairs "<unfinished ...>" lines with their "<... resumed>" halves.
+ *
+ * With -f, strace and ltrace split a call that blocks while another thread
+ * logs into two lines. The stitcher keeps the first half per pid until the
+ * second half arrives and then joins their argument text.
+ */
+
+// How a trace line relates to the call it records
+typedef enum {
+    RUNE_LINE_INVALID = -1,  // Not a call record (signal, exit notice, malformed)
+    RUNE_LINE_COMPLETE = 0,  // "name(args) = ret"
+    RUNE_LINE_UNFINISHED,    // "name(args <unfinished ...>"
+    RUNE_LINE_RESUMED        // "<... name resumed>args) = ret"
+} rune_line_kind_t;
+
+// The first half of a call waiting for its resumption
+typedef struct {
+    long pid;
+    int state;               // 0 = empty slot, 1 = live, 2 = deleted
+    char *name;              // Owned copy, so the line it came from may go away
+    size_t name_len;
+    char *args;              // Owned copy of the arguments logged so far
+    size_t args_len;
+    int64_t timestamp_ns;    // When the call started, 0 if the trace has no timestamps
+    uint64_t seq;            // Order in which the calls were held
+} rune_pending_call_t;
+
+// Open-addressing table of pending calls keyed by pid
+typedef struct {
+    rune_pending_call_t *slots;
+    size_t capacity;         // Always a power of two
+    size_t used;             // Live plus deleted slots
+    uint64_t next_seq;
+    char *joined;            // Scratch buffer for joined argument text
+    size_t joined_capacity;
+} rune_stitcher_t;
+
+/**
+ * @brief Initializes an empty stitcher.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_stitcher_init(rune_stitcher_t *stitcher);
+
+/**
+ * @brief Stores the first half of a call until it is resumed.
+ *
+ * A call already pending for the same pid never resumed; it is handed to
+ * on_replaced, if given, and then replaced.
+ *
+ * @param stitcher The stitcher.
+ * @param pid The thread that made the call.
+ * @param name The call name.
+ * @param args The arguments logged before "<unfinished ...>".
+ * @param timestamp_ns When the call started, or 0.
+ * @param on_replaced Callback invoked for the call this one replaces, or NULL to drop it.
+ * @param user_data Opaque pointer passed to on_replaced.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_stitcher_hold(rune_stitcher_t *stitcher, long pid, rune_strview_t name, rune_strview_t args,
+                       int64_t timestamp_ns, void (*on_replaced)(const rune_pending_call_t *call, void *user_data),
+                       void *user_data);
+
+/**
+ * @brief Tells whether a pid has a call pending.
+ *
+ * @param stitcher The stitcher.
+ * @param pid The thread to look up.
+ * @return 1 if a call is pending for pid, 0 otherwise.
+ */
+int rune_stitcher_pending(const rune_stitcher_t *stitcher, long pid);
+
+/**
+ * @brief Completes the pending call of a pid with its resumed half.
+ *
+ * @param stitcher The stitcher.
+ * @param pid The thread whose call resumed.
+ * @param args_tail The arguments logged after "resumed>".
+ * @param name On success, receives the name logged with the first half.
+ * @param joined_args On success, receives the full argument text.
+ *                    Both views stay valid until the next call on the stitcher.
+ * @param timestamp_ns On success, receives the start time given to rune_stitcher_hold.
+ * @return 1 if a pending call was completed, 0 if the pid had none, -1 on allocation failure.
+ */
+int rune_stitcher_resume(rune_stitcher_t *stitcher, long pid, rune_strview_t args_tail,
+                         rune_strview_t *name, rune_strview_t *joined_args, int64_t *timestamp_ns);
+
+/**
+ * @brief Hands every call that is still pending to a callback and forgets it.
+ *
+ * Calls are handed over in the order they were held, so draining one
+ * stitcher into another keeps that order.
+ *
+ * @param stitcher The stitcher.
+ * @param fn Callback invoked for every pending call.
+ * @param user_data Opaque pointer passed to fn.
+ */
+void rune_stitcher_drain(rune_stitcher_t *stitcher, void (*fn)(const rune_pending_call_t *call, void *user_data),
+                         void *user_data);
+
+/**
+ * @brief Releases all memory held by a stitcher.
+ */
+void rune_stitcher_free(rune_stitcher_t *stitcher);
+
+#endif // RUNE_STITCH_H
@@ -0,0 +1,362 @@
+#include "rune_store.h"
+#include "rune_syscalls.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_STORE_CAPACITY 4096
+#define INITIAL_ARENA_CAPACITY 65536
+
+int rune_store_init(rune_store_t *store) {
+    memset(store, 0, sizeof(*store));
+    if (rune_intern_init(&store->names) == -1) {
+        return -1;
+    }
+    if (rune_intern_init(&store->error_names) == -1) {
+        rune_intern_free(&store->names);
+        return -1;
+    }
+    return 0;
+}
+
+// Reallocates one column to hold capacity elements of elem_size bytes
+static int grow_column(void **column, size_t elem_size, size_t capacity) {
+    void *grown = realloc(*column, capacity * elem_size);
+    if (grown == NULL) {
+        perror("runescope: realloc failed for event store");
+        return -1;
+    }
+    *column = grown;
+    return 0;
+}
+
+static int reserve_events(rune_store_t *store, size_t count) {
+    if (count <= store->capacity) {
+        return 0;
+    }
+    size_t capacity = store->capacity ? store->capacity : INITIAL_STORE_CAPACITY;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    // A failure leaves the columns that did grow larger than needed, which is harmless
+    if (grow_column((void **)&store->pid, sizeof(*store->pid), capacity) == -1 ||
+        grow_column((void **)&store->name_id, sizeof(*store->name_id), capacity) == -1 ||
+        grow_column((void **)&store->ret, sizeof(*store->ret), capacity) == -1 ||
+        grow_column((void **)&store->err, sizeof(*store->err), capacity) == -1 ||
+        grow_column((void **)&store->flags, sizeof(*store->flags), capacity) == -1 ||
+        grow_column((void **)&store->timestamp_ns, sizeof(*store->timestamp_ns), capacity) == -1 ||
+        grow_column((void **)&store->duration_ns, sizeof(*store->duration_ns), capacity) == -1 ||
+        grow_column((void **)&store->args_offset, sizeof(*store->args_offset), capacity) == -1 ||
+        grow_column((void **)&store->args_len, sizeof(*store->args_len), capacity) == -1) {
+        return -1;
+    }
+    store->capacity = capacity;
+    return 0;
+}
+
+static int reserve_arena(rune_store_t *store, size_t len) {
+    if (store->arena_len + len <= store->arena_capacity) {
+        return 0;
+    }
+    size_t capacity = store->arena_capacity ? store->arena_capacity : INITIAL_ARENA_CAPACITY;
+    while (capacity < store->arena_len + len) {
+        capacity *= 2;
+    }
+    char *arena = realloc(store->args_arena, capacity);
+    if (arena == NULL) {
+        perror("runescope: realloc failed for argument arena");
+        return -1;
+    }
+    store->args_arena = arena;
+    store->arena_capacity = capacity;
+    return 0;
+}
+
+int rune_store_add_interned(rune_store_t *store, long pid, uint32_t name_id, long ret, int err, int flags,
+                            int64_t timestamp_ns, int64_t duration_ns, rune_strview_t args) {
+    if (reserve_events(store, store->count + 1) == -1 || reserve_arena(store, args.len) == -1) {
+        return -1;
+    }
+    size_t i = store->count++;
+    store->pid[i] = (int32_t)pid;
+    store->name_id[i] = name_id;
+    store->ret[i] = ret;
+    store->err[i] = err;
+    store->flags[i] = (uint8_t)flags;
+    store->timestamp_ns[i] = timestamp_ns;
+    store->duration_ns[i] = duration_ns;
+    store->args_offset[i] = store->arena_len;
+    store->args_len[i] = (uint32_t)args.len;
+    memcpy(store->args_arena + store->arena_len, args.ptr, args.len);
+    store->arena_len += args.len;
+    return 0;
+}
+
+int rune_store_add(rune_store_t *store, long pid, rune_strview_t name, long ret, int err, int flags,
+                   int64_t timestamp_ns, int64_t duration_ns, rune_strview_t args) {
+    long name_id = rune_intern_id(&store->names, name.ptr, name.len);
+    if (name_id == -1) {
+        return -1;
+    }
+    return rune_store_add_interned(store, pid, (uint32_t)name_id, ret, err, flags, timestamp_ns, duration_ns, args);
+}
+
+// Maps strace's "ENOENT (No such file or directory)" to ENOENT's value
+static int error_value(rune_store_t *store, rune_strview_t error_str) {
+    size_t len = 0;
+    while (len < error_str.len && error_str.ptr[len] != ' ') {
+        len++;
+    }
+    // Few distinct names ever show up, so each is looked up in the errno table only once
+    long id = rune_intern_id(&store->error_names, error_str.ptr, len);
+    if (id == -1) {
+        return RUNE_STORE_ERR_UNKNOWN;
+    }
+    while (store->error_values_count <= (size_t)id) {
+        if (store->error_values_count == store->error_values_capacity) {
+            size_t capacity = store->error_values_capacity ? store->error_values_capacity * 2 : 16;
+            int *values = realloc(store->error_values, capacity * sizeof(int));
+            if (values == NULL) {
+                perror("runescope: realloc failed for error names");
+                return RUNE_STORE_ERR_UNKNOWN;
+            }
+            store->error_values = values;
+            store->error_values_capacity = capacity;
+        }
+        const char *name = rune_intern_string(&store->error_names, (uint32_t)store->error_values_count);
+        int value = rune_syscalls_errno_value(name, strlen(name));
+        store->error_values[store->error_values_count++] = value != 0 ? value : RUNE_STORE_ERR_UNKNOWN;
+    }
+    return store->error_values[id];
+}
+
+void rune_store_add_strace_entry(const strace_entry_t *entry, void *user_data) {
+    rune_store_t *store = user_data;
+    int flags = 0;
+    int err = 0;
+    if (entry->has_error) {
+        flags |= RUNE_EVENT_ERROR;
+        err = error_value(store, entry->error_str);
+    }
+    if (entry->unfinished) {
+        flags |= RUNE_EVENT_UNFINISHED;
+    }
+    if (rune_store_add(store, entry->pid, entry->syscall_name, entry->return_value, err, flags, entry->timestamp_ns,
+                       entry->duration_ns, entry->args) == -1) {
+        store->failed = 1;
+    }
+}
+
+void rune_store_add_ltrace_entry(const ltrace_entry_t *entry, void *user_data) {
+    rune_store_t *store = user_data;
+    int flags = entry->unfinished ? RUNE_EVENT_UNFINISHED : 0;
+    if (rune_store_add(store, entry->pid, entry->function_name, entry->return_value, 0, flags, entry->timestamp_ns, -1,
+                       entry->args) == -1) {
+        store->failed = 1;
+    }
+}
+
+int rune_store_append(rune_store_t *dest, const rune_store_t *src, const size_t *order) {
+    uint32_t *id_map = malloc((src->names.count + 1) * sizeof(uint32_t));
+    if (id_map == NULL) {
+        perror("runescope: malloc failed for name map");
+        return -1;
+    }
+    for (size_t id = 0; id < src->names.count; id++) {
+        const char *name = src->names.strings[id];
+        long dest_id = rune_intern_id(&dest->names, name, strlen(name));
+        if (dest_id == -1) {
+            free(id_map);
+            return -1;
+        }
+        id_map[id] = (uint32_t)dest_id;
+    }
+    if (reserve_events(dest, dest->count + src->count) == -1 || reserve_arena(dest, src->arena_len) == -1) {
+        free(id_map);
+        return -1;
+    }
+
+    size_t base = dest->count;
+    size_t n = src->count;
+    if (order == NULL) {
+        memcpy(dest->pid + base, src->pid, n * sizeof(*src->pid));
+        memcpy(dest->ret + base, src->ret, n * sizeof(*src->ret));
+        memcpy(dest->err + base, src->err, n * sizeof(*src->err));
+        memcpy(dest->flags + base, src->flags, n * sizeof(*src->flags));
+        memcpy(dest->timestamp_ns + base, src->timestamp_ns, n * sizeof(*src->timestamp_ns));
+        memcpy(dest->duration_ns + base, src->duration_ns, n * sizeof(*src->duration_ns));
+        memcpy(dest->args_len + base, src->args_len, n * sizeof(*src->args_len));
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            size_t from = order[i];
+            dest->pid[base + i] = src->pid[from];
+            dest->ret[base + i] = src->ret[from];
+            dest->err[base + i] = src->err[from];
+            dest->flags[base + i] = src->flags[from];
+            dest->timestamp_ns[base + i] = src->timestamp_ns[from];
+            dest->duration_ns[base + i] = src->duration_ns[from];
+            dest->args_len[base + i] = src->args_len[from];
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t from = order != NULL ? order[i] : i;
+        dest->name_id[base + i] = id_map[src->name_id[from]];
+        dest->args_offset[base + i] = src->args_offset[from] + dest->arena_len;
+    }
+    memcpy(dest->args_arena + dest->arena_len, src->args_arena, src->arena_len);
+    dest->arena_len += src->arena_len;
+    dest->count += n;
+
+    free(id_map);
+    return 0;
+}
+
+const char *rune_store_name(const rune_store_t *store, uint32_t name_id) {
+    return rune_intern_string(&store->names, name_id);
+}
+
+rune_strview_t rune_store_args(const rune_store_t *store, size_t index) {
+    return rune_strview_make(store->args_arena + store->args_offset[index], store->args_len[index]);
+}
+
+void rune_store_count_by_name(const rune_store_t *store, unsigned long *calls, unsigned long *errors) {
+    memset(calls, 0, store->names.count * sizeof(*calls));
+    memset(errors, 0, store->names.count * sizeof(*errors));
+    for (size_t i = 0; i < store->count; i++) {
+        calls[store->name_id[i]]++;
+        errors[store->name_id[i]] += store->flags[i] & RUNE_EVENT_ERROR;
+    }
+}
+
+uint32_t *rune_store_pid_index(const rune_store_t *store, long **pids, size_t *num_pids) {
+    // Open-addressing table of pid index + 1, kept at most half full
+    size_t capacity = 64;
+    size_t n = 0;
+    size_t pids_capacity = 32;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    long *distinct = malloc(pids_capacity * sizeof(long));
+    uint32_t *index = malloc((store->count + 1) * sizeof(uint32_t));
+    if (slots == NULL || distinct == NULL || index == NULL) {
+        goto fail;
+    }
+
+    for (size_t i = 0; i < store->count; i++) {
+        long pid = store->pid[i];
+        size_t j = ((size_t)pid * 2654435761u) & (capacity - 1);
+        while (slots[j] != 0 && distinct[slots[j] - 1] != pid) {
+            j = (j + 1) & (capacity - 1);
+        }
+        if (slots[j] == 0) {
+            if ((n + 1) * 2 > capacity) {
+                // Rebuild at twice the size, then look the pid up again
+                uint32_t *grown = calloc(capacity * 2, sizeof(uint32_t));
+                if (grown == NULL) {
+                    goto fail;
+                }
+                capacity *= 2;
+                for (size_t k = 0; k < n; k++) {
+                    size_t m = ((size_t)distinct[k] * 2654435761u) & (capacity - 1);
+                    while (grown[m] != 0) {
+                        m = (m + 1) & (capacity - 1);
+                    }
+                    grown[m] = (uint32_t)k + 1;
+                }
+                free(slots);
+                slots = grown;
+                i--;
+                continue;
+            }
+            if (n == pids_capacity) {
+                long *grown = realloc(distinct, pids_capacity * 2 * sizeof(long));
+                if (grown == NULL) {
+                    goto fail;
+                }
+                distinct = grown;
+                pids_capacity *= 2;
+            }
+            distinct[n] = pid;
+            slots[j] = (uint32_t)++n;
+        }
+        index[i] = slots[j] - 1;
+    }
+    free(slots);
+
+    *pids = distinct;
+    *num_pids = n;
+    return index;
+
+fail:
+    perror("runescope: allocation failed for pid index");
+    free(slots);
+    free(distinct);
+    free(index);
+    return NULL;
+}
+
+static int compare_pid_stats(const void *a, const void *b) {
+    const rune_store_pid_stat_t *sa = a;
+    const rune_store_pid_stat_t *sb = b;
+    if (sa->errors != sb->errors) {
+        return sa->errors < sb->errors ? 1 : -1;
+    }
+    if (sa->calls != sb->calls) {
+        return sa->calls < sb->calls ? 1 : -1;
+    }
+    return (sa->pid > sb->pid) - (sa->pid < sb->pid);
+}
+
+rune_store_pid_stat_t *rune_store_count_by_pid(const rune_store_t *store, size_t *count) {
+    long *pids;
+    size_t num_pids;
+    uint32_t *index = rune_store_pid_index(store, &pids, &num_pids);
+    if (index == NULL) {
+        return NULL;
+    }
+    rune_store_pid_stat_t *stats = calloc(num_pids + 1, sizeof(rune_store_pid_stat_t));
+    if (stats == NULL) {
+        perror("runescope: calloc failed for per-pid counts");
+        free(index);
+        free(pids);
+        return NULL;
+    }
+    for (size_t k = 0; k < num_pids; k++) {
+        stats[k].pid = pids[k];
+    }
+    for (size_t i = 0; i < store->count; i++) {
+        stats[index[i]].calls++;
+        stats[index[i]].errors += store->flags[i] & RUNE_EVENT_ERROR;
+    }
+    free(index);
+    free(pids);
+
+    qsort(stats, num_pids, sizeof(rune_store_pid_stat_t), compare_pid_stats);
+    *count = num_pids;
+    return stats;
+}
+
+size_t rune_store_memory(const rune_store_t *store, size_t *args_bytes) {
+    size_t row_bytes = sizeof(*store->pid) + sizeof(*store->name_id) + sizeof(*store->ret) + sizeof(*store->err) +
+                       sizeof(*store->flags) + sizeof(*store->timestamp_ns) + sizeof(*store->duration_ns) + sizeof(*store->args_offset) +
+                       sizeof(*store->args_len);
+    if (args_bytes != NULL) {
+        *args_bytes = store->arena_len;
+    }
+    return store->count * row_bytes + store->arena_len;
+}
+
+void rune_store_free(rune_store_t *store) {
+    free(store->pid);
+    free(store->name_id);
+    free(store->ret);
+    free(store->err);
+    free(store->flags);
+    free(store->timestamp_ns);
+    free(store->duration_ns);
+    free(store->args_offset);
+    free(store->args_len);
+    free(store->args_arena);
+    free(store->error_values);
+    rune_intern_free(&store->names);
+    rune_intern_free(&store->error_names);
+    memset(store, 0, sizeof(*store));
+}
@@ -0,0 +1,181 @@
+#ifndef RUNE_STORE_H
+#define RUNE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rune_intern.h"
+#include "rune_strview.h"
+#include "rune_strace_parser.h"
+#include "rune_ltrace_parser.h"
+
+/**
+ * @brief In-memory store of parsed trace events.
+ *
+ * Events are kept as struct-of-arrays columns so an aggregation only touches
+ * the columns it needs. Names are interned into small IDs and argument text
+ * is copied into one growing arena, which puts an event at about 50 bytes
+ * plus its argument text.
+ */
+
+// Event flags
+#define RUNE_EVENT_ERROR      0x01 // The call failed
+#define RUNE_EVENT_UNFINISHED 0x02 // The call never returned
+
+// Errno column value for a failure whose error name runescope doesn't know
+#define RUNE_STORE_ERR_UNKNOWN (-1)
+
+typedef struct {
+    size_t count;            // Number of events
+    size_t capacity;         // Allocated rows in every column
+
+    // One entry per event in each column
+    int32_t *pid;
+    uint32_t *name_id;       // Index into names
+    int64_t *ret;            // Return value
+    int32_t *err;            // errno value when RUNE_EVENT_ERROR is set, else 0
+    uint8_t *flags;          // RUNE_EVENT_* bits
+    int64_t *timestamp_ns;   // Wall clock time of the call, 0 if the trace has none
+    int64_t *duration_ns;    // Time spent in the call, -1 if the trace has none
+    uint64_t *args_offset;   // Start of the argument text in args_arena
+    uint32_t *args_len;
+
+    char *args_arena;
+    size_t arena_len;
+    size_t arena_capacity;
+
+    rune_intern_t names;     // Syscall or function names
+    rune_intern_t error_names; // Distinct strace error names seen so far
+    int *error_values;       // errno value of each error_names ID
+    size_t error_values_count;
+    size_t error_values_capacity;
+    int failed;              // Set when an entry callback could not store an event
+} rune_store_t;
+
+// Per-pid totals, as returned by rune_store_count_by_pid
+typedef struct {
+    long pid;
+    unsigned long calls;
+    unsigned long errors;
+} rune_store_pid_stat_t;
+
+/**
+ * @brief Initializes an empty store.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_store_init(rune_store_t *store);
+
+/**
+ * @brief Appends one event.
+ *
+ * @param store The store.
+ * @param pid The thread that made the call.
+ * @param name The syscall or function name.
+ * @param ret The return value.
+ * @param err The errno value (0 if the call succeeded).
+ * @param flags RUNE_EVENT_* bits.
+ * @param timestamp_ns Wall clock time of the call in nanoseconds, or 0.
+ * @param duration_ns Time spent in the call in nanoseconds, or -1.
+ * @param args The argument text; it is copied into the store.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_store_add(rune_store_t *store, long pid, rune_strview_t name, long ret, int err, int flags,
+                   int64_t timestamp_ns, int64_t duration_ns, rune_strview_t args);
+
+/**
+ * @brief Appends one event whose name is already interned in store->names.
+ *
+ * Same as rune_store_add, with the name given by its ID.
+ */
+int rune_store_add_interned(rune_store_t *store, long pid, uint32_t name_id, long ret, int err, int flags,
+                            int64_t timestamp_ns, int64_t duration_ns, rune_strview_t args);
+
+/**
+ * @brief Appends a parsed strace entry; matches rune_strace_entry_cb.
+ *
+ * @param entry The entry.
+ * @param user_data The rune_store_t to append to. Its failed flag is set if
+ *                  the event could not be stored.
+ */
+void rune_store_add_strace_entry(const strace_entry_t *entry, void *user_data);
+
+/**
+ * @brief Appends a parsed ltrace entry; matches rune_ltrace_entry_cb.
+ *
+ * @param entry The entry.
+ * @param user_data The rune_store_t to append to. Its failed flag is set if
+ *                  the event could not be stored.
+ */
+void rune_store_add_ltrace_entry(const ltrace_entry_t *entry, void *user_data);
+
+/**
+ * @brief Appends all events of another store, translating its name IDs.
+ *
+ * Used to combine the per-chunk stores of a parallel parse.
+ *
+ * @param dest The store to append to.
+ * @param src The store to append.
+ * @param order The index in src of each event to append, in the order to
+ *              append them and covering every event once, or NULL to keep
+ *              src's order.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_store_append(rune_store_t *dest, const rune_store_t *src, const size_t *order);
+
+/**
+ * @brief Returns the name of an event or name ID.
+ */
+const char *rune_store_name(const rune_store_t *store, uint32_t name_id);
+
+/**
+ * @brief Returns the argument text of an event.
+ */
+rune_strview_t rune_store_args(const rune_store_t *store, size_t index);
+
+/**
+ * @brief Counts calls and failed calls per name.
+ *
+ * @param store The store.
+ * @param calls Receives the call count of every name ID; store->names.count entries.
+ * @param errors Receives the error count of every name ID; store->names.count entries.
+ */
+void rune_store_count_by_name(const rune_store_t *store, unsigned long *calls, unsigned long *errors);
+
+/**
+ * @brief Maps the pid of every event to a small, dense index.
+ *
+ * Lets per-pid aggregations use plain arrays instead of hashing every event.
+ *
+ * @param store The store.
+ * @param pids Receives a dynamically allocated array of the distinct pids, in
+ *             order of first appearance. The caller frees it.
+ * @param num_pids Receives the number of distinct pids.
+ * @return A dynamically allocated array of store->count indexes into *pids,
+ *         or NULL on allocation failure. The caller frees it.
+ */
+uint32_t *rune_store_pid_index(const rune_store_t *store, long **pids, size_t *num_pids);
+
+/**
+ * @brief Counts calls and failed calls per pid.
+ *
+ * @param store The store.
+ * @param count Receives the number of distinct pids.
+ * @return A dynamically allocated array sorted by errors, then calls, both
+ *         descending, or NULL on allocation failure. The caller frees it.
+ */
+rune_store_pid_stat_t *rune_store_count_by_pid(const rune_store_t *store, size_t *count);
+
+/**
+ * @brief Returns the number of bytes the store holds for its events.
+ *
+ * @param store The store.
+ * @param args_bytes If not NULL, receives the part spent on argument text.
+ */
+size_t rune_store_memory(const rune_store_t *store, size_t *args_bytes);
+
+/**
+ * @brief Releases all memory held by a store.
+ */
+void rune_store_free(rune_store_t *store);
+
+#endif // RUNE_STORE_H
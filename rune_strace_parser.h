@@ -2,29 +2,166 @@
 #define RUNE_STRACE_PARSER_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include "rune_strview.h"
+#include "rune_stitch.h"
 
-// Structure to hold parsed strace entry data
+// Structure to hold parsed strace entry data. The views point into the
+// buffer the entry was parsed from and are only valid as long as it is.
 typedef struct {
     long pid;
-    char syscall_name[64]; // Max length for syscall name
-    char args[512];        // Arguments as a raw string for now
+    rune_strview_t syscall_name;
+    rune_strview_t args;      // Arguments as raw text, quotes and nested structures intact
     long return_value;
-    char error_str[128];   // Error string if present (e.g., ENOENT)
+    rune_strview_t error_str; // Error string if present (e.g. "ENOENT (No such file or directory)")
     int has_error;
+    int unfinished;           // The syscall never returned ("= ?", or the trace ended first)
+    int64_t timestamp_ns;     // When the call started (strace -ttt), 0 if not recorded
+    int64_t duration_ns;      // Time spent in the call (strace -T), -1 if not recorded
 } strace_entry_t;
 
 /**
- * @brief Parses a strace log file and prints the extracted information.
+ * @brief Callback invoked for every syscall entry produced by a trace source.
  *
- * This function reads the specified strace log file line by line,
- * attempts to parse each line into a strace_entry_t structure,
- * and prints the parsed details.
- * In future iterations, this function will store the parsed data
- * in a more robust data structure for further analysis.
+ * @param entry The entry. It is only valid for the duration of the call.
+ * @param user_data The opaque pointer given to the trace source.
+ */
+typedef void (*rune_strace_entry_cb)(const strace_entry_t *entry, void *user_data);
+
+/**
+ * @brief Callback for an entry a parallel parse delivers after the rest of its chunk.
+ *
+ * @param entry The entry. It is only valid for the duration of the call.
+ * @param position How many of the entries the chunk delivered to on_entry precede it in the log.
+ * @param user_data The chunk's opaque pointer.
+ */
+typedef void (*rune_strace_late_entry_cb)(const strace_entry_t *entry, size_t position, void *user_data);
+
+// A resumed half kept back by a chunk parser, or the first unfinished half of a pid in the chunk
+typedef struct {
+    strace_entry_t entry;
+    size_t position;         // Entries the chunk delivered before it
+    int replaces;            // The unfinished half: a call pending from earlier chunks never resumed
+} rune_strace_orphan_t;
+
+// Line-by-line parsing state: joins unfinished/resumed halves before delivering entries
+typedef struct {
+    rune_strace_entry_cb on_entry;
+    void *user_data;
+    rune_stitcher_t stitcher;
+    size_t delivered;        // Entries passed to on_entry so far
+    int defer_orphans;       // Keep resumed halves whose first half may be in an earlier chunk
+    rune_stitcher_t held;    // With defer_orphans, the pids that logged an unfinished half
+    rune_strace_orphan_t *orphans; // Those halves, in log order; their views must outlive the parser
+    size_t orphan_count;
+    size_t orphan_capacity;
+} rune_strace_parser_t;
+
+/**
+ * @brief Parses a single line of strace output.
+ *
+ * Arguments are delimited by the parenthesis that closes the syscall, so
+ * quoted strings, structures and nested arrays in them are kept intact.
+ * For an unfinished line, entry->args holds the arguments logged so far;
+ * for a resumed line, the arguments logged after "resumed>". A -ttt
+ * timestamp after the pid and a trailing -T duration are picked up when
+ * present.
+ *
+ * @param line The line. It does not need to be NUL-terminated.
+ * @param len The length of the line, with or without its trailing newline.
+ * @param entry Receives the parsed entry, whose views point into line.
+ * @return The kind of line, or RUNE_LINE_INVALID if it is not a syscall record.
+ */
+rune_line_kind_t rune_strace_parser_parse_line(const char *line, size_t len, strace_entry_t *entry);
+
+/**
+ * @brief Prepares a parser that turns lines into complete entries.
+ *
+ * @param parser The parser to initialize.
+ * @param on_entry Callback invoked for every complete entry.
+ * @param user_data Opaque pointer passed to on_entry.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_strace_parser_init(rune_strace_parser_t *parser, rune_strace_entry_cb on_entry, void *user_data);
+
+/**
+ * @brief Parses one line and delivers the entry it completes, if any.
+ *
+ * Unfinished halves are held until their resumed half is fed. One that a
+ * later unfinished half of the same pid replaces never resumed and is
+ * delivered as an unfinished entry at that point.
+ *
+ * @param parser The parser.
+ * @param line The line. It does not need to be NUL-terminated.
+ * @param len The length of the line.
+ */
+void rune_strace_parser_feed_line(rune_strace_parser_t *parser, const char *line, size_t len);
+
+/**
+ * @brief Delivers calls that never resumed as unfinished entries and frees the parser.
+ *
+ * @param parser The parser.
+ */
+void rune_strace_parser_finish(rune_strace_parser_t *parser);
+
+/**
+ * @brief Parses every line of an in-memory strace log.
+ *
+ * @param data The log contents.
+ * @param len The length of data in bytes.
+ * @param on_entry Callback invoked for every parsed entry.
+ * @param user_data Opaque pointer passed to on_entry.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_strace_parser_parse_buffer(const char *data, size_t len, rune_strace_entry_cb on_entry, void *user_data);
+
+/**
+ * @brief Parses a strace log file.
+ *
+ * The file is memory-mapped and parsed in place, so entries passed to the
+ * callback point directly into the mapping and lines of any length are
+ * handled.
  *
  * @param file_path The path to the strace log file.
+ * @param on_entry Callback invoked for every parsed entry.
+ * @param user_data Opaque pointer passed to on_entry.
  * @return 0 on success, -1 on failure (e.g., file not found).
  */
-int rune_strace_parser_parse_file(const char *file_path);
+int rune_strace_parser_parse_file(const char *file_path, rune_strace_entry_cb on_entry, void *user_data);
+
+/**
+ * @brief Parses a strace log file on several threads.
+ *
+ * The mapped file is split into num_chunks newline-aligned chunks that are
+ * parsed by a pool of num_threads workers. Entries of chunk i are delivered
+ * with chunk_user_data[i], from whichever worker parses that chunk, so each
+ * chunk can build its own aggregate without locking. Once all workers are
+ * done, calls whose unfinished and resumed halves land in different chunks
+ * are joined and passed to on_late together with their place in the chunk,
+ * as are calls that never resumed: at the first unfinished half of their
+ * pid in a later chunk, or else at the end of the last chunk. Putting each late entry at its position gives the entries in the
+ * same order as rune_strace_parser_parse_file.
+ *
+ * @param file_path The path to the strace log file.
+ * @param num_threads The number of worker threads, or 0 for one per CPU.
+ * @param num_chunks The number of chunks, and of entries in chunk_user_data.
+ * @param on_entry Callback invoked for every entry parsed by a worker.
+ * @param on_late Callback invoked for every entry completed after the workers.
+ * @param chunk_user_data Opaque pointers passed to both callbacks, one per chunk.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_strace_parser_parse_file_parallel(const char *file_path, int num_threads, size_t num_chunks,
+                                           rune_strace_entry_cb on_entry, rune_strace_late_entry_cb on_late,
+                                           void *const chunk_user_data[]);
+
+/**
+ * @brief Prints a single strace entry in runescope's "Parsed:" format.
+ *
+ * Matches rune_strace_entry_cb so it can be handed to any trace source.
+ *
+ * @param entry The entry to print.
+ * @param user_data Unused.
+ */
+void rune_strace_parser_print_entry(const strace_entry_t *entry, void *user_data);
 
 #endif // RUNE_STRACE_PARSER_H
@@ -0,0 +1,296 @@
+#define _POSIX_C_SOURCE 200809L // For mkdtemp, clock_gettime
+#include "rune_stream.h"
+#include "rune_strace_parser.h"
+#include "rune_ltrace_parser.h"
+#include "rune_summary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h> // For mkfifo
+
+#define READ_CHUNK_SIZE 65536
+#define LIVE_SUMMARY_ROWS 10
+
+struct rune_stream {
+    rune_stream_kind_t kind;
+    char dir_path[256];
+    char fifo_path[288];
+    int fifo_fd;
+    int wake_pipe[2];       // Written by rune_stream_finish to stop the parser thread
+    FILE *raw_log;          // Optional copy of everything read from the FIFO
+    int interval_seconds;
+    struct timespec started;
+    rune_summary_t summary;
+    rune_strace_parser_t strace_parser; // Only the one matching kind is used
+    rune_ltrace_parser_t ltrace_parser;
+    int parser_ready;
+    char *line_buf;         // Holds the incomplete line carried over between reads
+    size_t line_len;
+    size_t line_capacity;
+    pthread_t thread;
+};
+
+static const char *stream_title(const rune_stream_t *stream) {
+    return stream->kind == RUNE_STREAM_STRACE ? "Strace" : "Ltrace";
+}
+
+static double elapsed_seconds(const rune_stream_t *stream) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - stream->started.tv_sec) +
+           (double)(now.tv_nsec - stream->started.tv_nsec) / 1e9;
+}
+
+static void count_strace_entry(const strace_entry_t *entry, void *user_data) {
+    rune_summary_t *summary = user_data;
+    rune_summary_add(summary, entry->syscall_name.ptr, entry->syscall_name.len, entry->has_error);
+}
+
+static void count_ltrace_entry(const ltrace_entry_t *entry, void *user_data) {
+    rune_summary_t *summary = user_data;
+    rune_summary_add(summary, entry->function_name.ptr, entry->function_name.len, 0);
+}
+
+static void process_line(rune_stream_t *stream, const char *line, size_t len) {
+    if (stream->kind == RUNE_STREAM_STRACE) {
+        rune_strace_parser_feed_line(&stream->strace_parser, line, len);
+    } else {
+        rune_ltrace_parser_feed_line(&stream->ltrace_parser, line, len);
+    }
+}
+
+// Appends freshly read bytes and parses every line they complete
+static int consume(rune_stream_t *stream, const char *data, size_t len) {
+    if (stream->raw_log != NULL) {
+        fwrite(data, 1, len, stream->raw_log);
+    }
+
+    if (stream->line_len + len + 1 > stream->line_capacity) {
+        size_t capacity = stream->line_capacity ? stream->line_capacity : READ_CHUNK_SIZE;
+        while (stream->line_len + len + 1 > capacity) {
+            capacity *= 2;
+        }
+        char *buf = realloc(stream->line_buf, capacity);
+        if (buf == NULL) {
+            perror("runescope: realloc failed for stream buffer");
+            return -1;
+        }
+        stream->line_buf = buf;
+        stream->line_capacity = capacity;
+    }
+    memcpy(stream->line_buf + stream->line_len, data, len);
+    stream->line_len += len;
+
+    char *start = stream->line_buf;
+    char *end = stream->line_buf + stream->line_len;
+    char *newline;
+    while ((newline = memchr(start, '\n', end - start)) != NULL) {
+        process_line(stream, start, newline - start);
+        start = newline + 1;
+    }
+
+    // Keep only the trailing partial line
+    stream->line_len = end - start;
+    memmove(stream->line_buf, start, stream->line_len);
+    return 0;
+}
+
+// Reads whatever the FIFO holds; returns 1 at end of stream, 0 if more may come, -1 on error
+static int read_available(rune_stream_t *stream) {
+    char chunk[READ_CHUNK_SIZE];
+    for (;;) {
+        ssize_t n = read(stream->fifo_fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            if (consume(stream, chunk, (size_t)n) == -1) {
+                return -1;
+            }
+        } else if (n == 0) {
+            return 1; // No writer left and nothing buffered
+        } else if (errno == EAGAIN) {
+            return 0;
+        } else if (errno != EINTR) {
+            perror("runescope: read from trace FIFO failed");
+            return -1;
+        }
+    }
+}
+
+static void *stream_thread(void *arg) {
+    rune_stream_t *stream = arg;
+    double next_summary = stream->interval_seconds;
+
+    for (;;) {
+        int timeout_ms = -1;
+        if (stream->interval_seconds > 0) {
+            double remaining = next_summary - elapsed_seconds(stream);
+            timeout_ms = remaining > 0 ? (int)(remaining * 1000) + 1 : 0;
+        }
+
+        struct pollfd fds[2] = {
+            { .fd = stream->fifo_fd, .events = POLLIN },
+            { .fd = stream->wake_pipe[0], .events = POLLIN },
+        };
+        if (poll(fds, 2, timeout_ms) == -1 && errno != EINTR) {
+            perror("runescope: poll on trace FIFO failed");
+            break;
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            // POLLHUP only shows up once a writer has come and gone
+            if (read_available(stream) != 0) {
+                break;
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            // The tool has exited: take what is left and stop
+            read_available(stream);
+            break;
+        }
+
+        if (stream->interval_seconds > 0 && elapsed_seconds(stream) >= next_summary) {
+            char title[64];
+            snprintf(title, sizeof(title), "%s live summary at %.0fs", stream_title(stream), elapsed_seconds(stream));
+            rune_summary_print(&stream->summary, stdout, title, stream->kind == RUNE_STREAM_STRACE ? "syscall" : "function",
+                               LIVE_SUMMARY_ROWS);
+            fflush(stdout);
+            next_summary += stream->interval_seconds;
+        }
+    }
+
+    if (stream->line_len > 0) {
+        process_line(stream, stream->line_buf, stream->line_len); // Last line had no newline
+        stream->line_len = 0;
+    }
+    // Calls still waiting for their resumed half are counted as unfinished
+    if (stream->kind == RUNE_STREAM_STRACE) {
+        rune_strace_parser_finish(&stream->strace_parser);
+    } else {
+        rune_ltrace_parser_finish(&stream->ltrace_parser);
+    }
+    stream->parser_ready = 0;
+    return NULL;
+}
+
+static void stream_cleanup(rune_stream_t *stream) {
+    if (stream->fifo_fd != -1) {
+        close(stream->fifo_fd);
+    }
+    if (stream->wake_pipe[0] != -1) {
+        close(stream->wake_pipe[0]);
+        close(stream->wake_pipe[1]);
+    }
+    if (stream->raw_log != NULL) {
+        fclose(stream->raw_log);
+    }
+    if (stream->fifo_path[0] != '\0') {
+        unlink(stream->fifo_path);
+    }
+    if (stream->dir_path[0] != '\0') {
+        rmdir(stream->dir_path);
+    }
+    if (stream->parser_ready && stream->kind == RUNE_STREAM_STRACE) {
+        rune_strace_parser_finish(&stream->strace_parser);
+    } else if (stream->parser_ready) {
+        rune_ltrace_parser_finish(&stream->ltrace_parser);
+    }
+    rune_summary_free(&stream->summary);
+    free(stream->line_buf);
+    free(stream);
+}
+
+rune_stream_t *rune_stream_start(rune_stream_kind_t kind, const char *raw_log_path, int interval_seconds) {
+    rune_stream_t *stream = calloc(1, sizeof(rune_stream_t));
+    if (stream == NULL) {
+        perror("runescope: calloc failed for stream");
+        return NULL;
+    }
+    stream->kind = kind;
+    stream->interval_seconds = interval_seconds;
+    stream->fifo_fd = -1;
+    stream->wake_pipe[0] = stream->wake_pipe[1] = -1;
+    if (rune_summary_init(&stream->summary) == -1) {
+        free(stream);
+        return NULL;
+    }
+    if (kind == RUNE_STREAM_STRACE) {
+        stream->parser_ready = rune_strace_parser_init(&stream->strace_parser, count_strace_entry, &stream->summary) == 0;
+    } else {
+        stream->parser_ready = rune_ltrace_parser_init(&stream->ltrace_parser, count_ltrace_entry, &stream->summary) == 0;
+    }
+    if (!stream->parser_ready) {
+        stream_cleanup(stream);
+        return NULL;
+    }
+
+    const char *tmp_dir = getenv("TMPDIR");
+    snprintf(stream->dir_path, sizeof(stream->dir_path), "%s/runescope.XXXXXX", tmp_dir ? tmp_dir : "/tmp");
+    if (mkdtemp(stream->dir_path) == NULL) {
+        perror("runescope: mkdtemp failed for trace FIFO");
+        stream->dir_path[0] = '\0';
+        stream_cleanup(stream);
+        return NULL;
+    }
+    snprintf(stream->fifo_path, sizeof(stream->fifo_path), "%s/%s.fifo", stream->dir_path,
+             kind == RUNE_STREAM_STRACE ? "strace" : "ltrace");
+    if (mkfifo(stream->fifo_path, 0600) == -1) {
+        perror("runescope: mkfifo failed");
+        stream->fifo_path[0] = '\0';
+        stream_cleanup(stream);
+        return NULL;
+    }
+
+    // Non-blocking, so opening doesn't wait for the tool to open its end
+    stream->fifo_fd = open(stream->fifo_path, O_RDONLY | O_NONBLOCK);
+    if (stream->fifo_fd == -1) {
+        perror("runescope: Failed to open trace FIFO");
+        stream_cleanup(stream);
+        return NULL;
+    }
+    if (pipe(stream->wake_pipe) == -1) {
+        perror("runescope: pipe failed");
+        stream->wake_pipe[0] = stream->wake_pipe[1] = -1;
+        stream_cleanup(stream);
+        return NULL;
+    }
+    if (raw_log_path != NULL) {
+        stream->raw_log = fopen(raw_log_path, "w");
+        if (stream->raw_log == NULL) {
+            perror("runescope: Failed to open raw log file");
+            stream_cleanup(stream);
+            return NULL;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stream->started);
+    int err = pthread_create(&stream->thread, NULL, stream_thread, stream);
+    if (err != 0) {
+        fprintf(stderr, "runescope: pthread_create failed: %s\n", strerror(err));
+        stream_cleanup(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+const char *rune_stream_fifo_path(const rune_stream_t *stream) {
+    return stream->fifo_path;
+}
+
+int rune_stream_finish(rune_stream_t *stream) {
+    if (write(stream->wake_pipe[1], "x", 1) != 1) {
+        perror("runescope: failed to wake stream thread");
+    }
+    pthread_join(stream->thread, NULL);
+
+    char title[64];
+    snprintf(title, sizeof(title), "%s summary after %.1fs", stream_title(stream), elapsed_seconds(stream));
+    rune_summary_print(&stream->summary, stdout, title, stream->kind == RUNE_STREAM_STRACE ? "syscall" : "function", 0);
+
+    stream_cleanup(stream);
+    return 0;
+}
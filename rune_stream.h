@@ -0,0 +1,50 @@
+#ifndef RUNE_STREAM_H
+#define RUNE_STREAM_H
+
+/**
+ * @brief Live analysis of strace/ltrace output while the target runs.
+ *
+ * A stream creates a FIFO that is handed to the tracing tool as its -o
+ * output. A parser thread reads the FIFO as the tool writes it, feeds every
+ * entry into a running summary, and prints that summary periodically. The
+ * raw log is only written to disk when requested, and memory use does not
+ * grow with the length of the trace.
+ */
+
+typedef enum {
+    RUNE_STREAM_STRACE,
+    RUNE_STREAM_LTRACE
+} rune_stream_kind_t;
+
+typedef struct rune_stream rune_stream_t;
+
+/**
+ * @brief Creates a stream and its FIFO, and starts the parser thread.
+ *
+ * @param kind Whether the FIFO will carry strace or ltrace output.
+ * @param raw_log_path If not NULL, every line read is also written to this file.
+ * @param interval_seconds Seconds between live summaries, or 0 to only print the final one.
+ * @return The new stream, or NULL on failure.
+ */
+rune_stream_t *rune_stream_start(rune_stream_kind_t kind, const char *raw_log_path, int interval_seconds);
+
+/**
+ * @brief Returns the path of the stream's FIFO, to be passed to the tool's -o option.
+ *
+ * @param stream The stream.
+ * @return The FIFO path. It stays valid until rune_stream_finish is called.
+ */
+const char *rune_stream_fifo_path(const rune_stream_t *stream);
+
+/**
+ * @brief Drains the FIFO, stops the parser thread and prints the final summary.
+ *
+ * Must be called once the tool writing to the FIFO has exited. Removes the
+ * FIFO and frees the stream.
+ *
+ * @param stream The stream to finish.
+ * @return 0 on success, -1 on failure.
+ */
+int rune_stream_finish(rune_stream_t *stream);
+
+#endif // RUNE_STREAM_H
@@ -0,0 +1,28 @@
+#ifndef RUNE_STRVIEW_H
+#define RUNE_STRVIEW_H
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief A non-owning view of a run of characters.
+ *
+ * Parsed entries point into the buffer they were parsed from (a mapped log
+ * file, a stream buffer, ...) instead of copying into fixed-size arrays. A
+ * view is not NUL-terminated; print it with "%.*s", (int)view.len, view.ptr.
+ */
+typedef struct {
+    const char *ptr;
+    size_t len;
+} rune_strview_t;
+
+static inline rune_strview_t rune_strview_make(const char *ptr, size_t len) {
+    rune_strview_t view = { ptr, len };
+    return view;
+}
+
+static inline int rune_strview_equals(rune_strview_t view, const char *str) {
+    return strlen(str) == view.len && memcmp(view.ptr, str, view.len) == 0;
+}
+
+#endif // RUNE_STRVIEW_H
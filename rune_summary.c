@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L // For flockfile
+#include "rune_summary.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_SUMMARY_CAPACITY 64
+
+// FNV-1a over the name bytes
+static size_t hash_name(const char *name, size_t len) {
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+int rune_summary_init(rune_summary_t *summary) {
+    memset(summary, 0, sizeof(*summary));
+    summary->entries = calloc(INITIAL_SUMMARY_CAPACITY, sizeof(rune_summary_entry_t));
+    if (summary->entries == NULL) {
+        perror("runescope: calloc failed for summary");
+        return -1;
+    }
+    summary->capacity = INITIAL_SUMMARY_CAPACITY;
+    return 0;
+}
+
+static int summary_grow(rune_summary_t *summary) {
+    size_t capacity = summary->capacity * 2;
+    rune_summary_entry_t *entries = calloc(capacity, sizeof(rune_summary_entry_t));
+    if (entries == NULL) {
+        perror("runescope: calloc failed for summary");
+        return -1;
+    }
+    for (size_t i = 0; i < summary->capacity; i++) {
+        if (summary->entries[i].name == NULL) {
+            continue;
+        }
+        size_t j = hash_name(summary->entries[i].name, strlen(summary->entries[i].name)) & (capacity - 1);
+        while (entries[j].name != NULL) {
+            j = (j + 1) & (capacity - 1);
+        }
+        entries[j] = summary->entries[i];
+    }
+    free(summary->entries);
+    summary->entries = entries;
+    summary->capacity = capacity;
+    return 0;
+}
+
+int rune_summary_add(rune_summary_t *summary, const char *name, size_t name_len, int is_error) {
+    return rune_summary_add_counts(summary, name, name_len, 1, is_error ? 1 : 0);
+}
+
+int rune_summary_add_counts(rune_summary_t *summary, const char *name, size_t name_len,
+                            unsigned long calls, unsigned long errors) {
+    size_t i = hash_name(name, name_len) & (summary->capacity - 1);
+    while (summary->entries[i].name != NULL) {
+        rune_summary_entry_t *entry = &summary->entries[i];
+        if (strncmp(entry->name, name, name_len) == 0 && entry->name[name_len] == '\0') {
+            break;
+        }
+        i = (i + 1) & (summary->capacity - 1);
+    }
+
+    if (summary->entries[i].name == NULL) {
+        if ((summary->count + 1) * 2 > summary->capacity) {
+            if (summary_grow(summary) == -1) {
+                return -1;
+            }
+            return rune_summary_add_counts(summary, name, name_len, calls, errors); // Slot moved
+        }
+        char *copy = malloc(name_len + 1);
+        if (copy == NULL) {
+            perror("runescope: malloc failed for summary name");
+            return -1;
+        }
+        memcpy(copy, name, name_len);
+        copy[name_len] = '\0';
+        summary->entries[i].name = copy;
+        summary->count++;
+    }
+
+    summary->entries[i].calls += calls;
+    summary->entries[i].errors += errors;
+    summary->total_calls += calls;
+    summary->total_errors += errors;
+    return 0;
+}
+
+int rune_summary_merge(rune_summary_t *dest, const rune_summary_t *src) {
+    for (size_t i = 0; i < src->capacity; i++) {
+        const rune_summary_entry_t *entry = &src->entries[i];
+        if (entry->name != NULL &&
+            rune_summary_add_counts(dest, entry->name, strlen(entry->name), entry->calls, entry->errors) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int compare_by_calls(const void *a, const void *b) {
+    const rune_summary_entry_t *ea = *(const rune_summary_entry_t *const *)a;
+    const rune_summary_entry_t *eb = *(const rune_summary_entry_t *const *)b;
+    if (ea->calls != eb->calls) {
+        return ea->calls < eb->calls ? 1 : -1;
+    }
+    return strcmp(ea->name, eb->name);
+}
+
+void rune_summary_print(const rune_summary_t *summary, FILE *out, const char *title,
+                        const char *name_header, size_t top_n) {
+    const rune_summary_entry_t **sorted = malloc((summary->count + 1) * sizeof(*sorted));
+    if (sorted == NULL) {
+        perror("runescope: malloc failed for summary output");
+        return;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < summary->capacity; i++) {
+        if (summary->entries[i].name != NULL) {
+            sorted[n++] = &summary->entries[i];
+        }
+    }
+    qsort(sorted, n, sizeof(*sorted), compare_by_calls);
+    if (top_n == 0 || top_n > n) {
+        top_n = n;
+    }
+
+    // Keep the table in one piece when several threads print summaries
+    flockfile(out);
+    fprintf(out, "\n--- %s: %lu calls, %lu errors, %zu distinct ---\n",
+            title, summary->total_calls, summary->total_errors, summary->count);
+    fprintf(out, "%12s %10s  %s\n", "calls", "errors", name_header);
+    for (size_t i = 0; i < top_n; i++) {
+        fprintf(out, "%12lu %10lu  %s\n", sorted[i]->calls, sorted[i]->errors, sorted[i]->name);
+    }
+    if (top_n < n) {
+        fprintf(out, "%12s %10s  (%zu more)\n", "...", "", n - top_n);
+    }
+    funlockfile(out);
+
+    free(sorted);
+}
+
+void rune_summary_free(rune_summary_t *summary) {
+    for (size_t i = 0; i < summary->capacity; i++) {
+        free(summary->entries[i].name);
+    }
+    free(summary->entries);
+    memset(summary, 0, sizeof(*summary));
+}
@@ -0,0 +1,92 @@
+#ifndef RUNE_SUMMARY_H
+#define RUNE_SUMMARY_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @brief Aggregate call statistics keyed by syscall or function name.
+ *
+ * A summary only grows with the number of distinct names, never with the
+ * number of calls, so it can sit behind a trace of unbounded length.
+ */
+
+// Statistics for one syscall or library function
+typedef struct {
+    char *name;             // NULL for an empty slot
+    unsigned long calls;
+    unsigned long errors;
+} rune_summary_entry_t;
+
+// Open-addressing hash table of rune_summary_entry_t keyed by name
+typedef struct {
+    rune_summary_entry_t *entries;
+    size_t capacity;        // Always a power of two
+    size_t count;           // Number of distinct names
+    unsigned long total_calls;
+    unsigned long total_errors;
+} rune_summary_t;
+
+/**
+ * @brief Initializes an empty summary.
+ *
+ * @param summary The summary to initialize.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_summary_init(rune_summary_t *summary);
+
+/**
+ * @brief Records one call.
+ *
+ * @param summary The summary to update.
+ * @param name The syscall or function name (not necessarily NUL-terminated).
+ * @param name_len The length of name.
+ * @param is_error Non-zero if the call failed.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_summary_add(rune_summary_t *summary, const char *name, size_t name_len, int is_error);
+
+/**
+ * @brief Records several calls at once.
+ *
+ * @param summary The summary to update.
+ * @param name The syscall or function name (not necessarily NUL-terminated).
+ * @param name_len The length of name.
+ * @param calls The number of calls to add.
+ * @param errors How many of those calls failed.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_summary_add_counts(rune_summary_t *summary, const char *name, size_t name_len,
+                            unsigned long calls, unsigned long errors);
+
+/**
+ * @brief Adds every count of one summary to another.
+ *
+ * Used to combine the per-thread summaries of a parallel parse.
+ *
+ * @param dest The summary to add to.
+ * @param src The summary to add.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_summary_merge(rune_summary_t *dest, const rune_summary_t *src);
+
+/**
+ * @brief Prints the summary as a table sorted by call count.
+ *
+ * @param summary The summary to print.
+ * @param out The stream to print to.
+ * @param title Heading printed above the table.
+ * @param name_header Column header for the names (e.g. "syscall").
+ * @param top_n The maximum number of rows to print, or 0 for all of them.
+ */
+void rune_summary_print(const rune_summary_t *summary, FILE *out, const char *title,
+                        const char *name_header, size_t top_n);
+
+/**
+ * @brief Releases all memory held by a summary.
+ *
+ * @param summary The summary to free.
+ */
+void rune_summary_free(rune_summary_t *summary);
+
+#endif // RUNE_SUMMARY_H
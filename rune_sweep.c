@@ -0,0 +1,566 @@
+#define _GNU_SOURCE // For pipe2, sched_setaffinity and getline
+#include "rune_sweep.h"
+#include "rune_exec.h"
+#include "rune_latency.h"
+#include "rune_ltrace_parser.h"
+#include "rune_pool.h"
+#include "rune_strace_parser.h"
+#include "rune_tracer.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define LABEL_WIDTH 48
+#define TOP_SLOWEST 3
+#define POLL_MIN_NS 1000000L   // Timeout checks start at 1ms...
+#define POLL_MAX_NS 20000000L  // ...and back off to 20ms for long jobs
+
+// What a job process reports back through its pipe
+typedef struct {
+    int exit_status;           // The target's exit status, -1 if killed by a signal
+    int failed;                // Runescope could not run the configuration
+    long max_rss_kb;           // Largest child of the job: the target, or a tool running it
+    uint64_t syscalls;
+    uint64_t syscall_errors;
+    uint64_t library_calls;
+    long long leaked_bytes;    // valgrind "definitely lost", -1 if unknown
+} job_report_t;
+
+typedef struct {
+    char **argv;               // Base arguments followed by this line's, NULL-terminated
+    size_t argc;
+    size_t num_owned;          // The last num_owned arguments are owned by the configuration
+    char *input_path;          // Fed to stdin, or NULL
+    char *label;               // The spec line
+    job_report_t report;
+    int timed_out;
+    int64_t wall_ns;
+} sweep_config_t;
+
+typedef struct {
+    const char *executable_path;
+    const rune_sweep_options_t *options;
+    sweep_config_t *configs;
+    pthread_mutex_t cpu_lock;
+    int *cpus;                 // CPUs this process may run on
+    unsigned char *cpu_busy;
+    size_t num_cpus;
+} sweep_t;
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void count_syscall(const strace_entry_t *entry, void *user_data) {
+    job_report_t *report = user_data;
+    report->syscalls++;
+    report->syscall_errors += entry->has_error != 0;
+}
+
+static void count_library_call(const ltrace_entry_t *entry, void *user_data) {
+    (void)entry;
+    ((job_report_t *)user_data)->library_calls++;
+}
+
+// Finds "definitely lost: 1,234 bytes" in a memcheck log
+static long long valgrind_leaked_bytes(const char *log_path) {
+    FILE *f = fopen(log_path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    long long leaked = -1;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (getline(&line, &capacity, f) != -1) {
+        const char *p = strstr(line, "definitely lost: ");
+        if (p != NULL) {
+            leaked = 0;
+            for (p += 17; isdigit((unsigned char)*p) || *p == ','; p++) {
+                if (*p != ',') {
+                    leaked = leaked * 10 + (*p - '0');
+                }
+            }
+        } else if (strstr(line, "All heap blocks were freed") != NULL) {
+            leaked = 0;
+        }
+    }
+    free(line);
+    fclose(f);
+    return leaked;
+}
+
+static void redirect(int fd, const char *path, int flags) {
+    int new_fd = open(path, flags);
+    if (new_fd == -1) {
+        fprintf(stderr, "runescope: open failed for %s: %s\n", path, strerror(errno));
+        _exit(EXIT_FAILURE);
+    }
+    dup2(new_fd, fd);
+    close(new_fd);
+}
+
+// Runs in the job process: runs the configuration, reports and exits
+static void run_job(const sweep_t *sweep, size_t index, int cpu, int report_fd) {
+    const rune_sweep_options_t *options = sweep->options;
+    const sweep_config_t *config = &sweep->configs[index];
+    job_report_t report = {0};
+    report.leaked_bytes = -1;
+
+    setpgid(0, 0); // A timeout kills the job with everything it started
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+    redirect(STDIN_FILENO, config->input_path != NULL ? config->input_path : "/dev/null", O_RDONLY);
+    redirect(STDOUT_FILENO, "/dev/null", O_WRONLY);
+
+    if (options->use_native) {
+        report.exit_status = rune_tracer_run(sweep->executable_path, config->argv, options->trace_spec,
+                                             count_syscall, &report);
+    } else if (options->use_strace || options->use_ltrace || options->use_valgrind) {
+        char strace_log[64], ltrace_log[64], valgrind_log[64];
+        snprintf(strace_log, sizeof(strace_log), "runescope_sweep_%zu_strace.log", index + 1);
+        snprintf(ltrace_log, sizeof(ltrace_log), "runescope_sweep_%zu_ltrace.log", index + 1);
+        snprintf(valgrind_log, sizeof(valgrind_log), "runescope_sweep_%zu_valgrind.log", index + 1);
+        rune_exec_options_t exec_options = {0};
+        exec_options.max_jobs = 1; // The sweep already keeps the CPUs busy
+        report.exit_status = rune_exec_run_target(sweep->executable_path, config->argv,
+                                                  options->use_strace, strace_log,
+                                                  options->use_ltrace, ltrace_log,
+                                                  options->use_valgrind, valgrind_log, &exec_options);
+        if (options->use_strace && rune_strace_parser_parse_file(strace_log, count_syscall, &report) == -1) {
+            report.failed = 1;
+        }
+        if (options->use_ltrace && rune_ltrace_parser_parse_file(ltrace_log, count_library_call, &report) == -1) {
+            report.failed = 1;
+        }
+        if (options->use_valgrind) {
+            report.leaked_bytes = valgrind_leaked_bytes(valgrind_log);
+        }
+    } else {
+        rune_exec_usage_t usage;
+        if (rune_exec_run_measured(sweep->executable_path, config->argv, -1, 0, &usage) == -1) {
+            report.failed = 1;
+            usage.exit_status = -1;
+        }
+        report.exit_status = usage.exit_status;
+    }
+
+    struct rusage children;
+    if (getrusage(RUSAGE_CHILDREN, &children) == 0) {
+        report.max_rss_kb = children.ru_maxrss;
+    }
+    if (write(report_fd, &report, sizeof(report)) != (ssize_t)sizeof(report)) {
+        _exit(EXIT_FAILURE);
+    }
+    _exit(EXIT_SUCCESS);
+}
+
+static int acquire_cpu(sweep_t *sweep) {
+    int cpu = -1;
+    pthread_mutex_lock(&sweep->cpu_lock);
+    for (size_t i = 0; i < sweep->num_cpus; i++) {
+        if (!sweep->cpu_busy[i]) {
+            sweep->cpu_busy[i] = 1;
+            cpu = sweep->cpus[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sweep->cpu_lock);
+    return cpu; // -1 when there are more jobs than CPUs: run unpinned
+}
+
+static void release_cpu(sweep_t *sweep, int cpu) {
+    pthread_mutex_lock(&sweep->cpu_lock);
+    for (size_t i = 0; i < sweep->num_cpus; i++) {
+        if (sweep->cpus[i] == cpu) {
+            sweep->cpu_busy[i] = 0;
+        }
+    }
+    pthread_mutex_unlock(&sweep->cpu_lock);
+}
+
+// Pool task: runs configuration index in a job process and waits for it
+static void sweep_task(size_t index, void *arg) {
+    sweep_t *sweep = arg;
+    sweep_config_t *config = &sweep->configs[index];
+    config->report.failed = 1;
+    config->report.exit_status = -1;
+    config->report.leaked_bytes = -1;
+
+    int report_pipe[2];
+    if (pipe2(report_pipe, O_CLOEXEC) == -1) {
+        perror("runescope: pipe failed for sweep job");
+        return;
+    }
+    int cpu = sweep->options->pin ? acquire_cpu(sweep) : -1;
+    int64_t started = monotonic_ns();
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("runescope: fork failed");
+        close(report_pipe[0]);
+        close(report_pipe[1]);
+        release_cpu(sweep, cpu);
+        return;
+    } else if (pid == 0) {
+        close(report_pipe[0]);
+        run_job(sweep, index, cpu, report_pipe[1]);
+    }
+    setpgid(pid, pid); // Also here, so that a kill cannot race the child's own setpgid
+    close(report_pipe[1]);
+
+    int status;
+    int64_t deadline = sweep->options->timeout_seconds > 0
+                           ? started + (int64_t)(sweep->options->timeout_seconds * 1e9) : 0;
+    long poll_ns = POLL_MIN_NS;
+    for (;;) {
+        pid_t done = waitpid(pid, &status, deadline != 0 && !config->timed_out ? WNOHANG : 0);
+        if (done == pid) {
+            break;
+        }
+        if (done == -1 && errno != EINTR) {
+            perror("runescope: waitpid failed");
+            break;
+        }
+        if (done == 0 && monotonic_ns() >= deadline) {
+            kill(-pid, SIGKILL);
+            config->timed_out = 1;
+        } else if (done == 0) {
+            struct timespec pause = { 0, poll_ns };
+            nanosleep(&pause, NULL);
+            poll_ns = poll_ns * 2 < POLL_MAX_NS ? poll_ns * 2 : POLL_MAX_NS;
+        }
+    }
+    config->wall_ns = monotonic_ns() - started;
+    release_cpu(sweep, cpu);
+
+    job_report_t report;
+    if (!config->timed_out && read(report_pipe[0], &report, sizeof(report)) == (ssize_t)sizeof(report)) {
+        config->report = report;
+    }
+    close(report_pipe[0]);
+}
+
+// Splits a spec line into owned arguments; "< FILE" becomes the input
+static int parse_line(char *line, sweep_config_t *config, char *const base_argv[]) {
+    size_t base_count = 0;
+    while (base_argv[base_count] != NULL) {
+        base_count++;
+    }
+    size_t capacity = base_count + 8;
+    config->argv = malloc(capacity * sizeof(char *));
+    if (config->argv == NULL) {
+        return -1;
+    }
+    memcpy(config->argv, base_argv, base_count * sizeof(char *));
+    size_t count = base_count;
+    int next_is_input = 0;
+    config->argc = count;
+
+    char *p = line;
+    for (;;) {
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        // Unquote in place: the token is rewritten over the line as it is read
+        char *token = p;
+        char *w = p;
+        while (*p != '\0' && !isspace((unsigned char)*p)) {
+            if (*p == '\'' || *p == '"') {
+                char quote = *p++;
+                while (*p != '\0' && *p != quote) {
+                    *w++ = *p++;
+                }
+                if (*p == quote) {
+                    p++;
+                }
+            } else {
+                *w++ = *p++;
+            }
+        }
+        int at_end = *p == '\0';
+        *w = '\0';
+        if (!at_end) {
+            p++;
+        }
+
+        if (strcmp(token, "<") == 0) {
+            next_is_input = 1;
+        } else if (next_is_input) {
+            free(config->input_path);
+            config->input_path = strdup(token);
+            next_is_input = 0;
+            if (config->input_path == NULL) {
+                return -1;
+            }
+        } else {
+            if (count + 2 > capacity) {
+                capacity *= 2;
+                char **grown = realloc(config->argv, capacity * sizeof(char *));
+                if (grown == NULL) {
+                    return -1;
+                }
+                config->argv = grown;
+            }
+            config->argv[count] = strdup(token);
+            if (config->argv[count] == NULL) {
+                return -1;
+            }
+            config->argc = ++count;
+            config->num_owned++;
+        }
+        if (at_end) {
+            break;
+        }
+    }
+    config->argv[count] = NULL;
+    return 0;
+}
+
+static void free_configs(sweep_config_t *configs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (configs[i].argv != NULL) {
+            for (size_t j = configs[i].argc - configs[i].num_owned; j < configs[i].argc; j++) {
+                free(configs[i].argv[j]);
+            }
+        }
+        free(configs[i].argv);
+        free(configs[i].input_path);
+        free(configs[i].label);
+    }
+    free(configs);
+}
+
+static sweep_config_t *read_spec(const char *spec_path, char *const base_argv[], size_t *num_configs) {
+    FILE *f = fopen(spec_path, "r");
+    if (f == NULL) {
+        perror("runescope: fopen failed for sweep spec");
+        return NULL;
+    }
+    sweep_config_t *configs = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t len;
+    int failed = 0;
+    while (!failed && (len = getline(&line, &line_capacity, f)) != -1) {
+        while (len > 0 && isspace((unsigned char)line[len - 1])) {
+            line[--len] = '\0';
+        }
+        char *start = line;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            sweep_config_t *grown = realloc(configs, capacity * sizeof(*configs));
+            if (grown == NULL) {
+                failed = 1;
+                break;
+            }
+            configs = grown;
+        }
+        sweep_config_t *config = &configs[count++];
+        memset(config, 0, sizeof(*config));
+        config->label = strdup(start);
+        failed = config->label == NULL || parse_line(start, config, base_argv) == -1;
+    }
+    free(line);
+    fclose(f);
+    if (failed) {
+        perror("runescope: malloc failed for sweep spec");
+        free_configs(configs, count);
+        return NULL;
+    }
+    *num_configs = count;
+    return configs;
+}
+
+static const char *format_kb(long kb, char *buf, size_t size) {
+    if (kb >= 10240) {
+        snprintf(buf, size, "%.1fMB", (double)kb / 1024.0);
+    } else {
+        snprintf(buf, size, "%ldKB", kb);
+    }
+    return buf;
+}
+
+static const char *format_status(const sweep_config_t *config, char *buf, size_t size) {
+    if (config->timed_out) {
+        return "timeout";
+    }
+    if (config->report.failed) {
+        return "error";
+    }
+    if (config->report.exit_status == -1) {
+        return "signal";
+    }
+    snprintf(buf, size, "%d", config->report.exit_status);
+    return buf;
+}
+
+static void print_results(const sweep_t *sweep, size_t num_configs, FILE *out) {
+    const rune_sweep_options_t *options = sweep->options;
+    int show_syscalls = options->use_native || options->use_strace;
+    char wall[32], rss[32], status[16];
+
+    fprintf(out, "\n--- Sweep: %zu configurations ---\n", num_configs);
+    fprintf(out, "%5s %8s %10s %10s", "#", "exit", "wall", "max RSS");
+    if (show_syscalls) {
+        fprintf(out, " %10s %8s", "syscalls", "errors");
+    }
+    if (options->use_ltrace) {
+        fprintf(out, " %10s", "libcalls");
+    }
+    if (options->use_valgrind) {
+        fprintf(out, " %12s", "leaked");
+    }
+    fprintf(out, "  arguments\n");
+
+    size_t non_zero = 0, timed_out = 0, leaking = 0;
+    for (size_t i = 0; i < num_configs; i++) {
+        const sweep_config_t *config = &sweep->configs[i];
+        const job_report_t *report = &config->report;
+        fprintf(out, "%5zu %8s %10s %10s", i + 1, format_status(config, status, sizeof(status)),
+                rune_latency_format(config->wall_ns, wall, sizeof(wall)), format_kb(report->max_rss_kb, rss, sizeof(rss)));
+        if (show_syscalls) {
+            fprintf(out, " %10llu %8llu", (unsigned long long)report->syscalls,
+                    (unsigned long long)report->syscall_errors);
+        }
+        if (options->use_ltrace) {
+            fprintf(out, " %10llu", (unsigned long long)report->library_calls);
+        }
+        if (options->use_valgrind) {
+            if (report->leaked_bytes >= 0) {
+                fprintf(out, " %12lld", report->leaked_bytes);
+            } else {
+                fprintf(out, " %12s", "?");
+            }
+        }
+        int label_len = (int)strlen(config->label);
+        if (label_len > LABEL_WIDTH) {
+            fprintf(out, "  %.*s...\n", LABEL_WIDTH - 3, config->label);
+        } else {
+            fprintf(out, "  %s\n", config->label);
+        }
+        non_zero += !config->timed_out && report->exit_status != 0;
+        timed_out += config->timed_out;
+        leaking += report->leaked_bytes > 0;
+    }
+
+    // The slowest few, by insertion into a small sorted list
+    size_t slowest[TOP_SLOWEST];
+    size_t num_slowest = 0;
+    for (size_t i = 0; i < num_configs; i++) {
+        size_t pos = num_slowest < TOP_SLOWEST ? num_slowest++ : TOP_SLOWEST;
+        while (pos > 0 && sweep->configs[slowest[pos - 1]].wall_ns < sweep->configs[i].wall_ns) {
+            if (pos < TOP_SLOWEST) {
+                slowest[pos] = slowest[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < TOP_SLOWEST) {
+            slowest[pos] = i;
+        }
+    }
+    size_t largest = 0;
+    for (size_t i = 1; i < num_configs; i++) {
+        if (sweep->configs[i].report.max_rss_kb > sweep->configs[largest].report.max_rss_kb) {
+            largest = i;
+        }
+    }
+
+    fprintf(out, "Slowest:");
+    for (size_t i = 0; i < num_slowest; i++) {
+        fprintf(out, " #%zu (%s)", slowest[i] + 1,
+                rune_latency_format(sweep->configs[slowest[i]].wall_ns, wall, sizeof(wall)));
+    }
+    fprintf(out, "\nLargest peak RSS: #%zu (%s)\n", largest + 1,
+            format_kb(sweep->configs[largest].report.max_rss_kb, rss, sizeof(rss)));
+    if (non_zero > 0 || timed_out > 0) {
+        fprintf(out, "Failing: %zu exited with a non-zero status or a signal, %zu timed out\n", non_zero, timed_out);
+    }
+    if (leaking > 0) {
+        fprintf(out, "Leaking: %zu configurations lost memory (see runescope_sweep_<N>_valgrind.log)\n", leaking);
+    }
+}
+
+// The CPUs this process may use, for handing out one per running job
+static int init_cpus(sweep_t *sweep) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+        perror("runescope: sched_getaffinity failed");
+        return -1;
+    }
+    size_t count = (size_t)CPU_COUNT(&allowed);
+    sweep->cpus = malloc((count ? count : 1) * sizeof(int));
+    sweep->cpu_busy = calloc(count ? count : 1, 1);
+    if (sweep->cpus == NULL || sweep->cpu_busy == NULL) {
+        perror("runescope: malloc failed for sweep CPUs");
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE && sweep->num_cpus < count; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            sweep->cpus[sweep->num_cpus++] = cpu;
+        }
+    }
+    return 0;
+}
+
+int rune_sweep_run(const char *executable_path, char *const base_argv[], const char *spec_path,
+                   const rune_sweep_options_t *options, FILE *out) {
+    sweep_t sweep = {0};
+    size_t num_configs = 0;
+    sweep.executable_path = executable_path;
+    sweep.options = options;
+    sweep.configs = read_spec(spec_path, base_argv, &num_configs);
+    if (sweep.configs == NULL) {
+        return -1;
+    }
+    if (num_configs == 0) {
+        fprintf(stderr, "runescope: Error: The sweep spec %s has no configurations.\n", spec_path);
+        free_configs(sweep.configs, 0);
+        return -1;
+    }
+
+    int result = 0;
+    pthread_mutex_init(&sweep.cpu_lock, NULL);
+    if (options->pin && init_cpus(&sweep) == -1) {
+        result = -1;
+    } else {
+        int workers = options->max_jobs > 0 ? options->max_jobs : rune_pool_cpu_count();
+        fflush(out); // Job processes must not inherit unflushed output
+        fflush(stdout);
+        if (rune_pool_run(num_configs, workers, sweep_task, &sweep) == -1) {
+            result = -1;
+        } else {
+            print_results(&sweep, num_configs, out);
+        }
+    }
+    pthread_mutex_destroy(&sweep.cpu_lock);
+    free(sweep.cpus);
+    free(sweep.cpu_busy);
+    free_configs(sweep.configs, num_configs);
+    return result;
+}
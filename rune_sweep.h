@@ -0,0 +1,52 @@
+#ifndef RUNE_SWEEP_H
+#define RUNE_SWEEP_H
+
+#include <stdio.h>
+
+/**
+ * @brief Runs one executable over a matrix of argument sets in parallel.
+ *
+ * Every configuration runs in its own job process, so concurrent native
+ * tracers and tools cannot see each other's children. Jobs are handed out
+ * to worker threads through rune_pool, each worker taking the next
+ * configuration as soon as it is free. Each job can be limited in time and
+ * pinned to a CPU of its own.
+ */
+
+// How to run a sweep
+typedef struct {
+    int max_jobs;           // Configurations running at the same time, 0 = one per CPU
+    double timeout_seconds; // Kill a configuration after this long, 0 = no limit
+    int pin;                // Give every running configuration a CPU of its own
+    int use_native;         // Count syscalls with the built-in tracer
+    const char *trace_spec; // With use_native: the syscalls to trace, NULL for all
+    int use_strace;         // Run under strace and count the syscalls in its log
+    int use_ltrace;         // Run under ltrace and count the library calls in its log
+    int use_valgrind;       // Run under valgrind's memcheck and report the bytes definitely lost
+} rune_sweep_options_t;
+
+/**
+ * @brief Runs every configuration of a sweep spec and prints a table of the results.
+ *
+ * Each non-empty line of the spec that does not start with '#' is one
+ * configuration: arguments appended to base_argv, split at whitespace, with
+ * '...' and "..." quoting. A "< FILE" pair on the line feeds FILE to the
+ * target's stdin; otherwise stdin is /dev/null. The target's stdout is
+ * discarded. Tool logs are written per configuration, to
+ * runescope_sweep_<N>_<tool>.log.
+ *
+ * The table lists the exit status, wall time, peak RSS and, depending on
+ * the analyses, syscall and error counts, library calls and leaked bytes of
+ * every configuration, followed by the slowest, largest and failing ones.
+ *
+ * @param executable_path The absolute path to the target executable.
+ * @param base_argv The target's fixed arguments, starting with argv[0], NULL-terminated.
+ * @param spec_path The sweep spec file.
+ * @param options Parallelism, limits and analyses.
+ * @param out The stream to print to.
+ * @return 0 on success, -1 if the spec could not be read or on allocation failure.
+ */
+int rune_sweep_run(const char *executable_path, char *const base_argv[], const char *spec_path,
+                   const rune_sweep_options_t *options, FILE *out);
+
+#endif // RUNE_SWEEP_H
@@ -0,0 +1,1085 @@
+#define _GNU_SOURCE // For the full set of SYS_* numbers
+#include "rune_syscalls.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/syscall.h>
+
+typedef struct {
+    const char *name;
+    int nargs;
+    int classes;
+} rune_syscall_info_t;
+
+// Indexed by syscall number; numbers that are not listed have a NULL name
+static const rune_syscall_info_t syscall_table[] = {
+#ifdef SYS_read
+    [SYS_read] = { "read", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_write
+    [SYS_write] = { "write", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_open
+    [SYS_open] = { "open", 3, RUNE_SC_FILE },
+#endif
+#ifdef SYS_close
+    [SYS_close] = { "close", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_stat
+    [SYS_stat] = { "stat", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_fstat
+    [SYS_fstat] = { "fstat", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_lstat
+    [SYS_lstat] = { "lstat", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_poll
+    [SYS_poll] = { "poll", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_lseek
+    [SYS_lseek] = { "lseek", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_mmap
+    [SYS_mmap] = { "mmap", 6, RUNE_SC_DESC | RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_mprotect
+    [SYS_mprotect] = { "mprotect", 3, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_munmap
+    [SYS_munmap] = { "munmap", 2, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_brk
+    [SYS_brk] = { "brk", 1, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_rt_sigaction
+    [SYS_rt_sigaction] = { "rt_sigaction", 4, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_rt_sigprocmask
+    [SYS_rt_sigprocmask] = { "rt_sigprocmask", 4, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_rt_sigreturn
+    [SYS_rt_sigreturn] = { "rt_sigreturn", 0, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_ioctl
+    [SYS_ioctl] = { "ioctl", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_pread64
+    [SYS_pread64] = { "pread64", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_pwrite64
+    [SYS_pwrite64] = { "pwrite64", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_readv
+    [SYS_readv] = { "readv", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_writev
+    [SYS_writev] = { "writev", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_access
+    [SYS_access] = { "access", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_pipe
+    [SYS_pipe] = { "pipe", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_select
+    [SYS_select] = { "select", 5, RUNE_SC_DESC },
+#endif
+#ifdef SYS_sched_yield
+    [SYS_sched_yield] = { "sched_yield", 0, 0 },
+#endif
+#ifdef SYS_mremap
+    [SYS_mremap] = { "mremap", 5, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_msync
+    [SYS_msync] = { "msync", 3, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_mincore
+    [SYS_mincore] = { "mincore", 3, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_madvise
+    [SYS_madvise] = { "madvise", 3, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_shmget
+    [SYS_shmget] = { "shmget", 3, RUNE_SC_IPC },
+#endif
+#ifdef SYS_shmat
+    [SYS_shmat] = { "shmat", 3, RUNE_SC_IPC | RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_shmctl
+    [SYS_shmctl] = { "shmctl", 3, RUNE_SC_IPC },
+#endif
+#ifdef SYS_dup
+    [SYS_dup] = { "dup", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_dup2
+    [SYS_dup2] = { "dup2", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_pause
+    [SYS_pause] = { "pause", 0, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_nanosleep
+    [SYS_nanosleep] = { "nanosleep", 2, 0 },
+#endif
+#ifdef SYS_getitimer
+    [SYS_getitimer] = { "getitimer", 2, 0 },
+#endif
+#ifdef SYS_alarm
+    [SYS_alarm] = { "alarm", 1, 0 },
+#endif
+#ifdef SYS_setitimer
+    [SYS_setitimer] = { "setitimer", 3, 0 },
+#endif
+#ifdef SYS_getpid
+    [SYS_getpid] = { "getpid", 0, 0 },
+#endif
+#ifdef SYS_sendfile
+    [SYS_sendfile] = { "sendfile", 4, RUNE_SC_DESC | RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_socket
+    [SYS_socket] = { "socket", 3, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_connect
+    [SYS_connect] = { "connect", 3, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_accept
+    [SYS_accept] = { "accept", 3, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_sendto
+    [SYS_sendto] = { "sendto", 6, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_recvfrom
+    [SYS_recvfrom] = { "recvfrom", 6, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_sendmsg
+    [SYS_sendmsg] = { "sendmsg", 3, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_recvmsg
+    [SYS_recvmsg] = { "recvmsg", 3, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_shutdown
+    [SYS_shutdown] = { "shutdown", 2, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_bind
+    [SYS_bind] = { "bind", 3, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_listen
+    [SYS_listen] = { "listen", 2, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_getsockname
+    [SYS_getsockname] = { "getsockname", 3, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_getpeername
+    [SYS_getpeername] = { "getpeername", 3, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_socketpair
+    [SYS_socketpair] = { "socketpair", 4, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_setsockopt
+    [SYS_setsockopt] = { "setsockopt", 5, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_getsockopt
+    [SYS_getsockopt] = { "getsockopt", 5, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_clone
+    [SYS_clone] = { "clone", 5, RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_fork
+    [SYS_fork] = { "fork", 0, RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_vfork
+    [SYS_vfork] = { "vfork", 0, RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_execve
+    [SYS_execve] = { "execve", 3, RUNE_SC_FILE | RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_exit
+    [SYS_exit] = { "exit", 1, RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_wait4
+    [SYS_wait4] = { "wait4", 4, RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_kill
+    [SYS_kill] = { "kill", 2, RUNE_SC_SIGNAL | RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_uname
+    [SYS_uname] = { "uname", 1, 0 },
+#endif
+#ifdef SYS_semget
+    [SYS_semget] = { "semget", 3, RUNE_SC_IPC },
+#endif
+#ifdef SYS_semop
+    [SYS_semop] = { "semop", 3, RUNE_SC_IPC },
+#endif
+#ifdef SYS_semctl
+    [SYS_semctl] = { "semctl", 4, RUNE_SC_IPC },
+#endif
+#ifdef SYS_shmdt
+    [SYS_shmdt] = { "shmdt", 1, RUNE_SC_IPC | RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_msgget
+    [SYS_msgget] = { "msgget", 2, RUNE_SC_IPC },
+#endif
+#ifdef SYS_msgsnd
+    [SYS_msgsnd] = { "msgsnd", 4, RUNE_SC_IPC },
+#endif
+#ifdef SYS_msgrcv
+    [SYS_msgrcv] = { "msgrcv", 5, RUNE_SC_IPC },
+#endif
+#ifdef SYS_msgctl
+    [SYS_msgctl] = { "msgctl", 3, RUNE_SC_IPC },
+#endif
+#ifdef SYS_fcntl
+    [SYS_fcntl] = { "fcntl", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_flock
+    [SYS_flock] = { "flock", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_fsync
+    [SYS_fsync] = { "fsync", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_fdatasync
+    [SYS_fdatasync] = { "fdatasync", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_truncate
+    [SYS_truncate] = { "truncate", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_ftruncate
+    [SYS_ftruncate] = { "ftruncate", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_getdents
+    [SYS_getdents] = { "getdents", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_getcwd
+    [SYS_getcwd] = { "getcwd", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_chdir
+    [SYS_chdir] = { "chdir", 1, RUNE_SC_FILE },
+#endif
+#ifdef SYS_fchdir
+    [SYS_fchdir] = { "fchdir", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_rename
+    [SYS_rename] = { "rename", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_mkdir
+    [SYS_mkdir] = { "mkdir", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_rmdir
+    [SYS_rmdir] = { "rmdir", 1, RUNE_SC_FILE },
+#endif
+#ifdef SYS_creat
+    [SYS_creat] = { "creat", 2, RUNE_SC_FILE | RUNE_SC_DESC },
+#endif
+#ifdef SYS_link
+    [SYS_link] = { "link", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_unlink
+    [SYS_unlink] = { "unlink", 1, RUNE_SC_FILE },
+#endif
+#ifdef SYS_symlink
+    [SYS_symlink] = { "symlink", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_readlink
+    [SYS_readlink] = { "readlink", 3, RUNE_SC_FILE },
+#endif
+#ifdef SYS_chmod
+    [SYS_chmod] = { "chmod", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_fchmod
+    [SYS_fchmod] = { "fchmod", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_chown
+    [SYS_chown] = { "chown", 3, RUNE_SC_FILE },
+#endif
+#ifdef SYS_fchown
+    [SYS_fchown] = { "fchown", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_lchown
+    [SYS_lchown] = { "lchown", 3, RUNE_SC_FILE },
+#endif
+#ifdef SYS_umask
+    [SYS_umask] = { "umask", 1, 0 },
+#endif
+#ifdef SYS_gettimeofday
+    [SYS_gettimeofday] = { "gettimeofday", 2, 0 },
+#endif
+#ifdef SYS_getrlimit
+    [SYS_getrlimit] = { "getrlimit", 2, 0 },
+#endif
+#ifdef SYS_getrusage
+    [SYS_getrusage] = { "getrusage", 2, 0 },
+#endif
+#ifdef SYS_sysinfo
+    [SYS_sysinfo] = { "sysinfo", 1, 0 },
+#endif
+#ifdef SYS_times
+    [SYS_times] = { "times", 1, 0 },
+#endif
+#ifdef SYS_ptrace
+    [SYS_ptrace] = { "ptrace", 4, 0 },
+#endif
+#ifdef SYS_getuid
+    [SYS_getuid] = { "getuid", 0, 0 },
+#endif
+#ifdef SYS_getgid
+    [SYS_getgid] = { "getgid", 0, 0 },
+#endif
+#ifdef SYS_setuid
+    [SYS_setuid] = { "setuid", 1, 0 },
+#endif
+#ifdef SYS_setgid
+    [SYS_setgid] = { "setgid", 1, 0 },
+#endif
+#ifdef SYS_geteuid
+    [SYS_geteuid] = { "geteuid", 0, 0 },
+#endif
+#ifdef SYS_getegid
+    [SYS_getegid] = { "getegid", 0, 0 },
+#endif
+#ifdef SYS_setpgid
+    [SYS_setpgid] = { "setpgid", 2, 0 },
+#endif
+#ifdef SYS_getppid
+    [SYS_getppid] = { "getppid", 0, 0 },
+#endif
+#ifdef SYS_getpgrp
+    [SYS_getpgrp] = { "getpgrp", 0, 0 },
+#endif
+#ifdef SYS_setsid
+    [SYS_setsid] = { "setsid", 0, 0 },
+#endif
+#ifdef SYS_getpgid
+    [SYS_getpgid] = { "getpgid", 1, 0 },
+#endif
+#ifdef SYS_getsid
+    [SYS_getsid] = { "getsid", 1, 0 },
+#endif
+#ifdef SYS_capget
+    [SYS_capget] = { "capget", 2, 0 },
+#endif
+#ifdef SYS_capset
+    [SYS_capset] = { "capset", 2, 0 },
+#endif
+#ifdef SYS_rt_sigpending
+    [SYS_rt_sigpending] = { "rt_sigpending", 2, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_rt_sigtimedwait
+    [SYS_rt_sigtimedwait] = { "rt_sigtimedwait", 4, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_rt_sigqueueinfo
+    [SYS_rt_sigqueueinfo] = { "rt_sigqueueinfo", 3, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_rt_sigsuspend
+    [SYS_rt_sigsuspend] = { "rt_sigsuspend", 2, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_sigaltstack
+    [SYS_sigaltstack] = { "sigaltstack", 2, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_utime
+    [SYS_utime] = { "utime", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_mknod
+    [SYS_mknod] = { "mknod", 3, RUNE_SC_FILE },
+#endif
+#ifdef SYS_personality
+    [SYS_personality] = { "personality", 1, 0 },
+#endif
+#ifdef SYS_statfs
+    [SYS_statfs] = { "statfs", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_fstatfs
+    [SYS_fstatfs] = { "fstatfs", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_getpriority
+    [SYS_getpriority] = { "getpriority", 2, 0 },
+#endif
+#ifdef SYS_setpriority
+    [SYS_setpriority] = { "setpriority", 3, 0 },
+#endif
+#ifdef SYS_mlock
+    [SYS_mlock] = { "mlock", 2, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_munlock
+    [SYS_munlock] = { "munlock", 2, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_mlockall
+    [SYS_mlockall] = { "mlockall", 1, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_munlockall
+    [SYS_munlockall] = { "munlockall", 0, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_pivot_root
+    [SYS_pivot_root] = { "pivot_root", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_prctl
+    [SYS_prctl] = { "prctl", 5, 0 },
+#endif
+#ifdef SYS_arch_prctl
+    [SYS_arch_prctl] = { "arch_prctl", 2, 0 },
+#endif
+#ifdef SYS_chroot
+    [SYS_chroot] = { "chroot", 1, RUNE_SC_FILE },
+#endif
+#ifdef SYS_sync
+    [SYS_sync] = { "sync", 0, 0 },
+#endif
+#ifdef SYS_acct
+    [SYS_acct] = { "acct", 1, RUNE_SC_FILE },
+#endif
+#ifdef SYS_mount
+    [SYS_mount] = { "mount", 5, RUNE_SC_FILE },
+#endif
+#ifdef SYS_umount2
+    [SYS_umount2] = { "umount2", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_swapon
+    [SYS_swapon] = { "swapon", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_swapoff
+    [SYS_swapoff] = { "swapoff", 1, RUNE_SC_FILE },
+#endif
+#ifdef SYS_gettid
+    [SYS_gettid] = { "gettid", 0, 0 },
+#endif
+#ifdef SYS_readahead
+    [SYS_readahead] = { "readahead", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_setxattr
+    [SYS_setxattr] = { "setxattr", 5, RUNE_SC_FILE },
+#endif
+#ifdef SYS_lsetxattr
+    [SYS_lsetxattr] = { "lsetxattr", 5, RUNE_SC_FILE },
+#endif
+#ifdef SYS_fsetxattr
+    [SYS_fsetxattr] = { "fsetxattr", 5, RUNE_SC_DESC },
+#endif
+#ifdef SYS_getxattr
+    [SYS_getxattr] = { "getxattr", 4, RUNE_SC_FILE },
+#endif
+#ifdef SYS_lgetxattr
+    [SYS_lgetxattr] = { "lgetxattr", 4, RUNE_SC_FILE },
+#endif
+#ifdef SYS_fgetxattr
+    [SYS_fgetxattr] = { "fgetxattr", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_listxattr
+    [SYS_listxattr] = { "listxattr", 3, RUNE_SC_FILE },
+#endif
+#ifdef SYS_llistxattr
+    [SYS_llistxattr] = { "llistxattr", 3, RUNE_SC_FILE },
+#endif
+#ifdef SYS_flistxattr
+    [SYS_flistxattr] = { "flistxattr", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_removexattr
+    [SYS_removexattr] = { "removexattr", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_lremovexattr
+    [SYS_lremovexattr] = { "lremovexattr", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_fremovexattr
+    [SYS_fremovexattr] = { "fremovexattr", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_tkill
+    [SYS_tkill] = { "tkill", 2, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_futex
+    [SYS_futex] = { "futex", 6, 0 },
+#endif
+#ifdef SYS_sched_setaffinity
+    [SYS_sched_setaffinity] = { "sched_setaffinity", 3, 0 },
+#endif
+#ifdef SYS_sched_getaffinity
+    [SYS_sched_getaffinity] = { "sched_getaffinity", 3, 0 },
+#endif
+#ifdef SYS_epoll_create
+    [SYS_epoll_create] = { "epoll_create", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_remap_file_pages
+    [SYS_remap_file_pages] = { "remap_file_pages", 5, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_getdents64
+    [SYS_getdents64] = { "getdents64", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_set_tid_address
+    [SYS_set_tid_address] = { "set_tid_address", 1, 0 },
+#endif
+#ifdef SYS_semtimedop
+    [SYS_semtimedop] = { "semtimedop", 4, RUNE_SC_IPC },
+#endif
+#ifdef SYS_fadvise64
+    [SYS_fadvise64] = { "fadvise64", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_timer_create
+    [SYS_timer_create] = { "timer_create", 3, 0 },
+#endif
+#ifdef SYS_clock_gettime
+    [SYS_clock_gettime] = { "clock_gettime", 2, 0 },
+#endif
+#ifdef SYS_clock_nanosleep
+    [SYS_clock_nanosleep] = { "clock_nanosleep", 4, 0 },
+#endif
+#ifdef SYS_exit_group
+    [SYS_exit_group] = { "exit_group", 1, RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_epoll_wait
+    [SYS_epoll_wait] = { "epoll_wait", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_epoll_ctl
+    [SYS_epoll_ctl] = { "epoll_ctl", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_tgkill
+    [SYS_tgkill] = { "tgkill", 3, RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_utimes
+    [SYS_utimes] = { "utimes", 2, RUNE_SC_FILE },
+#endif
+#ifdef SYS_mbind
+    [SYS_mbind] = { "mbind", 6, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_set_mempolicy
+    [SYS_set_mempolicy] = { "set_mempolicy", 3, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_get_mempolicy
+    [SYS_get_mempolicy] = { "get_mempolicy", 5, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_mq_open
+    [SYS_mq_open] = { "mq_open", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_mq_unlink
+    [SYS_mq_unlink] = { "mq_unlink", 1, 0 },
+#endif
+#ifdef SYS_mq_timedsend
+    [SYS_mq_timedsend] = { "mq_timedsend", 5, RUNE_SC_DESC },
+#endif
+#ifdef SYS_mq_timedreceive
+    [SYS_mq_timedreceive] = { "mq_timedreceive", 5, RUNE_SC_DESC },
+#endif
+#ifdef SYS_waitid
+    [SYS_waitid] = { "waitid", 5, RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_inotify_init
+    [SYS_inotify_init] = { "inotify_init", 0, RUNE_SC_DESC },
+#endif
+#ifdef SYS_inotify_add_watch
+    [SYS_inotify_add_watch] = { "inotify_add_watch", 3, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_inotify_rm_watch
+    [SYS_inotify_rm_watch] = { "inotify_rm_watch", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_migrate_pages
+    [SYS_migrate_pages] = { "migrate_pages", 4, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_openat
+    [SYS_openat] = { "openat", 4, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_mkdirat
+    [SYS_mkdirat] = { "mkdirat", 3, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_mknodat
+    [SYS_mknodat] = { "mknodat", 4, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_fchownat
+    [SYS_fchownat] = { "fchownat", 5, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_futimesat
+    [SYS_futimesat] = { "futimesat", 3, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_newfstatat
+    [SYS_newfstatat] = { "newfstatat", 4, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_unlinkat
+    [SYS_unlinkat] = { "unlinkat", 3, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_renameat
+    [SYS_renameat] = { "renameat", 4, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_linkat
+    [SYS_linkat] = { "linkat", 5, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_symlinkat
+    [SYS_symlinkat] = { "symlinkat", 3, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_readlinkat
+    [SYS_readlinkat] = { "readlinkat", 4, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_fchmodat
+    [SYS_fchmodat] = { "fchmodat", 3, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_faccessat
+    [SYS_faccessat] = { "faccessat", 3, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_pselect6
+    [SYS_pselect6] = { "pselect6", 6, RUNE_SC_DESC },
+#endif
+#ifdef SYS_ppoll
+    [SYS_ppoll] = { "ppoll", 5, RUNE_SC_DESC },
+#endif
+#ifdef SYS_unshare
+    [SYS_unshare] = { "unshare", 1, 0 },
+#endif
+#ifdef SYS_set_robust_list
+    [SYS_set_robust_list] = { "set_robust_list", 2, 0 },
+#endif
+#ifdef SYS_get_robust_list
+    [SYS_get_robust_list] = { "get_robust_list", 3, 0 },
+#endif
+#ifdef SYS_splice
+    [SYS_splice] = { "splice", 6, RUNE_SC_DESC },
+#endif
+#ifdef SYS_tee
+    [SYS_tee] = { "tee", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_sync_file_range
+    [SYS_sync_file_range] = { "sync_file_range", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_vmsplice
+    [SYS_vmsplice] = { "vmsplice", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_move_pages
+    [SYS_move_pages] = { "move_pages", 6, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_utimensat
+    [SYS_utimensat] = { "utimensat", 4, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_epoll_pwait
+    [SYS_epoll_pwait] = { "epoll_pwait", 6, RUNE_SC_DESC },
+#endif
+#ifdef SYS_signalfd
+    [SYS_signalfd] = { "signalfd", 3, RUNE_SC_DESC | RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_timerfd_create
+    [SYS_timerfd_create] = { "timerfd_create", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_eventfd
+    [SYS_eventfd] = { "eventfd", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_fallocate
+    [SYS_fallocate] = { "fallocate", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_timerfd_settime
+    [SYS_timerfd_settime] = { "timerfd_settime", 4, RUNE_SC_DESC },
+#endif
+#ifdef SYS_timerfd_gettime
+    [SYS_timerfd_gettime] = { "timerfd_gettime", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_accept4
+    [SYS_accept4] = { "accept4", 4, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_signalfd4
+    [SYS_signalfd4] = { "signalfd4", 4, RUNE_SC_DESC | RUNE_SC_SIGNAL },
+#endif
+#ifdef SYS_eventfd2
+    [SYS_eventfd2] = { "eventfd2", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_epoll_create1
+    [SYS_epoll_create1] = { "epoll_create1", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_dup3
+    [SYS_dup3] = { "dup3", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_pipe2
+    [SYS_pipe2] = { "pipe2", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_inotify_init1
+    [SYS_inotify_init1] = { "inotify_init1", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_preadv
+    [SYS_preadv] = { "preadv", 5, RUNE_SC_DESC },
+#endif
+#ifdef SYS_pwritev
+    [SYS_pwritev] = { "pwritev", 5, RUNE_SC_DESC },
+#endif
+#ifdef SYS_rt_tgsigqueueinfo
+    [SYS_rt_tgsigqueueinfo] = { "rt_tgsigqueueinfo", 4, RUNE_SC_SIGNAL | RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_perf_event_open
+    [SYS_perf_event_open] = { "perf_event_open", 5, RUNE_SC_DESC },
+#endif
+#ifdef SYS_recvmmsg
+    [SYS_recvmmsg] = { "recvmmsg", 5, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_fanotify_init
+    [SYS_fanotify_init] = { "fanotify_init", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_fanotify_mark
+    [SYS_fanotify_mark] = { "fanotify_mark", 5, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_prlimit64
+    [SYS_prlimit64] = { "prlimit64", 4, 0 },
+#endif
+#ifdef SYS_name_to_handle_at
+    [SYS_name_to_handle_at] = { "name_to_handle_at", 5, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_open_by_handle_at
+    [SYS_open_by_handle_at] = { "open_by_handle_at", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_syncfs
+    [SYS_syncfs] = { "syncfs", 1, RUNE_SC_DESC },
+#endif
+#ifdef SYS_sendmmsg
+    [SYS_sendmmsg] = { "sendmmsg", 4, RUNE_SC_NETWORK },
+#endif
+#ifdef SYS_setns
+    [SYS_setns] = { "setns", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_getcpu
+    [SYS_getcpu] = { "getcpu", 3, 0 },
+#endif
+#ifdef SYS_process_vm_readv
+    [SYS_process_vm_readv] = { "process_vm_readv", 6, 0 },
+#endif
+#ifdef SYS_process_vm_writev
+    [SYS_process_vm_writev] = { "process_vm_writev", 6, 0 },
+#endif
+#ifdef SYS_renameat2
+    [SYS_renameat2] = { "renameat2", 5, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_seccomp
+    [SYS_seccomp] = { "seccomp", 3, 0 },
+#endif
+#ifdef SYS_getrandom
+    [SYS_getrandom] = { "getrandom", 3, 0 },
+#endif
+#ifdef SYS_memfd_create
+    [SYS_memfd_create] = { "memfd_create", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_execveat
+    [SYS_execveat] = { "execveat", 5, RUNE_SC_DESC | RUNE_SC_FILE | RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_membarrier
+    [SYS_membarrier] = { "membarrier", 2, 0 },
+#endif
+#ifdef SYS_mlock2
+    [SYS_mlock2] = { "mlock2", 3, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_copy_file_range
+    [SYS_copy_file_range] = { "copy_file_range", 6, RUNE_SC_DESC },
+#endif
+#ifdef SYS_preadv2
+    [SYS_preadv2] = { "preadv2", 6, RUNE_SC_DESC },
+#endif
+#ifdef SYS_pwritev2
+    [SYS_pwritev2] = { "pwritev2", 6, RUNE_SC_DESC },
+#endif
+#ifdef SYS_pkey_mprotect
+    [SYS_pkey_mprotect] = { "pkey_mprotect", 4, RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_statx
+    [SYS_statx] = { "statx", 5, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_io_uring_setup
+    [SYS_io_uring_setup] = { "io_uring_setup", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_io_uring_enter
+    [SYS_io_uring_enter] = { "io_uring_enter", 6, RUNE_SC_DESC },
+#endif
+#ifdef SYS_rseq
+    [SYS_rseq] = { "rseq", 4, 0 },
+#endif
+#ifdef SYS_pidfd_send_signal
+    [SYS_pidfd_send_signal] = { "pidfd_send_signal", 4, RUNE_SC_DESC | RUNE_SC_SIGNAL | RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_pidfd_open
+    [SYS_pidfd_open] = { "pidfd_open", 2, RUNE_SC_DESC },
+#endif
+#ifdef SYS_clone3
+    [SYS_clone3] = { "clone3", 2, RUNE_SC_PROCESS },
+#endif
+#ifdef SYS_close_range
+    [SYS_close_range] = { "close_range", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_openat2
+    [SYS_openat2] = { "openat2", 4, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_pidfd_getfd
+    [SYS_pidfd_getfd] = { "pidfd_getfd", 3, RUNE_SC_DESC },
+#endif
+#ifdef SYS_faccessat2
+    [SYS_faccessat2] = { "faccessat2", 4, RUNE_SC_DESC | RUNE_SC_FILE },
+#endif
+#ifdef SYS_process_madvise
+    [SYS_process_madvise] = { "process_madvise", 5, RUNE_SC_DESC | RUNE_SC_MEMORY },
+#endif
+#ifdef SYS_epoll_pwait2
+    [SYS_epoll_pwait2] = { "epoll_pwait2", 6, RUNE_SC_DESC },
+#endif
+};
+
+#define SYSCALL_TABLE_SIZE ((long)(sizeof(syscall_table) / sizeof(syscall_table[0])))
+
+static const char *const errno_names[] = {
+    [EPERM] = "EPERM",
+    [ENOENT] = "ENOENT",
+    [ESRCH] = "ESRCH",
+    [EINTR] = "EINTR",
+    [EIO] = "EIO",
+    [ENXIO] = "ENXIO",
+    [E2BIG] = "E2BIG",
+    [ENOEXEC] = "ENOEXEC",
+    [EBADF] = "EBADF",
+    [ECHILD] = "ECHILD",
+    [EAGAIN] = "EAGAIN",
+    [ENOMEM] = "ENOMEM",
+    [EACCES] = "EACCES",
+    [EFAULT] = "EFAULT",
+    [ENOTBLK] = "ENOTBLK",
+    [EBUSY] = "EBUSY",
+    [EEXIST] = "EEXIST",
+    [EXDEV] = "EXDEV",
+    [ENODEV] = "ENODEV",
+    [ENOTDIR] = "ENOTDIR",
+    [EISDIR] = "EISDIR",
+    [EINVAL] = "EINVAL",
+    [ENFILE] = "ENFILE",
+    [EMFILE] = "EMFILE",
+    [ENOTTY] = "ENOTTY",
+    [ETXTBSY] = "ETXTBSY",
+    [EFBIG] = "EFBIG",
+    [ENOSPC] = "ENOSPC",
+    [ESPIPE] = "ESPIPE",
+    [EROFS] = "EROFS",
+    [EMLINK] = "EMLINK",
+    [EPIPE] = "EPIPE",
+    [EDOM] = "EDOM",
+    [ERANGE] = "ERANGE",
+    [EDEADLK] = "EDEADLK",
+    [ENAMETOOLONG] = "ENAMETOOLONG",
+    [ENOLCK] = "ENOLCK",
+    [ENOSYS] = "ENOSYS",
+    [ENOTEMPTY] = "ENOTEMPTY",
+    [ELOOP] = "ELOOP",
+    [ENOMSG] = "ENOMSG",
+    [EIDRM] = "EIDRM",
+    [ECHRNG] = "ECHRNG",
+    [EL2NSYNC] = "EL2NSYNC",
+    [EL3HLT] = "EL3HLT",
+    [EL3RST] = "EL3RST",
+    [ELNRNG] = "ELNRNG",
+    [EUNATCH] = "EUNATCH",
+    [ENOCSI] = "ENOCSI",
+    [EL2HLT] = "EL2HLT",
+    [EBADE] = "EBADE",
+    [EBADR] = "EBADR",
+    [EXFULL] = "EXFULL",
+    [ENOANO] = "ENOANO",
+    [EBADRQC] = "EBADRQC",
+    [EBADSLT] = "EBADSLT",
+    [EBFONT] = "EBFONT",
+    [ENOSTR] = "ENOSTR",
+    [ENODATA] = "ENODATA",
+    [ETIME] = "ETIME",
+    [ENOSR] = "ENOSR",
+    [ENONET] = "ENONET",
+    [ENOPKG] = "ENOPKG",
+    [EREMOTE] = "EREMOTE",
+    [ENOLINK] = "ENOLINK",
+    [EADV] = "EADV",
+    [ESRMNT] = "ESRMNT",
+    [ECOMM] = "ECOMM",
+    [EPROTO] = "EPROTO",
+    [EMULTIHOP] = "EMULTIHOP",
+    [EDOTDOT] = "EDOTDOT",
+    [EBADMSG] = "EBADMSG",
+    [EOVERFLOW] = "EOVERFLOW",
+    [ENOTUNIQ] = "ENOTUNIQ",
+    [EBADFD] = "EBADFD",
+    [EREMCHG] = "EREMCHG",
+    [ELIBACC] = "ELIBACC",
+    [ELIBBAD] = "ELIBBAD",
+    [ELIBSCN] = "ELIBSCN",
+    [ELIBMAX] = "ELIBMAX",
+    [ELIBEXEC] = "ELIBEXEC",
+    [EILSEQ] = "EILSEQ",
+    [ERESTART] = "ERESTART",
+    [ESTRPIPE] = "ESTRPIPE",
+    [EUSERS] = "EUSERS",
+    [ENOTSOCK] = "ENOTSOCK",
+    [EDESTADDRREQ] = "EDESTADDRREQ",
+    [EMSGSIZE] = "EMSGSIZE",
+    [EPROTOTYPE] = "EPROTOTYPE",
+    [ENOPROTOOPT] = "ENOPROTOOPT",
+    [EPROTONOSUPPORT] = "EPROTONOSUPPORT",
+    [ESOCKTNOSUPPORT] = "ESOCKTNOSUPPORT",
+    [EOPNOTSUPP] = "EOPNOTSUPP",
+    [EPFNOSUPPORT] = "EPFNOSUPPORT",
+    [EAFNOSUPPORT] = "EAFNOSUPPORT",
+    [EADDRINUSE] = "EADDRINUSE",
+    [EADDRNOTAVAIL] = "EADDRNOTAVAIL",
+    [ENETDOWN] = "ENETDOWN",
+    [ENETUNREACH] = "ENETUNREACH",
+    [ENETRESET] = "ENETRESET",
+    [ECONNABORTED] = "ECONNABORTED",
+    [ECONNRESET] = "ECONNRESET",
+    [ENOBUFS] = "ENOBUFS",
+    [EISCONN] = "EISCONN",
+    [ENOTCONN] = "ENOTCONN",
+    [ESHUTDOWN] = "ESHUTDOWN",
+    [ETOOMANYREFS] = "ETOOMANYREFS",
+    [ETIMEDOUT] = "ETIMEDOUT",
+    [ECONNREFUSED] = "ECONNREFUSED",
+    [EHOSTDOWN] = "EHOSTDOWN",
+    [EHOSTUNREACH] = "EHOSTUNREACH",
+    [EALREADY] = "EALREADY",
+    [EINPROGRESS] = "EINPROGRESS",
+    [ESTALE] = "ESTALE",
+    [EUCLEAN] = "EUCLEAN",
+    [ENOTNAM] = "ENOTNAM",
+    [ENAVAIL] = "ENAVAIL",
+    [EISNAM] = "EISNAM",
+    [EREMOTEIO] = "EREMOTEIO",
+    [EDQUOT] = "EDQUOT",
+    [ENOMEDIUM] = "ENOMEDIUM",
+    [EMEDIUMTYPE] = "EMEDIUMTYPE",
+    [ECANCELED] = "ECANCELED",
+    [ENOKEY] = "ENOKEY",
+    [EKEYEXPIRED] = "EKEYEXPIRED",
+    [EKEYREVOKED] = "EKEYREVOKED",
+    [EKEYREJECTED] = "EKEYREJECTED",
+    [EOWNERDEAD] = "EOWNERDEAD",
+    [ENOTRECOVERABLE] = "ENOTRECOVERABLE",
+    [ERFKILL] = "ERFKILL",
+};
+
+#define ERRNO_NAMES_SIZE ((int)(sizeof(errno_names) / sizeof(errno_names[0])))
+
+static const struct {
+    const char *name;
+    int classes;
+} class_names[] = {
+    { "file", RUNE_SC_FILE },
+    { "desc", RUNE_SC_DESC },
+    { "network", RUNE_SC_NETWORK },
+    { "net", RUNE_SC_NETWORK },
+    { "process", RUNE_SC_PROCESS },
+    { "signal", RUNE_SC_SIGNAL },
+    { "ipc", RUNE_SC_IPC },
+    { "memory", RUNE_SC_MEMORY },
+};
+
+const char *rune_syscalls_name(long nr) {
+    if (nr < 0 || nr >= SYSCALL_TABLE_SIZE) {
+        return NULL;
+    }
+    return syscall_table[nr].name;
+}
+
+int rune_syscalls_nargs(long nr) {
+    if (nr < 0 || nr >= SYSCALL_TABLE_SIZE || syscall_table[nr].name == NULL) {
+        return 6; // Unknown syscall, show every argument register
+    }
+    return syscall_table[nr].nargs;
+}
+
+const char *rune_syscalls_errno_name(int err) {
+    // Kernel-internal restart codes leak out to tracers on interrupted syscalls
+    switch (err) {
+    case 512: return "ERESTARTSYS";
+    case 513: return "ERESTARTNOINTR";
+    case 514: return "ERESTARTNOHAND";
+    case 516: return "ERESTART_RESTARTBLOCK";
+    default: break;
+    }
+    if (err <= 0 || err >= ERRNO_NAMES_SIZE) {
+        return NULL;
+    }
+    return errno_names[err];
+}
+
+int rune_syscalls_errno_value(const char *name, size_t len) {
+    static const int restart_codes[] = { 512, 513, 514, 516 };
+    for (size_t i = 0; i < sizeof(restart_codes) / sizeof(restart_codes[0]); i++) {
+        const char *candidate = rune_syscalls_errno_name(restart_codes[i]);
+        if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0') {
+            return restart_codes[i];
+        }
+    }
+    for (int err = 1; err < ERRNO_NAMES_SIZE; err++) {
+        if (errno_names[err] != NULL && strncmp(errno_names[err], name, len) == 0 && errno_names[err][len] == '\0') {
+            return err;
+        }
+    }
+    return 0;
+}
+
+// Marks every syscall matching one element of the trace specification
+static int select_element(const char *element, unsigned char *selected) {
+    int all = 0;
+    int classes = 0;
+
+    if (*element == '%') {
+        element++;
+    }
+    if (strcmp(element, "all") == 0) {
+        all = 1;
+    } else {
+        for (size_t i = 0; i < sizeof(class_names) / sizeof(class_names[0]); i++) {
+            if (strcmp(element, class_names[i].name) == 0) {
+                classes = class_names[i].classes;
+                break;
+            }
+        }
+    }
+
+    int matched = 0;
+    for (long nr = 0; nr < SYSCALL_TABLE_SIZE; nr++) {
+        if (syscall_table[nr].name == NULL) {
+            continue;
+        }
+        if (all || (syscall_table[nr].classes & classes) ||
+            (classes == 0 && strcmp(element, syscall_table[nr].name) == 0)) {
+            selected[nr] = 1;
+            matched = 1;
+        }
+    }
+    return matched ? 0 : -1;
+}
+
+long *rune_syscalls_parse_set(const char *spec, size_t *count) {
+    if (spec == NULL || count == NULL) {
+        return NULL;
+    }
+
+    unsigned char *selected = calloc(SYSCALL_TABLE_SIZE, 1);
+    char *spec_copy = strdup(spec);
+    if (selected == NULL || spec_copy == NULL) {
+        perror("runescope: allocation failed for trace set");
+        free(selected);
+        free(spec_copy);
+        return NULL;
+    }
+
+    // Duplicated because strtok modifies the string
+    for (char *element = strtok(spec_copy, ","); element != NULL; element = strtok(NULL, ",")) {
+        if (select_element(element, selected) == -1) {
+            fprintf(stderr, "runescope: Error: Unknown syscall or class '%s' in trace set.\n", element);
+            free(selected);
+            free(spec_copy);
+            return NULL;
+        }
+    }
+    free(spec_copy);
+
+    size_t n = 0;
+    for (long nr = 0; nr < SYSCALL_TABLE_SIZE; nr++) {
+        n += selected[nr];
+    }
+    long *list = malloc((n > 0 ? n : 1) * sizeof(long));
+    if (list == NULL) {
+        perror("runescope: malloc failed for trace set");
+        free(selected);
+        return NULL;
+    }
+    n = 0;
+    for (long nr = 0; nr < SYSCALL_TABLE_SIZE; nr++) {
+        if (selected[nr]) {
+            list[n++] = nr;
+        }
+    }
+    free(selected);
+
+    *count = n;
+    return list;
+}
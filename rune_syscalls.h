@@ -0,0 +1,71 @@
+#ifndef RUNE_SYSCALLS_H
+#define RUNE_SYSCALLS_H
+
+#include <stddef.h>
+
+/**
+ * @brief Syscall metadata for the native tracer.
+ *
+ * Maps syscall numbers of the host architecture to their names, argument
+ * counts and strace-style classes (%file, %network, ...), and errno values
+ * to their symbolic names.
+ */
+
+// Syscall classes, mirroring strace's -e trace=%class groups
+#define RUNE_SC_FILE    0x01 // Takes a file name argument
+#define RUNE_SC_DESC    0x02 // Operates on a file descriptor
+#define RUNE_SC_NETWORK 0x04 // Socket and network related
+#define RUNE_SC_PROCESS 0x08 // Process lifecycle management
+#define RUNE_SC_SIGNAL  0x10 // Signal related
+#define RUNE_SC_IPC     0x20 // SysV IPC
+#define RUNE_SC_MEMORY  0x40 // Memory mapping
+
+/**
+ * @brief Returns the name of a syscall.
+ *
+ * @param nr The syscall number on the host architecture.
+ * @return The syscall name, or NULL if the number is unknown.
+ */
+const char *rune_syscalls_name(long nr);
+
+/**
+ * @brief Returns the number of arguments a syscall takes.
+ *
+ * @param nr The syscall number on the host architecture.
+ * @return The argument count, or 6 if the number is unknown.
+ */
+int rune_syscalls_nargs(long nr);
+
+/**
+ * @brief Resolves a trace specification into a list of syscall numbers.
+ *
+ * The specification is a comma-separated list of syscall names and class
+ * names (file, desc, network, process, signal, ipc, memory, all), each class
+ * optionally prefixed with '%' as in strace's -e trace= syntax.
+ *
+ * @param spec The trace specification, e.g. "file,network,futex".
+ * @param count On success, receives the number of entries in the returned list.
+ * @return A dynamically allocated array of syscall numbers, or NULL if the
+ *         specification contains an unknown name or an error occurred. The
+ *         caller is responsible for freeing the returned array.
+ */
+long *rune_syscalls_parse_set(const char *spec, size_t *count);
+
+/**
+ * @brief Returns the symbolic name of an errno value (e.g. "ENOENT").
+ *
+ * @param err The errno value.
+ * @return The symbolic name, or NULL if the value is unknown.
+ */
+const char *rune_syscalls_errno_name(int err);
+
+/**
+ * @brief Returns the errno value of a symbolic name (e.g. "ENOENT").
+ *
+ * @param name The symbolic name (not necessarily NUL-terminated).
+ * @param len The length of name.
+ * @return The errno value, or 0 if the name is unknown.
+ */
+int rune_syscalls_errno_value(const char *name, size_t len);
+
+#endif // RUNE_SYSCALLS_H
@@ -0,0 +1,400 @@
+#define _GNU_SOURCE // For __WALL and PTRACE_GET_SYSCALL_INFO
+#include "rune_tracer.h"
+#include "rune_syscalls.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h> // For offsetof
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h> // For fork, pipe, execve
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#if defined(__x86_64__)
+#define RUNE_AUDIT_ARCH AUDIT_ARCH_X86_64
+#elif defined(__aarch64__)
+#define RUNE_AUDIT_ARCH AUDIT_ARCH_AARCH64
+#elif defined(__i386__)
+#define RUNE_AUDIT_ARCH AUDIT_ARCH_I386
+#endif
+
+// Classic BPF jump offsets are 8 bits wide, which caps an explicit syscall list
+#define MAX_FILTER_SYSCALLS 255
+
+#define INITIAL_TRACEE_CAPACITY 64
+
+// Per-thread tracing state, kept in an open-addressing table keyed by tid
+typedef struct {
+    pid_t tid;         // 0 = empty slot, -1 = deleted slot
+    int seen;          // Set once the first ptrace stop has been handled
+    int in_syscall;    // Entered a traced syscall, waiting for its exit stop
+    unsigned long long nr;
+    unsigned long long args[6];
+    int64_t entered_ns; // Wall clock time of the seccomp stop
+} tracee_t;
+
+typedef struct {
+    tracee_t *slots;
+    size_t capacity;   // Always a power of two
+    size_t used;       // Live plus deleted slots
+} tracee_table_t;
+
+static size_t tracee_hash(pid_t tid, size_t capacity) {
+    return ((size_t)tid * 2654435761u) & (capacity - 1);
+}
+
+static int tracee_table_init(tracee_table_t *table, size_t capacity) {
+    table->slots = calloc(capacity, sizeof(tracee_t));
+    if (table->slots == NULL) {
+        perror("runescope: calloc failed for tracee table");
+        return -1;
+    }
+    table->capacity = capacity;
+    table->used = 0;
+    return 0;
+}
+
+static tracee_t *tracee_find(tracee_table_t *table, pid_t tid) {
+    size_t i = tracee_hash(tid, table->capacity);
+    while (table->slots[i].tid != 0) {
+        if (table->slots[i].tid == tid) {
+            return &table->slots[i];
+        }
+        i = (i + 1) & (table->capacity - 1);
+    }
+    return NULL;
+}
+
+static int tracee_table_grow(tracee_table_t *table) {
+    tracee_table_t bigger;
+    if (tracee_table_init(&bigger, table->capacity * 2) == -1) {
+        return -1;
+    }
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i].tid > 0) {
+            size_t j = tracee_hash(table->slots[i].tid, bigger.capacity);
+            while (bigger.slots[j].tid != 0) {
+                j = (j + 1) & (bigger.capacity - 1);
+            }
+            bigger.slots[j] = table->slots[i];
+            bigger.used++;
+        }
+    }
+    free(table->slots);
+    *table = bigger;
+    return 0;
+}
+
+static tracee_t *tracee_get(tracee_table_t *table, pid_t tid) {
+    tracee_t *tracee = tracee_find(table, tid);
+    if (tracee != NULL) {
+        return tracee;
+    }
+    if ((table->used + 1) * 2 > table->capacity && tracee_table_grow(table) == -1) {
+        return NULL;
+    }
+    size_t i = tracee_hash(tid, table->capacity);
+    while (table->slots[i].tid > 0) {
+        i = (i + 1) & (table->capacity - 1);
+    }
+    if (table->slots[i].tid == 0) {
+        table->used++; // Reusing a deleted slot does not change the load
+    }
+    memset(&table->slots[i], 0, sizeof(tracee_t));
+    table->slots[i].tid = tid;
+    return &table->slots[i];
+}
+
+static void tracee_remove(tracee_table_t *table, pid_t tid) {
+    tracee_t *tracee = tracee_find(table, tid);
+    if (tracee != NULL) {
+        tracee->tid = -1;
+    }
+}
+
+// Builds the seccomp program: SECCOMP_RET_TRACE for the selected syscalls, ALLOW for the rest
+static struct sock_filter *build_filter(const long *syscalls, size_t count, int trace_all, unsigned short *len) {
+    struct sock_filter *filter = malloc((count + 6) * sizeof(struct sock_filter));
+    if (filter == NULL) {
+        perror("runescope: malloc failed for seccomp filter");
+        return NULL;
+    }
+
+    unsigned short n = 0;
+#ifdef RUNE_AUDIT_ARCH
+    // Syscalls of a foreign ABI use another numbering, let them through untraced
+    filter[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch));
+    filter[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, RUNE_AUDIT_ARCH, 1, 0);
+    filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+#endif
+    if (!trace_all) {
+        filter[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
+        for (size_t i = 0; i < count; i++) {
+            // Jump over the remaining comparisons and the ALLOW to the TRACE return
+            filter[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (unsigned int)syscalls[i],
+                                                       (unsigned char)(count - i), 0);
+        }
+        filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+    }
+    filter[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_TRACE);
+
+    *len = n;
+    return filter;
+}
+
+static int64_t realtime_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void emit_entry(const tracee_t *tracee, int has_exit, long long rval, int is_error,
+                       rune_strace_entry_cb on_entry, void *user_data) {
+    strace_entry_t entry = {0};
+    char name_buf[32];
+    char args_buf[6 * 24];
+    char error_buf[128];
+
+    entry.pid = tracee->tid;
+    entry.timestamp_ns = tracee->entered_ns;
+    entry.duration_ns = has_exit ? realtime_ns() - tracee->entered_ns : -1; // Includes ptrace stop overhead
+    const char *name = rune_syscalls_name((long)tracee->nr);
+    if (name == NULL) {
+        snprintf(name_buf, sizeof(name_buf), "syscall_%llu", tracee->nr);
+        name = name_buf;
+    }
+    entry.syscall_name = rune_strview_make(name, strlen(name));
+
+    int nargs = rune_syscalls_nargs((long)tracee->nr);
+    size_t pos = 0;
+    for (int i = 0; i < nargs; i++) {
+        pos += snprintf(args_buf + pos, sizeof(args_buf) - pos, "%s0x%llx", i > 0 ? ", " : "", tracee->args[i]);
+    }
+    entry.args = rune_strview_make(args_buf, pos);
+
+    // Syscalls like exit_group never return, strace prints them as "= ?"
+    if (has_exit && is_error) {
+        int err = (int)-rval;
+        const char *err_name = rune_syscalls_errno_name(err);
+        int len;
+        if (err_name != NULL && err >= 512) {
+            len = snprintf(error_buf, sizeof(error_buf), "%s", err_name); // No strerror() text
+        } else if (err_name != NULL) {
+            len = snprintf(error_buf, sizeof(error_buf), "%s (%s)", err_name, strerror(err));
+        } else {
+            len = snprintf(error_buf, sizeof(error_buf), "errno %d", err);
+        }
+        if (len >= (int)sizeof(error_buf)) {
+            len = sizeof(error_buf) - 1;
+        }
+        entry.return_value = -1;
+        entry.has_error = 1;
+        entry.error_str = rune_strview_make(error_buf, (size_t)len);
+    } else if (has_exit) {
+        entry.return_value = (long)rval;
+    }
+
+    on_entry(&entry, user_data);
+}
+
+// Handles a ptrace stop and returns the ptrace request that resumes the tracee
+static int handle_stop(tracee_t *tracee, int status, int *inject_signal,
+                       rune_strace_entry_cb on_entry, void *user_data) {
+    int sig = WSTOPSIG(status);
+    int event = (unsigned int)status >> 16;
+    int first_stop = !tracee->seen;
+    struct __ptrace_syscall_info info;
+
+    tracee->seen = 1;
+    *inject_signal = 0;
+
+    if (event == PTRACE_EVENT_SECCOMP) {
+        if (ptrace(PTRACE_GET_SYSCALL_INFO, tracee->tid, (void *)sizeof(info), &info) > 0 &&
+            info.op == PTRACE_SYSCALL_INFO_SECCOMP) {
+            tracee->in_syscall = 1;
+            tracee->entered_ns = realtime_ns();
+            tracee->nr = info.seccomp.nr;
+            memcpy(tracee->args, info.seccomp.args, sizeof(tracee->args));
+        }
+        // Resume in syscall-stop mode only until this syscall's exit stop
+        return tracee->in_syscall ? PTRACE_SYSCALL : PTRACE_CONT;
+    }
+
+    if (sig == (SIGTRAP | 0x80)) {
+        if (ptrace(PTRACE_GET_SYSCALL_INFO, tracee->tid, (void *)sizeof(info), &info) > 0) {
+            if (info.op == PTRACE_SYSCALL_INFO_EXIT && tracee->in_syscall) {
+                emit_entry(tracee, 1, info.exit.rval, info.exit.is_error, on_entry, user_data);
+                tracee->in_syscall = 0;
+            } else if (info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+                // Kernels before 4.8 report the seccomp stop ahead of the entry stop
+                return PTRACE_SYSCALL;
+            }
+        }
+        return PTRACE_CONT;
+    }
+
+    if (event == PTRACE_EVENT_STOP) {
+        // Auto-attached threads and children start with a PTRACE_EVENT_STOP
+        if (!first_stop && (sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU)) {
+            return PTRACE_LISTEN; // Group-stop: stay stopped until SIGCONT
+        }
+    } else if (event == 0) {
+        *inject_signal = sig; // Signal-delivery-stop: pass the signal on
+    }
+
+    // Fork, vfork, clone and exec events need no action beyond resuming
+    return tracee->in_syscall ? PTRACE_SYSCALL : PTRACE_CONT;
+}
+
+int rune_tracer_run(const char *executable_path, char *const argv_target[],
+                    const char *trace_spec, rune_strace_entry_cb on_entry, void *user_data) {
+    long *syscalls = NULL;
+    size_t syscall_count = 0;
+    int trace_all = (trace_spec == NULL);
+
+    if (!trace_all) {
+        syscalls = rune_syscalls_parse_set(trace_spec, &syscall_count);
+        if (syscalls == NULL) {
+            return -1;
+        }
+        if (syscall_count > MAX_FILTER_SYSCALLS) {
+            trace_all = 1; // Too many to list, stopping on everything is equivalent
+        }
+    }
+
+    unsigned short filter_len = 0;
+    struct sock_filter *filter = build_filter(syscalls, syscall_count, trace_all, &filter_len);
+    free(syscalls);
+    if (filter == NULL) {
+        return -1;
+    }
+
+    tracee_table_t tracees;
+    if (tracee_table_init(&tracees, INITIAL_TRACEE_CAPACITY) == -1) {
+        free(filter);
+        return -1;
+    }
+
+    // The child waits on this pipe until the parent has seized it
+    int sync_pipe[2];
+    if (pipe(sync_pipe) == -1) {
+        perror("runescope: pipe failed");
+        free(filter);
+        free(tracees.slots);
+        return -1;
+    }
+
+    fflush(stdout); // Don't let the child inherit unflushed output
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        perror("runescope: fork failed");
+        close(sync_pipe[0]);
+        close(sync_pipe[1]);
+        free(filter);
+        free(tracees.slots);
+        return -1;
+    } else if (pid == 0) {
+        // Child process
+        extern char **environ;
+        char go;
+
+        close(sync_pipe[1]);
+        if (read(sync_pipe[0], &go, 1) != 1) {
+            _exit(EXIT_FAILURE); // Parent could not seize us
+        }
+        close(sync_pipe[0]);
+
+        struct sock_fprog prog = { .len = filter_len, .filter = filter };
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == -1 ||
+            prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) == -1) {
+            perror("runescope: installing seccomp filter failed");
+            _exit(EXIT_FAILURE);
+        }
+
+        execve(executable_path, argv_target, environ);
+        perror("runescope: execve failed");
+        _exit(EXIT_FAILURE);
+    }
+
+    // Parent process
+    free(filter);
+    close(sync_pipe[0]);
+
+    long options = PTRACE_O_TRACESECCOMP | PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEFORK |
+                   PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL;
+    if (ptrace(PTRACE_SEIZE, pid, NULL, (void *)options) == -1) {
+        perror("runescope: PTRACE_SEIZE failed");
+        close(sync_pipe[1]); // Child sees EOF and exits
+        waitpid(pid, NULL, 0);
+        free(tracees.slots);
+        return -1;
+    }
+
+    tracee_t *root = tracee_get(&tracees, pid);
+    if (root != NULL) {
+        root->seen = 1; // A seized tracee gets no initial stop
+    }
+    if (write(sync_pipe[1], "g", 1) != 1) {
+        perror("runescope: failed to release traced child");
+    }
+    close(sync_pipe[1]);
+
+    int root_status = -1;
+    for (;;) {
+        int status;
+        pid_t tid = waitpid(-1, &status, __WALL);
+        if (tid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != ECHILD) {
+                // Defensive programming: Handle waitpid failure
+                perror("runescope: waitpid failed");
+            }
+            break; // All tracees are gone
+        }
+
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            tracee_t *tracee = tracee_find(&tracees, tid);
+            if (tracee != NULL && tracee->in_syscall) {
+                emit_entry(tracee, 0, 0, 0, on_entry, user_data);
+            }
+            tracee_remove(&tracees, tid);
+            if (tid == pid) {
+                root_status = status;
+            }
+            continue;
+        }
+        if (!WIFSTOPPED(status)) {
+            continue;
+        }
+
+        tracee_t *tracee = tracee_get(&tracees, tid);
+        if (tracee == NULL) {
+            kill(pid, SIGKILL); // Out of memory, PTRACE_O_EXITKILL cannot help here
+            continue;
+        }
+        int inject_signal;
+        int request = handle_stop(tracee, status, &inject_signal, on_entry, user_data);
+        // ESRCH just means the tracee was killed meanwhile; its exit is reported next
+        ptrace(request, tid, NULL, (void *)(long)inject_signal);
+    }
+    free(tracees.slots);
+
+    if (root_status == -1) {
+        fprintf(stderr, "runescope: Target program terminated abnormally.\n");
+        return -1;
+    } else if (WIFEXITED(root_status)) {
+        return WEXITSTATUS(root_status);
+    } else {
+        fprintf(stderr, "runescope: Target program terminated by signal %d\n", WTERMSIG(root_status));
+        return -1;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef RUNE_TRACER_H
+#define RUNE_TRACER_H
+
+#include "rune_strace_parser.h"
+
+/**
+ * @brief Built-in syscall tracer based on PTRACE_SEIZE and seccomp-BPF.
+ *
+ * Unlike the strace path in rune_exec.c, the tracer installs a seccomp filter
+ * in the target before execve so the kernel only stops the target on the
+ * selected syscalls. Every other syscall runs at full speed. Completed
+ * syscalls are delivered directly as strace_entry_t records, so there is no
+ * text log to write and parse again.
+ */
+
+/**
+ * @brief Runs a target program under the native tracer.
+ *
+ * This function forks a new process, seizes it with ptrace, installs the
+ * seccomp filter in the child and then execs the target. Threads and child
+ * processes of the target are traced as well.
+ *
+ * @param executable_path The absolute path to the target executable.
+ * @param argv_target An array of strings representing the arguments for the target executable,
+ *                    starting with the executable's name itself (argv[0]).
+ * @param trace_spec The syscalls to trace in strace -e trace= syntax (e.g. "file,network"),
+ *                   or NULL to trace every syscall.
+ * @param on_entry Callback invoked for every completed syscall.
+ * @param user_data Opaque pointer passed to on_entry.
+ * @return The exit status of the executed program, or -1 if an error occurred in runescope itself.
+ */
+int rune_tracer_run(const char *executable_path, char *const argv_target[],
+                    const char *trace_spec, rune_strace_entry_cb on_entry, void *user_data);
+
+#endif // RUNE_TRACER_H
@@ -0,0 +1,962 @@
+#define _POSIX_C_SOURCE 200809L // For flockfile
+#include "rune_vm.h"
+#include "rune_latency.h"
+#include "rune_scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ARGS 6
+#define PAGE_SIZE 4096           // Lengths are rounded up to whole pages, as the kernel does
+#define SIZE_CLASSES 65          // Class c holds sizes in (2^(c-1), 2^c]
+#define TIMELINE_SLOTS 20
+#define TIMELINE_BAR 40
+#define THRASH_MIN_CYCLES 20     // Flag a size class mapped and unmapped whole at least this many times
+#define HEAP_STEPS_MIN 100       // Flag heaps grown in at least this many steps...
+#define HEAP_SMALL_STEP (256 * 1024) // ...averaging under this size
+#define REGROW_MIN 20            // Flag heaps grown again after a trim at least this many times
+#define FRAGMENT_MIN_VMAS 64     // Flag anonymous memory in at least this many VMAs...
+#define FRAGMENT_MIN_SHARE 0.25  // ...with at least this share of holes between them
+#define HOLE_MAX (1024 * 1024)   // Larger gaps separate areas of the address space rather than fragment one
+#define SHOOTDOWN_MIN 100        // Flag at least this many unmaps/protection changes in multi-threaded address spaces
+#define MAX_MAP_COUNT 65530      // The default vm.max_map_count
+#define MAX_PATTERNS 10          // Findings listed per pattern
+#define GLIBC_MMAP_THRESHOLD_MAX (32ull << 20) // How far glibc raises its mmap threshold on its own (64-bit)
+
+// Raw flag values, for the native tracer's numeric arguments
+#define PROT_BITS 0x7            // PROT_READ | PROT_WRITE | PROT_EXEC
+#define MAP_SHARED_FLAG 0x01
+#define MAP_ANONYMOUS_FLAG 0x20
+#define CLONE_VM_FLAG 0x100
+
+// What a syscall does to the address space
+typedef enum {
+    VM_NONE,
+    VM_MMAP,
+    VM_MUNMAP,
+    VM_MREMAP,
+    VM_MPROTECT,
+    VM_BRK,
+    VM_EXEC,
+    VM_EXIT,
+    VM_CLONE
+} vm_role_t;
+
+static const struct {
+    const char *name;
+    vm_role_t role;
+} vm_syscalls[] = {
+    { "mmap", VM_MMAP },
+    { "mmap2", VM_MMAP },
+    { "munmap", VM_MUNMAP },
+    { "mremap", VM_MREMAP },
+    { "mprotect", VM_MPROTECT },
+    { "pkey_mprotect", VM_MPROTECT },
+    { "brk", VM_BRK },
+    { "execve", VM_EXEC },
+    { "execveat", VM_EXEC },
+    { "exit_group", VM_EXIT },
+    { "clone", VM_CLONE },
+    { "clone3", VM_CLONE },
+    { "fork", VM_CLONE },
+    { "vfork", VM_CLONE },
+};
+
+// Region kinds
+#define REGION_ANON   0x01 // Not backed by a file
+#define REGION_SHARED 0x02 // MAP_SHARED
+#define REGION_TRACED 0x04 // Mapped during the trace, so its age is known
+
+// A mapped range; ranges split by munmap or mprotect keep the born time of their mapping
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    int64_t born;   // When it was mapped, in ns or as an event index without timestamps
+    uint8_t prot;
+    uint8_t kind;
+} vm_region_t;
+
+// An address space, shared by the threads of a process
+typedef struct {
+    vm_region_t *regions;  // Sorted by start, never overlapping
+    size_t count;
+    size_t capacity;
+    uint64_t mapped;       // Bytes in regions
+    uint64_t heap_start;   // brk heap, both 0 until the first brk
+    uint64_t heap_end;
+    uint64_t peak;         // Most mapped + heap bytes at once
+    long pid;              // The process that used it first
+    char program[32];      // Basename of the program it was exec'd for, "" if not traced
+    unsigned users;        // Pid indexes using it now
+    unsigned threads;      // Most pid indexes that used it at once
+    int exited;
+    unsigned long calls;   // Mapping calls made in it; 0 for copies replaced by an exec right away
+    unsigned long cycles;  // Anonymous regions mapped and unmapped whole
+    unsigned long heap_grows, heap_trims, heap_regrows, heap_failed;
+    uint64_t heap_grown, heap_largest_step;
+    int trimmed;           // The last change of the heap was a trim
+    unsigned long shootdowns; // munmap, mprotect and mremap calls while other threads shared it
+} vm_space_t;
+
+// Anonymous regions of one size class that were mapped and unmapped whole
+typedef struct {
+    unsigned long cycles;
+    uint64_t bytes;
+    int64_t lifetime_sum;
+    long pid;       // The first process that did it
+} vm_class_t;
+
+typedef struct {
+    long pid;
+    uint32_t index;
+} pid_slot_t;
+
+typedef struct {
+    const rune_store_t *store;
+    const long *pids;
+    vm_space_t *spaces;
+    size_t num_spaces;
+    size_t spaces_capacity;
+    uint32_t *space_of;         // Per pid index: index into spaces + 1, 0 = none yet
+    pid_slot_t *pid_slots;      // Sorted by pid, to find a clone child's pid index
+    size_t num_pids;
+    vm_class_t classes[SIZE_CLASSES];
+    unsigned long maps, unmaps, remaps, protects, brks, failed_calls;
+    uint64_t total;             // Mapped + heap bytes of all live address spaces
+    uint64_t peak;
+    int64_t peak_at;
+    uint64_t timeline[TIMELINE_SLOTS]; // Highest total in each slot of the trace
+    uint64_t timeline_end[TIMELINE_SLOTS]; // Total after the last event in each slot
+    int timeline_seen[TIMELINE_SLOTS];
+    unsigned long timeline_maps[TIMELINE_SLOTS];
+    unsigned long timeline_unmaps[TIMELINE_SLOTS];
+    int64_t first, span;
+    int timed;
+    int failed;
+} vm_state_t;
+
+static int size_class(uint64_t size) {
+    return size <= 1 ? 0 : 64 - __builtin_clzll(size - 1);
+}
+
+static uint64_t page_align(uint64_t len) {
+    return (len + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+}
+
+// An address or length argument; strace prints a null address as NULL
+static uint64_t arg_value(const rune_strview_t *args, size_t nargs, size_t index) {
+    long value = 0;
+    if (index < nargs) {
+        rune_scan_number(args[index].ptr, args[index].ptr + args[index].len, &value);
+    }
+    return (uint64_t)value;
+}
+
+static int is_numeric(rune_strview_t arg) {
+    return arg.len > 0 && arg.ptr[0] >= '0' && arg.ptr[0] <= '9';
+}
+
+static int has_flag(rune_strview_t arg, const char *flag) {
+    return rune_scan_find(arg.ptr, arg.ptr + arg.len, flag) != NULL;
+}
+
+// PROT_* bits of a protection argument, symbolic (strace) or numeric (native tracer)
+static uint8_t prot_bits(rune_strview_t arg) {
+    if (is_numeric(arg)) {
+        long value = 0;
+        rune_scan_number(arg.ptr, arg.ptr + arg.len, &value);
+        return (uint8_t)(value & PROT_BITS);
+    }
+    return (uint8_t)((has_flag(arg, "PROT_READ") ? 0x1 : 0) | (has_flag(arg, "PROT_WRITE") ? 0x2 : 0) |
+                     (has_flag(arg, "PROT_EXEC") ? 0x4 : 0));
+}
+
+static uint8_t map_kind(rune_strview_t arg) {
+    if (is_numeric(arg)) {
+        long value = 0;
+        rune_scan_number(arg.ptr, arg.ptr + arg.len, &value);
+        return (uint8_t)(((value & MAP_ANONYMOUS_FLAG) ? REGION_ANON : 0) | ((value & MAP_SHARED_FLAG) ? REGION_SHARED : 0));
+    }
+    return (uint8_t)((has_flag(arg, "MAP_ANON") ? REGION_ANON : 0) | (has_flag(arg, "MAP_SHARED") ? REGION_SHARED : 0));
+}
+
+static uint32_t find_pid_index(const vm_state_t *state, long pid, int *found) {
+    size_t lo = 0, hi = state->num_pids;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (state->pid_slots[mid].pid < pid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = lo < state->num_pids && state->pid_slots[lo].pid == pid;
+    return *found ? state->pid_slots[lo].index : 0;
+}
+
+static int compare_pid_slots(const void *a, const void *b) {
+    const pid_slot_t *sa = a;
+    const pid_slot_t *sb = b;
+    return (sa->pid > sb->pid) - (sa->pid < sb->pid);
+}
+
+// Adds mapped or heap bytes to a space, and to the total while the space is alive
+static void account(vm_state_t *state, vm_space_t *space, int64_t delta) {
+    if (!space->exited) {
+        state->total += (uint64_t)delta;
+    }
+    uint64_t size = space->mapped + (space->heap_end - space->heap_start);
+    if (size > space->peak) {
+        space->peak = size;
+    }
+}
+
+static void note_total(vm_state_t *state, int64_t now, vm_role_t role) {
+    if (state->total > state->peak) {
+        state->peak = state->total;
+        state->peak_at = now;
+    }
+    size_t slot = state->span > 0 ? (size_t)((double)(now - state->first) / (double)state->span * TIMELINE_SLOTS) : 0;
+    if (slot >= TIMELINE_SLOTS) {
+        slot = TIMELINE_SLOTS - 1;
+    }
+    if (state->total > state->timeline[slot]) {
+        state->timeline[slot] = state->total;
+    }
+    state->timeline_end[slot] = state->total;
+    state->timeline_seen[slot] = 1;
+    state->timeline_maps[slot] += role == VM_MMAP;
+    state->timeline_unmaps[slot] += role == VM_MUNMAP;
+}
+
+// A slot starts at the total the previous slots left, even when it has no events of its own
+static void carry_timeline(vm_state_t *state) {
+    uint64_t carried = 0;
+    for (int s = 0; s < TIMELINE_SLOTS; s++) {
+        if (carried > state->timeline[s]) {
+            state->timeline[s] = carried;
+        }
+        if (state->timeline_seen[s]) {
+            carried = state->timeline_end[s];
+        }
+    }
+}
+
+// Adds an empty space, or a copy of space copy_index if it is not negative
+static long new_space(vm_state_t *state, long pid, long copy_index) {
+    if (state->num_spaces == state->spaces_capacity) {
+        size_t capacity = state->spaces_capacity ? state->spaces_capacity * 2 : 16;
+        vm_space_t *spaces = realloc(state->spaces, capacity * sizeof(vm_space_t));
+        if (spaces == NULL) {
+            perror("runescope: realloc failed for address spaces");
+            state->failed = 1;
+            return -1;
+        }
+        state->spaces = spaces;
+        state->spaces_capacity = capacity;
+    }
+    vm_space_t *space = &state->spaces[state->num_spaces];
+    memset(space, 0, sizeof(*space));
+    space->pid = pid;
+    const vm_space_t *copy_of = copy_index >= 0 ? &state->spaces[copy_index] : NULL;
+    if (copy_of != NULL) {
+        if (copy_of->count > 0) {
+            space->regions = malloc(copy_of->count * sizeof(vm_region_t));
+            if (space->regions == NULL) {
+                perror("runescope: malloc failed for address space");
+                state->failed = 1;
+                return -1;
+            }
+            memcpy(space->regions, copy_of->regions, copy_of->count * sizeof(vm_region_t));
+            space->count = space->capacity = copy_of->count;
+        }
+        space->mapped = copy_of->mapped;
+        space->heap_start = copy_of->heap_start;
+        space->heap_end = copy_of->heap_end;
+        memcpy(space->program, copy_of->program, sizeof(space->program));
+        account(state, space, (int64_t)(space->mapped + (space->heap_end - space->heap_start)));
+    }
+    return (long)state->num_spaces++;
+}
+
+static void attach(vm_state_t *state, uint32_t pid_index, long space_index) {
+    vm_space_t *space = &state->spaces[space_index];
+    state->space_of[pid_index] = (uint32_t)space_index + 1;
+    space->users++;
+    if (space->users > space->threads) {
+        space->threads = space->users;
+    }
+}
+
+// Stops a pid index from using its space; a space nobody uses any more leaves the total
+static void detach(vm_state_t *state, uint32_t pid_index) {
+    if (state->space_of[pid_index] == 0) {
+        return;
+    }
+    vm_space_t *space = &state->spaces[state->space_of[pid_index] - 1];
+    state->space_of[pid_index] = 0;
+    if (space->users > 0 && --space->users == 0 && !space->exited) {
+        state->total -= space->mapped + (space->heap_end - space->heap_start);
+        space->exited = 1;
+    }
+}
+
+// Returns the space of a pid index, giving a pid seen for the first time a space of its own
+static vm_space_t *space_for(vm_state_t *state, uint32_t pid_index) {
+    if (state->space_of[pid_index] == 0) {
+        long s = new_space(state, state->pids[pid_index], -1);
+        if (s < 0) {
+            return NULL;
+        }
+        attach(state, pid_index, s);
+    }
+    return &state->spaces[state->space_of[pid_index] - 1];
+}
+
+static int reserve_regions(vm_state_t *state, vm_space_t *space, size_t extra) {
+    if (space->count + extra <= space->capacity) {
+        return 0;
+    }
+    size_t capacity = space->capacity ? space->capacity * 2 : 64;
+    while (capacity < space->count + extra) {
+        capacity *= 2;
+    }
+    vm_region_t *regions = realloc(space->regions, capacity * sizeof(vm_region_t));
+    if (regions == NULL) {
+        perror("runescope: realloc failed for address space");
+        state->failed = 1;
+        return -1;
+    }
+    space->regions = regions;
+    space->capacity = capacity;
+    return 0;
+}
+
+// Index of the first region that ends after addr
+static size_t first_ending_after(const vm_space_t *space, uint64_t addr) {
+    size_t lo = 0, hi = space->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (space->regions[mid].end <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Splits the region that straddles addr, if any, into the parts below and above it
+static int split_at(vm_state_t *state, vm_space_t *space, uint64_t addr) {
+    size_t i = first_ending_after(space, addr);
+    if (i == space->count || space->regions[i].start >= addr) {
+        return 0;
+    }
+    if (reserve_regions(state, space, 1) == -1) {
+        return -1;
+    }
+    vm_region_t *r = &space->regions[i];
+    memmove(r + 1, r, (space->count - i) * sizeof(vm_region_t));
+    r[0].end = addr;
+    r[1].start = addr;
+    space->count++;
+    return 0;
+}
+
+// Removes [start, end) from a space, trimming or splitting the regions it overlaps
+static void unmap_range(vm_state_t *state, vm_space_t *space, uint64_t start, uint64_t end) {
+    if (start >= end || split_at(state, space, start) == -1 || split_at(state, space, end) == -1) {
+        return;
+    }
+    size_t i = first_ending_after(space, start);
+    size_t j = i;
+    uint64_t removed = 0;
+    while (j < space->count && space->regions[j].end <= end) {
+        removed += space->regions[j].end - space->regions[j].start;
+        j++;
+    }
+    memmove(&space->regions[i], &space->regions[j], (space->count - j) * sizeof(vm_region_t));
+    space->count -= j - i;
+    space->mapped -= removed;
+    account(state, space, -(int64_t)removed);
+}
+
+// Maps a region, replacing whatever it overlaps (MAP_FIXED)
+static void map_region(vm_state_t *state, vm_space_t *space, const vm_region_t *region) {
+    unmap_range(state, space, region->start, region->end);
+    if (state->failed || reserve_regions(state, space, 1) == -1) {
+        return;
+    }
+    size_t i = first_ending_after(space, region->start);
+    memmove(&space->regions[i + 1], &space->regions[i], (space->count - i) * sizeof(vm_region_t));
+    space->regions[i] = *region;
+    space->count++;
+    space->mapped += region->end - region->start;
+    account(state, space, (int64_t)(region->end - region->start));
+}
+
+// Whether [start, end) is exactly one anonymous mapping made during the trace, whatever mprotect split it into
+static int is_whole_mapping(const vm_space_t *space, uint64_t start, uint64_t end, int64_t *born) {
+    size_t i = first_ending_after(space, start);
+    if (i == space->count || space->regions[i].start != start || !(space->regions[i].kind & REGION_TRACED) ||
+        !(space->regions[i].kind & REGION_ANON)) {
+        return 0;
+    }
+    *born = space->regions[i].born;
+    if (i > 0 && space->regions[i - 1].end == start && space->regions[i - 1].born == *born) {
+        return 0;
+    }
+    uint64_t at = start;
+    for (; i < space->count && space->regions[i].start == at && space->regions[i].born == *born; i++) {
+        at = space->regions[i].end;
+        if (at == end) {
+            return i + 1 == space->count || space->regions[i + 1].start != end || space->regions[i + 1].born != *born;
+        }
+    }
+    return 0;
+}
+
+// Strips the quotes of a strace string argument and returns what follows its last slash
+static rune_strview_t program_name(rune_strview_t arg) {
+    if (arg.len < 2 || arg.ptr[0] != '"') {
+        return rune_strview_make("", 0); // The native tracer only sees pointers
+    }
+    const char *start = arg.ptr + 1;
+    const char *end = memchr(start, '"', arg.len - 1);
+    if (end == NULL) {
+        end = arg.ptr + arg.len;
+    }
+    for (const char *p = start; p < end; p++) {
+        if (*p == '/') {
+            start = p + 1;
+        }
+    }
+    return rune_strview_make(start, (size_t)(end - start));
+}
+
+static void replay_event(vm_state_t *state, size_t i, vm_role_t role, uint32_t pid_index, int64_t now) {
+    const rune_store_t *store = state->store;
+    vm_space_t *space = space_for(state, pid_index);
+    if (space == NULL) {
+        return;
+    }
+    rune_strview_t text = rune_store_args(store, i);
+    rune_strview_t args[MAX_ARGS];
+    size_t nargs = rune_scan_split_args(text.ptr, text.ptr + text.len, args, MAX_ARGS);
+    int ok = !(store->flags[i] & (RUNE_EVENT_ERROR | RUNE_EVENT_UNFINISHED));
+    uint64_t ret = (uint64_t)store->ret[i];
+    const char *name = rune_store_name(store, store->name_id[i]);
+    int shared = space->users > 1;
+    space->calls += role >= VM_MMAP && role <= VM_BRK;
+
+    switch (role) {
+    case VM_MMAP: {
+        state->maps++;
+        if (!ok || nargs < 4) {
+            state->failed_calls += !ok;
+            break;
+        }
+        vm_region_t region = { ret, ret + page_align(arg_value(args, nargs, 1)), now, prot_bits(args[2]),
+                               (uint8_t)(map_kind(args[3]) | REGION_TRACED) };
+        map_region(state, space, &region);
+        break;
+    }
+    case VM_MUNMAP: {
+        state->unmaps++;
+        uint64_t start = arg_value(args, nargs, 0);
+        uint64_t end = start + page_align(arg_value(args, nargs, 1));
+        if (!ok || nargs < 2) {
+            state->failed_calls += !ok;
+            break;
+        }
+        int64_t born;
+        if (is_whole_mapping(space, start, end, &born)) {
+            vm_class_t *cls = &state->classes[size_class(end - start)];
+            cls->cycles++;
+            cls->bytes += end - start;
+            cls->lifetime_sum += now - born;
+            if (cls->pid == 0) {
+                cls->pid = space->pid;
+            }
+            space->cycles++;
+        }
+        unmap_range(state, space, start, end);
+        space->shootdowns += shared;
+        break;
+    }
+    case VM_MREMAP: {
+        state->remaps++;
+        if (!ok || nargs < 3) {
+            state->failed_calls += !ok;
+            break;
+        }
+        uint64_t old_start = arg_value(args, nargs, 0);
+        uint64_t old_end = old_start + page_align(arg_value(args, nargs, 1));
+        uint64_t new_len = page_align(arg_value(args, nargs, 2));
+        // The pieces mprotect split the mapping into move with it and keep their age and
+        // protection; growth takes after the last piece, as the kernel extends the last VMA
+        uint64_t moved_end = old_start + (old_end > old_start && old_end - old_start < new_len ? old_end - old_start : new_len);
+        size_t first = first_ending_after(space, old_start);
+        size_t n = 0;
+        while (first + n < space->count && space->regions[first + n].start < moved_end) {
+            n++;
+        }
+        vm_region_t *pieces = malloc((n ? n : 1) * sizeof(vm_region_t));
+        if (pieces == NULL) {
+            perror("runescope: malloc failed for mremap");
+            state->failed = 1;
+            break;
+        }
+        if (n == 0) {
+            pieces[0] = (vm_region_t){ old_start, old_start, now, 0x3, REGION_ANON }; // Mapped before the trace
+            n = 1;
+        } else {
+            memcpy(pieces, &space->regions[first], n * sizeof(vm_region_t));
+        }
+        // Cover the new size without gaps, whatever the trace missed of the old mapping
+        pieces[0].start = old_start;
+        for (size_t k = 1; k < n; k++) {
+            pieces[k].start = pieces[k - 1].end;
+        }
+        pieces[n - 1].end = old_start + new_len;
+        if (old_end > old_start) {
+            unmap_range(state, space, old_start, old_end); // An old size of 0 duplicates a shared mapping
+        }
+        for (size_t k = 0; k < n && !state->failed; k++) {
+            pieces[k].start = pieces[k].start - old_start + ret;
+            pieces[k].end = pieces[k].end - old_start + ret;
+            map_region(state, space, &pieces[k]);
+        }
+        free(pieces);
+        space->shootdowns += shared;
+        break;
+    }
+    case VM_MPROTECT: {
+        state->protects++;
+        if (!ok || nargs < 3) {
+            state->failed_calls += !ok;
+            break;
+        }
+        uint64_t start = arg_value(args, nargs, 0);
+        uint64_t end = start + page_align(arg_value(args, nargs, 1));
+        if (split_at(state, space, start) == -1 || split_at(state, space, end) == -1) {
+            break;
+        }
+        uint8_t prot = prot_bits(args[2]);
+        for (size_t r = first_ending_after(space, start); r < space->count && space->regions[r].start < end; r++) {
+            space->regions[r].prot = prot;
+        }
+        space->shootdowns += shared;
+        break;
+    }
+    case VM_BRK: {
+        state->brks++;
+        if (!ok) {
+            break;
+        }
+        uint64_t requested = arg_value(args, nargs, 0);
+        if (space->heap_start == 0) {
+            space->heap_start = space->heap_end = ret; // The first brk, normally brk(NULL) at startup
+        }
+        if (requested != 0 && ret != requested) {
+            space->heap_failed++; // brk returns the old break when it cannot move it
+            break;
+        }
+        if (ret > space->heap_end) {
+            uint64_t step = ret - space->heap_end;
+            space->heap_grows++;
+            space->heap_grown += step;
+            if (step > space->heap_largest_step) {
+                space->heap_largest_step = step;
+            }
+            space->heap_regrows += space->trimmed;
+            space->trimmed = 0;
+        } else if (ret < space->heap_end) {
+            space->heap_trims++;
+            space->trimmed = 1;
+        } else {
+            break;
+        }
+        if (ret < space->heap_start) {
+            space->heap_start = ret;
+        }
+        int64_t delta = (int64_t)(ret - space->heap_end);
+        space->heap_end = ret;
+        account(state, space, delta);
+        break;
+    }
+    case VM_EXEC:
+        if (ok) {
+            size_t path_arg = strcmp(name, "execveat") == 0 ? 1 : 0;
+            // The old image is gone; a vfork parent that shared it keeps it
+            detach(state, pid_index);
+            long s = new_space(state, state->pids[pid_index], -1);
+            if (s < 0) {
+                break;
+            }
+            attach(state, pid_index, s);
+            rune_strview_t program = path_arg < nargs ? program_name(args[path_arg]) : rune_strview_make("", 0);
+            snprintf(state->spaces[s].program, sizeof(state->spaces[s].program), "%.*s", (int)program.len, program.ptr);
+        }
+        break;
+    case VM_EXIT: {
+        // Every thread of the process goes with it
+        uint32_t s = state->space_of[pid_index];
+        if (!space->exited) {
+            state->total -= space->mapped + (space->heap_end - space->heap_start);
+            space->exited = 1;
+        }
+        for (size_t p = 0; p < state->num_pids; p++) {
+            if (state->space_of[p] == s) {
+                state->space_of[p] = 0;
+            }
+        }
+        space->users = 0;
+        break;
+    }
+    case VM_CLONE:
+        if (ok && store->ret[i] > 0) {
+            int found;
+            uint32_t child = find_pid_index(state, store->ret[i], &found);
+            if (!found) {
+                break; // The child never made a call
+            }
+            // strace prints flags symbolically; the native tracer sees clone's raw flags and
+            // only a pointer for clone3, whose main use is creating threads
+            long flags;
+            int shares;
+            if (strcmp(name, "fork") == 0) {
+                shares = 0;
+            } else if (strcmp(name, "vfork") == 0 || rune_scan_find(text.ptr, text.ptr + text.len, "CLONE_VM") != NULL) {
+                shares = 1;
+            } else if (nargs == 0 || args[0].len == 0 || args[0].ptr[0] != '0') {
+                shares = 0;
+            } else if (strcmp(name, "clone3") == 0) {
+                shares = 1;
+            } else {
+                shares = rune_scan_number(args[0].ptr, args[0].ptr + args[0].len, &flags) != NULL &&
+                         (flags & CLONE_VM_FLAG) != 0;
+            }
+            // Calls the child made before the parent's clone returned went to a space of its own
+            long parent = (long)state->space_of[pid_index] - 1;
+            detach(state, child);
+            long s = shares ? parent : new_space(state, store->ret[i], parent);
+            if (s >= 0) {
+                attach(state, child, s);
+            }
+        }
+        break;
+    case VM_NONE:
+        break;
+    }
+}
+
+// The layout of a space at the end of the trace; VMAs count adjacent anonymous regions with the same protection once
+typedef struct {
+    size_t vmas;
+    size_t anon_vmas;
+    uint64_t anon_bytes, file_bytes, shared_bytes, reserved_bytes; // reserved: PROT_NONE
+    uint64_t holes;          // Gaps under HOLE_MAX between consecutive anonymous VMAs
+} vm_layout_t;
+
+static void measure_layout(const vm_space_t *space, vm_layout_t *layout) {
+    memset(layout, 0, sizeof(*layout));
+    const vm_region_t *prev = NULL;
+    uint64_t last_anon_end = 0;
+    for (size_t r = 0; r < space->count; r++) {
+        const vm_region_t *region = &space->regions[r];
+        uint64_t len = region->end - region->start;
+        int private_anon = (region->kind & (REGION_ANON | REGION_SHARED)) == REGION_ANON;
+        int anon = private_anon && region->prot != 0; // PROT_NONE counts as reserved, not anonymous memory
+        if (region->prot == 0) {
+            layout->reserved_bytes += len;
+        } else if (region->kind & REGION_SHARED) {
+            layout->shared_bytes += len;
+        } else if (anon) {
+            layout->anon_bytes += len;
+        } else {
+            layout->file_bytes += len;
+        }
+        int merges = prev != NULL && private_anon && prev->end == region->start &&
+                     ((prev->kind ^ region->kind) & ~REGION_TRACED) == 0 &&
+                     prev->prot == region->prot;
+        if (!merges) {
+            layout->vmas++;
+            if (anon) {
+                layout->anon_vmas++;
+                if (last_anon_end != 0 && region->start - last_anon_end < HOLE_MAX) {
+                    layout->holes += region->start - last_anon_end;
+                }
+            }
+        }
+        if (!anon) {
+            last_anon_end = 0; // Only gaps with anonymous memory on both sides count
+        } else {
+            last_anon_end = region->end;
+        }
+        prev = region;
+    }
+}
+
+static int compare_spaces(const void *a, const void *b) {
+    const vm_space_t *sa = *(const vm_space_t *const *)a;
+    const vm_space_t *sb = *(const vm_space_t *const *)b;
+    if (sa->peak != sb->peak) {
+        return sa->peak < sb->peak ? 1 : -1;
+    }
+    return (sa > sb) - (sa < sb);
+}
+
+static const char *space_label(const vm_space_t *space, char *buf, size_t size) {
+    if (space->program[0] != '\0') {
+        snprintf(buf, size, "pid %ld (%s)", space->pid, space->program);
+    } else {
+        snprintf(buf, size, "pid %ld", space->pid);
+    }
+    return buf;
+}
+
+static const char *format_at(const vm_state_t *state, int64_t at, char *buf, size_t size) {
+    if (state->timed) {
+        snprintf(buf, size, "+%.3fs", (double)(at - state->first) / 1e9);
+    } else {
+        snprintf(buf, size, "call %lld", (long long)(at - state->first));
+    }
+    return buf;
+}
+
+// order has room for one pointer per space
+static void print_report(const vm_state_t *state, FILE *out, size_t top_n, const vm_space_t **order) {
+    char a[16], b[16], c[16], d[16], e[16], f[16], label[64];
+    size_t num_spaces = 0;
+    vm_layout_t total_layout = {0};
+    uint64_t heap = 0, at_end = 0;
+    for (size_t s = 0; s < state->num_spaces; s++) {
+        if (state->spaces[s].calls > 0) {
+            order[num_spaces++] = &state->spaces[s];
+            vm_layout_t layout;
+            measure_layout(&state->spaces[s], &layout);
+            at_end += state->spaces[s].mapped + (state->spaces[s].heap_end - state->spaces[s].heap_start);
+            total_layout.anon_bytes += layout.anon_bytes;
+            total_layout.file_bytes += layout.file_bytes;
+            total_layout.shared_bytes += layout.shared_bytes;
+            total_layout.reserved_bytes += layout.reserved_bytes;
+            heap += state->spaces[s].heap_end - state->spaces[s].heap_start;
+        }
+    }
+    qsort(order, num_spaces, sizeof(order[0]), compare_spaces);
+
+    fprintf(out, "\n--- Address space: %zu address spaces, %lu mmap, %lu munmap, %lu mremap, %lu mprotect, %lu brk, %lu failed ---\n",
+            num_spaces, state->maps, state->unmaps, state->remaps, state->protects, state->brks, state->failed_calls);
+    if (state->maps + state->unmaps + state->remaps + state->protects + state->brks == 0) {
+        fprintf(out, "No memory-mapping calls in this trace (trace with -s or -n)\n");
+        return;
+    }
+    fprintf(out, "Peak mapped: %s at %s\n", rune_latency_format_bytes(state->peak, a, sizeof(a)),
+            format_at(state, state->peak_at, label, sizeof(label)));
+    fprintf(out, "Mapped at exit or the end of the trace: %s: anonymous %s, file %s, shared %s, reserved (PROT_NONE) %s, heap %s\n",
+            rune_latency_format_bytes(at_end, a, sizeof(a)), rune_latency_format_bytes(total_layout.anon_bytes, b, sizeof(b)),
+            rune_latency_format_bytes(total_layout.file_bytes, c, sizeof(c)), rune_latency_format_bytes(total_layout.shared_bytes, d, sizeof(d)),
+            rune_latency_format_bytes(total_layout.reserved_bytes, e, sizeof(e)), rune_latency_format_bytes(heap, f, sizeof(f)));
+
+    const char *unit = state->timed ? "s" : " calls";
+    double span = state->timed ? (double)state->span / 1e9 : (double)state->span;
+    fprintf(out, "\nMapped bytes over the trace (peak in each 1/%d), with the mmap and munmap calls in it:\n",
+            TIMELINE_SLOTS);
+    for (int s = 0; s < TIMELINE_SLOTS; s++) {
+        double at = (double)s * span / TIMELINE_SLOTS;
+        int bar = state->peak ? (int)((double)state->timeline[s] / (double)state->peak * TIMELINE_BAR + 0.5) : 0;
+        fprintf(out, "  %10.3f%-6s %9s %8lu %8lu  %.*s\n", at, unit, rune_latency_format_bytes(state->timeline[s], a, sizeof(a)),
+                state->timeline_maps[s], state->timeline_unmaps[s], bar, "########################################");
+    }
+
+    fprintf(out, "\n%9s %9s %9s %7s %9s %7s %7s %7s %9s %6s  %s\n", "peak", "end", "heap", "grows", "avg step",
+            "trims", "cycles", "VMAs", "anon", "holes", "process");
+    size_t shown = top_n == 0 || top_n > num_spaces ? num_spaces : top_n;
+    for (size_t k = 0; k < shown; k++) {
+        const vm_space_t *space = order[k];
+        vm_layout_t layout;
+        measure_layout(space, &layout);
+        uint64_t anon_span = layout.anon_bytes + layout.holes;
+        fprintf(out, "%9s %9s %9s %7lu %9s %7lu %7lu %7zu %9s %5.0f%%  %s%s\n", rune_latency_format_bytes(space->peak, a, sizeof(a)),
+                rune_latency_format_bytes(space->mapped + (space->heap_end - space->heap_start), b, sizeof(b)),
+                rune_latency_format_bytes(space->heap_end - space->heap_start, c, sizeof(c)), space->heap_grows,
+                rune_latency_format_bytes(space->heap_grows ? space->heap_grown / space->heap_grows : 0, d, sizeof(d)),
+                space->heap_trims, space->cycles, layout.vmas, rune_latency_format_bytes(layout.anon_bytes, e, sizeof(e)),
+                anon_span ? 100.0 * (double)layout.holes / (double)anon_span : 0.0,
+                space_label(space, label, sizeof(label)), space->exited ? "" : " (running at the end)");
+    }
+    if (shown < num_spaces) {
+        fprintf(out, "%9s %9s  (%zu more)\n", "...", "", num_spaces - shown);
+    }
+
+    fprintf(out, "\n--- Address space patterns ---\n");
+    size_t findings = 0, listed = 0;
+    for (int k = SIZE_CLASSES - 1; k >= 0 && listed < MAX_PATTERNS; k--) {
+        const vm_class_t *cls = &state->classes[k];
+        if (cls->cycles < THRASH_MIN_CYCLES) {
+            continue;
+        }
+        char lifetime[32];
+        int64_t average = cls->lifetime_sum / (int64_t)cls->cycles;
+        if (state->timed) {
+            rune_latency_format(average, lifetime, sizeof(lifetime));
+        } else {
+            snprintf(lifetime, sizeof(lifetime), "%lld calls", (long long)average);
+        }
+        fprintf(out, "mmap/munmap thrash: %lu anonymous regions of %s-%s mapped and unmapped whole (%s in all, up to %.0f page faults to touch it all again), average lifetime %s, first by pid %ld\n",
+                cls->cycles, rune_latency_format_bytes(((uint64_t)1 << (k - 1)) + 1, a, sizeof(a)),
+                rune_latency_format_bytes((uint64_t)1 << (k < 64 ? k : 63), b, sizeof(b)), rune_latency_format_bytes(cls->bytes, c, sizeof(c)),
+                (double)cls->bytes / PAGE_SIZE, lifetime, cls->pid);
+        listed++;
+    }
+    if (listed > 0) {
+        fprintf(out, "  glibc malloc serves blocks above M_MMAP_THRESHOLD with mmap and frees them with munmap. It raises the threshold\n"
+                     "  to the size of a freed block, up to %s, unless M_MMAP_THRESHOLD was set. Below that, set it above these sizes\n"
+                     "  (mallopt or MALLOC_MMAP_THRESHOLD_); larger blocks are always mapped, so keep those buffers for reuse.\n",
+                rune_latency_format_bytes(GLIBC_MMAP_THRESHOLD_MAX, a, sizeof(a)));
+    }
+    findings += listed;
+    listed = 0;
+    for (size_t k = 0; k < num_spaces && listed < MAX_PATTERNS; k++) {
+        const vm_space_t *space = order[k];
+        if (space->heap_regrows >= REGROW_MIN) {
+            fprintf(out, "Heap trim/regrow: %s shrank its heap %lu times and grew it again %lu times; raise M_TRIM_THRESHOLD (MALLOC_TRIM_THRESHOLD_)\n",
+                    space_label(space, label, sizeof(label)), space->heap_trims, space->heap_regrows);
+            listed++;
+        } else if (space->heap_grows >= HEAP_STEPS_MIN && space->heap_grown / space->heap_grows < HEAP_SMALL_STEP) {
+            fprintf(out, "Heap growth: %s grew its heap to %s in %lu steps of %s on average; a larger M_TOP_PAD (MALLOC_TOP_PAD_) takes fewer steps\n",
+                    space_label(space, label, sizeof(label)), rune_latency_format_bytes(space->heap_grown, a, sizeof(a)),
+                    space->heap_grows, rune_latency_format_bytes(space->heap_grown / space->heap_grows, b, sizeof(b)));
+            listed++;
+        }
+        if (space->heap_failed > 0 && listed < MAX_PATTERNS) {
+            fprintf(out, "Heap exhausted: brk could not grow the heap of %s %lu times; malloc falls back to mmap\n",
+                    space_label(space, label, sizeof(label)), space->heap_failed);
+            listed++;
+        }
+    }
+    findings += listed;
+    listed = 0;
+    for (size_t k = 0; k < num_spaces && listed < MAX_PATTERNS; k++) {
+        const vm_space_t *space = order[k];
+        vm_layout_t layout;
+        measure_layout(space, &layout);
+        uint64_t anon_span = layout.anon_bytes + layout.holes;
+        if (layout.anon_vmas >= FRAGMENT_MIN_VMAS && (double)layout.holes >= FRAGMENT_MIN_SHARE * (double)anon_span) {
+            fprintf(out, "Fragmentation: %s ended with %s of anonymous memory in %zu VMAs (%s on average) and %s of holes between them\n",
+                    space_label(space, label, sizeof(label)), rune_latency_format_bytes(layout.anon_bytes, a, sizeof(a)),
+                    layout.anon_vmas, rune_latency_format_bytes(layout.anon_bytes / layout.anon_vmas, b, sizeof(b)),
+                    rune_latency_format_bytes(layout.holes, c, sizeof(c)));
+            listed++;
+        }
+        if (layout.vmas * 2 >= MAX_MAP_COUNT && listed < MAX_PATTERNS) {
+            fprintf(out, "Map count: %s ended with %zu VMAs; mmap fails with ENOMEM at vm.max_map_count (%d by default)\n",
+                    space_label(space, label, sizeof(label)), layout.vmas, MAX_MAP_COUNT);
+            listed++;
+        }
+    }
+    findings += listed;
+    listed = 0;
+    for (size_t k = 0; k < num_spaces && listed < MAX_PATTERNS; k++) {
+        const vm_space_t *space = order[k];
+        if (space->shootdowns >= SHOOTDOWN_MIN) {
+            fprintf(out, "TLB shootdowns: %s made %lu munmap/mprotect/mremap calls while up to %u threads shared its address space; each one interrupts the CPUs running the others\n",
+                    space_label(space, label, sizeof(label)), space->shootdowns, space->threads);
+            listed++;
+        }
+    }
+    findings += listed;
+    if (findings == 0) {
+        fprintf(out, "No mmap/munmap thrash, heap trim/regrow, fragmented anonymous memory or TLB shootdown storms found\n");
+    }
+}
+
+int rune_vm_report(const rune_store_t *store, FILE *out, size_t top_n) {
+    vm_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.store = store;
+    long *pids;
+    uint32_t *pid_index = rune_store_pid_index(store, &pids, &state.num_pids);
+    if (pid_index == NULL) {
+        return -1;
+    }
+    state.pids = pids;
+    vm_role_t *roles = calloc(store->names.count + 1, sizeof(vm_role_t));
+    state.space_of = calloc(state.num_pids + 1, sizeof(uint32_t));
+    state.pid_slots = malloc((state.num_pids + 1) * sizeof(pid_slot_t));
+    int result = -1;
+    if (roles == NULL || state.space_of == NULL || state.pid_slots == NULL) {
+        perror("runescope: allocation failed for address space analysis");
+        goto out;
+    }
+
+    for (uint32_t id = 0; id < store->names.count; id++) {
+        const char *name = rune_store_name(store, id);
+        for (size_t k = 0; k < sizeof(vm_syscalls) / sizeof(vm_syscalls[0]); k++) {
+            if (strcmp(name, vm_syscalls[k].name) == 0) {
+                roles[id] = vm_syscalls[k].role;
+                break;
+            }
+        }
+    }
+    for (size_t p = 0; p < state.num_pids; p++) {
+        state.pid_slots[p].pid = pids[p];
+        state.pid_slots[p].index = (uint32_t)p;
+    }
+    qsort(state.pid_slots, state.num_pids, sizeof(pid_slot_t), compare_pid_slots);
+
+    // The time axis: timestamps if every replayed call has one, event indexes otherwise
+    int64_t first = 0, last = 0;
+    int seen = 0;
+    state.timed = 1;
+    for (size_t i = 0; i < store->count; i++) {
+        if (roles[store->name_id[i]] != VM_NONE) {
+            int64_t ts = store->timestamp_ns[i];
+            state.timed &= ts != 0;
+            first = seen && first < ts ? first : ts;
+            last = seen && last > ts ? last : ts;
+            seen = 1;
+        }
+    }
+    if (!state.timed) {
+        first = 0;
+        last = store->count > 0 ? (int64_t)store->count - 1 : 0;
+    }
+    state.first = first;
+    state.span = last - first;
+
+    for (size_t i = 0; i < store->count && !state.failed; i++) {
+        vm_role_t role = roles[store->name_id[i]];
+        if (role == VM_NONE || (role != VM_EXIT && (store->flags[i] & RUNE_EVENT_UNFINISHED))) {
+            continue;
+        }
+        int64_t now = state.timed ? store->timestamp_ns[i] : (int64_t)i;
+        replay_event(&state, i, role, pid_index[i], now);
+        note_total(&state, now, role);
+    }
+    carry_timeline(&state);
+    if (!state.failed) {
+        const vm_space_t **order = malloc((state.num_spaces + 1) * sizeof(vm_space_t *));
+        if (order == NULL) {
+            perror("runescope: malloc failed for address space report");
+        } else {
+            flockfile(out);
+            print_report(&state, out, top_n, order);
+            funlockfile(out);
+            free(order);
+            result = 0;
+        }
+    }
+
+out:
+    for (size_t s = 0; s < state.num_spaces; s++) {
+        free(state.spaces[s].regions);
+    }
+    free(state.spaces);
+    free(state.space_of);
+    free(state.pid_slots);
+    free(roles);
+    free(pid_index);
+    free(pids);
+    return result;
+}
@@ -0,0 +1,37 @@
+#ifndef RUNE_VM_H
+#define RUNE_VM_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "rune_store.h"
+
+/**
+ * @brief Address-space churn analysis.
+ *
+ * Replays brk, mmap, munmap, mremap and mprotect against a model of every
+ * process's address space: a sorted list of the regions it mapped, split
+ * and trimmed the way the kernel splits them, plus the brk heap. Threads
+ * created with CLONE_VM share one address space, forked children get a
+ * copy and a successful execve starts an empty one.
+ */
+
+/**
+ * @brief Prints how mapped memory evolves and the mapping patterns that cost page faults and TLB flushes.
+ *
+ * The report shows mapped bytes over the trace, per process peak and final
+ * mapped bytes with heap growth steps and the number of VMAs left, and
+ * flags anonymous regions that are mapped and unmapped whole over and over
+ * (glibc's mmap threshold), heaps trimmed and grown again, anonymous memory
+ * scattered over many small regions with holes between them, and frequent
+ * unmaps or protection changes in address spaces shared by several threads.
+ * Times come from strace -ttt when the trace has them; otherwise the trace
+ * is measured in syscalls.
+ *
+ * @param store The syscall events.
+ * @param out The stream to print to.
+ * @param top_n The number of processes to list.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int rune_vm_report(const rune_store_t *store, FILE *out, size_t top_n);
+
+#endif // RUNE_VM_H
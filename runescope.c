@@ -6,19 +6,214 @@
 #include "rune_ltrace_parser.h" // Include the ltrace parser header
 #include "rune_analyzer.h" // Include the analyzer header
 #include "rune_path_finder.h" // Include the path finder header
+#include "rune_tracer.h" // Include the native tracer header
+#include "rune_stream.h" // Include the live stream analysis header
+#include "rune_bench.h" // Include the benchmark header
+#include "rune_sweep.h" // Include the argument sweep header
+#include "rune_grind.h" // Include the cachegrind/callgrind profile header
+#include "rune_elf.h" // Include the ELF startup-cost header
+#include "rune_startup.h" // Include the startup timeline header
+#include "rune_chrome.h" // Include the Chrome trace export header
+#include "rune_profile.h" // Include the sampling profiler header
+#include "rune_baseline.h" // Include the baseline comparison header
+#include "rune_sampler.h" // Include the /proc process sampler header
+#include "rune_preload.h" // Include the LD_PRELOAD call collector header
+#include "rune_pipe.h" // Include the stdin/stdout throughput harness header
+#include "rune_latency.h" // For rune_latency_format
+
+#define TOP_GRIND_ENTRIES 20
+#define DEFAULT_STARTUP_RUNS 10
+#define DEFAULT_PROFILE_HZ 99 // Off the common 100 Hz timer ticks, so samples do not alias with them
+#define MAX_PROFILE_HZ 10000
+#define DEFAULT_BASELINE_RUNS 5
+#define DEFAULT_THRESHOLD_PERCENT 10.0
+#define MAX_THRESHOLDS 32
+#define REGRESSION_EXIT_STATUS 3 // Distinct from 1, which means runescope itself failed
+#define DEFAULT_SAMPLE_MS 100
+#define MAX_SAMPLE_MS 60000
+#define DEFAULT_PIPE_SIZE (64 * 1024 * 1024)
+#define DEFAULT_PIPE_SWEEP "1M,4M,16M,64M,256M"
+#define MAX_PIPE_SIZES 16
 
 typedef struct {
     int verbose_mode;
-    int static_mode; // This will now imply strace for now, but can be separated later
+    int static_mode; // Run strace; set by -s and by the modes that need syscall durations
+    int elf_mode; // Analyze the executable's ELF startup costs before running it
+    int elf_only; // Only the ELF analysis, the target is not executed
+    int startup_runs; // Measure the time to main over this many runs (0 = off)
+    char *chrome_path; // Also export the timed events as Chrome Trace Event JSON
+    int profile_hz; // Sample the target's stacks this many times a second (0 = off)
+    char *profile_output; // Collapsed stacks file of the profiler
+    int sample_ms; // Sample the memory, I/O and scheduling of the target's processes this often (0 = off)
+    char *save_baseline_path; // Save the run's aggregated metrics to this baseline file
+    char *compare_path; // Compare the run's aggregated metrics with this baseline file
+    int baseline_runs; // Untraced runs for the wall time and resource usage of a baseline
+    double threshold_percent; // Tolerance of --compare for metrics without one of their own
+    rune_baseline_threshold_t thresholds[MAX_THRESHOLDS]; // Per-prefix tolerances of --compare
+    size_t num_thresholds;
     int ltrace_mode;
+    int preload_mode; // Count library calls with librunescope_preload.so instead of ltrace
     int valgrind_mode;
+    const char *grind_tool; // "cachegrind" or "callgrind" instead of memcheck, NULL = memcheck
+    char *analyze_grind_path; // Existing cachegrind/callgrind profile to report on
+    int native_mode; // Trace syscalls with the built-in ptrace/seccomp tracer instead of strace
+    char *trace_spec; // Syscalls for the native tracer, NULL traces everything
+    int stream_mode; // Analyze strace/ltrace output through a FIFO while the target runs
+    int save_log; // In stream mode, also write the raw tool output to its log file
+    int interval_seconds; // In stream mode, seconds between live summaries (0 = off)
+    int num_jobs; // Threads for parsing logs, 0 = one per CPU
+    int tool_jobs; // strace/ltrace/valgrind runs at the same time, 0 = one per CPU
+    char *analyze_strace_path; // Existing strace log to analyze instead of running a target
+    char *analyze_ltrace_path; // Existing ltrace log to analyze instead of running a target
+    char *analyze_rtrace_path; // Existing .rtrace file to analyze instead of running a target
+    int save_binary; // Also save analyzed logs in the .rtrace binary format
+    int convert_only; // Save analyzed logs as .rtrace without printing a report
+    double from_seconds; // Time window for .rtrace files, in strace -ttt seconds (0 = unbounded)
+    double to_seconds;
+    long window_pid; // Only this pid from .rtrace files (0 = all)
+    int latency_mode; // Record syscall durations and report latency histograms
+    int futex_mode; // Report futex lock contention (also records durations)
+    int io_mode; // Report per-descriptor I/O and I/O anti-patterns
+    int mmap_mode; // Report address-space churn from brk/mmap/munmap/mremap/mprotect
+    int alloc_mode; // Report the heap allocation profile from ltrace
+    int counters_mode; // Count hardware/software performance events of the target
+    int bench_runs; // Benchmark the untraced target over this many runs (0 = off)
+    int warmup_runs; // Unmeasured runs before the benchmark
+    int pin_cpu; // CPU to pin benchmark runs to, -1 = no pinning
+    int show_output; // Let the target's stdout through during benchmark runs
+    char *sweep_path; // Run the target once per argument set in this spec file
+    int sweep_jobs; // Sweep configurations running at the same time, 0 = one per CPU
+    double timeout_seconds; // Kill a sweep configuration after this long (0 = no limit)
+    int sweep_pin; // Give every running sweep configuration its own CPU
+    int pipe_mode; // Feed the target's stdin and drain its stdout through pipes and measure its throughput
+    char *pipe_size; // Bytes to feed, NULL = DEFAULT_PIPE_SIZE, or the input file once
+    char *pipe_sweep; // Comma-separated sizes to run one after another instead
+    char *pipe_input; // File to feed instead of generated text lines
+    double pipe_rate; // Feed at most this many MB a second (0 = as fast as the target reads)
     char *target_executable;
     char **target_args;
     int target_argc;
 } runescope_config_t;
 
+// Places the binary copy next to the log: runescope_strace.log -> runescope_strace.rtrace
+static void rtrace_path_for(const char *log_path, char *buf, size_t size) {
+    const char *dot = strrchr(log_path, '.');
+    const char *slash = strrchr(log_path, '/');
+    size_t stem_len = (dot != NULL && (slash == NULL || dot > slash)) ? (size_t)(dot - log_path) : strlen(log_path);
+    snprintf(buf, size, "%.*s.rtrace", (int)stem_len, log_path);
+}
+
+// Runs one text log analysis, saving a binary copy if requested
+static int analyze_log(const char *log_path, int is_strace, const runescope_config_t *config,
+                       const rune_analyzer_options_t *options) {
+    rune_analyzer_options_t log_options = *options;
+    char binary_path[4096];
+    if (config->save_binary) {
+        rtrace_path_for(log_path, binary_path, sizeof(binary_path));
+        log_options.binary_path = binary_path;
+    }
+    return is_strace ? rune_analyzer_analyze_strace(log_path, &log_options)
+                     : rune_analyzer_analyze_ltrace(log_path, &log_options);
+}
+
+// Adds the untraced runs to the profile, then saves it and compares it with the baseline.
+// Returns runescope's exit status: 0, 1 on failure or REGRESSION_EXIT_STATUS.
+static int finish_baseline(const runescope_config_t *config, rune_baseline_t *baseline, const char *executable_path) {
+    int status = 0;
+    if (executable_path != NULL && config->baseline_runs > 0) {
+        printf("\nMeasuring %d untraced runs for the baseline...\n", config->baseline_runs);
+        if (rune_baseline_measure(baseline, executable_path, config->target_args, config->baseline_runs) == -1) {
+            status = 1;
+        }
+    }
+    if (status == 0 && config->save_baseline_path) {
+        if (rune_baseline_save(baseline, config->save_baseline_path) == 0) {
+            printf("Baseline written to: %s (%zu metrics)\n", config->save_baseline_path, baseline->names.count);
+        } else {
+            status = 1;
+        }
+    }
+    rune_baseline_t saved;
+    if (status == 0 && config->compare_path && rune_baseline_init(&saved) == 0) {
+        rune_baseline_thresholds_t thresholds = { config->threshold_percent, config->thresholds, config->num_thresholds };
+        int regressions = rune_baseline_load(&saved, config->compare_path) == 0
+                              ? rune_baseline_compare(&saved, baseline, &thresholds, stdout)
+                              : -1;
+        status = regressions < 0 ? 1 : (regressions > 0 ? REGRESSION_EXIT_STATUS : 0);
+        rune_baseline_free(&saved);
+    } else if (status == 0 && config->compare_path) {
+        status = 1;
+    }
+    rune_baseline_free(baseline);
+    return status;
+}
+
+// Closes a trace export and says what went into it
+static int finish_chrome(rune_chrome_writer_t *writer, const char *chrome_path) {
+    size_t events = writer->events;
+    size_t untimed = writer->untimed;
+    if (rune_chrome_close(writer) == -1) {
+        return -1;
+    }
+    printf("Chrome trace written to: %s (%zu events)\n", chrome_path, events);
+    if (untimed > 0) {
+        printf("Warning: %zu calls without timestamps were left out of the trace (they need -ttt).\n", untimed);
+    }
+    return 0;
+}
+
+// Writes the events of text logs as Chrome Trace Event JSON, one event at a time
+static int export_chrome(const char *chrome_path, const char *strace_log_path, const char *ltrace_log_path) {
+    rune_chrome_writer_t writer;
+    if (rune_chrome_open(&writer, chrome_path) == -1) {
+        return -1;
+    }
+    int result = 0;
+    if (strace_log_path && rune_strace_parser_parse_file(strace_log_path, rune_chrome_add_strace_entry, &writer) == -1) {
+        result = -1;
+    }
+    if (ltrace_log_path && rune_ltrace_parser_parse_file(ltrace_log_path, rune_chrome_add_ltrace_entry, &writer) == -1) {
+        result = -1;
+    }
+    return finish_chrome(&writer, chrome_path) == -1 ? -1 : result;
+}
+
+// Hands native tracer entries to their consumer and to the trace export
+typedef struct {
+    rune_strace_entry_cb on_entry;
+    void *user_data;
+    rune_chrome_writer_t *chrome;
+} native_sink_t;
+
+static void native_sink_entry(const strace_entry_t *entry, void *user_data) {
+    native_sink_t *sink = user_data;
+    sink->on_entry(entry, sink->user_data);
+    rune_chrome_add_strace_entry(entry, sink->chrome);
+}
+
+// Every tool ran the target on its own; show how each run went
+static void print_jobs(const rune_exec_jobs_t *jobs) {
+    char wall[32];
+    int differ = 0;
+    printf("\n--- Analysis jobs ---\n");
+    for (size_t j = 0; j < jobs->count; j++) {
+        const rune_exec_job_t *job = &jobs->jobs[j];
+        printf("  %-10s exit status %3d  %12s%s\n", job->tool != NULL ? job->tool : "target", job->exit_status,
+               rune_latency_format(job->wall_ns, wall, sizeof(wall)), job->counted ? "  (counted)" : "");
+        differ |= job->exit_status != jobs->jobs[0].exit_status;
+    }
+    if (differ) {
+        printf("Warning: The target exited differently under different tools; their reports may not be comparable.\n");
+    }
+}
+
 int main(int argc, char *argv[]) {
     runescope_config_t config = {0}; // Initialize all members to 0/NULL
+    config.interval_seconds = 5;
+    config.warmup_runs = 1;
+    config.pin_cpu = -1;
+    config.baseline_runs = DEFAULT_BASELINE_RUNS;
+    config.threshold_percent = DEFAULT_THRESHOLD_PERCENT;
 
     int i;
     for (i = 1; i < argc; i++) {
@@ -26,10 +221,136 @@ int main(int argc, char *argv[]) {
             config.verbose_mode = 1;
         } else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--static") == 0) {
             config.static_mode = 1;
+            config.elf_mode = 1;
+        } else if (strcmp(argv[i], "--elf") == 0) {
+            config.elf_mode = 1;
+            config.elf_only = 1;
+        } else if (strcmp(argv[i], "--startup") == 0) {
+            config.startup_runs = DEFAULT_STARTUP_RUNS;
+        } else if (strncmp(argv[i], "--startup=", 10) == 0) {
+            config.startup_runs = atoi(argv[i] + 10);
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            config.profile_hz = DEFAULT_PROFILE_HZ;
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            config.profile_hz = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--profile-output=", 17) == 0) {
+            config.profile_output = argv[i] + 17;
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            config.sample_ms = DEFAULT_SAMPLE_MS;
+        } else if (strncmp(argv[i], "--sample=", 9) == 0) {
+            config.sample_ms = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--save-baseline=", 16) == 0) {
+            config.save_baseline_path = argv[i] + 16;
+        } else if (strncmp(argv[i], "--compare=", 10) == 0) {
+            config.compare_path = argv[i] + 10;
+        } else if (strncmp(argv[i], "--baseline-runs=", 16) == 0) {
+            config.baseline_runs = atoi(argv[i] + 16);
+        } else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+            // Either PERCENT for every metric or PREFIX=PERCENT for the metrics starting with PREFIX
+            char *equals = strrchr(argv[i] + 12, '=');
+            if (equals == NULL) {
+                config.threshold_percent = atof(argv[i] + 12);
+            } else if (config.num_thresholds < MAX_THRESHOLDS) {
+                *equals = '\0';
+                config.thresholds[config.num_thresholds].prefix = argv[i] + 12;
+                config.thresholds[config.num_thresholds++].percent = atof(equals + 1);
+            }
+        } else if (strncmp(argv[i], "--chrome=", 9) == 0) {
+            config.chrome_path = argv[i] + 9;
         } else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--ltrace") == 0) {
             config.ltrace_mode = 1;
+        } else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--preload") == 0) {
+            config.preload_mode = 1;
         } else if (strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--memcheck") == 0) {
             config.valgrind_mode = 1;
+        } else if (strcmp(argv[i], "--cachegrind") == 0 || strcmp(argv[i], "--callgrind") == 0) {
+            config.valgrind_mode = 1;
+            config.grind_tool = argv[i] + 2;
+        } else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--native") == 0) {
+            config.native_mode = 1;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            config.stream_mode = 1;
+        } else if (strcmp(argv[i], "--save-log") == 0) {
+            config.save_log = 1;
+        } else if (strncmp(argv[i], "--interval=", 11) == 0) {
+            config.interval_seconds = atoi(argv[i] + 11);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            config.num_jobs = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            config.num_jobs = atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--tool-jobs=", 12) == 0) {
+            config.tool_jobs = atoi(argv[i] + 12);
+        } else if (strncmp(argv[i], "--analyze-strace=", 17) == 0) {
+            config.analyze_strace_path = argv[i] + 17;
+        } else if (strncmp(argv[i], "--analyze-ltrace=", 17) == 0) {
+            config.analyze_ltrace_path = argv[i] + 17;
+        } else if (strncmp(argv[i], "--analyze-cachegrind=", 21) == 0) {
+            config.analyze_grind_path = argv[i] + 21;
+        } else if (strncmp(argv[i], "--analyze-callgrind=", 20) == 0) {
+            config.analyze_grind_path = argv[i] + 20;
+        } else if (strncmp(argv[i], "--analyze-rtrace=", 17) == 0) {
+            config.analyze_rtrace_path = argv[i] + 17;
+        } else if (strcmp(argv[i], "--save-binary") == 0) {
+            config.save_binary = 1;
+        } else if (strcmp(argv[i], "--convert") == 0) {
+            config.save_binary = 1;
+            config.convert_only = 1;
+        } else if (strncmp(argv[i], "--from=", 7) == 0) {
+            config.from_seconds = atof(argv[i] + 7);
+        } else if (strncmp(argv[i], "--to=", 5) == 0) {
+            config.to_seconds = atof(argv[i] + 5);
+        } else if (strncmp(argv[i], "--pid=", 6) == 0) {
+            config.window_pid = atol(argv[i] + 6);
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            config.latency_mode = 1;
+        } else if (strcmp(argv[i], "--futex") == 0) {
+            config.futex_mode = 1;
+        } else if (strcmp(argv[i], "--io") == 0) {
+            config.io_mode = 1;
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            config.mmap_mode = 1;
+        } else if (strcmp(argv[i], "--alloc") == 0) {
+            config.alloc_mode = 1;
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            config.counters_mode = 1;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            config.bench_runs = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "--bench=", 8) == 0) {
+            config.bench_runs = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--warmup=", 9) == 0) {
+            config.warmup_runs = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--pin=", 6) == 0) {
+            config.pin_cpu = atoi(argv[i] + 6);
+        } else if (strcmp(argv[i], "--show-output") == 0) {
+            config.show_output = 1;
+        } else if (strncmp(argv[i], "--sweep=", 8) == 0) {
+            config.sweep_path = argv[i] + 8;
+        } else if (strncmp(argv[i], "--sweep-jobs=", 13) == 0) {
+            config.sweep_jobs = atoi(argv[i] + 13);
+        } else if (strncmp(argv[i], "--timeout=", 10) == 0) {
+            config.timeout_seconds = atof(argv[i] + 10);
+        } else if (strcmp(argv[i], "--sweep-pin") == 0) {
+            config.sweep_pin = 1;
+        } else if (strcmp(argv[i], "--pipe") == 0) {
+            config.pipe_mode = 1;
+        } else if (strncmp(argv[i], "--pipe=", 7) == 0) {
+            config.pipe_mode = 1;
+            config.pipe_size = argv[i] + 7;
+        } else if (strcmp(argv[i], "--pipe-sweep") == 0) {
+            config.pipe_mode = 1;
+            config.pipe_sweep = DEFAULT_PIPE_SWEEP;
+        } else if (strncmp(argv[i], "--pipe-sweep=", 13) == 0) {
+            config.pipe_mode = 1;
+            config.pipe_sweep = argv[i] + 13;
+        } else if (strncmp(argv[i], "--pipe-input=", 13) == 0) {
+            config.pipe_mode = 1;
+            config.pipe_input = argv[i] + 13;
+        } else if (strncmp(argv[i], "--pipe-rate=", 12) == 0) {
+            config.pipe_mode = 1;
+            config.pipe_rate = atof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            config.native_mode = 1;
+            config.trace_spec = argv[i] + 8;
         } else {
             // Found the target executable
             config.target_executable = argv[i];
@@ -42,14 +363,368 @@ int main(int argc, char *argv[]) {
     if (config.verbose_mode) {
         printf("Verbose mode enabled.\n");
     }
-    if (config.static_mode) {
-        printf("Static analysis mode enabled (implies strace for now).\n");
+    if (config.elf_only) {
+        printf("ELF startup analysis mode enabled (the target is not executed).\n");
+    } else if (config.static_mode) {
+        printf("Static analysis mode enabled (ELF startup analysis, then strace).\n");
+    }
+    if (config.alloc_mode) {
+        printf("Allocation profile mode enabled.\n");
+        config.ltrace_mode = 1; // Allocations come from ltrace -ttt
     }
     if (config.ltrace_mode) {
         printf("Ltrace mode enabled.\n");
     }
     if (config.valgrind_mode) {
-        printf("Valgrind (Memcheck) mode enabled.\n");
+        printf("Valgrind (%s) mode enabled.\n", config.grind_tool != NULL ? config.grind_tool : "Memcheck");
+    }
+    if (config.stream_mode) {
+        printf("Stream mode enabled (live summary every %ds, raw logs %s).\n",
+               config.interval_seconds, config.save_log ? "saved" : "not saved");
+    }
+    if (config.latency_mode) {
+        printf("Latency mode enabled.\n");
+        if (!config.native_mode && !config.static_mode) {
+            config.static_mode = 1; // Durations come from strace -T
+        }
+    }
+    if (config.futex_mode) {
+        printf("Futex contention mode enabled.\n");
+        if (!config.native_mode && !config.static_mode) {
+            config.static_mode = 1; // Futex waits come from strace -f -ttt -T
+        }
+    }
+    if (config.io_mode) {
+        printf("I/O pattern mode enabled.\n");
+        if (!config.native_mode && !config.static_mode) {
+            config.static_mode = 1; // Descriptors and sizes come from strace
+        }
+    }
+    if (config.mmap_mode) {
+        printf("Address space churn mode enabled.\n");
+        if (!config.native_mode && !config.static_mode) {
+            config.static_mode = 1; // Mappings come from strace -f -ttt
+        }
+    }
+    if (config.chrome_path) {
+        printf("Chrome trace export enabled (%s).\n", config.chrome_path);
+        if (config.stream_mode || config.analyze_rtrace_path || config.bench_runs > 0 || config.sweep_path ||
+            config.startup_runs > 0) {
+            fprintf(stderr, "runescope: Error: --chrome exports strace/ltrace logs or native traces and cannot be combined with --stream, --analyze-rtrace, --bench, --sweep or --startup.\n");
+            return 1;
+        }
+        if (!config.native_mode && !config.static_mode && !config.ltrace_mode && !config.analyze_strace_path &&
+            !config.analyze_ltrace_path) {
+            config.static_mode = 1; // Syscall events come from strace -ttt -T
+        }
+    }
+    if (config.counters_mode) {
+        printf("Performance counter mode enabled%s.\n",
+               config.static_mode || config.ltrace_mode || config.valgrind_mode ? " (counts include the first tracing tool)" : "");
+    }
+    if (config.native_mode) {
+        printf("Native tracer mode enabled (tracing %s).\n", config.trace_spec ? config.trace_spec : "all syscalls");
+        if (config.ltrace_mode || config.valgrind_mode || config.counters_mode) {
+            fprintf(stderr, "runescope: Error: The native tracer cannot be combined with -l, -m or --counters.\n");
+            return 1;
+        }
+    }
+
+    if (config.bench_runs > 0) {
+        printf("Benchmark mode enabled (%d runs after %d warmup).\n", config.bench_runs, config.warmup_runs);
+        if (config.static_mode || config.ltrace_mode || config.valgrind_mode || config.native_mode ||
+            config.stream_mode || config.counters_mode) {
+            fprintf(stderr, "runescope: Error: --bench runs the target untraced and cannot be combined with tracing or --counters.\n");
+            return 1;
+        }
+    }
+
+    if (config.startup_runs > 0) {
+        printf("Startup timeline mode enabled (%d runs).\n", config.startup_runs);
+        if (config.static_mode || config.ltrace_mode || config.valgrind_mode || config.native_mode ||
+            config.stream_mode || config.counters_mode || config.bench_runs > 0) {
+            fprintf(stderr, "runescope: Error: --startup traces the target itself and cannot be combined with other tracing, --counters or --bench.\n");
+            return 1;
+        }
+    }
+
+    if (config.profile_hz != 0) {
+        printf("Sampling profiler mode enabled (%d Hz).\n", config.profile_hz);
+        if (config.profile_hz < 0 || config.profile_hz > MAX_PROFILE_HZ) {
+            fprintf(stderr, "runescope: Error: --profile takes a frequency from 1 to %d Hz.\n", MAX_PROFILE_HZ);
+            return 1;
+        }
+        if (config.static_mode || config.ltrace_mode || config.valgrind_mode || config.native_mode ||
+            config.stream_mode || config.counters_mode || config.bench_runs > 0 || config.startup_runs > 0 ||
+            config.sweep_path) {
+            fprintf(stderr, "runescope: Error: --profile traces the target itself and cannot be combined with other tracing, --chrome, --counters, --bench, --startup or --sweep.\n");
+            return 1;
+        }
+    } else if (config.profile_output) {
+        fprintf(stderr, "runescope: Error: --profile-output needs --profile.\n");
+        return 1;
+    }
+
+    if (config.sample_ms != 0) {
+        printf("Process sampler mode enabled (every %dms).\n", config.sample_ms);
+        if (config.sample_ms < 0 || config.sample_ms > MAX_SAMPLE_MS) {
+            fprintf(stderr, "runescope: Error: --sample takes an interval from 1 to %d ms.\n", MAX_SAMPLE_MS);
+            return 1;
+        }
+        if (config.native_mode || config.bench_runs > 0 || config.startup_runs > 0 || config.profile_hz > 0 ||
+            config.sweep_path || config.elf_only || config.analyze_strace_path || config.analyze_ltrace_path ||
+            config.analyze_rtrace_path || config.analyze_grind_path) {
+            fprintf(stderr, "runescope: Error: --sample watches a run of the target and cannot be combined with -n, --bench, --startup, --profile, --sweep, --elf or --analyze-*.\n");
+            return 1;
+        }
+    }
+
+    if (config.preload_mode) {
+        printf("Preload mode enabled.\n");
+        if (config.static_mode || config.ltrace_mode || config.valgrind_mode || config.native_mode ||
+            config.stream_mode || config.chrome_path || config.bench_runs > 0 || config.sweep_path ||
+            config.startup_runs > 0 || config.profile_hz > 0 || config.save_baseline_path || config.compare_path ||
+            config.analyze_strace_path || config.analyze_ltrace_path || config.analyze_rtrace_path) {
+            fprintf(stderr, "runescope: Error: --preload runs the target without tracing tools and cannot be combined with -s, -l, -m, -n, --alloc, --stream, --chrome, --bench, --sweep, --startup, --profile, --save-baseline, --compare or --analyze-*.\n");
+            return 1;
+        }
+    }
+
+    int64_t pipe_sizes[MAX_PIPE_SIZES];
+    size_t num_pipe_sizes = 0;
+    if (config.pipe_mode) {
+        printf("Pipe throughput mode enabled (%s input%s).\n", config.pipe_input ? config.pipe_input : "generated",
+               config.pipe_sweep ? ", sweeping input sizes" : "");
+        if (config.static_mode || config.ltrace_mode || config.valgrind_mode || config.native_mode ||
+            config.stream_mode || config.counters_mode || config.chrome_path || config.bench_runs > 0 ||
+            config.sweep_path || config.startup_runs > 0 || config.profile_hz > 0 || config.sample_ms > 0 ||
+            config.preload_mode || config.save_baseline_path || config.compare_path || config.elf_only ||
+            config.analyze_strace_path || config.analyze_ltrace_path || config.analyze_rtrace_path ||
+            config.analyze_grind_path) {
+            fprintf(stderr, "runescope: Error: --pipe runs the target untraced and cannot be combined with tracing, --counters, --chrome, --bench, --sweep, --startup, --profile, --sample, --preload, --save-baseline, --compare, --elf or --analyze-*.\n");
+            return 1;
+        }
+        if (config.pipe_size && config.pipe_sweep) {
+            fprintf(stderr, "runescope: Error: --pipe=SIZE and --pipe-sweep cannot be combined.\n");
+            return 1;
+        }
+        if (config.pipe_rate < 0.0) {
+            fprintf(stderr, "runescope: Error: --pipe-rate takes a rate in MB a second.\n");
+            return 1;
+        }
+        if (config.pipe_sweep) {
+            char sweep[256]; // strtok writes into it, and the default is a string literal
+            snprintf(sweep, sizeof(sweep), "%s", config.pipe_sweep);
+            for (char *size = strtok(sweep, ","); size != NULL; size = strtok(NULL, ",")) {
+                int64_t bytes = rune_pipe_parse_size(size);
+                if (bytes <= 0 || num_pipe_sizes == MAX_PIPE_SIZES) {
+                    fprintf(stderr, "runescope: Error: --pipe-sweep takes up to %d sizes such as 1M,16M,256M.\n", MAX_PIPE_SIZES);
+                    return 1;
+                }
+                pipe_sizes[num_pipe_sizes++] = bytes;
+            }
+        } else if (config.pipe_size) {
+            pipe_sizes[0] = rune_pipe_parse_size(config.pipe_size);
+            if (pipe_sizes[0] <= 0) {
+                fprintf(stderr, "runescope: Error: --pipe takes a size such as 64M or 1G.\n");
+                return 1;
+            }
+            num_pipe_sizes = 1;
+        } else {
+            pipe_sizes[num_pipe_sizes++] = config.pipe_input ? 0 : DEFAULT_PIPE_SIZE; // 0 feeds the file once
+        }
+    }
+
+    int use_baseline = config.save_baseline_path != NULL || config.compare_path != NULL;
+    if (use_baseline) {
+        printf("Baseline mode enabled (%s%s%s).\n", config.save_baseline_path ? "saving to " : "",
+               config.save_baseline_path ? config.save_baseline_path : "",
+               config.compare_path ? (config.save_baseline_path ? ", comparing" : "comparing") : "");
+        if (config.stream_mode || config.convert_only || config.bench_runs > 0 || config.sweep_path ||
+            config.startup_runs > 0 || config.profile_hz > 0 || config.elf_only) {
+            fprintf(stderr, "runescope: Error: --save-baseline and --compare need a traced run or --analyze-* and cannot be combined with --stream, --convert, --bench, --sweep, --startup, --profile or --elf.\n");
+            return 1;
+        }
+        if (!config.native_mode && !config.static_mode && !config.ltrace_mode && !config.analyze_strace_path &&
+            !config.analyze_ltrace_path && !config.analyze_rtrace_path) {
+            config.static_mode = 1; // Syscall counts and times come from strace -T
+        }
+    } else if (config.num_thresholds > 0) {
+        fprintf(stderr, "runescope: Error: --threshold needs --compare.\n");
+        return 1;
+    }
+
+    if (config.sweep_path) {
+        printf("Sweep mode enabled (configurations from %s).\n", config.sweep_path);
+        if (config.stream_mode || config.counters_mode || config.bench_runs > 0) {
+            fprintf(stderr, "runescope: Error: --sweep cannot be combined with --stream, --counters or --bench.\n");
+            return 1;
+        }
+        if (config.grind_tool != NULL) {
+            // The sweep reads leaked bytes from memcheck logs and has no use for a profile
+            fprintf(stderr, "runescope: Error: --sweep runs valgrind as memcheck (-m) and cannot be combined with --%s.\n",
+                    config.grind_tool);
+            return 1;
+        }
+    }
+
+    rune_analyzer_options_t analyzer_options = {0};
+    analyzer_options.verbose = config.verbose_mode;
+    analyzer_options.num_threads = config.num_jobs;
+    analyzer_options.convert_only = config.convert_only;
+    analyzer_options.window.from_ns = (int64_t)(config.from_seconds * 1e9);
+    analyzer_options.window.to_ns = (int64_t)(config.to_seconds * 1e9);
+    analyzer_options.window.pid = config.window_pid;
+    analyzer_options.latency = config.latency_mode;
+    analyzer_options.futex = config.futex_mode;
+    analyzer_options.io = config.io_mode;
+    analyzer_options.mmap = config.mmap_mode;
+    analyzer_options.alloc = config.alloc_mode;
+    rune_baseline_t baseline;
+    if (use_baseline && rune_baseline_init(&baseline) == -1) {
+        return 1;
+    }
+    analyzer_options.baseline = use_baseline ? &baseline : NULL;
+
+    if (config.analyze_strace_path || config.analyze_ltrace_path || config.analyze_rtrace_path ||
+        config.analyze_grind_path) {
+        // Analyze captures from an earlier run; no target is executed
+        int result = 0;
+        if (config.analyze_grind_path && rune_grind_report(config.analyze_grind_path, stdout, TOP_GRIND_ENTRIES) == -1) {
+            result = 1;
+        }
+        if (config.analyze_strace_path && analyze_log(config.analyze_strace_path, 1, &config, &analyzer_options) == -1) {
+            result = 1;
+        }
+        if (config.analyze_ltrace_path && analyze_log(config.analyze_ltrace_path, 0, &config, &analyzer_options) == -1) {
+            result = 1;
+        }
+        if (config.analyze_rtrace_path && rune_analyzer_analyze_rtrace(config.analyze_rtrace_path, &analyzer_options) == -1) {
+            result = 1;
+        }
+        if (config.chrome_path && (config.analyze_strace_path || config.analyze_ltrace_path) &&
+            export_chrome(config.chrome_path, config.analyze_strace_path, config.analyze_ltrace_path) == -1) {
+            result = 1;
+        }
+        if (use_baseline) {
+            int status = finish_baseline(&config, &baseline, NULL);
+            result = status != 0 ? status : result;
+        }
+        return result;
+    }
+
+    if (config.target_executable && config.elf_only) {
+        char *resolved_executable_path = rune_path_finder_find_executable(config.target_executable);
+        if (resolved_executable_path == NULL) {
+            fprintf(stderr, "runescope: Error: Target executable '%s' not found or not executable.\n", config.target_executable);
+            return 1;
+        }
+        int result = rune_elf_report(resolved_executable_path, stdout) == -1;
+        free(resolved_executable_path);
+        return result;
+    }
+
+    if (config.target_executable && config.startup_runs > 0) {
+        char *resolved_executable_path = rune_path_finder_find_executable(config.target_executable);
+        if (resolved_executable_path == NULL) {
+            fprintf(stderr, "runescope: Error: Target executable '%s' not found or not executable.\n", config.target_executable);
+            return 1;
+        }
+        config.target_args[0] = resolved_executable_path;
+        int result = rune_startup_report(resolved_executable_path, config.target_args, config.startup_runs, stdout) == -1;
+        free(resolved_executable_path);
+        return result;
+    }
+
+    if (config.target_executable && config.profile_hz > 0) {
+        char *resolved_executable_path = rune_path_finder_find_executable(config.target_executable);
+        if (resolved_executable_path == NULL) {
+            fprintf(stderr, "runescope: Error: Target executable '%s' not found or not executable.\n", config.target_executable);
+            return 1;
+        }
+        config.target_args[0] = resolved_executable_path;
+        rune_profile_options_t profile_options = { config.profile_hz,
+                                                   config.profile_output ? config.profile_output : "runescope_profile.folded" };
+        int exit_status = rune_profile_run(resolved_executable_path, config.target_args, &profile_options, stdout);
+        if (exit_status != -1) {
+            printf("Target program exited with status: %d\n", exit_status);
+        } else {
+            fprintf(stderr, "runescope: Error executing target program.\n");
+        }
+        free(resolved_executable_path);
+        return exit_status == -1;
+    }
+
+    if (config.target_executable && config.sweep_path) {
+        char *resolved_executable_path = rune_path_finder_find_executable(config.target_executable);
+        if (resolved_executable_path == NULL) {
+            fprintf(stderr, "runescope: Error: Target executable '%s' not found or not executable.\n", config.target_executable);
+            return 1;
+        }
+        rune_sweep_options_t sweep_options = {0};
+        sweep_options.max_jobs = config.sweep_jobs;
+        sweep_options.timeout_seconds = config.timeout_seconds;
+        sweep_options.pin = config.sweep_pin;
+        sweep_options.use_native = config.native_mode;
+        sweep_options.trace_spec = config.trace_spec;
+        sweep_options.use_strace = config.static_mode && !config.native_mode;
+        sweep_options.use_ltrace = config.ltrace_mode;
+        sweep_options.use_valgrind = config.valgrind_mode;
+        int result = rune_sweep_run(resolved_executable_path, config.target_args, config.sweep_path, &sweep_options,
+                                    stdout) == -1;
+        free(resolved_executable_path);
+        return result;
+    }
+
+    if (config.target_executable && config.pipe_mode) {
+        char *resolved_executable_path = rune_path_finder_find_executable(config.target_executable);
+        if (resolved_executable_path == NULL) {
+            fprintf(stderr, "runescope: Error: Target executable '%s' not found or not executable.\n", config.target_executable);
+            return 1;
+        }
+        config.target_args[0] = resolved_executable_path;
+        rune_pipe_options_t pipe_options = { config.pipe_input, config.pipe_rate, pipe_sizes, num_pipe_sizes };
+        int result = rune_pipe_run(resolved_executable_path, config.target_args, &pipe_options, stdout) == -1;
+        free(resolved_executable_path);
+        return result;
+    }
+
+    if (config.target_executable && config.bench_runs > 0) {
+        // "A args... --vs B args..." compares two commands
+        rune_bench_command_t commands[2];
+        size_t num_commands = 1;
+        for (int j = 1; j < config.target_argc; j++) {
+            if (strcmp(config.target_args[j], "--vs") == 0) {
+                config.target_args[j] = NULL; // Terminates A's arguments
+                num_commands = 2;
+                commands[1].argv = &config.target_args[j + 1];
+                break;
+            }
+        }
+        if (num_commands == 2 && commands[1].argv[0] == NULL) {
+            fprintf(stderr, "runescope: Error: --vs must be followed by a second command.\n");
+            return 1;
+        }
+        commands[0].argv = config.target_args;
+        char *resolved[2] = { NULL, NULL };
+        int result = 0;
+        for (size_t c = 0; c < num_commands; c++) {
+            resolved[c] = rune_path_finder_find_executable(commands[c].argv[0]);
+            if (resolved[c] == NULL) {
+                fprintf(stderr, "runescope: Error: Target executable '%s' not found or not executable.\n", commands[c].argv[0]);
+                result = 1;
+                break;
+            }
+            commands[c].executable_path = resolved[c];
+        }
+        rune_bench_options_t bench_options = { config.bench_runs, config.warmup_runs, config.pin_cpu, config.show_output };
+        if (result == 0 && rune_bench_run(commands, num_commands, &bench_options, stdout) == -1) {
+            fprintf(stderr, "runescope: Error executing target program.\n");
+            result = 1;
+        }
+        free(resolved[0]);
+        free(resolved[1]);
+        return result;
     }
 
     if (config.target_executable) {
@@ -72,40 +747,191 @@ int main(int argc, char *argv[]) {
         for (int j = 0; j < config.target_argc; j++) {
             printf("  argv_target[%d]: %s\n", j, config.target_args[j]);
         }
+        if (config.elf_mode) {
+            rune_elf_report(resolved_executable_path, stdout);
+        }
 
         // Execute the target program, potentially with strace, ltrace, or valgrind
         printf("\nExecuting target program...\n");
         const char *strace_output_file = "runescope_strace.log";
         const char *ltrace_output_file = "runescope_ltrace.log";
         const char *valgrind_output_file = "runescope_valgrind.log";
+        char grind_output_file[64];
+        snprintf(grind_output_file, sizeof(grind_output_file), "runescope_%s.out",
+                 config.grind_tool != NULL ? config.grind_tool : "memcheck");
+
+        if (config.native_mode) {
+            // Syscalls are delivered as entries as they complete, no log file involved
+            printf("\n--- Analyzing Native Trace ---\n");
+            rune_store_t store;
+            int use_store = (config.latency_mode || config.futex_mode || config.io_mode || config.mmap_mode ||
+                             use_baseline) &&
+                            rune_store_init(&store) == 0;
+            rune_chrome_writer_t chrome;
+            native_sink_t sink = { use_store ? rune_store_add_strace_entry : rune_strace_parser_print_entry,
+                                   use_store ? &store : NULL, &chrome };
+            int use_chrome = config.chrome_path && rune_chrome_open(&chrome, config.chrome_path) == 0;
+            int exit_status = rune_tracer_run(resolved_executable_path, config.target_args, config.trace_spec,
+                                              use_chrome ? native_sink_entry : sink.on_entry,
+                                              use_chrome ? (void *)&sink : sink.user_data);
+            if (exit_status != -1) {
+                printf("Target program exited with status: %d\n", exit_status);
+            } else {
+                fprintf(stderr, "runescope: Error executing target program.\n");
+            }
+            if (use_chrome) {
+                finish_chrome(&chrome, config.chrome_path);
+            }
+            if (use_store) {
+                rune_analyzer_report(&store, 1, &analyzer_options);
+                rune_store_free(&store);
+            }
+            int status = use_baseline && exit_status != -1 ? finish_baseline(&config, &baseline, resolved_executable_path) : 0;
+            free(resolved_executable_path);
+            return status;
+        }
+
+        // In stream mode the tools write into FIFOs that are parsed while the target runs
+        rune_stream_t *strace_stream = NULL;
+        rune_stream_t *ltrace_stream = NULL;
+        const char *strace_target = strace_output_file;
+        const char *ltrace_target = ltrace_output_file;
+        if (config.stream_mode && config.static_mode) {
+            strace_stream = rune_stream_start(RUNE_STREAM_STRACE, config.save_log ? strace_output_file : NULL,
+                                              config.interval_seconds);
+            if (strace_stream == NULL) {
+                free(resolved_executable_path);
+                return 1;
+            }
+            strace_target = rune_stream_fifo_path(strace_stream);
+        }
+        if (config.stream_mode && config.ltrace_mode) {
+            ltrace_stream = rune_stream_start(RUNE_STREAM_LTRACE, config.save_log ? ltrace_output_file : NULL,
+                                              config.interval_seconds);
+            if (ltrace_stream == NULL) {
+                if (strace_stream != NULL) {
+                    rune_stream_finish(strace_stream);
+                }
+                free(resolved_executable_path);
+                return 1;
+            }
+            ltrace_target = rune_stream_fifo_path(ltrace_stream);
+        }
+
+        char *preload_library = NULL;
+        rune_preload_t *preload = NULL;
+        if (config.preload_mode) {
+            preload_library = rune_preload_find_library();
+            if (preload_library == NULL) {
+                fprintf(stderr, "runescope: Error: librunescope_preload.so not found next to runescope; build it with make or set RUNESCOPE_PRELOAD_LIB.\n");
+                free(resolved_executable_path);
+                return 1;
+            }
+            preload = rune_preload_start();
+            if (preload == NULL) {
+                free(preload_library);
+                free(resolved_executable_path);
+                return 1;
+            }
+        }
 
+        rune_counters_t counters;
+        rune_sampler_t sampler;
+        if (config.sample_ms > 0) {
+            rune_sampler_init(&sampler, config.sample_ms);
+        }
+        rune_exec_jobs_t jobs = {0};
+        rune_exec_options_t exec_options = { config.latency_mode || config.futex_mode || config.mmap_mode ||
+                                                 config.chrome_path != NULL || use_baseline,
+                                             config.alloc_mode || config.chrome_path != NULL,
+                                             config.counters_mode ? &counters : NULL, config.tool_jobs, &jobs,
+                                             config.grind_tool, grind_output_file,
+                                             config.sample_ms > 0 ? &sampler : NULL, preload_library,
+                                             preload != NULL ? rune_preload_region_path(preload) : NULL };
         int exit_status = rune_exec_run_target(
             resolved_executable_path, 
             config.target_args, 
-            config.static_mode, strace_output_file, 
-            config.ltrace_mode, ltrace_output_file, 
-            config.valgrind_mode, valgrind_output_file
+            config.static_mode, strace_target, 
+            config.ltrace_mode, ltrace_target, 
+            config.valgrind_mode, valgrind_output_file,
+            &exec_options
         );
+
+        // The tools have exited, so the streams can be drained and summarized
+        if (strace_stream != NULL) {
+            rune_stream_finish(strace_stream);
+        }
+        if (ltrace_stream != NULL) {
+            rune_stream_finish(ltrace_stream);
+        }
+        if (preload != NULL) {
+            rune_preload_finish(preload);
+            free(preload_library);
+        }
+
         if (exit_status != -1) {
             printf("Target program exited with status: %d\n", exit_status);
-            if (config.static_mode) {
+            if (jobs.count > 1) {
+                print_jobs(&jobs);
+            }
+            if (config.counters_mode) {
+                rune_counters_print(&counters, stdout);
+            }
+            if (config.sample_ms > 0) {
+                rune_sampler_print(&sampler, stdout);
+            }
+            if (config.stream_mode) {
+                if (config.save_log && config.static_mode) {
+                    printf("Strace output written to: %s\n", strace_output_file);
+                }
+                if (config.save_log && config.ltrace_mode) {
+                    printf("Ltrace output written to: %s\n", ltrace_output_file);
+                }
+            } else if (config.static_mode) {
                 printf("Strace output written to: %s\n", strace_output_file);
-                rune_analyzer_analyze_strace(strace_output_file);
+                analyze_log(strace_output_file, 1, &config, &analyzer_options);
             }
-            if (config.ltrace_mode) {
+            if (!config.stream_mode && config.ltrace_mode) {
                 printf("Ltrace output written to: %s\n", ltrace_output_file);
-                rune_analyzer_analyze_ltrace(ltrace_output_file);
+                analyze_log(ltrace_output_file, 0, &config, &analyzer_options);
             }
             if (config.valgrind_mode) {
                 printf("Valgrind output written to: %s\n", valgrind_output_file);
+                if (config.grind_tool != NULL) {
+                    printf("Profile written to: %s\n", grind_output_file);
+                    rune_grind_report(grind_output_file, stdout, TOP_GRIND_ENTRIES);
+                }
                 // TODO: Add code here to read and parse the valgrind_output_file
             }
+            if (config.chrome_path && !config.stream_mode) {
+                export_chrome(config.chrome_path, config.static_mode ? strace_output_file : NULL,
+                              config.ltrace_mode ? ltrace_output_file : NULL);
+            }
+            if (use_baseline) {
+                int status = finish_baseline(&config, &baseline, resolved_executable_path);
+                if (config.sample_ms > 0) {
+                    rune_sampler_free(&sampler);
+                }
+                free(resolved_executable_path);
+                return status;
+            }
         } else {
             fprintf(stderr, "runescope: Error executing target program.\n");
         }
+        if (config.sample_ms > 0) {
+            rune_sampler_free(&sampler);
+        }
         free(resolved_executable_path); // Free the dynamically allocated path
     } else {
-        printf("Usage: %s [-v|--verbose] [-s|--static] [-l|--ltrace] [-m|--memcheck] <executable> [executable_options...]\n", argv[0]);
+        printf("Usage: %s [-v|--verbose] [-s|--static] [-l|--ltrace] [-p|--preload] [-m|--memcheck] [--cachegrind|--callgrind] [-n|--native] [--trace=SET] [--stream [--save-log] [--interval=SECONDS]] [-j N|--jobs=N] [--tool-jobs=N] [--save-binary] [--latency] [--futex] [--io] [--mmap] [--alloc] [--counters] [--sample[=MS]] [--chrome=FILE] [--save-baseline=FILE] [--compare=FILE [--threshold=[PREFIX=]PERCENT]...] [--baseline-runs=N] <executable> [executable_options...]\n", argv[0]);
+        printf("       %s --elf <executable>\n", argv[0]);
+        printf("       %s --startup[=RUNS] <executable> [executable_options...]\n", argv[0]);
+        printf("       %s --profile[=HZ] [--profile-output=FILE] <executable> [executable_options...]\n", argv[0]);
+        printf("       %s --sweep=SPEC [--sweep-jobs=N] [--timeout=SECONDS] [--sweep-pin] [-n|-s] [-l] [-m] <executable> [executable_options...]\n", argv[0]);
+        printf("       %s --pipe[=SIZE]|--pipe-sweep[=SIZE,...] [--pipe-input=FILE] [--pipe-rate=MB] <executable> [executable_options...]\n", argv[0]);
+        printf("       %s --bench N [--warmup=N] [--pin=CPU] [--show-output] <executable> [executable_options...] [--vs <executable> [executable_options...]]\n", argv[0]);
+        printf("       %s [-v] [-j N|--jobs=N] [--analyze-strace=LOG] [--analyze-ltrace=LOG] [--analyze-cachegrind=FILE|--analyze-callgrind=FILE] [--save-binary|--convert] [--latency] [--futex] [--io] [--mmap] [--alloc] [--chrome=FILE] [--save-baseline=FILE] [--compare=FILE [--threshold=[PREFIX=]PERCENT]...]\n", argv[0]);
+        printf("       %s [-v] --analyze-rtrace=FILE [--from=SECONDS] [--to=SECONDS] [--pid=PID] [--latency] [--futex] [--io] [--mmap] [--alloc]\n", argv[0]);
         printf("Example: %s -v -s -l -m /bin/ls -l -a\n", argv[0]);
     }
 